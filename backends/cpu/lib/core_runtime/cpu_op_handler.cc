@@ -16,6 +16,8 @@
 
 #include "tfrt/cpu/core_runtime/cpu_op_handler.h"
 
+#include <atomic>
+
 #include "cpu_op_registry_impl.h"
 #include "llvm/Support/Compiler.h"
 #include "tfrt/core_runtime/core_runtime.h"
@@ -41,6 +43,28 @@ namespace tfrt {
 
 namespace {
 
+// A tensor type that is registered by another library and looked up by name.
+// The lookup locks the tensor type registry, which is on the path of every
+// eager op, so a registered type is only looked up once. An unregistered type
+// is not cached, as the library may register it later.
+class RegisteredTensorType {
+ public:
+  explicit RegisteredTensorType(string_view name) : name_(name) {}
+
+  TensorType Get() {
+    TensorType type = type_.load(std::memory_order_relaxed);
+    if (type != TensorType::kUnknownTensorType) return type;
+    type = GetStaticTensorType(name_);
+    if (type != TensorType::kUnknownTensorType)
+      type_.store(type, std::memory_order_relaxed);
+    return type;
+  }
+
+ private:
+  string_view name_;
+  std::atomic<TensorType> type_{TensorType::kUnknownTensorType};
+};
+
 // If the specified tensor needs conversion to be compatible with CpuOpEntry,
 // then return the target tensor type. Otherwise, return the original tensor
 // type.
@@ -67,15 +91,17 @@ TensorType ArgumentTensorType(const Tensor& t, const CpuOpFlags& flags) {
 
   // Note: TFLite tensors are deprecated and this path will be removed.
   if (flags & CpuOpFlags::AllowsTfLite) {
-    auto type = t.dtype() == DType::String
-                    ? GetStaticTensorType("TFLiteStringHost")
-                    : GetStaticTensorType("TFLiteHost");
+    static RegisteredTensorType tflite_string_type("TFLiteStringHost");
+    static RegisteredTensorType tflite_type("TFLiteHost");
+    auto type = t.dtype() == DType::String ? tflite_string_type.Get()
+                                           : tflite_type.Get();
     if (t.IsTensorType(type)) return type;
     if (result == DenseHostTensor::kTensorType) result = type;
   }
 
   if (flags & CpuOpFlags::AllowsTfRuntimeFallback) {
-    auto type = GetStaticTensorType("RuntimeFallback");
+    static RegisteredTensorType fallback_type("RuntimeFallback");
+    auto type = fallback_type.Get();
     if (t.IsTensorType(type)) return type;
     if (result == DenseHostTensor::kTensorType) result = type;
   }
@@ -38,7 +38,7 @@ static AsyncValueRef<DenseHostTensor> DecodeJpeg(
 
   EnqueueWork(exec_ctx, [data = data.ValueRef(), output = output.CopyRef(),
                          exec_ctx] {
-    TFRT_TRACE_SCOPE(Default, "DecodeJpeg");
+    TFRT_TRACE_STATIC_SCOPE(Default, "DecodeJpeg");
     if (!llvm::StringRef(data.get()).starts_with("\xff\xd8\xff")) {
       auto diag = EmitError(exec_ctx, "image does not have jpeg format");
       output.SetError(diag.status);
@@ -81,7 +81,7 @@ static AsyncValueRef<DenseHostTensor> ResizeBilinear(
   return EnqueueWork(
       exec_ctx,
       [input = input.ValueRef(), height, width, exec_ctx]() -> ReturnTy {
-        TFRT_TRACE_SCOPE(Default, "ResizeBilinear");
+        TFRT_TRACE_STATIC_SCOPE(Default, "ResizeBilinear");
         const TensorShape& shape = input->shape();
         if (shape.GetRank() != 3) {
           auto diag = EmitError(exec_ctx, "input tensor shape must be 3");
@@ -0,0 +1,173 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmark measuring the per-call overhead of executing BEF functions.
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/bef/bef_buffer.h"
+#include "tfrt/bef_converter/mlir_src_to_bef.h"
+#include "tfrt/bef_executor/bef_file.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/kernel_registry.h"
+#include "tfrt/support/string_util.h"
+
+namespace tfrt {
+namespace {
+
+// Returns the MLIR source of a function with `num_kernels` chained adds.
+std::string GetChainedAddFunction(int num_kernels) {
+  std::string mlir_src = "func.func @main(%a0: i32) -> i32 {\n";
+  for (int i = 1; i <= num_kernels; ++i) {
+    mlir_src += StrCat("  %a", i, " = tfrt.add.i32 %a", i - 1, ", %a", i - 1,
+                       "\n");
+  }
+  mlir_src += StrCat("  tfrt.return %a", num_kernels, " : i32\n}\n");
+  return mlir_src;
+}
+
+// Returns the MLIR source of a function with `num_kernels` independent adds
+// that all use the function argument. The cost threshold puts every add in its
+// own stream, so that they are launched as outline kernels.
+std::string GetFanOutAddFunction(int num_kernels) {
+  std::string result_types;
+  std::string results;
+  for (int i = 1; i <= num_kernels; ++i) {
+    if (i > 1) {
+      result_types += ", ";
+      results += ", ";
+    }
+    result_types += "i32";
+    results += StrCat("%a", i);
+  }
+
+  std::string mlir_src =
+      StrCat("func.func @main(%a0: i32) -> (", result_types,
+             ") attributes {tfrt.cost_threshold = 1 : i64} {\n");
+  for (int i = 1; i <= num_kernels; ++i) {
+    mlir_src += StrCat("  %a", i, " = tfrt.add.i32 %a0, %a0\n");
+  }
+  mlir_src += StrCat("  tfrt.return ", results, " : ", result_types, "\n}\n");
+  return mlir_src;
+}
+
+class BEFExecutorBenchmark {
+ public:
+  explicit BEFExecutorBenchmark(int num_kernels)
+      : BEFExecutorBenchmark(GetChainedAddFunction(num_kernels),
+                             /*num_results=*/1, CreateHostContext()) {}
+
+  BEFExecutorBenchmark(string_view mlir_src, int num_results,
+                       std::unique_ptr<HostContext> host)
+      : host_(std::move(host)),
+        bef_buffer_(ConvertMLIRSrcToBEF(mlir_src,
+                                        /*disable_optional_sections=*/true)),
+        exec_ctx_(*RequestContextBuilder(host_.get(),
+                                         /*resource_context=*/nullptr)
+                       .build()),
+        argument_(MakeAvailableAsyncValueRef<int32_t>(1)),
+        num_results_(num_results) {
+    RegisterStaticKernels(host_->GetMutableRegistry());
+  }
+
+  RCReference<BEFFile> OpenBEFFile() {
+    return BEFFile::Open(bef_buffer_, host_->GetKernelRegistry(),
+                         host_->diag_handler(), host_->allocator());
+  }
+
+  void Execute(const Function* function) {
+    AsyncValue* arguments[] = {argument_.GetAsyncValue()};
+    llvm::SmallVector<RCReference<AsyncValue>, 4> results(num_results_);
+    function->Execute(exec_ctx_, arguments, results);
+    host_->Await(results);
+  }
+
+ private:
+  std::unique_ptr<HostContext> host_;
+  BefBuffer bef_buffer_;
+  ExecutionContext exec_ctx_;
+  AsyncValueRef<int32_t> argument_;
+  int num_results_;
+};
+
+// Steady state executions that reuse the function template decoded and cached
+// on the BEFFunction by the first execution.
+static void BM_ExecuteCachedFunction(benchmark::State& state) {
+  BEFExecutorBenchmark bench(state.range(0));
+  auto bef_file = bench.OpenBEFFile();
+  const Function* function = bef_file->GetFunction("main");
+  ASSERT_NE(function, nullptr);
+
+  for (auto _ : state) {
+    bench.Execute(function);
+  }
+}
+BENCHMARK(BM_ExecuteCachedFunction)->Arg(1)->Arg(16)->Arg(128);
+
+// Executions of freshly loaded functions that have to decode the kernel and
+// register tables from the BEF file before running, i.e. the per-call cost
+// without the function template cache. Loading the BEF file is not timed.
+static void BM_ExecuteUncachedFunction(benchmark::State& state) {
+  BEFExecutorBenchmark bench(state.range(0));
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto bef_file = bench.OpenBEFFile();
+    const Function* function = bef_file->GetFunction("main");
+    state.ResumeTiming();
+
+    bench.Execute(function);
+
+    state.PauseTiming();
+    bef_file.reset();
+    state.ResumeTiming();
+  }
+}
+BENCHMARK(BM_ExecuteUncachedFunction)->Arg(1)->Arg(16)->Arg(128);
+
+// Executions of a function whose pseudo kernel makes many outline kernels ready
+// at once, which measures the cost of launching them to a multi-threaded work
+// queue.
+static void BM_ExecuteFanOutFunction(benchmark::State& state) {
+  auto host = std::make_unique<HostContext>(
+      [](const DecodedDiagnostic& diag) { abort(); }, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(/*num_threads=*/4,
+                                   /*num_blocking_threads=*/4));
+  BEFExecutorBenchmark bench(GetFanOutAddFunction(state.range(0)),
+                             state.range(0), std::move(host));
+  auto bef_file = bench.OpenBEFFile();
+  const Function* function = bef_file->GetFunction("main");
+  ASSERT_NE(function, nullptr);
+
+  for (auto _ : state) {
+    bench.Execute(function);
+  }
+}
+BENCHMARK(BM_ExecuteFanOutFunction)->Arg(4)->Arg(32)->Arg(128);
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,101 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests for BEFFile::OpenMapped.
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/bef/bef_buffer.h"
+#include "tfrt/bef_converter/mlir_src_to_bef.h"
+#include "tfrt/bef_executor/bef_file.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/kernel_registry.h"
+
+namespace tfrt {
+namespace {
+
+constexpr char kMLIRSrc[] = R"mlir(func.func @main(%a0: i32) -> i32 {
+  %a1 = tfrt.add.i32 %a0, %a0
+  tfrt.return %a1 : i32
+}
+)mlir";
+
+class BEFFileMappedTest : public ::testing::TestWithParam<bool> {
+ protected:
+  void SetUp() override {
+    ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("bef_file_mapped_test",
+                                                    "bef", path_));
+    BefBuffer bef_buffer =
+        ConvertMLIRSrcToBEF(kMLIRSrc, /*disable_optional_sections=*/true);
+    std::error_code error_code;
+    llvm::raw_fd_ostream os(path_, error_code);
+    ASSERT_FALSE(error_code);
+    os.write(reinterpret_cast<const char*>(bef_buffer.data()),
+             bef_buffer.size());
+  }
+
+  void TearDown() override { llvm::sys::fs::remove(path_); }
+
+  llvm::SmallString<128> path_;
+};
+
+TEST_P(BEFFileMappedTest, Execute) {
+  auto host = CreateHostContext();
+  RegisterStaticKernels(host->GetMutableRegistry());
+
+  auto bef_file =
+      BEFFile::OpenMapped(path_.str(), host->GetKernelRegistry(),
+                          host->diag_handler(), host->allocator(),
+                          /*prefetch=*/GetParam());
+  ASSERT_TRUE(bef_file);
+  const Function* function = bef_file->GetFunction("main");
+  ASSERT_NE(function, nullptr);
+
+  auto exec_ctx =
+      RequestContextBuilder(host.get(), /*resource_context=*/nullptr).build();
+  ASSERT_TRUE(!!exec_ctx);
+
+  auto argument = MakeAvailableAsyncValueRef<int32_t>(3);
+  AsyncValue* arguments[] = {argument.GetAsyncValue()};
+  RCReference<AsyncValue> results[1];
+  function->Execute(*exec_ctx, arguments, results);
+  host->Await(results);
+  EXPECT_EQ(results[0]->get<int32_t>(), 6);
+}
+
+INSTANTIATE_TEST_SUITE_P(Prefetch, BEFFileMappedTest, ::testing::Bool());
+
+TEST(BEFFileMappedErrorTest, MissingFile) {
+  auto host = CreateHostContext();
+
+  std::string error_message;
+  auto bef_file = BEFFile::OpenMapped(
+      "/nonexistent/file.bef", host->GetKernelRegistry(),
+      [&](DecodedDiagnostic diag) { error_message = diag.message(); },
+      host->allocator());
+  EXPECT_FALSE(bef_file);
+  EXPECT_FALSE(error_message.empty());
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,293 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests for the lazy function decoding of BEFFile.
+
+#include "tfrt/bef_executor/bef_file.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "tfrt/bef/bef_buffer.h"
+#include "tfrt/bef/bef_encoding.h"
+#include "tfrt/bef_converter/mlir_src_to_bef.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/kernel_registry.h"
+#include "tfrt/support/mutex.h"
+
+namespace tfrt {
+namespace {
+
+constexpr char kMLIRSrc[] = R"mlir(
+func.func @main(%a0: i32) -> i32 {
+  %a1 = tfrt.add.i32 %a0, %a0
+  tfrt.return %a1 : i32
+}
+
+func.func @unknown_kernel() {
+  "unsupported_kernel"() : () -> ()
+  tfrt.return
+}
+)mlir";
+
+class BEFFileTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    host_ = CreateHostContext();
+    RegisterStaticKernels(host_->GetMutableRegistry());
+    bef_buffer_ =
+        ConvertMLIRSrcToBEF(kMLIRSrc, /*disable_optional_sections=*/true);
+    ASSERT_FALSE(bef_buffer_.empty());
+  }
+
+  RCReference<BEFFile> Open() {
+    return BEFFile::Open(
+        bef_buffer_, host_->GetKernelRegistry(),
+        [this](DecodedDiagnostic diag) {
+          mutex_lock lock(mu_);
+          errors_.emplace_back(diag.message());
+        },
+        host_->allocator());
+  }
+
+  std::vector<std::string> errors() {
+    mutex_lock lock(mu_);
+    return errors_;
+  }
+
+  std::unique_ptr<HostContext> host_;
+  BefBuffer bef_buffer_;
+
+  mutex mu_;
+  std::vector<std::string> errors_;
+};
+
+TEST_F(BEFFileTest, UnknownKernelIsReportedOnFirstUse) {
+  // Opening the file does not resolve the kernels.
+  auto bef_file = Open();
+  ASSERT_TRUE(bef_file);
+  EXPECT_TRUE(errors().empty());
+
+  EXPECT_NE(bef_file->GetFunction("main"), nullptr);
+  EXPECT_TRUE(errors().empty());
+
+  EXPECT_EQ(bef_file->GetFunction("unknown_kernel"), nullptr);
+  EXPECT_THAT(errors(), ::testing::ElementsAre(::testing::HasSubstr(
+                            "unknown kernel name 'unsupported_kernel'")));
+}
+
+TEST_F(BEFFileTest, GetFunctionOrErrorTellsMissingFromMalformed) {
+  auto bef_file = Open();
+  ASSERT_TRUE(bef_file);
+
+  auto main = bef_file->GetFunctionOrError("main");
+  ASSERT_TRUE(!!main);
+  EXPECT_NE(*main, nullptr);
+
+  auto missing = bef_file->GetFunctionOrError("missing");
+  ASSERT_TRUE(!!missing);
+  EXPECT_EQ(*missing, nullptr);
+
+  // The failure is cached, so the decode error is only emitted once.
+  for (int i = 0; i < 2; ++i) {
+    auto malformed = bef_file->GetFunctionOrError("unknown_kernel");
+    ASSERT_FALSE(!!malformed);
+    EXPECT_EQ(llvm::toString(malformed.takeError()),
+              "failed to decode function unknown_kernel");
+  }
+  EXPECT_EQ(errors().size(), 1u);
+}
+
+TEST_F(BEFFileTest, ConcurrentFirstGetFunction) {
+  auto bef_file = Open();
+  ASSERT_TRUE(bef_file);
+
+  constexpr int kNumThreads = 8;
+  std::vector<const Function*> functions(kNumThreads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back(
+        [&, i] { functions[i] = bef_file->GetFunction("main"); });
+  }
+  for (auto& thread : threads) thread.join();
+
+  for (const Function* function : functions) {
+    ASSERT_NE(function, nullptr);
+    EXPECT_EQ(function, functions[0]);
+  }
+
+  auto exec_ctx =
+      RequestContextBuilder(host_.get(), /*resource_context=*/nullptr).build();
+  ASSERT_TRUE(!!exec_ctx);
+
+  auto argument = MakeAvailableAsyncValueRef<int32_t>(2);
+  AsyncValue* arguments[] = {argument.GetAsyncValue()};
+  RCReference<AsyncValue> results[1];
+  functions[0]->Execute(*exec_ctx, arguments, results);
+  host_->Await(results);
+  EXPECT_EQ(results[0]->get<int32_t>(), 4);
+  EXPECT_TRUE(errors().empty());
+}
+
+// A HostAllocator that counts the bytes it has allocated and not freed.
+class CountingAllocator : public HostAllocator {
+ public:
+  void* AllocateBytes(size_t size, size_t alignment) override {
+    live_bytes_ += size;
+    ++num_allocations_;
+    return allocator_->AllocateBytes(size, alignment);
+  }
+
+  void DeallocateBytes(void* ptr, size_t size) override {
+    live_bytes_ -= size;
+    allocator_->DeallocateBytes(ptr, size);
+  }
+
+  int64_t live_bytes() const { return live_bytes_; }
+  int num_allocations() const { return num_allocations_; }
+
+ private:
+  std::unique_ptr<HostAllocator> allocator_ = CreateMallocAllocator();
+  std::atomic<int64_t> live_bytes_{0};
+  std::atomic<int> num_allocations_{0};
+};
+
+TEST_F(BEFFileTest, ExecutorFramesUseFileAllocator) {
+  CountingAllocator allocator;
+  auto bef_file = BEFFile::Open(
+      bef_buffer_, host_->GetKernelRegistry(),
+      [](DecodedDiagnostic diag) { ADD_FAILURE() << diag.message(); },
+      &allocator);
+  ASSERT_TRUE(bef_file);
+  const Function* function = bef_file->GetFunction("main");
+  ASSERT_NE(function, nullptr);
+
+  for (int i = 0; i < 3; ++i) {
+    auto exec_ctx =
+        RequestContextBuilder(host_.get(), /*resource_context=*/nullptr)
+            .build();
+    ASSERT_TRUE(!!exec_ctx);
+
+    auto argument = MakeAvailableAsyncValueRef<int32_t>(i);
+    AsyncValue* arguments[] = {argument.GetAsyncValue()};
+    RCReference<AsyncValue> results[1];
+    function->Execute(*exec_ctx, arguments, results);
+    host_->Await(results);
+    host_->Quiesce();
+    EXPECT_EQ(results[0]->get<int32_t>(), 2 * i);
+  }
+
+  // The sequential executions reuse the frame of the first one, which stays
+  // in the pool of the function until the file is destroyed.
+  EXPECT_EQ(allocator.num_allocations(), 1);
+  EXPECT_GT(allocator.live_bytes(), 0);
+  bef_file.reset();
+  EXPECT_EQ(allocator.live_bytes(), 0);
+}
+
+// Returns a BEF file of `format_version`, written by hand as MLIRToBEF only
+// writes the current version, with a function equivalent to:
+//
+//   func.func @second(%a0: i32, %a1: i32) -> i32 {
+//     tfrt.return %a1 : i32
+//   }
+BefBuffer MakeSecondArgumentBEF(uint8_t format_version) {
+  BefBuffer buffer = {kBEFMagic1, kBEFMagic2, format_version};
+  auto emit_section = [&](BEFSectionID id, std::vector<uint8_t> data) {
+    // All the sections are shorter than 64 bytes, so their length fits in one
+    // VBR byte. The sections are aligned to 4 bytes, relative to the buffer,
+    // which is more aligned.
+    buffer.push_back(static_cast<uint8_t>(id));
+    buffer.push_back(data.size() << 1 | 1);
+    buffer.push_back(4);
+    while (buffer.size() % 4 != 0) buffer.push_back(0);
+    buffer.insert(buffer.end(), data.begin(), data.end());
+  };
+
+  emit_section(BEFSectionID::kStrings,
+               {'i', '3', '2', 0, 's', 'e', 'c', 'o', 'n', 'd', 0});
+  // No kernels.
+  emit_section(BEFSectionID::kKernels, {0});
+  // The i32 type.
+  emit_section(BEFSectionID::kTypes, {1, 0});
+  // The function at offset 0, named "second", of type (i32, i32) -> i32.
+  emit_section(BEFSectionID::kFunctionIndex,
+               {1, static_cast<uint8_t>(FunctionKind::kBEFFunction), 0, 4, 2,
+                0, 0, 1, 0});
+
+  // The location, two registers of which the second is returned, and the
+  // kernel table with the pseudo kernel only.
+  std::vector<uint8_t> function = {0, 2, 0, 1, 1, 0, 0, 0};
+  if (format_version >= kBEFVersion1) function.push_back(0);
+  // The result register.
+  function.push_back(1);
+  while (function.size() % kKernelEntryAlignment != 0) function.push_back(0);
+  // The pseudo kernel, with the pseudo result and the two arguments as results
+  // without users.
+  const uint32_t pseudo_kernel[] = {0xABABABAB, 0xCDCDCDCD, 0, 0, 0, 3,
+                                    0,          0,          0, 2, 0, 1};
+  for (uint32_t entry : pseudo_kernel) {
+    for (int i = 0; i < 4; ++i) function.push_back(entry >> (8 * i));
+  }
+  emit_section(BEFSectionID::kFunctions, function);
+
+  return buffer;
+}
+
+TEST_F(BEFFileTest, OpenOldFormatVersion) {
+  for (uint8_t format_version : {kBEFVersion0, kBEFVersion1}) {
+    bef_buffer_ = MakeSecondArgumentBEF(format_version);
+    auto bef_file = Open();
+    ASSERT_TRUE(bef_file);
+    const Function* function = bef_file->GetFunction("second");
+    ASSERT_NE(function, nullptr);
+
+    auto exec_ctx =
+        RequestContextBuilder(host_.get(), /*resource_context=*/nullptr)
+            .build();
+    ASSERT_TRUE(!!exec_ctx);
+
+    auto a0 = MakeAvailableAsyncValueRef<int32_t>(1);
+    auto a1 = MakeAvailableAsyncValueRef<int32_t>(2);
+    AsyncValue* arguments[] = {a0.GetAsyncValue(), a1.GetAsyncValue()};
+    RCReference<AsyncValue> results[1];
+    function->Execute(*exec_ctx, arguments, results);
+    host_->Await(results);
+    EXPECT_EQ(results[0]->get<int32_t>(), 2)
+        << "format version " << static_cast<int>(format_version);
+  }
+  EXPECT_TRUE(errors().empty());
+}
+
+TEST_F(BEFFileTest, UnknownFormatVersionIsRejected) {
+  bef_buffer_ = MakeSecondArgumentBEF(kBEFCurrentVersion + 1);
+  EXPECT_FALSE(Open());
+  EXPECT_THAT(errors(), ::testing::ElementsAre(::testing::HasSubstr(
+                            "Unknown BEF format version")));
+}
+
+}  // namespace
+}  // namespace tfrt
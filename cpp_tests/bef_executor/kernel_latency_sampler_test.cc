@@ -0,0 +1,203 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests for KernelLatencySampler.
+
+#include "tfrt/bef_executor/kernel_latency_sampler.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "llvm/ADT/StringMap.h"
+#include "tfrt/bef/bef_buffer.h"
+#include "tfrt/bef_converter/mlir_src_to_bef.h"
+#include "tfrt/bef_executor/bef_file.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/kernel_registry.h"
+#include "tfrt/metrics/metrics_registry.h"
+#include "tfrt/support/mutex.h"
+
+namespace tfrt {
+namespace {
+
+class TestHistogram : public metrics::Histogram {
+ public:
+  void Record(double value) override {
+    mutex_lock lock(mu_);
+    values_.push_back(value);
+  }
+
+  std::vector<double> values() {
+    mutex_lock lock(mu_);
+    return values_;
+  }
+
+ private:
+  mutex mu_;
+  std::vector<double> values_;
+};
+
+class TestStringGauge : public metrics::Gauge<std::string> {
+ public:
+  void Set(std::string value) override {}
+};
+
+// A registry that keeps the histograms, so that the tests can inspect them.
+class TestMetricsRegistry : public metrics::MetricsRegistry {
+ public:
+  metrics::Gauge<std::string>* NewStringGauge(std::string name) override {
+    return new TestStringGauge();
+  }
+
+  metrics::Histogram* NewHistogram(std::string name,
+                                   const metrics::Buckets& buckets) override {
+    mutex_lock lock(mu_);
+    auto& histogram = histograms_[name];
+    if (!histogram) histogram = std::make_unique<TestHistogram>();
+    return histogram.get();
+  }
+
+  // Returns the values recorded by the latency histogram of `kernel_name`,
+  // after running the collection callbacks like an exporting registry.
+  std::vector<double> ReadLatencies(const std::string& kernel_name) {
+    metrics::RunCollectionCallbacks();
+    return GetLatencies(kernel_name);
+  }
+
+  // Returns the values recorded by the latency histogram of `kernel_name`.
+  std::vector<double> GetLatencies(const std::string& kernel_name) {
+    mutex_lock lock(mu_);
+    auto it = histograms_.find(
+        "/tensorflow/runtime/bef_executor/kernel_latency/" + kernel_name);
+    if (it == histograms_.end()) return {};
+    return it->second->values();
+  }
+
+ private:
+  mutex mu_;
+  llvm::StringMap<std::unique_ptr<TestHistogram>> histograms_;
+};
+
+TestMetricsRegistry& GetTestMetricsRegistry() {
+  static auto* registry = [] {
+    auto* registry = new TestMetricsRegistry();
+    metrics::RegisterMetricsRegistry(registry);
+    return registry;
+  }();
+  return *registry;
+}
+
+constexpr char kMLIRSrc[] = R"mlir(func.func @main(%a0: i32) -> i32 {
+  %a1 = tfrt.add.i32 %a0, %a0
+  %a2 = tfrt.add.i32 %a1, %a1
+  tfrt.return %a2 : i32
+}
+)mlir";
+
+TEST(KernelLatencySamplerTest, RecordKernels) {
+  TestMetricsRegistry& registry = GetTestMetricsRegistry();
+
+  auto host = CreateHostContext();
+  RegisterStaticKernels(host->GetMutableRegistry());
+
+  BefBuffer bef_buffer =
+      ConvertMLIRSrcToBEF(kMLIRSrc, /*disable_optional_sections=*/true);
+  auto bef_file = BEFFile::Open(bef_buffer, host->GetKernelRegistry(),
+                                host->diag_handler(), host->allocator());
+  ASSERT_TRUE(bef_file);
+  const Function* function = bef_file->GetFunction("main");
+  ASSERT_NE(function, nullptr);
+
+  auto exec_ctx =
+      RequestContextBuilder(host.get(), /*resource_context=*/nullptr).build();
+  ASSERT_TRUE(!!exec_ctx);
+
+  // Sample every kernel execution.
+  KernelLatencySampler sampler(/*sample_period=*/1);
+  SetKernelLatencySampler(&sampler);
+  for (int i = 0; i < 2; ++i) {
+    auto argument = MakeAvailableAsyncValueRef<int32_t>(1);
+    AsyncValue* arguments[] = {argument.GetAsyncValue()};
+    RCReference<AsyncValue> results[1];
+    function->Execute(*exec_ctx, arguments, results);
+    host->Await(results);
+    EXPECT_EQ(results[0]->get<int32_t>(), 4);
+  }
+  SetKernelLatencySampler(nullptr);
+
+  // Samples are buffered until they are flushed.
+  EXPECT_TRUE(registry.GetLatencies("tfrt.add.i32").empty());
+  sampler.Flush();
+
+  // Both tfrt.add.i32 kernels are recorded twice.
+  std::vector<double> latencies = registry.GetLatencies("tfrt.add.i32");
+  EXPECT_EQ(latencies.size(), 4);
+  for (double latency : latencies) EXPECT_GE(latency, 0);
+}
+
+TEST(KernelLatencySamplerTest, FlushOnRead) {
+  TestMetricsRegistry& registry = GetTestMetricsRegistry();
+
+  KernelLatencySampler sampler(/*sample_period=*/1);
+  sampler.RecordKernel("test.read", std::chrono::microseconds(2));
+  EXPECT_TRUE(registry.GetLatencies("test.read").empty());
+
+  // Reading the metrics flushes the buffered samples.
+  EXPECT_THAT(registry.ReadLatencies("test.read"),
+              ::testing::ElementsAre(2.0));
+}
+
+TEST(KernelLatencySamplerTest, SampleRate) {
+  constexpr int kSamplePeriod = 10;
+  constexpr int kNumExecutions = 100000;
+
+  KernelLatencySampler sampler(kSamplePeriod);
+  int num_samples = 0;
+  for (int i = 0; i < kNumExecutions; ++i) {
+    if (sampler.ShouldSample()) ++num_samples;
+  }
+  EXPECT_GT(num_samples, kNumExecutions / kSamplePeriod * 0.9);
+  EXPECT_LT(num_samples, kNumExecutions / kSamplePeriod * 1.1);
+}
+
+TEST(KernelLatencySamplerTest, FlushAllThreads) {
+  TestMetricsRegistry& registry = GetTestMetricsRegistry();
+
+  KernelLatencySampler sampler(/*sample_period=*/1);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&sampler]() {
+      for (int j = 0; j < 10; ++j)
+        sampler.RecordKernel("test.kernel", std::chrono::microseconds(j));
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  sampler.Flush();
+  std::vector<double> latencies = registry.GetLatencies("test.kernel");
+  EXPECT_EQ(latencies.size(), 40);
+  EXPECT_THAT(latencies, ::testing::Contains(9.0).Times(4));
+}
+
+}  // namespace
+}  // namespace tfrt
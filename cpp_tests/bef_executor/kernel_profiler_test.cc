@@ -0,0 +1,105 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests for KernelProfiler.
+
+#include "tfrt/bef_executor/kernel_profiler.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/bef/bef_buffer.h"
+#include "tfrt/bef_converter/mlir_src_to_bef.h"
+#include "tfrt/bef_executor/bef_file.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/kernel_registry.h"
+
+namespace tfrt {
+namespace {
+
+constexpr char kMLIRSrc[] = R"mlir(func.func @main(%a0: i32) -> i32 {
+  %a1 = tfrt.add.i32 %a0, %a0
+  %a2 = tfrt.add.i32 %a1, %a1
+  tfrt.return %a2 : i32
+}
+)mlir";
+
+TEST(KernelProfilerTest, RecordKernels) {
+  auto host = CreateHostContext();
+  RegisterStaticKernels(host->GetMutableRegistry());
+
+  BefBuffer bef_buffer =
+      ConvertMLIRSrcToBEF(kMLIRSrc, /*disable_optional_sections=*/true);
+  auto bef_file = BEFFile::Open(bef_buffer, host->GetKernelRegistry(),
+                                host->diag_handler(), host->allocator());
+  ASSERT_TRUE(bef_file);
+  const Function* function = bef_file->GetFunction("main");
+  ASSERT_NE(function, nullptr);
+
+  auto exec_ctx =
+      RequestContextBuilder(host.get(), /*resource_context=*/nullptr).build();
+  ASSERT_TRUE(!!exec_ctx);
+
+  KernelProfiler profiler;
+  SetKernelProfiler(&profiler);
+  for (int i = 0; i < 2; ++i) {
+    auto argument = MakeAvailableAsyncValueRef<int32_t>(1);
+    AsyncValue* arguments[] = {argument.GetAsyncValue()};
+    RCReference<AsyncValue> results[1];
+    function->Execute(*exec_ctx, arguments, results);
+    host->Await(results);
+    EXPECT_EQ(results[0]->get<int32_t>(), 4);
+  }
+  SetKernelProfiler(nullptr);
+
+  std::string profile;
+  llvm::raw_string_ostream os(profile);
+  profiler.PrintProfile(os);
+  os.flush();
+
+  llvm::SmallVector<llvm::StringRef, 4> lines;
+  llvm::StringRef(profile).split(lines, '\n', /*MaxSplit=*/-1,
+                                 /*KeepEmpty=*/false);
+
+  // Both tfrt.add.i32 kernels are recorded twice. Each line has the filename,
+  // the line, the column, the count and the average wall time.
+  std::vector<std::string> lines_and_counts;
+  for (auto line : lines) {
+    llvm::SmallVector<llvm::StringRef, 5> fields;
+    line.split(fields, '\t');
+    ASSERT_EQ(fields.size(), 5);
+    lines_and_counts.push_back((fields[1] + ":" + fields[3]).str());
+  }
+  std::sort(lines_and_counts.begin(), lines_and_counts.end());
+  EXPECT_THAT(lines_and_counts, ::testing::ElementsAre("2:2", "3:2"));
+
+  profiler.Clear();
+  std::string empty_profile;
+  llvm::raw_string_ostream empty_os(empty_profile);
+  profiler.PrintProfile(empty_os);
+  EXPECT_TRUE(empty_os.str().empty());
+}
+
+}  // namespace
+}  // namespace tfrt
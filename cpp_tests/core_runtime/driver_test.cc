@@ -22,6 +22,7 @@
 #include "benchmark/benchmark.h"
 #include "gtest/gtest.h"
 #include "llvm_derived/Support/raw_ostream.h"
+#include "tfrt/core_runtime/core_runtime.h"
 #include "tfrt/core_runtime/core_runtime_op.h"
 #include "tfrt/core_runtime/op_attrs.h"
 #include "tfrt/core_runtime/tensor_handle.h"
@@ -165,5 +166,114 @@ TEST_F(CpuDriverTest, NativeCompositeOpTest) {
   ASSERT_EQ(a2->get<int32_t>(), 2);
 }
 
+TEST_F(CpuDriverTest, ExecuteCachesResolvedOps) {
+  static constexpr char kRelu[] = "tfrt_test.relu";
+
+  tfrt::OpAttrs attrs;
+  attrs.SetArray("shape", tfrt::ArrayRef<Index>{2, 2});
+  attrs.SetArray("values", tfrt::ArrayRef<float>{2.0});
+  tfrt::TensorHandle a1;
+  driver_.Execute(driver_.CreateExecutionContext(__FILE__, __LINE__),
+                  "tfrt_test.create_dense_tensor", {}, attrs.freeze(), a1);
+
+  auto exec_ctx = driver_.CreateExecutionContext(__FILE__, __LINE__);
+  tfrt::OpAttrs empty_attrs;
+  auto before = CoreRuntime::GetThreadOpCacheStats();
+  for (int i = 0; i < 3; ++i) {
+    tfrt::TensorHandle arg = a1.CopyRef();
+    tfrt::TensorHandle result;
+    driver_.Execute(exec_ctx, kRelu, arg, empty_attrs.freeze(), result);
+    driver_.WaitForHostContextQuiesce();
+    ASSERT_FALSE(result.IsError());
+  }
+  auto after = CoreRuntime::GetThreadOpCacheStats();
+  EXPECT_EQ(after.hits - before.hits, 2);
+  EXPECT_EQ(after.misses - before.misses, 1);
+
+  // Unsupported ops are not cached, and keep failing.
+  for (int i = 0; i < 2; ++i) {
+    tfrt::TensorHandle result;
+    driver_.Execute(exec_ctx, "tfrt_test.unsupported_op", {},
+                    empty_attrs.freeze(), result);
+    driver_.WaitForHostContextQuiesce();
+    EXPECT_TRUE(result.IsError());
+  }
+  EXPECT_EQ(CoreRuntime::GetThreadOpCacheStats().hits, after.hits);
+}
+
+// Eager dispatch of a cheap op, which measures the op dispatch overhead.
+class EagerDispatchBenchmark {
+ public:
+  EagerDispatchBenchmark()
+      : exec_ctx_(driver_.CreateExecutionContext(__FILE__, __LINE__)) {
+    tfrt::OpAttrs attrs;
+    attrs.SetArray("shape", tfrt::ArrayRef<Index>{2});
+    attrs.SetArray("values", tfrt::ArrayRef<float>{1.0});
+    driver_.Execute(exec_ctx_, "tfrt_test.create_dense_tensor", {},
+                    attrs.freeze(), input_);
+    driver_.WaitForHostContextQuiesce();
+  }
+
+  ~EagerDispatchBenchmark() { driver_.WaitForHostContextQuiesce(); }
+
+  example::CoreRuntimeCpuDriver& driver() { return driver_; }
+  const ExecutionContext& exec_ctx() const { return exec_ctx_; }
+  OpAttrsRef attrs() const { return empty_attrs_.freeze(); }
+  TensorHandle input() const { return input_.CopyRef(); }
+
+ private:
+  example::CoreRuntimeCpuDriver driver_;
+  ExecutionContext exec_ctx_;
+  tfrt::OpAttrs empty_attrs_;
+  TensorHandle input_;
+};
+
+static constexpr char kBenchmarkOp[] = "tfrt_test.relu";
+
+// Execute the op by name, which hits the resolved op cache.
+static void BM_EagerExecute(benchmark::State& state) {
+  EagerDispatchBenchmark bm;
+  auto before = CoreRuntime::GetThreadOpCacheStats();
+  for (auto _ : state) {
+    TensorHandle arg = bm.input();
+    TensorHandle result;
+    bm.driver().Execute(bm.exec_ctx(), kBenchmarkOp, arg, bm.attrs(), result);
+    benchmark::DoNotOptimize(result);
+  }
+  auto after = CoreRuntime::GetThreadOpCacheStats();
+  int64_t hits = after.hits - before.hits;
+  int64_t misses = after.misses - before.misses;
+  state.counters["hit_rate"] =
+      hits + misses == 0 ? 0.0 : static_cast<double>(hits) / (hits + misses);
+}
+BENCHMARK(BM_EagerExecute);
+
+// Resolve the op on every call, which is the cost of a cache miss.
+static void BM_EagerMakeOpAndExecute(benchmark::State& state) {
+  EagerDispatchBenchmark bm;
+  for (auto _ : state) {
+    TensorHandle arg = bm.input();
+    TensorHandle result;
+    CoreRuntimeOp op = bm.driver().MakeOp(kBenchmarkOp);
+    op(bm.exec_ctx(), arg, bm.attrs(), result, /*chain=*/nullptr);
+    benchmark::DoNotOptimize(result);
+  }
+}
+BENCHMARK(BM_EagerMakeOpAndExecute);
+
+// Execute an op resolved ahead of time, which is the lower bound of the eager
+// dispatch cost.
+static void BM_EagerExecuteResolvedOp(benchmark::State& state) {
+  EagerDispatchBenchmark bm;
+  CoreRuntimeOp op = bm.driver().MakeOp(kBenchmarkOp);
+  for (auto _ : state) {
+    TensorHandle arg = bm.input();
+    TensorHandle result;
+    op(bm.exec_ctx(), arg, bm.attrs(), result, /*chain=*/nullptr);
+    benchmark::DoNotOptimize(result);
+  }
+}
+BENCHMARK(BM_EagerExecuteResolvedOp);
+
 }  // namespace
 }  // namespace tfrt
@@ -0,0 +1,197 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests and benchmarks for the arena allocator.
+
+#include "tfrt/host_context/arena_allocator.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/host_context/host_allocator.h"
+
+namespace tfrt {
+namespace {
+
+// An allocator that counts the allocations that are not deallocated yet.
+class CountingAllocator : public HostAllocator {
+ public:
+  void* AllocateBytes(size_t size, size_t alignment) override {
+    ++num_live_;
+    return allocator_->AllocateBytes(size, alignment);
+  }
+
+  void DeallocateBytes(void* ptr, size_t size) override {
+    --num_live_;
+    allocator_->DeallocateBytes(ptr, size);
+  }
+
+  int num_live() const { return num_live_; }
+
+ private:
+  std::unique_ptr<HostAllocator> allocator_ = CreateMallocAllocator();
+  std::atomic<int> num_live_{0};
+};
+
+bool IsAligned(void* ptr, size_t alignment) {
+  return reinterpret_cast<std::uintptr_t>(ptr) % alignment == 0;
+}
+
+TEST(ArenaAllocatorTest, AllocateDeallocateBytesWithAlignment) {
+  CountingAllocator parent;
+  {
+    auto arena = CreateArenaAllocator(&parent);
+    for (size_t size : {0, 1, 24, 100, 4096, 4097, 1 << 20}) {
+      for (size_t alignment : {1, 8, 16, 64, 4096}) {
+        void* buffer = arena->AllocateBytes(size, alignment);
+        ASSERT_NE(nullptr, buffer);
+        EXPECT_TRUE(IsAligned(buffer, alignment));
+        memset(buffer, 0xff, size);
+        arena->DeallocateBytes(buffer, size);
+      }
+    }
+  }
+  EXPECT_EQ(parent.num_live(), 0);
+}
+
+TEST(ArenaAllocatorTest, OverAlignedAllocationsAreForwarded) {
+  CountingAllocator parent;
+  {
+    auto arena = CreateArenaAllocator(&parent);
+    for (size_t size : {1, 100, 4096}) {
+      for (size_t alignment : {1 << 15, 1 << 16, 1 << 20}) {
+        void* buffer = arena->AllocateBytes(size, alignment);
+        ASSERT_NE(nullptr, buffer);
+        EXPECT_TRUE(IsAligned(buffer, alignment));
+        memset(buffer, 0xff, size);
+        arena->DeallocateBytes(buffer, size);
+      }
+    }
+    // The forwarded allocations are returned to the parent immediately.
+    EXPECT_EQ(parent.num_live(), 0);
+  }
+  EXPECT_EQ(parent.num_live(), 0);
+}
+
+TEST(ArenaAllocatorTest, ReleaseFreesChunksInBulk) {
+  CountingAllocator parent;
+  auto arena = CreateArenaAllocator(&parent);
+
+  std::vector<uint8_t*> blocks;
+  for (int i = 0; i < 10000; ++i) {
+    auto* block = static_cast<uint8_t*>(arena->AllocateBytes(32, 8));
+    ASSERT_NE(nullptr, block);
+    memset(block, i % 256, 32);
+    blocks.push_back(block);
+  }
+  // The allocations are served from a few large chunks.
+  EXPECT_LT(parent.num_live(), 10);
+
+  for (int i = 0; i < blocks.size(); ++i) {
+    for (int j = 0; j < 32; ++j) ASSERT_EQ(blocks[i][j], i % 256);
+    arena->DeallocateBytes(blocks[i], 32);
+  }
+  // The chunks are kept until the arena is released.
+  EXPECT_GT(parent.num_live(), 0);
+
+  arena.reset();
+  EXPECT_EQ(parent.num_live(), 0);
+}
+
+TEST(ArenaAllocatorTest, AllocationsEscapeTheArena) {
+  CountingAllocator parent;
+  auto arena = CreateArenaAllocator(&parent);
+  HostAllocator* allocator = arena.get();
+
+  auto* small = static_cast<char*>(allocator->AllocateBytes(16, 8));
+  auto* large = static_cast<char*>(allocator->AllocateBytes(1 << 16, 64));
+  ASSERT_NE(nullptr, small);
+  ASSERT_NE(nullptr, large);
+  arena.reset();
+
+  // The allocations are still valid after the arena is released.
+  memset(small, 1, 16);
+  memset(large, 1, 1 << 16);
+  EXPECT_EQ(parent.num_live(), 2);
+
+  allocator->DeallocateBytes(small, 16);
+  EXPECT_EQ(parent.num_live(), 1);
+  allocator->DeallocateBytes(large, 1 << 16);
+  EXPECT_EQ(parent.num_live(), 0);
+}
+
+TEST(ArenaAllocatorTest, ConcurrentAllocations) {
+  CountingAllocator parent;
+  auto arena = CreateArenaAllocator(&parent);
+
+  constexpr int kNumThreads = 8;
+  constexpr int kNumBlocks = 10000;
+  std::vector<std::vector<int64_t*>> blocks(kNumThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < kNumBlocks; ++i) {
+        auto* block = arena->Allocate<int64_t>();
+        *block = t * kNumBlocks + i;
+        blocks[t].push_back(block);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  // Blocks of different threads do not overlap.
+  for (int t = 0; t < kNumThreads; ++t) {
+    for (int i = 0; i < kNumBlocks; ++i) {
+      ASSERT_EQ(*blocks[t][i], t * kNumBlocks + i);
+      arena->Deallocate(blocks[t][i]);
+    }
+  }
+
+  arena.reset();
+  EXPECT_EQ(parent.num_live(), 0);
+}
+
+// Allocates and deallocates the small blocks of a request, eg. the buffers of
+// small tensors.
+static void AllocateDeallocate(HostAllocator* allocator) {
+  constexpr int kNumBlocks = 64;
+  void* blocks[kNumBlocks];
+  for (int i = 0; i < kNumBlocks; ++i)
+    blocks[i] = allocator->AllocateBytes(64, 8);
+  benchmark::DoNotOptimize(blocks);
+  for (int i = 0; i < kNumBlocks; ++i)
+    allocator->DeallocateBytes(blocks[i], 64);
+}
+
+static void BM_MallocAllocator(benchmark::State& state) {
+  static HostAllocator* allocator = CreateMallocAllocator().release();
+  for (auto _ : state) AllocateDeallocate(allocator);
+}
+BENCHMARK(BM_MallocAllocator)->ThreadRange(1, 8);
+
+static void BM_ArenaAllocator(benchmark::State& state) {
+  static HostAllocator* parent = CreateMallocAllocator().release();
+  // Each iteration is a request with its own arena.
+  for (auto _ : state) AllocateDeallocate(CreateArenaAllocator(parent).get());
+}
+BENCHMARK(BM_ArenaAllocator)->ThreadRange(1, 8);
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,90 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Unit tests and benchmarks for the attribute cache.
+
+#include "tfrt/host_context/attribute_cache.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+
+namespace tfrt {
+namespace {
+
+TEST(AttributeCacheTest, CreateOnce) {
+  AttributeCache cache;
+  int num_created = 0;
+  auto create = [&] {
+    ++num_created;
+    return std::string("value");
+  };
+
+  const std::string& value = cache.GetOrCreate<std::string>(create);
+  EXPECT_EQ(value, "value");
+  EXPECT_EQ(&cache.GetOrCreate<std::string>(create), &value);
+  EXPECT_EQ(num_created, 1);
+}
+
+TEST(AttributeCacheTest, DestroyValue) {
+  auto value = std::make_shared<int>(42);
+  {
+    AttributeCache cache;
+    cache.GetOrCreate<std::shared_ptr<int>>([&] { return value; });
+    EXPECT_EQ(value.use_count(), 2);
+  }
+  EXPECT_EQ(value.use_count(), 1);
+}
+
+TEST(AttributeCacheTest, Concurrent) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumKernels = 64;
+  std::vector<AttributeCache> caches(kNumKernels);
+  auto values = std::make_shared<int>(0);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&] {
+      for (int kernel = 0; kernel < kNumKernels; ++kernel) {
+        const std::shared_ptr<int>& value =
+            caches[kernel].GetOrCreate<std::shared_ptr<int>>([&] {
+              return std::shared_ptr<int>(values, nullptr);
+            });
+        // All the threads get the value that was published first.
+        EXPECT_EQ(&value, &caches[kernel].GetOrCreate<std::shared_ptr<int>>(
+                              [] { return std::shared_ptr<int>(); }));
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  // The values that lost the race were destroyed.
+  EXPECT_EQ(values.use_count(), 1 + kNumKernels);
+}
+
+static void BM_GetOrCreate(benchmark::State& state) {
+  static AttributeCache* cache = new AttributeCache();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cache->GetOrCreate<int>([] { return 1; }));
+  }
+}
+BENCHMARK(BM_GetOrCreate)->ThreadRange(1, 8);
+
+}  // namespace
+}  // namespace tfrt
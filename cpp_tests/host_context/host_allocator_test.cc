@@ -19,8 +19,15 @@
 #include "tfrt/host_context/host_allocator.h"
 
 #include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
 
+#include "benchmark/benchmark.h"
 #include "gtest/gtest.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/support/latch.h"
+#include "tfrt/support/numa.h"
 
 namespace tfrt {
 namespace {
@@ -53,6 +60,64 @@ TEST_F(HostAllocatorTest, AllocateDeallocate) {
   allocator_->Deallocate<uint64_t>(entries, kTestAllocateEntryCount);
 }
 
+TEST(NumaAllocatorTest, AllocateDeallocateBytesWithAlignment) {
+  auto allocator = CreateNumaAllocator();
+  auto is_aligned = [](void* ptr, size_t alignment) {
+    return reinterpret_cast<std::uintptr_t>(ptr) % alignment == 0;
+  };
+
+  // Both small (malloc) and large (node local pages) allocations.
+  for (size_t size : {1024, 1 << 20}) {
+    for (size_t alignment : {1, 8, 64, 1024, 4096, 1 << 16}) {
+      void* buffer = allocator->AllocateBytes(size, alignment);
+      ASSERT_NE(nullptr, buffer);
+      EXPECT_TRUE(is_aligned(buffer, alignment));
+      memset(buffer, 0, size);
+      allocator->DeallocateBytes(buffer, size);
+    }
+  }
+}
+
+TEST(NumaAllocatorTest, LargeAllocationsAreReused) {
+  auto allocator = CreateNumaAllocator();
+  constexpr size_t kSize = 1 << 20;
+  void* first = allocator->AllocateBytes(kSize, 64);
+  ASSERT_NE(nullptr, first);
+  allocator->DeallocateBytes(first, kSize);
+
+  // A freed block is reused for an allocation of the same size class.
+  void* second = allocator->AllocateBytes(kSize - 4096, 64);
+  EXPECT_EQ(first, second);
+  allocator->DeallocateBytes(second, kSize - 4096);
+}
+
+TEST(NumaAllocatorTest, AllocationsLargerThanRegions) {
+  auto allocator = CreateNumaAllocator();
+  auto is_aligned = [](void* ptr, size_t alignment) {
+    return reinterpret_cast<std::uintptr_t>(ptr) % alignment == 0;
+  };
+
+  // Allocations too large to be pooled, and a pooled size with an alignment
+  // too large for the size classes.
+  for (auto [size, alignment] : {std::pair<size_t, size_t>{100 << 20, 64},
+                                 {100 << 20, 4096},
+                                 {1 << 20, 128 << 20}}) {
+    void* buffer = allocator->AllocateBytes(size, alignment);
+    ASSERT_NE(nullptr, buffer);
+    EXPECT_TRUE(is_aligned(buffer, alignment));
+    memset(buffer, 0, size);
+    allocator->DeallocateBytes(buffer, size);
+  }
+}
+
+TEST(NumaTest, CurrentNode) {
+  int num_nodes = GetNumNumaNodes();
+  ASSERT_GE(num_nodes, 1);
+  int node = GetCurrentNumaNode();
+  EXPECT_GE(node, 0);
+  EXPECT_LT(node, num_nodes);
+}
+
 // Tests for HostArray class.
 constexpr size_t kTestArraySize = 16;
 class HostArrayTest : public ::testing::Test {
@@ -94,5 +159,45 @@ TEST_F(HostArrayTest, Move) {
   EXPECT_EQ(0, host_array_.size());
 }
 
+// Each task allocates a buffer, fills it and sums it a few times, which is
+// bound by the memory bandwidth. With `state.range(0)` set, the worker threads
+// are pinned to NUMA nodes and the buffers are allocated on the node of the
+// worker, otherwise the threads float and the buffers come from malloc.
+static void BM_ParallelBufferSum(benchmark::State& state) {
+  const bool numa = state.range(0);
+  constexpr int kNumThreads = 16;
+  constexpr int kNumTasks = 64;
+  constexpr size_t kBufferSize = 4 << 20;
+  constexpr int kNumPasses = 4;
+
+  MultiThreadedWorkQueueOptions options;
+  options.pin_to_numa_nodes = numa;
+  auto work_queue = CreateMultiThreadedWorkQueue(kNumThreads, 1, options);
+  auto allocator = numa ? CreateNumaAllocator() : CreateMallocAllocator();
+
+  for (auto _ : state) {
+    latch done(kNumTasks);
+    for (int i = 0; i < kNumTasks; ++i) {
+      work_queue->AddTask([&]() {
+        auto* buffer = allocator->Allocate<uint64_t>(kBufferSize / 8);
+        for (size_t j = 0; j < kBufferSize / 8; ++j) buffer[j] = j;
+        uint64_t sum = 0;
+        for (int pass = 0; pass < kNumPasses; ++pass) {
+          for (size_t j = 0; j < kBufferSize / 8; ++j) sum += buffer[j];
+        }
+        benchmark::DoNotOptimize(sum);
+        allocator->Deallocate(buffer, kBufferSize / 8);
+        done.count_down();
+      });
+    }
+    done.wait();
+  }
+
+  state.SetBytesProcessed(state.iterations() * kNumTasks * kBufferSize *
+                          (kNumPasses + 1));
+}
+
+BENCHMARK(BM_ParallelBufferSum)->Arg(0)->Arg(1)->UseRealTime();
+
 }  // namespace
 }  // namespace tfrt
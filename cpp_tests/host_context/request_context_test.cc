@@ -16,11 +16,17 @@
 
 // Unit test for TFRT RequestContext.
 
+#include <chrono>
+#include <string>
+#include <utility>
+
 #include "gtest/gtest.h"
+#include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/support/error_util.h"
 
 namespace tfrt {
 namespace {
@@ -60,5 +66,135 @@ TEST(RequestContextTest, ContextData) {
   EXPECT_EQ(expected_request_context.get()->GetDataIfExists<int>(), nullptr);
 }
 
+TEST(RequestContextTest, ArenaAllocator) {
+  auto host = CreateTestHostContext();
+
+  auto request_context = RequestContextBuilder(host.get(), nullptr).build();
+  ASSERT_FALSE(!request_context);
+  EXPECT_EQ(request_context.get()->allocator(), host->allocator());
+
+  HostAllocator* allocator;
+  int* value;
+  {
+    auto arena_request_context = RequestContextBuilder(host.get(), nullptr)
+                                     .set_use_arena_allocator(true)
+                                     .build();
+    ASSERT_FALSE(!arena_request_context);
+    allocator = arena_request_context.get()->allocator();
+    EXPECT_NE(allocator, host->allocator());
+
+    ExecutionContext exec_ctx(arena_request_context.get());
+    EXPECT_EQ(exec_ctx.allocator(), allocator);
+
+    value = exec_ctx.allocator()->Allocate<int>();
+    *value = 42;
+  }
+
+  // An allocation that outlives the request stays valid.
+  EXPECT_EQ(*value, 42);
+  allocator->Deallocate(value);
+}
+
+TEST(RequestContextTest, Deadline) {
+  auto host = CreateTestHostContext();
+
+  auto request_context = RequestContextBuilder(host.get(), nullptr).build();
+  ASSERT_FALSE(!request_context);
+  EXPECT_FALSE(request_context.get()->HasDeadline());
+  EXPECT_FALSE(request_context.get()->CancelIfDeadlineExceeded());
+
+  RequestOptions request_options;
+  request_options.deadline =
+      RequestOptions::Clock::now() + std::chrono::hours(1);
+  auto future_request_context = RequestContextBuilder(host.get(), nullptr)
+                                    .set_request_options(request_options)
+                                    .build();
+  ASSERT_FALSE(!future_request_context);
+  EXPECT_TRUE(future_request_context.get()->HasDeadline());
+  EXPECT_FALSE(future_request_context.get()->CancelIfDeadlineExceeded());
+  EXPECT_FALSE(future_request_context.get()->IsCancelled());
+
+  request_options.deadline =
+      RequestOptions::Clock::now() - std::chrono::seconds(1);
+  auto expired_request_context = RequestContextBuilder(host.get(), nullptr)
+                                     .set_request_options(request_options)
+                                     .build();
+  ASSERT_FALSE(!expired_request_context);
+  EXPECT_TRUE(expired_request_context.get()->CancelIfDeadlineExceeded());
+  ASSERT_TRUE(expired_request_context.get()->IsCancelled());
+  EXPECT_EQ(
+      expired_request_context.get()->GetCancelAsyncValue()->GetError().code(),
+      absl::StatusCode::kDeadlineExceeded);
+}
+
+TEST(RequestContextTest, EnqueueWorkAfterDeadline) {
+  auto host = CreateTestHostContext();
+
+  RequestOptions request_options;
+  request_options.deadline =
+      RequestOptions::Clock::now() - std::chrono::seconds(1);
+  auto request_context = RequestContextBuilder(host.get(), nullptr)
+                             .set_request_options(request_options)
+                             .build();
+  ASSERT_FALSE(!request_context);
+  ExecutionContext exec_ctx(request_context.get());
+
+  // The work still runs, but it observes the cancellation of the request.
+  bool cancelled = false;
+  EnqueueWork(exec_ctx, [&] { cancelled = exec_ctx.IsCancelled(); });
+  host->Quiesce();
+  EXPECT_TRUE(cancelled);
+}
+
+TEST(RequestContextTest, AdmitRequest) {
+  auto host = CreateTestHostContext();
+
+  auto request_context = RequestContextBuilder(host.get(), nullptr).build();
+  ASSERT_FALSE(!request_context);
+  // Requests without a deadline are always admitted.
+  RequestContext& request = *request_context.get();
+  EXPECT_EQ(
+      llvm::toString(host->AdmitRequest(request, std::chrono::hours(1))), "");
+
+  RequestOptions request_options;
+  request_options.deadline =
+      RequestOptions::Clock::now() + std::chrono::minutes(1);
+  auto deadline_request_context = RequestContextBuilder(host.get(), nullptr)
+                                      .set_request_options(request_options)
+                                      .build();
+  ASSERT_FALSE(!deadline_request_context);
+  RequestContext& deadline_request = *deadline_request_context.get();
+  EXPECT_EQ(llvm::toString(
+                host->AdmitRequest(deadline_request, std::chrono::seconds(1))),
+            "");
+
+  std::string error = llvm::toString(
+      host->AdmitRequest(deadline_request, std::chrono::hours(1)));
+  EXPECT_NE(error.find("exceeds the remaining time"), std::string::npos)
+      << error;
+  // Rejecting a request does not cancel it.
+  EXPECT_FALSE(deadline_request.IsCancelled());
+}
+
+TEST(RequestContextTest, AdmitRequestAfterDeadline) {
+  auto host = CreateTestHostContext();
+
+  RequestOptions request_options;
+  request_options.deadline =
+      RequestOptions::Clock::now() - std::chrono::milliseconds(1);
+  auto request_context = RequestContextBuilder(host.get(), nullptr)
+                             .set_request_options(request_options)
+                             .build();
+  ASSERT_FALSE(!request_context);
+
+  // The estimated cost takes any duration of the request deadline clock.
+  std::chrono::system_clock::duration estimated_cost =
+      std::chrono::microseconds(1);
+  Error error = host->AdmitRequest(*request_context.get(), estimated_cost);
+  ASSERT_TRUE(!!error);
+  EXPECT_TRUE(error.isA<DeadlineExceededErrorInfo>());
+  llvm::consumeError(std::move(error));
+}
+
 }  // namespace
 }  // namespace tfrt
@@ -0,0 +1,147 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests and benchmarks for the thread caching HostAllocator.
+
+#include "tfrt/host_context/thread_caching_allocator.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/host_context/host_allocator.h"
+
+namespace tfrt {
+namespace {
+
+bool IsAligned(void* ptr, size_t alignment) {
+  return reinterpret_cast<std::uintptr_t>(ptr) % alignment == 0;
+}
+
+TEST(ThreadCachingAllocatorTest, AllocateDeallocateBytesWithAlignment) {
+  auto allocator = CreateThreadCachingAllocator();
+
+  for (size_t size : {0, 1, 24, 48, 100, 256, 300, 4096, 32 * 1024, 1 << 20}) {
+    for (size_t alignment : {1, 8, 16, 64, 256, 4096}) {
+      void* buffer = allocator->AllocateBytes(size, alignment);
+      ASSERT_NE(nullptr, buffer);
+      EXPECT_TRUE(IsAligned(buffer, alignment));
+      memset(buffer, 0xff, size);
+      allocator->DeallocateBytes(buffer, size);
+    }
+  }
+}
+
+TEST(ThreadCachingAllocatorTest, OverAlignedAllocationsAreForwarded) {
+  auto allocator = CreateThreadCachingAllocator();
+
+  // No size class is aligned to more than 32KiB.
+  for (size_t size : {1, 64, 4096}) {
+    for (size_t alignment : {64 * 1024, 1 << 20}) {
+      void* buffer = allocator->AllocateBytes(size, alignment);
+      ASSERT_NE(nullptr, buffer);
+      EXPECT_TRUE(IsAligned(buffer, alignment));
+      memset(buffer, 0xff, size);
+      allocator->DeallocateBytes(buffer, size);
+    }
+  }
+
+  // The cached blocks are still served after the forwarded ones are freed.
+  void* buffer = allocator->AllocateBytes(64, 64);
+  ASSERT_NE(nullptr, buffer);
+  allocator->DeallocateBytes(buffer, 64);
+}
+
+TEST(ThreadCachingAllocatorTest, BlocksDoNotOverlap) {
+  auto allocator = CreateThreadCachingAllocator();
+
+  constexpr int kNumBlocks = 1000;
+  constexpr size_t kSize = 40;
+  std::vector<uint8_t*> blocks;
+  for (int i = 0; i < kNumBlocks; ++i) {
+    auto* block = static_cast<uint8_t*>(allocator->AllocateBytes(kSize, 8));
+    ASSERT_NE(nullptr, block);
+    memset(block, i % 256, kSize);
+    blocks.push_back(block);
+  }
+
+  for (int i = 0; i < kNumBlocks; ++i) {
+    for (size_t j = 0; j < kSize; ++j) ASSERT_EQ(blocks[i][j], i % 256);
+    allocator->DeallocateBytes(blocks[i], kSize);
+  }
+}
+
+TEST(ThreadCachingAllocatorTest, DeallocateFromOtherThreads) {
+  auto allocator = CreateThreadCachingAllocator();
+
+  // Blocks allocated by one thread are freed by other threads, which return
+  // them to the central free lists.
+  constexpr int kNumThreads = 4;
+  constexpr int kNumBlocks = 10000;
+  std::vector<std::vector<void*>> blocks(kNumThreads);
+  for (auto& thread_blocks : blocks) {
+    for (int i = 0; i < kNumBlocks; ++i)
+      thread_blocks.push_back(allocator->AllocateBytes(64, 64));
+  }
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (void* block : blocks[t]) allocator->DeallocateBytes(block, 64);
+      // Reuse the freed blocks.
+      for (int i = 0; i < kNumBlocks; ++i) {
+        void* block = allocator->AllocateBytes(64, 64);
+        ASSERT_NE(nullptr, block);
+        allocator->DeallocateBytes(block, 64);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+}
+
+// Allocates and deallocates a batch of small blocks, like the async values and
+// frames of a kernel execution.
+static void AllocateDeallocate(benchmark::State& state,
+                               HostAllocator* allocator) {
+  constexpr int kNumBlocks = 64;
+  const size_t size = state.range(0);
+  void* blocks[kNumBlocks];
+  for (auto _ : state) {
+    for (int i = 0; i < kNumBlocks; ++i)
+      blocks[i] = allocator->AllocateBytes(size, 8);
+    benchmark::DoNotOptimize(blocks);
+    for (int i = 0; i < kNumBlocks; ++i)
+      allocator->DeallocateBytes(blocks[i], size);
+  }
+  state.SetItemsProcessed(state.iterations() * kNumBlocks);
+}
+
+static void BM_MallocAllocator(benchmark::State& state) {
+  static HostAllocator* allocator = CreateMallocAllocator().release();
+  AllocateDeallocate(state, allocator);
+}
+BENCHMARK(BM_MallocAllocator)->Arg(64)->Arg(256)->ThreadRange(1, 8);
+
+static void BM_ThreadCachingAllocator(benchmark::State& state) {
+  static HostAllocator* allocator = CreateThreadCachingAllocator().release();
+  AllocateDeallocate(state, allocator);
+}
+BENCHMARK(BM_ThreadCachingAllocator)->Arg(64)->Arg(256)->ThreadRange(1, 8);
+
+}  // namespace
+}  // namespace tfrt
@@ -14,15 +14,24 @@
  * limitations under the License.
  */
 
-// Unit test for TFRT TimerQueue.
+// Unit test and benchmarks for TFRT TimerQueue.
 
 #include "tfrt/host_context/timer_queue.h"
 
+#include <atomic>
 #include <chrono>
 #include <ctime>
 #include <memory>
+#include <queue>
+#include <thread>
+#include <vector>
 
+#include "benchmark/benchmark.h"
 #include "gtest/gtest.h"
+#include "llvm/ADT/FunctionExtras.h"
+#include "tfrt/support/latch.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/ref_count.h"
 
 namespace tfrt {
 namespace {
@@ -93,5 +102,180 @@ TEST(TimerQueueTest, TimerQueueTimerCancelled) {
   ASSERT_FALSE(expired_2);
 }
 
+// This test checks that cancelled timers release their callbacks.
+TEST(TimerQueueTest, TimerQueueCancelReleasesCallback) {
+  TimerQueue tq;
+  auto state = std::make_shared<int>(0);
+
+  auto timer = tq.ScheduleTimer(1h, [state]() { ++*state; });
+  ASSERT_EQ(state.use_count(), 2);
+
+  tq.CancelTimer(timer);
+  ASSERT_EQ(state.use_count(), 1);
+
+  // Cancelling a timer twice is a no-op.
+  tq.CancelTimer(timer);
+}
+
+// This test checks that timers with a deadline in the past expire.
+TEST(TimerQueueTest, TimerQueuePastDeadlineExpires) {
+  TimerQueue tq;
+  latch expired(1);
+  auto timer = tq.ScheduleTimerAt(std::chrono::system_clock::now() - 1s,
+                                  [&]() { expired.count_down(); });
+  expired.wait();
+}
+
+// This test checks that a timer scheduled while the timer thread scans the
+// shards, here from a timer callback, expires on time, even if no other timer
+// is pending.
+TEST(TimerQueueTest, TimerQueueScheduleDuringScan) {
+  TimerQueue tq;
+  std::atomic<bool> expired{false};
+  std::chrono::system_clock::time_point deadline;
+  auto timer = tq.ScheduleTimer(10ms, [&]() {
+    deadline = std::chrono::system_clock::now() + 10ms;
+    tq.ScheduleTimerAt(deadline, [&]() { expired = true; });
+  });
+
+  auto start = std::chrono::system_clock::now();
+  while (!expired && std::chrono::system_clock::now() - start < 5s)
+    std::this_thread::sleep_for(1ms);
+  ASSERT_TRUE(expired);
+  EXPECT_LT(std::chrono::system_clock::now() - deadline, 1s);
+}
+
+// This test checks that timers scheduled by many threads, over several levels
+// of the timing wheels, never expire before their deadline.
+TEST(TimerQueueTest, TimerQueueManyThreads) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumTimersPerThread = 64;
+
+  TimerQueue tq;
+  latch expired(kNumThreads * kNumTimersPerThread);
+  std::atomic<int> num_early{0};
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&, i]() {
+      for (int j = 0; j < kNumTimersPerThread; ++j) {
+        auto deadline = std::chrono::system_clock::now() +
+                        std::chrono::milliseconds((i * 97 + j * 31) % 600);
+        tq.ScheduleTimerAt(deadline, [&, deadline]() {
+          if (std::chrono::system_clock::now() < deadline) ++num_early;
+          expired.count_down();
+        });
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  expired.wait();
+  EXPECT_EQ(num_early, 0);
+}
+
+// The TimerQueue implementation preceding the timing wheels, a binary heap
+// with lazy cancellation, as the baseline for the benchmarks.
+class HeapTimerQueue {
+  using Clock = std::chrono::system_clock;
+
+  struct TimerEntry : public ReferenceCounted<TimerEntry> {
+    TimerEntry(Clock::time_point deadline,
+               llvm::unique_function<void()> callback)
+        : deadline(deadline), callback(std::move(callback)) {}
+
+    Clock::time_point deadline;
+    llvm::unique_function<void()> callback;
+    std::atomic<bool> cancelled{false};
+  };
+
+  struct Compare {
+    bool operator()(const RCReference<TimerEntry>& a,
+                    const RCReference<TimerEntry>& b) const {
+      return a->deadline > b->deadline;
+    }
+  };
+
+ public:
+  using TimerHandle = RCReference<TimerEntry>;
+
+  HeapTimerQueue() : thread_([this]() { Run(); }) {}
+
+  ~HeapTimerQueue() {
+    {
+      mutex_lock lock(mu_);
+      stop_ = true;
+      cv_.notify_one();
+    }
+    thread_.join();
+  }
+
+  TimerHandle ScheduleTimer(Clock::duration timeout,
+                            llvm::unique_function<void()> callback) {
+    auto entry =
+        MakeRef<TimerEntry>(Clock::now() + timeout, std::move(callback));
+    mutex_lock lock(mu_);
+    bool notify = timers_.empty() || timers_.top()->deadline > entry->deadline;
+    timers_.push(entry);
+    if (notify) cv_.notify_one();
+    return entry;
+  }
+
+  void CancelTimer(const TimerHandle& timer) { timer->cancelled = true; }
+
+ private:
+  void Run() {
+    mutex_lock lock(mu_);
+    while (!stop_) {
+      while (!timers_.empty() && timers_.top()->cancelled) timers_.pop();
+      if (timers_.empty()) {
+        cv_.wait(lock);
+      } else {
+        cv_.wait_until(lock, timers_.top()->deadline);
+      }
+      while (!timers_.empty() && timers_.top()->deadline <= Clock::now()) {
+        auto entry = timers_.top();
+        timers_.pop();
+        if (!entry->cancelled) entry->callback();
+      }
+    }
+  }
+
+  mutex mu_;
+  condition_variable cv_;
+  bool stop_ = false;
+  std::priority_queue<RCReference<TimerEntry>,
+                      std::vector<RCReference<TimerEntry>>, Compare>
+      timers_;
+  std::thread thread_;
+};
+
+// Each iteration schedules a batch of request deadlines and cancels them, as
+// if the requests completed before their deadline.
+template <typename Queue>
+static void ScheduleAndCancel(benchmark::State& state) {
+  // Shared by all benchmark threads, and leaked as they may still use it
+  // when the first thread returns.
+  static auto* queue = new Queue();
+
+  const int batch_size = state.range(0);
+  std::vector<typename Queue::TimerHandle> timers(batch_size);
+  for (auto _ : state) {
+    for (auto& timer : timers) timer = queue->ScheduleTimer(100ms, []() {});
+    for (auto& timer : timers) queue->CancelTimer(timer);
+  }
+  state.SetItemsProcessed(state.iterations() * batch_size);
+}
+
+static void BM_HeapTimerQueue(benchmark::State& state) {
+  ScheduleAndCancel<HeapTimerQueue>(state);
+}
+BENCHMARK(BM_HeapTimerQueue)->Arg(1)->Arg(64)->ThreadRange(1, 8);
+
+static void BM_TimerQueue(benchmark::State& state) {
+  ScheduleAndCancel<TimerQueue>(state);
+}
+BENCHMARK(BM_TimerQueue)->Arg(1)->Arg(64)->ThreadRange(1, 8);
+
 }  // namespace
 }  // namespace tfrt
@@ -0,0 +1,168 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests for the asynchronous reads of RandomAccessFile.
+
+#include "tfrt/io/file_system.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/host_context.h"
+
+namespace tfrt {
+namespace io {
+namespace {
+
+class FileSystemTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("file_system_test", "bin",
+                                                    path_));
+    contents_.resize(100000);
+    for (size_t i = 0; i < contents_.size(); ++i) contents_[i] = i * 7;
+    std::error_code error_code;
+    llvm::raw_fd_ostream os(path_, error_code);
+    ASSERT_FALSE(error_code);
+    os.write(contents_.data(), contents_.size());
+  }
+
+  void TearDown() override { llvm::sys::fs::remove(path_); }
+
+  std::unique_ptr<RandomAccessFile> OpenFile(const std::string& scheme,
+                                             const std::string& path) {
+    auto* file_system = FileSystemRegistry::Default()->Lookup(scheme);
+    EXPECT_NE(file_system, nullptr);
+    std::unique_ptr<RandomAccessFile> file;
+    EXPECT_FALSE(file_system->NewRandomAccessFile(path, &file));
+    return file;
+  }
+
+  // Reads overlapping chunks of the file, including chunks that run past its
+  // end, and checks them against the contents of the file.
+  void CheckReadBatchAsync(const RandomAccessFile& file, HostContext* host) {
+    constexpr size_t kChunkSize = 3000;
+    constexpr size_t kNumReads = 60;
+
+    std::vector<std::vector<char>> buffers(kNumReads,
+                                           std::vector<char>(kChunkSize));
+    std::vector<ReadRequest> requests;
+    for (size_t i = 0; i < kNumReads; ++i)
+      requests.push_back({buffers[i].data(), kChunkSize, i * 2000 + 1});
+
+    std::vector<AsyncValueRef<size_t>> results =
+        file.ReadBatchAsync(requests, host);
+    ASSERT_EQ(results.size(), kNumReads);
+    std::vector<RCReference<AsyncValue>> values;
+    for (auto& result : results) values.push_back(result.CopyRCRef());
+    host->Await(values);
+
+    for (size_t i = 0; i < kNumReads; ++i) {
+      const size_t offset = requests[i].offset;
+      const size_t expected = offset >= contents_.size()
+                                  ? 0
+                                  : std::min(kChunkSize,
+                                             contents_.size() - offset);
+      ASSERT_FALSE(results[i].IsError()) << results[i].GetError();
+      ASSERT_EQ(results[i].get(), expected);
+      EXPECT_EQ(std::memcmp(buffers[i].data(), contents_.data() + offset,
+                            expected),
+                0);
+    }
+  }
+
+  llvm::SmallString<128> path_;
+  std::string contents_;
+};
+
+TEST_F(FileSystemTest, ReadAsync) {
+  auto host = CreateHostContext();
+  auto file = OpenFile("", path_.str().str());
+  ASSERT_NE(file, nullptr);
+
+  std::vector<char> buffer(contents_.size() + 10);
+  AsyncValueRef<size_t> result =
+      file->ReadAsync(buffer.data(), buffer.size(), /*offset=*/0, host.get());
+  host->Await(result.CopyRCRef());
+  ASSERT_FALSE(result.IsError());
+  ASSERT_EQ(result.get(), contents_.size());
+  EXPECT_EQ(std::string(buffer.data(), contents_.size()), contents_);
+}
+
+TEST_F(FileSystemTest, ReadBatchAsync) {
+  auto host = CreateHostContext();
+  auto file = OpenFile("", path_.str().str());
+  ASSERT_NE(file, nullptr);
+  CheckReadBatchAsync(*file, host.get());
+}
+
+TEST_F(FileSystemTest, ReadBatchAsyncFileScheme) {
+  auto host = CreateHostContext();
+  auto file = OpenFile("file", "file://" + path_.str().str());
+  ASSERT_NE(file, nullptr);
+  CheckReadBatchAsync(*file, host.get());
+}
+
+// A file that only implements the synchronous reads, which tests the default
+// implementation of the asynchronous reads.
+class SyncRandomAccessFile : public RandomAccessFile {
+ public:
+  explicit SyncRandomAccessFile(std::unique_ptr<RandomAccessFile> file)
+      : file_(std::move(file)) {}
+
+  llvm::Expected<size_t> Read(char* buf, size_t max_count,
+                              size_t offset) const override {
+    return file_->Read(buf, max_count, offset);
+  }
+
+ private:
+  std::unique_ptr<RandomAccessFile> file_;
+};
+
+TEST_F(FileSystemTest, ReadBatchAsyncOnBlockingThreads) {
+  auto host = CreateHostContext();
+  SyncRandomAccessFile file(OpenFile("", path_.str().str()));
+  CheckReadBatchAsync(file, host.get());
+}
+
+TEST(FileSystemRegistryTest, LookupForPath) {
+  auto* registry = FileSystemRegistry::Default();
+
+  auto local = registry->LookupForPath("/tmp/file");
+  ASSERT_TRUE(!!local);
+  EXPECT_EQ(*local, registry->Lookup(""));
+
+  auto file_scheme = registry->LookupForPath("file:///tmp/file");
+  ASSERT_TRUE(!!file_scheme);
+  EXPECT_EQ(*file_scheme, registry->Lookup("file"));
+
+  auto unknown = registry->LookupForPath("unknown://file");
+  ASSERT_FALSE(!!unknown);
+  EXPECT_EQ(llvm::toString(unknown.takeError()),
+            "no file system is registered for scheme 'unknown' to open "
+            "unknown://file");
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace tfrt
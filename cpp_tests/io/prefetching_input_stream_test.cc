@@ -0,0 +1,165 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests for PrefetchingInputStream.
+
+#include "tfrt/io/prefetching_input_stream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/host_context.h"
+
+namespace tfrt {
+namespace io {
+namespace {
+
+// A file in memory, whose read at `fail_offset` fails once.
+class MemoryFile : public RandomAccessFile {
+ public:
+  explicit MemoryFile(std::string contents, size_t fail_offset = SIZE_MAX)
+      : contents_(std::move(contents)), fail_offset_(fail_offset) {}
+
+  llvm::Expected<size_t> Read(char* buf, size_t max_count,
+                              size_t offset) const override {
+    if (offset == fail_offset_ && !failed_.exchange(true))
+      return MakeStringError("failed to read at offset ", offset);
+    if (offset >= contents_.size()) return 0;
+    size_t count = std::min(max_count, contents_.size() - offset);
+    std::memcpy(buf, contents_.data() + offset, count);
+    return count;
+  }
+
+ private:
+  std::string contents_;
+  size_t fail_offset_;
+  mutable std::atomic<bool> failed_{false};
+};
+
+std::string MakeContents(size_t size) {
+  std::string contents(size, 0);
+  for (size_t i = 0; i < size; ++i) contents[i] = 'a' + i % 26;
+  return contents;
+}
+
+// Reads the stream in chunks of `chunk_size` bytes until EOF.
+std::string ReadAll(InputStream& stream, size_t chunk_size) {
+  std::string result;
+  std::vector<char> chunk(chunk_size);
+  while (true) {
+    auto count = stream.Read(chunk.data(), chunk_size);
+    EXPECT_TRUE(!!count);
+    if (!count) {
+      llvm::consumeError(count.takeError());
+      break;
+    }
+    result.append(chunk.data(), *count);
+    if (*count < chunk_size) break;
+  }
+  return result;
+}
+
+TEST(PrefetchingInputStreamTest, Read) {
+  auto host = CreateHostContext();
+  for (size_t size : {0, 1, 6, 7, 8, 21, 1000}) {
+    for (size_t chunk_size : {1, 5, 7, 100, 2000}) {
+      std::string contents = MakeContents(size);
+      PrefetchingInputStream stream(std::make_unique<MemoryFile>(contents),
+                                    host.get(), /*buffer_size=*/7,
+                                    /*max_buffer_size=*/7, /*num_buffers=*/3);
+      EXPECT_EQ(ReadAll(stream, chunk_size), contents)
+          << "size: " << size << ", chunk_size: " << chunk_size;
+      EXPECT_EQ(*stream.Tell(), size);
+
+      // Reads after EOF return no bytes.
+      char c;
+      EXPECT_EQ(*stream.Read(&c, 1), 0u);
+    }
+  }
+}
+
+TEST(PrefetchingInputStreamTest, AdaptiveBufferSize) {
+  auto host = CreateHostContext();
+  std::string contents = MakeContents(10000);
+  PrefetchingInputStream stream(std::make_unique<MemoryFile>(contents),
+                                host.get(), /*buffer_size=*/16,
+                                /*max_buffer_size=*/256);
+  EXPECT_EQ(ReadAll(stream, 100), contents);
+
+  // The blocking work of the single threaded work queue only runs when it is
+  // awaited, so every read stalls the consumer, and the buffer grows to its
+  // maximum size.
+  EXPECT_EQ(stream.buffer_size(), 256u);
+}
+
+TEST(PrefetchingInputStreamTest, ReadError) {
+  auto host = CreateHostContext();
+  std::string contents = MakeContents(100);
+  PrefetchingInputStream stream(
+      std::make_unique<MemoryFile>(contents, /*fail_offset=*/20), host.get(),
+      /*buffer_size=*/10, /*max_buffer_size=*/10);
+
+  char buf[20];
+  auto count = stream.Read(buf, 20);
+  ASSERT_TRUE(!!count);
+  EXPECT_EQ(std::string(buf, *count), contents.substr(0, 20));
+
+  count = stream.Read(buf, 10);
+  ASSERT_FALSE(!!count);
+  EXPECT_EQ(llvm::toString(count.takeError()),
+            "failed to read at offset 20");
+
+  // The failed read is retried by the next call.
+  EXPECT_EQ(ReadAll(stream, 10), contents.substr(20));
+  EXPECT_EQ(*stream.Tell(), contents.size());
+}
+
+TEST(PrefetchingInputStreamTest, ReadErrorAfterPartialRead) {
+  auto host = CreateHostContext();
+  std::string contents = MakeContents(100);
+  PrefetchingInputStream stream(
+      std::make_unique<MemoryFile>(contents, /*fail_offset=*/20), host.get(),
+      /*buffer_size=*/10, /*max_buffer_size=*/10);
+
+  char buf[25];
+  auto count = stream.Read(buf, 10);
+  ASSERT_TRUE(!!count);
+  EXPECT_EQ(std::string(buf, *count), contents.substr(0, 10));
+
+  // The bytes before the failed buffer are returned first.
+  count = stream.Read(buf, 25);
+  ASSERT_TRUE(!!count);
+  EXPECT_EQ(std::string(buf, *count), contents.substr(10, 10));
+  EXPECT_EQ(*stream.Tell(), 20u);
+
+  count = stream.Read(buf, 25);
+  ASSERT_FALSE(!!count);
+  EXPECT_EQ(llvm::toString(count.takeError()),
+            "failed to read at offset 20");
+  EXPECT_EQ(*stream.Tell(), 20u);
+
+  EXPECT_EQ(ReadAll(stream, 25), contents.substr(20));
+  EXPECT_EQ(*stream.Tell(), contents.size());
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace tfrt
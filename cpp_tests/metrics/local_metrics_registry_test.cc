@@ -0,0 +1,201 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests and benchmarks for LocalMetricsRegistry.
+
+#include "tfrt/metrics/local_metrics_registry.h"
+
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/cpp_tests/error_util.h"
+#include "tfrt/metrics/metrics_registry.h"
+
+namespace tfrt {
+namespace metrics {
+namespace {
+
+using ::testing::HasSubstr;
+
+std::string WriteText(const LocalMetricsRegistry& registry) {
+  std::string text;
+  llvm::raw_string_ostream os(text);
+  registry.WritePrometheusText(os);
+  return os.str();
+}
+
+TEST(LocalMetricsRegistryTest, Counter) {
+  LocalMetricsRegistry registry;
+  Counter* counter = registry.NewCounter("/tfrt/test/counter");
+  counter->Increment();
+  counter->IncrementBy(41);
+
+  EXPECT_EQ(WriteText(registry),
+            "# TYPE tfrt_test_counter counter\n"
+            "tfrt_test_counter 42\n");
+}
+
+TEST(LocalMetricsRegistryTest, Gauges) {
+  LocalMetricsRegistry registry;
+  registry.NewInt64Gauge("/tfrt/test/int")->Set(-3);
+  registry.NewDoubleGauge("/tfrt/test/double")->Set(0.5);
+  registry.NewStringGauge("/tfrt/test/string")->Set("a\"b");
+
+  EXPECT_EQ(WriteText(registry),
+            "# TYPE tfrt_test_double gauge\n"
+            "tfrt_test_double 0.5\n"
+            "# TYPE tfrt_test_int gauge\n"
+            "tfrt_test_int -3\n"
+            "# TYPE tfrt_test_string gauge\n"
+            "tfrt_test_string{value=\"a\\\"b\"} 1\n");
+}
+
+TEST(LocalMetricsRegistryTest, Histogram) {
+  LocalMetricsRegistry registry;
+  Histogram* histogram = registry.NewHistogram(
+      "/tfrt/test/histogram", Buckets::Explicit({1.0, 10.0}));
+  histogram->Record(0.5);
+  histogram->Record(5.0);
+  histogram->Record(100.0);
+
+  EXPECT_EQ(WriteText(registry),
+            "# TYPE tfrt_test_histogram histogram\n"
+            "tfrt_test_histogram_bucket{le=\"1\"} 1\n"
+            "tfrt_test_histogram_bucket{le=\"10\"} 2\n"
+            "tfrt_test_histogram_bucket{le=\"+Inf\"} 3\n"
+            "tfrt_test_histogram_sum 105.5\n"
+            "tfrt_test_histogram_count 3\n");
+}
+
+TEST(LocalMetricsRegistryTest, HistogramValueOnBound) {
+  LocalMetricsRegistry registry;
+  Histogram* histogram = registry.NewHistogram(
+      "/tfrt/test/histogram", Buckets::Explicit({1.0, 10.0}));
+  // A value equal to a bound is counted in the bucket that ends at the bound,
+  // as documented by Buckets::Explicit.
+  histogram->Record(1.0);
+  histogram->Record(10.0);
+
+  EXPECT_EQ(WriteText(registry),
+            "# TYPE tfrt_test_histogram histogram\n"
+            "tfrt_test_histogram_bucket{le=\"1\"} 1\n"
+            "tfrt_test_histogram_bucket{le=\"10\"} 2\n"
+            "tfrt_test_histogram_bucket{le=\"+Inf\"} 2\n"
+            "tfrt_test_histogram_sum 11\n"
+            "tfrt_test_histogram_count 2\n");
+}
+
+TEST(LocalMetricsRegistryTest, SameNameIsSameMetric) {
+  LocalMetricsRegistry registry;
+  Counter* counter = registry.NewCounter("/tfrt/test/metric");
+  EXPECT_EQ(registry.NewCounter("/tfrt/test/metric"), counter);
+
+  // A metric of another type is not exported.
+  registry.NewInt64Gauge("/tfrt/test/metric")->Set(7);
+  counter->Increment();
+  EXPECT_EQ(WriteText(registry),
+            "# TYPE tfrt_test_metric counter\n"
+            "tfrt_test_metric 1\n");
+}
+
+TEST(LocalMetricsRegistryTest, CollectionCallbacks) {
+  LocalMetricsRegistry registry;
+  int64_t buffered = 0;
+  int64_t id = AddCollectionCallback([&]() {
+    registry.NewCounter("/tfrt/test/collected")->IncrementBy(buffered);
+    buffered = 0;
+  });
+
+  buffered = 3;
+  EXPECT_EQ(WriteText(registry),
+            "# TYPE tfrt_test_collected counter\n"
+            "tfrt_test_collected 3\n");
+
+  RemoveCollectionCallback(id);
+  buffered = 4;
+  EXPECT_EQ(WriteText(registry),
+            "# TYPE tfrt_test_collected counter\n"
+            "tfrt_test_collected 3\n");
+}
+
+TEST(LocalMetricsRegistryTest, ConcurrentRecording) {
+  LocalMetricsRegistry registry;
+  Counter* counter = registry.NewCounter("/tfrt/test/counter");
+  Histogram* histogram = registry.NewHistogram(
+      "/tfrt/test/histogram", Buckets::Explicit({1, 2, 4, 8, 16, 32, 64}));
+
+  constexpr int kNumThreads = 8;
+  constexpr int kNumIterations = 10000;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < kNumIterations; ++j) {
+        counter->Increment();
+        histogram->Record(j % 100);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  std::string text = WriteText(registry);
+  const std::string total = std::to_string(kNumThreads * kNumIterations);
+  EXPECT_THAT(text, HasSubstr("tfrt_test_counter " + total + "\n"));
+  EXPECT_THAT(text, HasSubstr("tfrt_test_histogram_count " + total + "\n"));
+}
+
+TEST(LocalMetricsRegistryTest, WriteFile) {
+  LocalMetricsRegistry registry;
+  registry.NewCounter("/tfrt/test/counter")->Increment();
+
+  EXPECT_THAT(
+      registry.WritePrometheusTextFile(::testing::TempDir() + "/metrics.txt"),
+      IsSuccess());
+  EXPECT_THAT(registry.WritePrometheusTextFile("/nonexistent/dir/metrics.txt"),
+              IsFailure());
+#if defined(__linux__)
+  // Writes to /dev/full fail with ENOSPC.
+  EXPECT_THAT(registry.WritePrometheusTextFile("/dev/full"), IsFailure());
+#endif
+}
+
+void BM_CounterIncrement(benchmark::State& state) {
+  static LocalMetricsRegistry* registry = new LocalMetricsRegistry();
+  Counter* counter = registry->NewCounter("/tfrt/benchmark/counter");
+  for (auto _ : state) counter->Increment();
+}
+BENCHMARK(BM_CounterIncrement)->ThreadRange(1, 8);
+
+void BM_HistogramRecord(benchmark::State& state) {
+  static LocalMetricsRegistry* registry = new LocalMetricsRegistry();
+  std::vector<double> bounds;
+  for (double bound = 1; bound < 1e6; bound *= 2) bounds.push_back(bound);
+  Histogram* histogram = registry->NewHistogram(
+      "/tfrt/benchmark/histogram", Buckets::Explicit(std::move(bounds)));
+  double value = 0;
+  for (auto _ : state) {
+    histogram->Record(value);
+    value = value < 1e6 ? value * 2 + 1 : 0;
+  }
+}
+BENCHMARK(BM_HistogramRecord)->ThreadRange(1, 8);
+
+}  // namespace
+}  // namespace metrics
+}  // namespace tfrt
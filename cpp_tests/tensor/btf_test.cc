@@ -18,7 +18,11 @@
 
 #include "tfrt/tensor/btf.h"
 
+#include <fstream>
+
 #include "gtest/gtest.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/raw_ostream.h"
 #include "tfrt/cpp_tests/test_util.h"
 #include "tfrt/tensor/btf_util.h"
@@ -103,6 +107,97 @@ TEST(BTFTest, BTFWriteAndRead) {
   }
 }
 
+class MappedBTFFileTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_FALSE(
+        llvm::sys::fs::createTemporaryFile("btf_test", "btf", path_));
+  }
+
+  void TearDown() override { llvm::sys::fs::remove(path_); }
+
+  void WriteFile(const std::string& contents) {
+    std::ofstream os(path_.str().str(), std::ios_base::binary);
+    os << contents;
+  }
+
+  llvm::SmallString<128> path_;
+};
+
+TEST_F(MappedBTFFileTest, ReadDHT) {
+  auto context = CreateHostContext();
+  const auto a = CreateDummyTensor<int>({3, 2}, context.get());
+  const auto b = CreateDummyTensor<uint8_t>({63}, context.get());
+  const auto c = CreateDummyTensor<double>({}, context.get());
+  std::vector<const Tensor*> tensors{&a, &b, &c};
+  std::stringstream os;
+  ASSERT_FALSE(WriteTensorsToBTF(&os, tensors));
+  WriteFile(os.str());
+
+  auto file = MappedBTFFile::Open(path_.str());
+  ASSERT_TRUE(!!file) << llvm::toString(file.takeError());
+  ASSERT_EQ(file->num_tensors(), tensors.size());
+
+  std::vector<DenseHostTensor> outs;
+  for (int i = 0; i < tensors.size(); i++) {
+    const auto& expected =
+        reinterpret_cast<const DenseHostTensor&>(*tensors[i]);
+    auto out = file->ReadDHT(i);
+    ASSERT_TRUE(!!out) << llvm::toString(out.takeError());
+    EXPECT_EQ(*out, expected);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(out->data()) %
+                  GetHostAlignment(out->dtype()),
+              0u);
+    outs.push_back(std::move(*out));
+  }
+
+  // The tensors alias the mapping instead of copying it.
+  auto again = file->ReadDHT(0);
+  ASSERT_TRUE(!!again);
+  EXPECT_EQ(again->data(), outs[0].data());
+
+  // The tensors keep the mapping alive.
+  file = MakeStringError("closed");
+  llvm::consumeError(file.takeError());
+  for (int i = 0; i < tensors.size(); i++) {
+    EXPECT_EQ(outs[i], reinterpret_cast<const DenseHostTensor&>(*tensors[i]));
+  }
+
+  auto reopened = MappedBTFFile::Open(path_.str());
+  ASSERT_TRUE(!!reopened);
+  auto error = reopened->ReadDHT(tensors.size()).takeError();
+  EXPECT_FALSE(error.success());
+  llvm::consumeError(std::move(error));
+}
+
+TEST_F(MappedBTFFileTest, InvalidOffsets) {
+  // The offset of the only tensor is not 8-byte aligned.
+  const uint64_t header[] = {1, 20, 0, 0};
+  WriteFile(std::string(reinterpret_cast<const char*>(header), sizeof(header)));
+  auto file = MappedBTFFile::Open(path_.str());
+  ASSERT_FALSE(!!file);
+  EXPECT_EQ(llvm::toString(file.takeError()),
+            StrCat("invalid tensor record offset 20 for tensor index 0 in ",
+                   path_.str()));
+}
+
+TEST_F(MappedBTFFileTest, TruncatedTensorData) {
+  auto context = CreateHostContext();
+  const auto a = CreateDummyTensor<float>({4, 4}, context.get());
+  std::vector<const Tensor*> tensors{&a};
+  std::stringstream os;
+  ASSERT_FALSE(WriteTensorsToBTF(&os, tensors));
+  const std::string contents = os.str();
+  WriteFile(contents.substr(0, contents.size() - 8));
+
+  auto file = MappedBTFFile::Open(path_.str());
+  ASSERT_TRUE(!!file) << llvm::toString(file.takeError());
+  auto out = file->ReadDHT(0);
+  ASSERT_FALSE(!!out);
+  EXPECT_EQ(llvm::toString(out.takeError()),
+            "failed to read tensor data at offset 16");
+}
+
 }  // namespace
 }  // namespace btf
 }  // namespace tfrt
@@ -0,0 +1,245 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests and benchmarks for the ring buffer tracing sink and the binary
+// trace format.
+
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/tracing/trace_file.h"
+#include "tfrt/tracing/tracing.h"
+
+namespace tfrt {
+namespace tracing {
+namespace {
+
+#define TFRT_SKIP_IF(cond) \
+  if (cond) GTEST_SKIP() << #cond;
+
+TraceFile MakeTraceFile() {
+  TraceFile trace;
+  trace.ns_per_tick = 0.5;
+  trace.names = {"outer", "inner \"quoted\""};
+  TraceThread thread;
+  thread.thread_id = 3;
+  thread.events.push_back({/*begin=*/10, /*end=*/20, /*name_id=*/1, false});
+  thread.events.push_back({/*begin=*/0, /*end=*/100, /*name_id=*/0, false});
+  thread.events.push_back({/*begin=*/50, /*end=*/50, /*name_id=*/0, true});
+  trace.threads.push_back(thread);
+  return trace;
+}
+
+std::string WriteToString(const TraceFile& trace) {
+  std::string data;
+  llvm::raw_string_ostream os(data);
+  WriteTraceFile(trace, os);
+  return os.str();
+}
+
+TEST(TraceFileTest, RoundTrip) {
+  TraceFile trace = MakeTraceFile();
+  auto result = ReadTraceFile(WriteToString(trace));
+  ASSERT_TRUE(!!result) << llvm::toString(result.takeError());
+
+  EXPECT_EQ(result->ns_per_tick, trace.ns_per_tick);
+  EXPECT_EQ(result->names, trace.names);
+  ASSERT_EQ(result->threads.size(), 1);
+  EXPECT_EQ(result->threads[0].thread_id, 3);
+  ASSERT_EQ(result->threads[0].events.size(), 3);
+  for (int i = 0; i < 3; ++i) {
+    const TraceEvent& expected = trace.threads[0].events[i];
+    const TraceEvent& event = result->threads[0].events[i];
+    EXPECT_EQ(event.begin, expected.begin);
+    EXPECT_EQ(event.end, expected.end);
+    EXPECT_EQ(event.name_id, expected.name_id);
+    EXPECT_EQ(event.instant, expected.instant);
+  }
+}
+
+TEST(TraceFileTest, InvalidFile) {
+  EXPECT_FALSE(!!ReadTraceFile("not a trace file"));
+
+  std::string data = WriteToString(MakeTraceFile());
+  auto result = ReadTraceFile(llvm::StringRef(data).drop_back(8));
+  ASSERT_FALSE(!!result);
+  EXPECT_EQ(llvm::toString(result.takeError()),
+            "Invalid trace file: truncated events");
+}
+
+TEST(TraceFileTest, ChromeTraceJson) {
+  std::string json;
+  llvm::raw_string_ostream os(json);
+  WriteChromeTraceJson(MakeTraceFile(), os);
+
+  auto value = llvm::json::parse(os.str());
+  ASSERT_TRUE(!!value) << llvm::toString(value.takeError());
+  const llvm::json::Array* events =
+      value->getAsObject()->getArray("traceEvents");
+  ASSERT_NE(events, nullptr);
+  ASSERT_EQ(events->size(), 3);
+
+  const llvm::json::Object* inner = (*events)[0].getAsObject();
+  EXPECT_EQ(*inner->getString("name"), "inner \"quoted\"");
+  EXPECT_EQ(*inner->getString("ph"), "X");
+  EXPECT_EQ(*inner->getInteger("tid"), 3);
+  EXPECT_DOUBLE_EQ(*inner->getNumber("ts"), 0.005);
+  EXPECT_DOUBLE_EQ(*inner->getNumber("dur"), 0.005);
+
+  const llvm::json::Object* instant = (*events)[2].getAsObject();
+  EXPECT_EQ(*instant->getString("ph"), "i");
+}
+
+std::string GetTraceFilePath() {
+  const char* dir = std::getenv("TEST_TMPDIR");
+  return std::string(dir ? dir : "/tmp") + "/ring_buffer_tracing_sink.trace";
+}
+
+TEST(RingBufferTracingSinkTest, WritesTrace) {
+  TFRT_SKIP_IF(internal::kMaxTracingLevel < TracingLevel::Default)
+
+  const std::string path = GetTraceFilePath();
+  setenv("TFRT_TRACE_FILE", path.c_str(), /*overwrite=*/1);
+
+  RequestTracing(true);
+  {
+    TracingScope outer(TracingLevel::Default, [] { return "outer"; });
+    { TracingScope inner(TracingLevel::Default, [] { return "inner"; }); }
+    RecordTracingEvent(TracingLevel::Default, [] { return "event"; });
+  }
+  std::thread([] {
+    TracingScope scope(TracingLevel::Default, [] { return "thread"; });
+  }).join();
+  RequestTracing(false);
+
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  ASSERT_TRUE(!!buffer);
+  auto trace = ReadTraceFile((*buffer)->getBuffer());
+  ASSERT_TRUE(!!trace) << llvm::toString(trace.takeError());
+  ASSERT_EQ(trace->threads.size(), 2);
+
+  auto name = [&](const TraceEvent& event) {
+    return trace->names[event.name_id];
+  };
+
+  // Scopes are recorded when they end.
+  const auto& events = trace->threads[0].events;
+  ASSERT_EQ(events.size(), 3);
+  EXPECT_EQ(name(events[0]), "inner");
+  EXPECT_EQ(name(events[1]), "event");
+  EXPECT_TRUE(events[1].instant);
+  EXPECT_EQ(name(events[2]), "outer");
+  EXPECT_LE(events[2].begin, events[0].begin);
+  EXPECT_LE(events[0].end, events[2].end);
+
+  ASSERT_EQ(trace->threads[1].events.size(), 1);
+  EXPECT_EQ(name(trace->threads[1].events[0]), "thread");
+}
+
+TEST(RingBufferTracingSinkTest, WritesStaticNames) {
+  TFRT_SKIP_IF(internal::kMaxTracingLevel < TracingLevel::Default)
+
+  const std::string path = GetTraceFilePath();
+  setenv("TFRT_TRACE_FILE", path.c_str(), /*overwrite=*/1);
+
+  RequestTracing(true);
+  std::thread([] {
+    TFRT_TRACE_STATIC_SCOPE(Default, "static scope");
+    TFRT_TRACE_STATIC_EVENT(Default, "static event");
+    // A dynamic name with the same characters shares the name.
+    TFRT_TRACE_EVENT(Default, std::string("static ") + "event");
+  }).join();
+  RequestTracing(false);
+
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  ASSERT_TRUE(!!buffer);
+  auto trace = ReadTraceFile((*buffer)->getBuffer());
+  ASSERT_TRUE(!!trace) << llvm::toString(trace.takeError());
+  ASSERT_EQ(trace->threads.size(), 1);
+
+  const auto& events = trace->threads[0].events;
+  ASSERT_EQ(events.size(), 3);
+  EXPECT_EQ(trace->names[events[0].name_id], "static event");
+  EXPECT_TRUE(events[0].instant);
+  EXPECT_EQ(events[1].name_id, events[0].name_id);
+  EXPECT_EQ(trace->names[events[2].name_id], "static scope");
+  EXPECT_FALSE(events[2].instant);
+}
+
+TEST(RingBufferTracingSinkTest, KeepsLastRecords) {
+  TFRT_SKIP_IF(internal::kMaxTracingLevel < TracingLevel::Default)
+
+  const std::string path = GetTraceFilePath();
+  setenv("TFRT_TRACE_FILE", path.c_str(), /*overwrite=*/1);
+
+  // The number of records of a thread buffer. The oldest slot may be being
+  // overwritten, so one record less is dumped.
+  constexpr int kRecordsPerThread = 1 << 16;
+  RequestTracing(true);
+  std::thread([] {
+    for (int i = 0; i < kRecordsPerThread + 10; ++i)
+      RecordTracingEvent(TracingLevel::Default, [] { return "event"; });
+  }).join();
+  RequestTracing(false);
+
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  ASSERT_TRUE(!!buffer);
+  auto trace = ReadTraceFile((*buffer)->getBuffer());
+  ASSERT_TRUE(!!trace) << llvm::toString(trace.takeError());
+  ASSERT_EQ(trace->threads.size(), 1);
+  EXPECT_EQ(trace->threads[0].events.size(), kRecordsPerThread - 1);
+}
+
+static void BM_RingBufferTracingScope(benchmark::State& state) {
+  setenv("TFRT_TRACE_FILE", GetTraceFilePath().c_str(), /*overwrite=*/1);
+  RequestTracing(true);
+  for (auto _ : state) {
+    TracingScope scope(TracingLevel::Default, [] { return "kernel"; });
+  }
+  RequestTracing(false);
+}
+BENCHMARK(BM_RingBufferTracingScope);
+
+static void BM_RingBufferStaticTracingScope(benchmark::State& state) {
+  setenv("TFRT_TRACE_FILE", GetTraceFilePath().c_str(), /*overwrite=*/1);
+  RequestTracing(true);
+  for (auto _ : state) {
+    TFRT_TRACE_STATIC_SCOPE(Default, "kernel");
+  }
+  RequestTracing(false);
+}
+BENCHMARK(BM_RingBufferStaticTracingScope);
+
+// A name that does not fit in the inline storage of std::string, so that each
+// scope allocates it.
+static void BM_RingBufferTracingScopeLongName(benchmark::State& state) {
+  setenv("TFRT_TRACE_FILE", GetTraceFilePath().c_str(), /*overwrite=*/1);
+  RequestTracing(true);
+  for (auto _ : state) {
+    TracingScope scope(TracingLevel::Default,
+                       [] { return "tf.MatMul kernel with a long name"; });
+  }
+  RequestTracing(false);
+}
+BENCHMARK(BM_RingBufferTracingScopeLongName);
+
+}  // namespace
+}  // namespace tracing
+}  // namespace tfrt
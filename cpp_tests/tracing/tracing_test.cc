@@ -166,6 +166,25 @@ TEST(TracingTest, Scopes) {
   TracingScope(TracingLevel::Default, [] { return "scope3"; });
 }
 
+TEST(TracingTest, StaticNames) {
+  TFRT_SKIP_IF(internal::kMaxTracingLevel < TracingLevel::Default);
+
+  InSequence seq;
+  StrictMock<MockTracingSink> sink;
+  EXPECT_CALL(sink, RequestTracing(true)).Times(1);
+  RequestTracing(true);
+
+  // By default, static names are passed to the NameGenerator overloads.
+  EXPECT_CALL(sink, RecordTracingEvent(FunctionReturns("event"))).Times(1);
+  TFRT_TRACE_STATIC_EVENT(Default, "event");
+  EXPECT_CALL(sink, PushTracingScope(FunctionReturns("scope"))).Times(1);
+  EXPECT_CALL(sink, PopTracingScope()).Times(1);
+  { TFRT_TRACE_STATIC_SCOPE(Default, "scope"); }
+
+  EXPECT_CALL(sink, RequestTracing(false)).Times(1);
+  RequestTracing(false);
+}
+
 }  // namespace
 }  // namespace tracing
 }  // namespace tfrt
@@ -37,11 +37,24 @@ enum : uint8_t {
   kBEFMagic1 = 0x0B,
   kBEFMagic2 = 0xEF,
 
-  // This is the only known version of BEF files at the moment, new numbers
-  // should be used when/if a format break is introduced.
+  // The format versions of BEF files. New numbers should be used when/if a
+  // format break is introduced.
+  //
+  // Version 0 is the original format, whose kernel table entries have no
+  // Priority field. It is still supported by the readers.
   kBEFVersion0 = 0,
+  // Version 1 adds the Priority field to the kernel table entries.
+  kBEFVersion1 = 1,
+  // The version of the BEF files written by MLIRToBEF.
+  kBEFCurrentVersion = kBEFVersion1,
 };
 
+// Returns whether the kernel table entries of a BEF file of `format_version`
+// have a Priority field.
+constexpr bool BEFKernelEntriesHavePriority(uint8_t format_version) {
+  return format_version >= kBEFVersion1;
+}
+
 // These are the section ID's for the standard sections.  Each section is
 // encoded with an ID, followed by a length, followed by the contents of the
 // section:
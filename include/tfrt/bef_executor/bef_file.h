@@ -52,21 +52,50 @@ class BEFFile : public ReferenceCounted<BEFFile> {
   // pointer to our initialized object on success.  On failure, an error
   // message is emitted to the error_handler and nullptr is returned.
   //
-  // TODO: This should (optionally) manage ownership of the underlying data
-  // passed in, taking a closure to run when the lifetime of the BEFFile is
-  // done.
+  // Only the function index is decoded by Open(). The body of a function is
+  // decoded, and its kernels are bound to the kernels in `registry`, on the
+  // first GetFunction() or execution of the function. Hence an unknown kernel
+  // is reported when a function that uses it is first used, and `registry`
+  // must outlive the BEFFile.
+  //
+  // The caller must keep `file` alive for the lifetime of the BEFFile. Use
+  // OpenMapped() to let the BEFFile own the file contents. The executions of
+  // the functions allocate their frames with `host_allocator`, which must also
+  // outlive the BEFFile.
   static RCReference<BEFFile> Open(ArrayRef<uint8_t> file,
                                    const KernelRegistry& registry,
                                    ErrorHandler error_handler,
                                    HostAllocator* host_allocator);
 
+  // Open the BEF file at `path` by memory mapping it read-only through the
+  // file system registered for the scheme of `path` (see tfrt/io), so that
+  // the file contents are not copied and the pages can be shared by processes
+  // loading the same file. The mapping is kept alive as long as the BEFFile.
+  //
+  // If `prefetch` is true, the sections that are accessed during execution
+  // (functions, kernels and attributes) are paged in ahead of time. On
+  // failure, an error message is emitted to the error_handler and nullptr is
+  // returned.
+  static RCReference<BEFFile> OpenMapped(string_view path,
+                                         const KernelRegistry& registry,
+                                         ErrorHandler error_handler,
+                                         HostAllocator* host_allocator,
+                                         bool prefetch = false);
+
   // Get a list of functions out of the BEF file.
   void GetFunctionList(llvm::SmallVectorImpl<const Function*>* result) const;
 
   // Return the Function record with the specified name, or null if it isn't
-  // found in this BEF file.
+  // found in this BEF file. The function is decoded on the first call, and
+  // null is returned if it cannot be decoded, in which case an error is
+  // emitted to the error_handler. It is safe to call this method concurrently.
   const Function* GetFunction(string_view function_name) const;
 
+  // Same as GetFunction(), but tells a function that is not found from one
+  // that cannot be decoded: return null in the first case, and an error in
+  // the second case.
+  Expected<const Function*> GetFunctionOrError(string_view function_name) const;
+
   LocationHandler* location_handler() const { return location_handler_.get(); }
 
   virtual ~BEFFile() = 0;
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2022 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Kernel Latency Sampler
+//
+// This file declares KernelLatencySampler, which records the latency of a
+// sample of the kernels executed by BEFExecutor into per-kernel histograms.
+
+#ifndef TFRT_BEF_EXECUTOR_KERNEL_LATENCY_SAMPLER_H_
+#define TFRT_BEF_EXECUTOR_KERNEL_LATENCY_SAMPLER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Compiler.h"
+#include "tfrt/metrics/histogram.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+
+// KernelLatencySampler records the wall time of one in `sample_period` kernel
+// executions, on average, into one histogram per kernel name. The histograms
+// are created through tfrt/metrics with the name
+// "/tensorflow/runtime/bef_executor/kernel_latency/<kernel name>", and record
+// latencies in microseconds.
+//
+// Samples are buffered per thread, and exported to the histograms when the
+// buffer of a thread is full or when Flush() is called. The sampler registers
+// Flush() as a metrics collection callback, so that the registry exports the
+// buffered samples before it reads the metrics. Kernel executions that are not
+// sampled only decrement a thread-local counter.
+//
+// Note that the wall time of an asynchronous kernel only covers the
+// synchronous part of the kernel, ie. until the kernel returns to the executor.
+//
+// This class is thread-safe.
+class KernelLatencySampler {
+ public:
+  // Returns the default histogram buckets, powers of two from 0.25us to about
+  // one second.
+  static metrics::Buckets DefaultBuckets();
+
+  explicit KernelLatencySampler(int sample_period,
+                                metrics::Buckets buckets = DefaultBuckets());
+  ~KernelLatencySampler();
+
+  // Returns whether the next kernel execution of the calling thread should be
+  // sampled.
+  bool ShouldSample() {
+    if (LLVM_LIKELY(--sample_countdown_ > 0)) return false;
+    ResetSampleCountdown();
+    return true;
+  }
+
+  // Record that the kernel `kernel_name` ran for `duration`.
+  void RecordKernel(string_view kernel_name, std::chrono::nanoseconds duration);
+
+  // Export the samples buffered by all threads to the histograms.
+  void Flush();
+
+ private:
+  struct ThreadSamples;
+
+  // Start a new sampling period for the calling thread, with a random length
+  // of `sample_period_` on average, so that the samples are not correlated
+  // with periodic patterns of kernel executions.
+  void ResetSampleCountdown();
+
+  ThreadSamples& GetThreadSamples();
+
+  // Export `samples` to the histograms.
+  void Export(llvm::StringMap<std::vector<double>> samples);
+
+  static thread_local int64_t sample_countdown_;
+
+  const int sample_period_;
+  const metrics::Buckets buckets_;
+  // Identifies the sampler in the thread-local state, as the address of a
+  // destroyed sampler can be reused.
+  const uint64_t id_;
+  // The id of the collection callback that flushes the samples.
+  const int64_t collection_callback_id_;
+
+  mutex mu_;
+  std::vector<std::shared_ptr<ThreadSamples>> thread_samples_
+      TFRT_GUARDED_BY(mu_);
+  llvm::StringMap<metrics::Histogram*> histograms_ TFRT_GUARDED_BY(mu_);
+};
+
+// Set the kernel latency sampler used by BEFExecutor, or nullptr to stop
+// sampling. The sampler must outlive all the kernel executions that use it.
+void SetKernelLatencySampler(KernelLatencySampler* sampler);
+
+// Return the kernel latency sampler used by BEFExecutor, or nullptr if kernel
+// latency sampling is disabled.
+KernelLatencySampler* GetKernelLatencySampler();
+
+}  // namespace tfrt
+
+#endif  // TFRT_BEF_EXECUTOR_KERNEL_LATENCY_SAMPLER_H_
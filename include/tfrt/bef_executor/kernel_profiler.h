@@ -0,0 +1,88 @@
+/*
+ * Copyright 2022 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Kernel Profiler
+//
+// This file declares KernelProfiler, which records the wall time of kernels
+// executed by BEFExecutor. The recorded profile can be fed back into the
+// compiler (see the `tfrt-apply-cost-profile` pass) so that StreamAnalysis
+// partitions streams according to the measured kernel costs.
+
+#ifndef TFRT_BEF_EXECUTOR_KERNEL_PROFILER_H_
+#define TFRT_BEF_EXECUTOR_KERNEL_PROFILER_H_
+
+#include <chrono>
+#include <cstdint>
+
+#include "llvm/ADT/StringMap.h"
+#include "tfrt/host_context/location.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+
+// KernelProfiler accumulates the wall time of kernels keyed by their source
+// locations. Only kernels with a file-line-column location are recorded, as
+// these are the locations that can be matched with the operations when the
+// program is compiled again.
+//
+// Note that the wall time of an asynchronous kernel only covers the
+// synchronous part of the kernel, ie. until the kernel returns to the executor.
+//
+// The profile is written in a text format, one kernel location per line:
+//
+//   <filename> '\t' <line> '\t' <column> '\t' <count> '\t' <average ns>
+//
+// This class is thread-safe.
+class KernelProfiler {
+ public:
+  // Record that the kernel at `location` ran for `duration`.
+  void RecordKernel(Location location, std::chrono::nanoseconds duration);
+
+  // Write the recorded profile to the file at `path`.
+  Error WriteProfile(string_view path) const;
+
+  // Write the recorded profile to `os`.
+  void PrintProfile(raw_ostream& os) const;
+
+  // Discard all recorded kernels.
+  void Clear();
+
+ private:
+  struct Entry {
+    std::string filename;
+    int line = -1;
+    int column = -1;
+    int64_t count = 0;
+    int64_t total_ns = 0;
+  };
+
+  mutable mutex mu_;
+  llvm::StringMap<Entry> entries_ TFRT_GUARDED_BY(mu_);
+};
+
+// Set the kernel profiler used by BEFExecutor, or nullptr to stop profiling.
+// The profiler must outlive all the kernel executions that use it.
+void SetKernelProfiler(KernelProfiler* profiler);
+
+// Return the kernel profiler used by BEFExecutor, or nullptr if kernel
+// profiling is disabled.
+KernelProfiler* GetKernelProfiler();
+
+}  // namespace tfrt
+
+#endif  // TFRT_BEF_EXECUTOR_KERNEL_PROFILER_H_
@@ -151,6 +151,22 @@ class StreamAnalysis {
 
   size_t GetNumStreams() const { return streams_.size(); }
 
+  // Return the cost of the most expensive path from `op` (inclusive) to the end
+  // of the function. Operations with a higher critical path cost should be
+  // executed first when there are multiple ready operations, as they are more
+  // likely to determine the latency of the function.
+  int64_t GetCriticalPathCost(mlir::Operation* op) const {
+    auto iter = critical_path_costs_.find(op);
+    assert(iter != critical_path_costs_.end());
+    return iter->second;
+  }
+
+  // Return the critical path cost of the root, which is the entry of the
+  // function.
+  int64_t GetRootCriticalPathCost() const {
+    return GetCriticalPathCost(/*op=*/nullptr);
+  }
+
   // The cost threshold is used to decide whether to merge two streams. When
   // there are independent streams, if the cost of a stream is smaller than this
   // threshold, then it would be worth merging this stream with others, while if
@@ -166,6 +182,7 @@ class StreamAnalysis {
   void GetOptionsForBlock(mlir::Block& block);
   void AnalyzeBlock(mlir::Block& block);
   void ScheduleOpForwardPass(mlir::Block& block);
+  void ComputeCriticalPathBackwardPass(mlir::Block& block);
   void BuildStreamBackwardPass(mlir::Block& block);
   void BuildStreamForOp(mlir::Operation* op);
   void MergeInterDependentStreams(int64_t cost_from_root,
@@ -250,6 +267,10 @@ class StreamAnalysis {
   // `stream_map_` contains the finalized op-to-stream mapping.
   llvm::DenseMap<mlir::Operation*, Stream*> stream_map_;
 
+  // `critical_path_costs_` contains the cost of the most expensive path from
+  // each op to the end of the function.
+  llvm::DenseMap<mlir::Operation*, int64_t> critical_path_costs_;
+
   const CostModelInterface* cost_model_ = nullptr;
 };
 
@@ -19,6 +19,7 @@
 #ifndef TFRT_CORE_RUNTIME_CORE_RUNTIME_H_
 #define TFRT_CORE_RUNTIME_CORE_RUNTIME_H_
 
+#include <cstdint>
 #include <functional>
 
 #include "tfrt/support/forward_decls.h"
@@ -90,11 +91,28 @@ class CoreRuntime final {
   //
   // If the client does not need the location information in error messages, the
   // client can set `loc` to a default constructed Location, Loation().
+  //
+  // The ops resolved by the op_handler are cached per (op_handler, op_name),
+  // and each thread keeps a small cache of the recently executed ops, so that
+  // repeated calls do not look up the op in the op handler again.
   void Execute(const ExecutionContext& exec_ctx, string_view op_name,
                OpHandler* op_handler, MutableArrayRef<TensorHandle> arguments,
                const OpAttrsRef& attrs, MutableArrayRef<TensorHandle> results,
                AsyncValueRef<Chain>* chain);
 
+  // Statistics of the per-thread cache of the ops resolved by Execute().
+  struct OpCacheStats {
+    // The number of Execute() calls that found the op in the thread cache.
+    int64_t hits = 0;
+    // The number of Execute() calls that did not find the op in the thread
+    // cache.
+    int64_t misses = 0;
+  };
+
+  // Return the op cache statistics of the calling thread, for all the
+  // CoreRuntime instances.
+  static OpCacheStats GetThreadOpCacheStats();
+
   // [Experimental]
   // Return an CoreRuntimeOp (a callable) that clients can use to execute an op
   // directly, or an error if it cannot find the op in the op registry.
@@ -24,9 +24,11 @@
 namespace tfrt {
 
 class AggregateAttr;
+class AsyncKernelFrame;
 class ExecutionContext;
 class CoreRuntimeOp;
 class OpAttrs;
+class OpAttrsRef;
 class Value;
 class TensorHandle;
 template <typename T>
@@ -53,6 +55,25 @@ void ExecuteOpImpl(CoreRuntimeOp op, ArrayRef<AsyncValue *> args,
                    AggregateAttr op_func_attr_array,
                    const ExecutionContext &exec_ctx);
 
+// Same as above, but the attributes are converted to an immutable OpAttrs set
+// only once per kernel, and cached in the attribute cache of `frame` (see
+// AsyncKernelFrame::GetAttributeCache). The attributes are converted on every
+// execution if the frame has no attribute cache. `op_attr_array` and
+// `op_func_attr_array` must be attributes of `frame`.
+void ExecuteOpImpl(CoreRuntimeOp op, ArrayRef<AsyncValue *> args,
+                   AsyncValueRef<Chain> *op_chain,
+                   MutableArrayRef<RCReference<AsyncValue>> results,
+                   AggregateAttr op_attr_array,
+                   AggregateAttr op_func_attr_array,
+                   const AsyncKernelFrame &frame);
+
+// Same as above, with the attributes already set up in `op_attrs`.
+void ExecuteOpImpl(CoreRuntimeOp op, ArrayRef<AsyncValue *> args,
+                   AsyncValueRef<Chain> *op_chain,
+                   MutableArrayRef<RCReference<AsyncValue>> results,
+                   const OpAttrsRef &op_attrs,
+                   const ExecutionContext &exec_ctx);
+
 void ExecuteOpImplSync(const CoreRuntimeOp &op,
                        RepeatedSyncArguments<TensorHandle> args,
                        AsyncValueRef<Chain> *op_chain, SyncKernelFrame *frame,
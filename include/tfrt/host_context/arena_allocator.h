@@ -0,0 +1,66 @@
+/*
+ * Copyright 2022 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Arena Memory Allocator
+//
+// This file declares an allocator that bump-allocates request-local memory and
+// releases it in bulk.
+
+#ifndef TFRT_HOST_CONTEXT_ARENA_ALLOCATOR_H_
+#define TFRT_HOST_CONTEXT_ARENA_ALLOCATOR_H_
+
+#include <memory>
+
+#include "tfrt/host_context/host_allocator.h"
+
+namespace tfrt {
+
+// An allocator that carves allocations out of large chunks obtained from a
+// parent allocator. Allocation is a lock-free pointer bump in the current
+// chunk, and deallocation only decrements the number of live allocations of
+// the chunk, so concurrent kernels of a request do not contend on the parent
+// allocator. Freed memory is not reused; chunks are returned to the parent in
+// bulk once the arena is released.
+//
+// Allocations that escape the arena, ie. that are still alive when the arena
+// is released, stay valid: their chunks are returned to the parent when they
+// are deallocated. Allocations larger than a few kilobytes, or aligned to more
+// than a quarter of a chunk, are forwarded to the parent allocator.
+//
+// An ArenaAllocator is typically owned by a RequestContext (see
+// RequestContextBuilder::set_use_arena_allocator) and released when the
+// request completes.
+class ArenaAllocator : public HostAllocator {
+ public:
+  // Release the arena. Allocating from the arena after it is released is not
+  // allowed. The arena is destroyed once all its allocations are deallocated.
+  virtual void Release() = 0;
+};
+
+struct ArenaAllocatorReleaser {
+  void operator()(ArenaAllocator* allocator) const { allocator->Release(); }
+};
+
+using ArenaAllocatorPtr =
+    std::unique_ptr<ArenaAllocator, ArenaAllocatorReleaser>;
+
+// Create an arena allocator that allocates its chunks from `parent`. `parent`
+// must outlive all allocations of the arena.
+ArenaAllocatorPtr CreateArenaAllocator(HostAllocator* parent);
+
+}  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_ARENA_ALLOCATOR_H_
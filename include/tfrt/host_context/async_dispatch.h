@@ -100,6 +100,10 @@ void Await(const ExecutionContext& exec_ctx,
            ArrayRef<RCReference<AsyncValue>> values);
 
 // Add some non-blocking work to the work_queue used by the ExecutionContext.
+// If the request has a deadline, the request is cancelled when the work is
+// dequeued after the deadline (see RequestContext::CancelIfDeadlineExceeded).
+// The work still runs, as it may be responsible for resolving async values,
+// but it observes the cancellation.
 void EnqueueWork(const ExecutionContext& exec_ctx,
                  llvm::unique_function<void()> work);
 
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2022 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Attribute Cache
+//
+// This file declares AttributeCache, a cache of values derived from the
+// attributes of a BEF file.
+
+#ifndef TFRT_HOST_CONTEXT_ATTRIBUTE_CACHE_H_
+#define TFRT_HOST_CONTEXT_ATTRIBUTE_CACHE_H_
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "tfrt/support/type_id.h"
+
+namespace tfrt {
+
+// A cache of the value that a kernel derives from its attributes, eg. the
+// attributes of corert.executeop converted to an OpAttrs set. As attributes
+// are constants, such a value only needs to be computed once per kernel.
+//
+// The BEF executor keeps an AttributeCache for each kernel of a function, in
+// the decoded function that is shared by all its executions, and makes it
+// available to the kernel through AsyncKernelFrame::GetAttributeCache(). The
+// cached value is destroyed with the function, so it may refer to the
+// attributes of the BEF file.
+//
+// The value is published with a single atomic operation, so that looking it up
+// after the first execution of the kernel does not take any lock.
+class AttributeCache {
+ public:
+  AttributeCache() = default;
+  AttributeCache(const AttributeCache&) = delete;
+  AttributeCache& operator=(const AttributeCache&) = delete;
+  ~AttributeCache() { delete entry_.load(std::memory_order_acquire); }
+
+  // Return the value of type T cached for the kernel, created by `create`,
+  // which returns a T, on the first lookup. A kernel must always look up the
+  // same type. It is safe to call this method concurrently, and the returned
+  // reference is stable. If several threads race on the first lookup, each of
+  // them calls `create` and only one of the values is kept.
+  template <typename T, typename F>
+  const T& GetOrCreate(F&& create) {
+    const Entry* entry = entry_.load(std::memory_order_acquire);
+    if (entry == nullptr) {
+      auto created = std::make_unique<TypedEntry<T>>(create());
+      if (entry_.compare_exchange_strong(entry, created.get(),
+                                         std::memory_order_acq_rel,
+                                         std::memory_order_acquire)) {
+        entry = created.release();
+      }
+    }
+    assert(entry->type_id == DenseTypeId<AttributeCache>::get<T>() &&
+           "the cached value has a different type");
+    return static_cast<const TypedEntry<T>*>(entry)->value;
+  }
+
+ private:
+  struct Entry {
+    explicit Entry(size_t type_id) : type_id(type_id) {}
+    virtual ~Entry() = default;
+    const size_t type_id;
+  };
+
+  template <typename T>
+  struct TypedEntry : Entry {
+    explicit TypedEntry(T value)
+        : Entry(DenseTypeId<AttributeCache>::get<T>()),
+          value(std::move(value)) {}
+    T value;
+  };
+
+  std::atomic<const Entry*> entry_{nullptr};
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_ATTRIBUTE_CACHE_H_
@@ -25,6 +25,7 @@
 #include <functional>
 #include <memory>
 #include <optional>
+#include <utility>
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/Support/Compiler.h"
@@ -88,6 +89,15 @@ class ConcurrentWorkQueue {
   // thread.
   virtual void AddTask(TaskFunction work) = 0;
 
+  // Enqueue a block of work on behalf of a request with the given priority
+  // (see RequestOptions::priority). Thread-safe.
+  //
+  // Work queues that support request priorities run the pending work of higher
+  // priority requests first. By default the priority is ignored.
+  virtual void AddTaskWithPriority(TaskFunction work, int priority) {
+    AddTask(std::move(work));
+  }
+
   // Enqueue a blocking task. Thread-safe.
   //
   // If `allow_queuing` is false, implementation must guarantee that work will
@@ -116,6 +126,12 @@ class ConcurrentWorkQueue {
   // to run on the currently active thread and enqueue no work items.
   virtual int GetParallelismLevel() const = 0;
 
+  // Return the number of worker threads that are idle, i.e. that would start a
+  // task added now right away. This is a hint that callers can use to decide
+  // whether to split work into more tasks or to keep it in the current thread.
+  // By default all the workers are assumed to be idle.
+  virtual int GetNumIdleWorkers() const { return GetParallelismLevel(); }
+
   // Returns true if the caller thread is one of the worker threads managed by
   // this work queue. Returns true only for threads executing compute tasks.
   virtual bool IsInWorkerThread() const = 0;
@@ -140,6 +156,58 @@ std::unique_ptr<ConcurrentWorkQueue> CreateSingleThreadedWorkQueue();
 std::unique_ptr<ConcurrentWorkQueue> CreateMultiThreadedWorkQueue(
     int num_threads, int num_blocking_threads);
 
+// Options of the multi-threaded work queue.
+struct MultiThreadedWorkQueueOptions {
+  // If true, the non-blocking worker threads are split into one group per NUMA
+  // node and each group is pinned to the CPUs of its node. Workers prefer
+  // stealing tasks from the workers of their own node, and tasks submitted by
+  // other threads are queued on the node of the submitting thread. This has no
+  // effect on machines with a single NUMA node. Use it together with
+  // CreateNumaAllocator() to keep memory accesses local to the nodes.
+  bool pin_to_numa_nodes = false;
+
+  // If true, the non-blocking work is scheduled according to the request
+  // priorities (see ConcurrentWorkQueue::AddTaskWithPriority). Each worker
+  // thread runs and steals the pending work of the highest priority first.
+  bool request_priorities = false;
+
+  // If true, the non-blocking worker threads export statistics about the
+  // scheduling through tfrt/metrics, under
+  // "/tensorflow/runtime/work_queue/tfrt-non-blocking-queue/": the number of
+  // tasks executed, successful and failed steals, park events, the parked
+  // threads unparked by new tasks, the time spent parked, the sampled number
+  // of pending tasks of each worker, and the latency from adding a task to its
+  // start for a sample of the tasks. Worker threads accumulate their
+  // statistics locally, so the overhead is a few instructions per task.
+  bool collect_stats = false;
+
+  // Non-blocking worker threads that run out of work spin in a steal loop
+  // before parking, which avoids the park/unpark latency if new tasks are
+  // added soon. `max_spinning_threads` is the maximum number of threads
+  // spinning at once, and `spin_count` is the number of steal attempts before
+  // parking, divided by the number of threads. Zero disables spinning.
+  int max_spinning_threads = 1;
+  int spin_count = 5000;
+
+  // If true, each non-blocking worker thread tunes its number of steal
+  // attempts before parking between 1/16 and 4 times the configured number,
+  // proportionally to the rate of its recent spin loops that found a task.
+  bool adaptive_spinning = false;
+
+  // If true, the non-blocking worker threads are pinned to CPUs spread evenly
+  // over the CPU topology (read from sysfs on Linux), and each worker thread
+  // steals tasks from the workers sharing its L2 cache first, then from the
+  // other workers sharing its L3 cache, then its package, and then from the
+  // remaining workers. This keeps the data of the stolen tasks in the shared
+  // caches. Takes precedence over `pin_to_numa_nodes`, and has no effect if
+  // the topology is unknown.
+  bool topology_aware_stealing = false;
+};
+
+std::unique_ptr<ConcurrentWorkQueue> CreateMultiThreadedWorkQueue(
+    int num_threads, int num_blocking_threads,
+    const MultiThreadedWorkQueueOptions& options);
+
 // A factory function for creating ConcurrentWorkQueue objects. The factory
 // function defines the semantics of the argument string.
 // TODO(pgavin): Consider using a configuration object or other data structure
@@ -19,9 +19,13 @@
 #ifndef TFRT_HOST_CONTEXT_EXECUTION_CONTEXT_H_
 #define TFRT_HOST_CONTEXT_EXECUTION_CONTEXT_H_
 
+#include <chrono>
 #include <utility>
 
+#include "absl/status/status.h"  // from @com_google_absl
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/Error.h"
+#include "tfrt/host_context/arena_allocator.h"
 #include "tfrt/host_context/location.h"
 #include "tfrt/host_context/resource_context.h"
 #include "tfrt/support/forward_decls.h"
@@ -49,10 +53,32 @@ class CancellationContext : public ReferenceCounted<CancellationContext> {
 
   void Cancel();
 
+  // Cancel with `status` as the error of the cancel async value. Only the
+  // first cancellation takes effect.
+  void Cancel(absl::Status status);
+
  private:
   std::atomic<ErrorAsyncValue*> cancel_value_{nullptr};
 };
 
+struct RequestOptions {
+  using RequestPriority = int;
+  using Clock = std::chrono::system_clock;
+
+  // The priority of the request. 0 is the default priority, requests with a
+  // higher priority are latency-critical and requests with a negative priority
+  // are batch traffic. Work queues that support request priorities (eg. the
+  // "mstd_priority" work queue) run the tasks of higher priority requests
+  // first.
+  RequestPriority priority = 0;
+
+  // The time by which the request must complete. The tasks of the request
+  // that are dequeued after the deadline cancel the request with a
+  // DeadlineExceeded error instead of running its kernels (see
+  // RequestContext::CancelIfDeadlineExceeded). The default is no deadline.
+  Clock::time_point deadline = Clock::time_point::max();
+};
+
 // A request refers to either a BEFFunction execution or an op execution.
 // RequestContext holds per request information, such as the cancellation status
 // and request priority. A RequestContext object is reference counted and is
@@ -71,6 +97,11 @@ class RequestContext : public ReferenceCounted<RequestContext> {
   HostContext* host() const { return host_; }
   ResourceContext* resource_context() const { return resource_context_; }
 
+  // The allocator for the request-local memory. It is the request arena if the
+  // request was built with an arena allocator, and the host allocator
+  // otherwise.
+  HostAllocator* allocator() const { return allocator_; }
+
   const RCReference<CancellationContext>& cancellation_context() const {
     return cancellation_;
   }
@@ -97,19 +128,50 @@ class RequestContext : public ReferenceCounted<RequestContext> {
 
   int64_t id() const { return id_; }
 
+  RequestOptions::RequestPriority priority() const { return priority_; }
+
+  RequestOptions::Clock::time_point deadline() const { return deadline_; }
+
+  bool HasDeadline() const {
+    return deadline_ != RequestOptions::Clock::time_point::max();
+  }
+
+  // Returns the time left until the deadline, which is negative once the
+  // deadline has passed.
+  RequestOptions::Clock::duration GetRemainingTime() const {
+    if (!HasDeadline()) return RequestOptions::Clock::duration::max();
+    return deadline_ - RequestOptions::Clock::now();
+  }
+
+  // Cancel the request with a DeadlineExceeded error if its deadline has
+  // passed. Returns true if the request is cancelled, for the deadline or any
+  // other reason. This only reads the clock for requests with a deadline, so
+  // it is cheap enough to be called whenever a task of the request is
+  // dequeued.
+  bool CancelIfDeadlineExceeded() {
+    if (LLVM_LIKELY(!HasDeadline())) return IsCancelled();
+    return CancelIfDeadlineExceededSlow();
+  }
+
  private:
   friend class RequestContextBuilder;
 
   RequestContext(HostContext* host, ResourceContext* resource_context,
-                 ContextData ctx_data, int64_t id)
-      : id_{id},
-        host_{host},
-        resource_context_{resource_context},
-        context_data_{std::move(ctx_data)},
-        cancellation_{TakeRef(new CancellationContext)} {}
+                 ContextData ctx_data, int64_t id,
+                 RequestOptions::RequestPriority priority,
+                 RequestOptions::Clock::time_point deadline,
+                 ArenaAllocatorPtr arena);
+
+  bool CancelIfDeadlineExceededSlow();
 
   int64_t id_;
+  RequestOptions::RequestPriority priority_;
+  RequestOptions::Clock::time_point deadline_;
   HostContext* const host_ = nullptr;
+  // Released when the request completes, ie. when the RequestContext is
+  // destroyed. Allocations that outlive the request keep their memory.
+  ArenaAllocatorPtr arena_;
+  HostAllocator* const allocator_ = nullptr;
   // Both ResourceContext and ContextData manages data used during the request
   // execution. ResourceContext is more flexible than ContextData at the cost of
   // performance. ResourceContext stores the data keyed by a string name. It
@@ -124,12 +186,6 @@ class RequestContext : public ReferenceCounted<RequestContext> {
   RCReference<CancellationContext> cancellation_;
 };
 
-struct RequestOptions {
-  using RequestPriority = int;
-
-  RequestPriority priority = 0;
-};
-
 // A builder class for RequestContext.
 // Sample usage:
 // auto request_context = RequestContextBuilder(host, resource_context)
@@ -155,6 +211,19 @@ class RequestContextBuilder {
     return std::move(*this);
   }
 
+  // Allocate the request-local memory (see ExecutionContext::allocator) from
+  // an arena that is released in bulk when the request completes.
+  RequestContextBuilder& set_use_arena_allocator(bool use_arena_allocator) & {
+    use_arena_allocator_ = use_arena_allocator;
+    return *this;
+  }
+
+  RequestContextBuilder&& set_use_arena_allocator(
+      bool use_arena_allocator) && {
+    use_arena_allocator_ = use_arena_allocator;
+    return std::move(*this);
+  }
+
   int64_t id() const { return id_; }
   HostContext* host() const { return host_; }
   ResourceContext* resource_context() const { return resource_context_; }
@@ -174,6 +243,7 @@ class RequestContextBuilder {
   ResourceContext* resource_context_ = nullptr;
   RequestContext::ContextData context_data_;
   bool enable_cost_measurement_ = false;
+  bool use_arena_allocator_ = false;
 };
 
 // ExecutionContext holds the context information for kernel and op execution,
@@ -194,6 +264,9 @@ class ExecutionContext {
 
   Location location() const { return location_; }
   HostContext* host() const { return request_ctx_->host(); }
+  // The allocator for request-local memory, eg. the buffers of the tensors
+  // produced by kernels.
+  HostAllocator* allocator() const { return request_ctx_->allocator(); }
   bool IsCancelled() const { return request_ctx_->IsCancelled(); }
   ErrorAsyncValue* GetCancelAsyncValue() const {
     return request_ctx_->GetCancelAsyncValue();
@@ -212,6 +285,16 @@ class ExecutionContext {
 
   RequestContext* request_ctx() const { return request_ctx_.get(); }
 
+  // The priority of the tasks dispatched by this execution.
+  RequestOptions::RequestPriority priority() const {
+    return request_ctx_->priority();
+  }
+
+  // The deadline of the request, see RequestOptions::deadline.
+  RequestOptions::Clock::time_point deadline() const {
+    return request_ctx_->deadline();
+  }
+
   ResourceContext* resource_context() const {
     return request_ctx_->resource_context();
   }
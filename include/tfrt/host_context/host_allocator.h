@@ -74,6 +74,15 @@ class HostAllocator {
 // Create an allocator that just calls malloc/free.
 std::unique_ptr<HostAllocator> CreateMallocAllocator();
 
+// Create an allocator that allocates memory on the NUMA node of the calling
+// thread. It is meant to be used with a work queue that pins its worker
+// threads to NUMA nodes (see MultiThreadedWorkQueueOptions), so that the
+// buffers produced by a kernel are local to the workers that are likely to
+// consume them. Allocations of 64KiB or more are carved from large node-bound
+// regions and reused after they are freed; the regions are released when the
+// allocator is destroyed.
+std::unique_ptr<HostAllocator> CreateNumaAllocator();
+
 // Create an allocator of fixed size for testing.
 std::unique_ptr<HostAllocator> CreateFixedSizeAllocator(size_t capacity = 1024);
 
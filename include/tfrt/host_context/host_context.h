@@ -21,6 +21,7 @@
 #ifndef TFRT_HOST_CONTEXT_HOST_CONTEXT_H_
 #define TFRT_HOST_CONTEXT_HOST_CONTEXT_H_
 
+#include <chrono>
 #include <type_traits>
 
 #include "llvm/ADT/ArrayRef.h"
@@ -38,6 +39,7 @@ struct DecodedDiagnostic;
 
 class ConcurrentWorkQueue;
 class HostAllocator;
+class RequestContext;
 class TypeDescriptor;
 class SharedContext;
 
@@ -142,6 +144,19 @@ class HostContext {
   // by this context. Returns true only for threads executing non-blocking work.
   bool IsInWorkerThread() const;
 
+  //===--------------------------------------------------------------------===//
+  // Admission Control
+  //===--------------------------------------------------------------------===//
+
+  // Returns a DeadlineExceeded error if `request` is not expected to complete
+  // before its deadline, ie. if `estimated_cost` exceeds the time left until
+  // the deadline. Rejecting such requests before they are executed, instead of
+  // cancelling them at their deadline, keeps an overloaded host from spending
+  // its time on requests that time out anyway. Requests without a deadline
+  // are always admitted.
+  Error AdmitRequest(const RequestContext& request,
+                     std::chrono::system_clock::duration estimated_cost) const;
+
   //===--------------------------------------------------------------------===//
   // Shared context
   //===--------------------------------------------------------------------===//
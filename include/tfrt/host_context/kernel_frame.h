@@ -29,6 +29,7 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "tfrt/host_context/async_value.h"
+#include "tfrt/host_context/attribute_cache.h"
 #include "tfrt/host_context/attribute_utils.h"
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/execution_context.h"
@@ -84,6 +85,10 @@ class AsyncKernelFrame {
 
   ArrayRef<uint8_t> GetAttributeSection() const { return attribute_section_; }
 
+  // Get the cache of the value derived from the attributes of this kernel, or
+  // nullptr if the caller of the kernel does not provide one.
+  AttributeCache* GetAttributeCache() const { return attribute_cache_; }
+
   // Get the number of arguments.
   int GetNumArgs() const { return arguments_.size(); }
 
@@ -271,6 +276,7 @@ class AsyncKernelFrame {
   llvm::SmallVector<RCReference<AsyncValue>, 8> results_;
 
   ArrayRef<uint8_t> attribute_section_;
+  AttributeCache* attribute_cache_ = nullptr;
   ArrayRef<uint32_t> attribute_offsets_;
   ArrayRef<uint32_t> function_indices_;
   ArrayRef<std::unique_ptr<Function>> functions_;
@@ -287,6 +293,7 @@ inline void AsyncKernelFrame::AssignFields(const AsyncKernelFrame& other) {
   for (auto& result : other.results_) results_.push_back(result);
 
   attribute_section_ = other.attribute_section_;
+  attribute_cache_ = other.attribute_cache_;
   attribute_offsets_ = other.attribute_offsets_;
   function_indices_ = other.function_indices_;
   functions_ = other.functions_;
@@ -298,6 +305,7 @@ inline void AsyncKernelFrame::AssignFields(AsyncKernelFrame&& other) {
   results_ = std::move(other.results_);
 
   attribute_section_ = other.attribute_section_;
+  attribute_cache_ = other.attribute_cache_;
   attribute_offsets_ = other.attribute_offsets_;
   function_indices_ = other.function_indices_;
   functions_ = other.functions_;
@@ -332,6 +340,9 @@ class KernelFrameBuilder : public AsyncKernelFrame {
   void SetAttributeSection(ArrayRef<uint8_t> attribute_section) {
     attribute_section_ = attribute_section;
   }
+  void SetAttributeCache(AttributeCache* attribute_cache) {
+    attribute_cache_ = attribute_cache;
+  }
   void SetFunctions(ArrayRef<std::unique_ptr<Function>> functions) {
     functions_ = functions;
   }
@@ -36,10 +36,19 @@ class RequestDeadlineTracker {
                                const RCReference<RequestContext>& req_ctx) {
     timer_queue_->ScheduleTimerAt(
         deadline, [cancellation_context = req_ctx->cancellation_context()] {
-          cancellation_context->Cancel();
+          cancellation_context->Cancel(
+              absl::DeadlineExceededError("Deadline exceeded"));
         });
   }
 
+  // Enqueue a timer for the deadline of the request options of `req_ctx`, if
+  // it has one. The timer cancels the request even if none of its tasks is
+  // dequeued after the deadline, eg. when it waits for an external event.
+  void CancelRequestOnDeadline(const RCReference<RequestContext>& req_ctx) {
+    if (req_ctx->HasDeadline())
+      CancelRequestOnDeadline(req_ctx->deadline(), req_ctx);
+  }
+
  private:
   TimerQueue* timer_queue_;
 };
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2022 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Thread Caching Memory Allocator
+//
+// This file declares a host memory allocator with per-thread caches of
+// size-classed blocks.
+
+#ifndef TFRT_HOST_CONTEXT_THREAD_CACHING_ALLOCATOR_H_
+#define TFRT_HOST_CONTEXT_THREAD_CACHING_ALLOCATOR_H_
+
+#include <memory>
+
+#include "tfrt/host_context/host_allocator.h"
+
+namespace tfrt {
+
+// Create an allocator for the small, short-lived allocations made by the
+// runtime, e.g. async values, executor frames and small tensor buffers.
+//
+// Allocations up to 32KiB are rounded up to a size class and served from a
+// cache owned by the calling thread without synchronization. Each thread cache
+// refills from, and returns blocks in batches to, a central free list per size
+// class. Larger allocations, and allocations with an alignment larger than
+// 32KiB, are forwarded to AlignedAlloc().
+//
+// All the allocators created by this function share the same process-wide
+// caches, and the memory of the small blocks is retained by the process for
+// reuse. Statistics are exported as counters through tfrt/metrics under
+// "/tensorflow/runtime/host_allocator/thread_caching/".
+std::unique_ptr<HostAllocator> CreateThreadCachingAllocator();
+
+}  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_THREAD_CACHING_ALLOCATOR_H_
@@ -16,16 +16,18 @@
 
 // Timer Queue
 //
-// This file declares TimerQueue, a priority queue to keep track of pending
-// timers. The queue is keyed by timer deadline (the sooner it expires, the
-// higher the priority). On timer expiration, it calls the associated callback.
+// This file declares TimerQueue, a queue to keep track of pending timers. On
+// timer expiration, it calls the associated callback.
 
 #ifndef TFRT_HOST_CONTEXT_TIMER_QUEUE_H_
 #define TFRT_HOST_CONTEXT_TIMER_QUEUE_H_
 
+#include <atomic>
 #include <chrono>
-#include <queue>
+#include <cstdint>
+#include <memory>
 #include <thread>
+#include <vector>
 
 #include "llvm/ADT/FunctionExtras.h"
 #include "tfrt/support/mutex.h"
@@ -33,6 +35,14 @@
 
 namespace tfrt {
 
+// TimerQueue keeps the timers in hierarchical timing wheels, so that
+// scheduling and cancelling a timer are O(1). Deadlines are rounded up to the
+// wheel resolution of one millisecond.
+//
+// The wheels are sharded, and each thread schedules its timers into the shard
+// it is assigned to, so that the threads of a work queue do not contend on a
+// single mutex. A single timer thread advances all the shards and runs the
+// callbacks of the expired timers.
 class TimerQueue {
   using Clock = std::chrono::system_clock;
   using TimeDuration = Clock::duration;
@@ -41,6 +51,7 @@ class TimerQueue {
       std::chrono::time_point<std::chrono::system_clock, TimeDuration>;
 
   class TimerEntry;
+  struct Shard;
 
  public:
   using TimerHandle = RCReference<TimerEntry>;
@@ -56,6 +67,8 @@ class TimerQueue {
   // Enqueue a timer. Deadline is `timeout` microseconds from now.
   TimerHandle ScheduleTimer(TimeDuration timeout, TimerCallback callback);
 
+  // Cancel a timer. The timer is removed from the queue and its callback is
+  // destroyed, unless the timer has already expired.
   void CancelTimer(const TimerHandle& timer_handle);
 
  private:
@@ -71,34 +84,48 @@ class TimerQueue {
       return MakeRef<TimerEntry>(deadline, std::move(timer_callback));
     }
 
-    struct TimerEntryCompare {
-      bool operator()(const RCReference<TimerEntry>& a,
-                      const RCReference<TimerEntry>& b) const {
-        return a->deadline_ > b->deadline_;
-      }
-    };
-
    private:
     friend class TimerQueue;
     TimePoint deadline_;
     TimerCallback timer_callback_;
     std::atomic<bool> cancelled_{false};
+
+    // The wheel position of the timer, guarded by the mutex of its shard. The
+    // wheels hold a reference to the timers they contain.
+    Shard* shard_ = nullptr;
+    uint64_t deadline_tick_ = 0;
+    TimerEntry* prev_ = nullptr;
+    TimerEntry* next_ = nullptr;
+    // The wheel level of the timer, or -1 if it is not in a wheel.
+    int level_ = -1;
+    int slot_ = 0;
   };
+
   // Timer thread. If a timeout goes off, it calls the callback.
   void TimerThreadRun();
 
-  // Obtain the top timer (timer with the closest deadline) from the queue.
-  // Returns NULL if no active (not cancelled) timer found.
-  TimerEntry* getTopTimer();
+  // Returns the shard the calling thread schedules its timers into.
+  Shard& GetShard();
+
+  // Conversions between time points and wheel ticks. Ticks are counted from
+  // the creation of the queue.
+  uint64_t DeadlineTick(TimePoint deadline) const;
+  uint64_t NowTick() const;
+  TimePoint TickTime(uint64_t tick) const;
+
+  const TimePoint start_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  // The tick the timer thread sleeps until, or 0 while the timer thread scans
+  // the shards. Timers scheduled before this tick, or while it is 0, wake up
+  // the timer thread.
+  std::atomic<uint64_t> next_wakeup_tick_{0};
 
   mutable mutex mu_;
   condition_variable cv_;
   std::thread timer_thread_;
-  std::atomic<bool> stop_{false};
-  std::priority_queue<RCReference<TimerEntry>,
-                      std::vector<RCReference<TimerEntry>>,
-                      TimerEntry::TimerEntryCompare>
-      timers_ TFRT_GUARDED_BY(mu_);
+  bool wakeup_requested_ TFRT_GUARDED_BY(mu_) = false;
+  bool stop_ TFRT_GUARDED_BY(mu_) = false;
 };
 
 }  // namespace tfrt
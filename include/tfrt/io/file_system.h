@@ -19,19 +19,41 @@
 #ifndef TFRT_IO_FILE_SYSTEM_H_
 #define TFRT_IO_FILE_SYSTEM_H_
 
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringMap.h"
+#include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/forward_decls.h"
 #include "tfrt/support/mutex.h"
 #include "tfrt/support/thread_annotations.h"
 
 namespace tfrt {
+
+class HostContext;
+
 namespace io {
 
+// The minimum alignment of the memory returned by
+// FileSystem::NewReadOnlyMemoryRegionFromFile.
+constexpr size_t kReadOnlyMemoryRegionAlignment = 64;
+
 // The priority of a FileSystem instance is used by FileSystemRegistry::Register
 // to decide which file system to use if multiple FileSystem instances are
 // registered for the same sceheme.
 enum class FileSystemPriority : int { kDefault = 1, kHigh = 2 };
 
+// A read of up to `max_count` bytes at `offset` into the buffer at `buf`.
+struct ReadRequest {
+  char* buf;
+  size_t max_count;
+  size_t offset;
+};
+
 // An interface that declares operations to read bytes from a random access
 // file.
 class RandomAccessFile {
@@ -51,6 +73,41 @@ class RandomAccessFile {
   // On error, llvm::Error is returned.
   virtual llvm::Expected<size_t> Read(char* buf, size_t max_count,
                                       size_t offset) const = 0;
+
+  // Asynchronous version of Read(). The returned value is set to the number
+  // of bytes read, or to the error, once the read completes. The waiters of
+  // the returned value run on a thread of `host`.
+  //
+  // The file and `buf` must stay alive until the read completes.
+  //
+  // The default implementation calls Read() on a blocking work queue thread of
+  // `host`. File systems that support asynchronous I/O should override
+  // ReadBatchAsync() to avoid blocking a thread for each read.
+  AsyncValueRef<size_t> ReadAsync(char* buf, size_t max_count, size_t offset,
+                                  HostContext* host) const;
+
+  // Submits a batch of asynchronous reads, and returns one value per request
+  // in the same order. The requests may complete in any order. See
+  // ReadAsync().
+  virtual std::vector<AsyncValueRef<size_t>> ReadBatchAsync(
+      ArrayRef<ReadRequest> requests, HostContext* host) const;
+};
+
+// An interface for a read-only region of memory that holds the contents of a
+// file, eg. a memory mapped file. The memory is valid for the lifetime of the
+// region.
+class ReadOnlyMemoryRegion {
+ public:
+  explicit ReadOnlyMemoryRegion() {}
+
+  virtual ~ReadOnlyMemoryRegion() {}
+
+  // Returns the contents of the file.
+  virtual ArrayRef<uint8_t> data() const = 0;
+
+  // Hints that the bytes in [offset, offset + count) will be accessed soon, so
+  // that they can be paged in ahead of time. This is a no-op by default.
+  virtual void Prefetch(size_t offset, size_t count) const {}
 };
 
 // An interface that declares operations to manage files in a file system.
@@ -68,6 +125,19 @@ class FileSystem {
   virtual llvm::Error NewRandomAccessFile(
       const std::string& path, std::unique_ptr<RandomAccessFile>* file) = 0;
 
+  // Creates a read-only memory region with the contents of the file at `path`.
+  // The memory is aligned to at least kReadOnlyMemoryRegionAlignment bytes.
+  //
+  // The default implementation reads the whole file into memory using
+  // NewRandomAccessFile(). File systems that support memory mapping should
+  // override it to avoid copying the file.
+  //
+  // On success, stores a pointer to the new region in `region` and returns
+  // llvm::Error::success(). Otherwise, stores NULL in `region` and returns the
+  // error.
+  virtual llvm::Error NewReadOnlyMemoryRegionFromFile(
+      const std::string& path, std::unique_ptr<ReadOnlyMemoryRegion>* region);
+
   // Returns the priority of this file system. The file system with the highest
   // priority will be used if multiple file systems have been registered for the
   // same scheme.
@@ -105,6 +175,14 @@ class FileSystemRegistry {
   // FileSystemRegistry::Register(...).
   FileSystem* Lookup(const std::string& scheme);
 
+  // Returns the file system registered for the scheme of `path`, e.g. "scheme"
+  // for "scheme://file". Paths without a scheme, ie. local files, use the file
+  // system registered for the empty scheme. The file system takes the whole
+  // `path`, including the scheme.
+  //
+  // Returns an error if no file system is registered for the scheme.
+  Expected<FileSystem*> LookupForPath(string_view path);
+
  private:
   mutex mu_;
   llvm::StringMap<std::unique_ptr<FileSystem>> file_systems_
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2022 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares the PrefetchingInputStream class which reads ahead of
+// the consumer from a random access file.
+
+#ifndef TFRT_IO_PREFETCHING_INPUT_STREAM_H_
+#define TFRT_IO_PREFETCHING_INPUT_STREAM_H_
+
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/io/file_system.h"
+#include "tfrt/io/input_stream.h"
+
+namespace tfrt {
+
+class HostContext;
+
+namespace io {
+
+// An input stream that reads a file sequentially, like a BufferedInputStream
+// over a FileInputStream, but keeps up to `num_buffers` reads of the following
+// bytes in flight while the consumer reads the current buffer. The reads are
+// submitted with RandomAccessFile::ReadBatchAsync(), so they are queued by the
+// kernel if the file system supports asynchronous I/O, and run on the blocking
+// work queue of `host` otherwise.
+//
+// The buffer size adapts to the storage latency: it starts at `buffer_size`
+// and doubles, up to `max_buffer_size`, each time the consumer has to wait for
+// a read to complete.
+class PrefetchingInputStream : public InputStream {
+ public:
+  PrefetchingInputStream(std::unique_ptr<RandomAccessFile> file,
+                         HostContext* host, size_t buffer_size,
+                         size_t max_buffer_size, int num_buffers = 2);
+
+  // Waits for the reads in flight, which write to the buffers.
+  ~PrefetchingInputStream() override;
+
+  // This class is not copyable or movable.
+  PrefetchingInputStream(const PrefetchingInputStream&) = delete;
+  PrefetchingInputStream& operator=(const PrefetchingInputStream&) = delete;
+
+  // If a read of the file fails after some bytes were copied to `buf`,
+  // returns these bytes, and reports the error on the next call.
+  llvm::Expected<size_t> Read(char* buf, size_t max_count) override;
+
+  llvm::Expected<size_t> Tell() override;
+
+  // Returns the size of the next buffers to be read.
+  size_t buffer_size() const { return buffer_size_; }
+
+ private:
+  struct Buffer {
+    char* data;
+    size_t capacity;
+    // The offset of the buffer in the file.
+    size_t offset;
+    // The number of bytes read into the buffer, once the read completes.
+    AsyncValueRef<size_t> count;
+  };
+
+  // Submits the reads of the next buffers, up to `num_buffers_` in flight.
+  void Prefetch();
+
+  // Waits for the reads in flight, and releases all the buffers.
+  void DiscardBuffers();
+
+  // Returns the memory of `buffer`, or keeps it to be reused.
+  void ReleaseBuffer(Buffer buffer);
+
+  std::unique_ptr<RandomAccessFile> file_;
+  HostContext* host_;
+  size_t buffer_size_;
+  const size_t max_buffer_size_;
+  const int num_buffers_;
+
+  // The buffers in the order of the stream. The consumer reads the front
+  // buffer.
+  std::deque<Buffer> buffers_;
+  // The position of the next byte to be read in the front buffer.
+  size_t buffer_pos_ = 0;
+  // The free memory of buffers of `buffer_size_` bytes.
+  std::vector<char*> free_buffers_;
+
+  // The offset in the file of the next buffer to be read.
+  size_t read_offset_ = 0;
+  // Set once a read reaches the end of the file.
+  bool eof_ = false;
+  // Current position in this stream.
+  size_t stream_pos_ = 0;
+};
+
+}  // namespace io
+}  // namespace tfrt
+
+#endif  // TFRT_IO_PREFETCHING_INPUT_STREAM_H_
@@ -0,0 +1,40 @@
+/*
+ * Copyright 2022 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares the Counter metric interface.
+
+#ifndef TFRT_METRICS_COUNTER_H_
+#define TFRT_METRICS_COUNTER_H_
+
+#include <cstdint>
+
+namespace tfrt {
+namespace metrics {
+
+// The Counter metric interface. A counter is a monotonically increasing value.
+class Counter {
+ public:
+  virtual ~Counter() {}
+
+  virtual void IncrementBy(int64_t value) = 0;
+
+  void Increment() { IncrementBy(1); }
+};
+
+}  // namespace metrics
+}  // namespace tfrt
+
+#endif  // TFRT_METRICS_COUNTER_H_
@@ -28,10 +28,11 @@ namespace metrics {
 // Bucket ranges used by the Histogram metric.
 class Buckets {
  public:
-  // Returns a Buckets whose lower bounds (except for the underflow bucket) are
-  // given by `bounds`. The underflow bucket will have an upper bound of
-  // `bounds.front()` and the overflow bucket will have a lower bound of
-  // `bounds.back()`.
+  // Returns a Buckets whose upper bounds (except for the overflow bucket) are
+  // given by `bounds`. A bucket includes its upper bound, ie. the buckets are
+  // (-inf, bounds[0]], (bounds[0], bounds[1]], ..., (bounds.back(), +inf), so
+  // that a value equal to a bound is counted in the bucket that ends at the
+  // bound, like the "le" buckets of Prometheus.
   //
   // REQUIRES: |bounds| contains a non-empty sequence of monotonically
   // increasing finite numbers.
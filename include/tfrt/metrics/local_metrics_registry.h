@@ -0,0 +1,94 @@
+/*
+ * Copyright 2022 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares LocalMetricsRegistry, an in-process MetricsRegistry that
+// can be scraped in the Prometheus text exposition format.
+
+#ifndef TFRT_METRICS_LOCAL_METRICS_REGISTRY_H_
+#define TFRT_METRICS_LOCAL_METRICS_REGISTRY_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringMap.h"
+#include "metrics_registry.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace metrics {
+
+// A MetricsRegistry that keeps the metrics in memory.
+//
+// Counters and histograms are sharded, and threads record into their own
+// shard with relaxed atomic operations, so that recording is cheap enough for
+// the hot paths of the runtime and does not contend between threads. Gauges
+// are single atomics. Shards are summed when the metrics are written.
+//
+// Metrics created with the same name and type are the same metric. Metrics
+// created before the registry is registered are not recorded, so the registry
+// should be registered early, e.g.:
+//
+//   auto* registry = new LocalMetricsRegistry();
+//   RegisterMetricsRegistry(registry);
+//   ...
+//   registry->WritePrometheusText(llvm::outs());
+//
+// This class is thread-safe.
+class LocalMetricsRegistry : public MetricsRegistry {
+ public:
+  LocalMetricsRegistry();
+  ~LocalMetricsRegistry() override;
+
+  Counter* NewCounter(std::string name) override;
+  Gauge<int64_t>* NewInt64Gauge(std::string name) override;
+  Gauge<double>* NewDoubleGauge(std::string name) override;
+  Gauge<std::string>* NewStringGauge(std::string name) override;
+  Histogram* NewHistogram(std::string name, const Buckets& buckets) override;
+
+  // Run the collection callbacks, then write all the metrics in the
+  // Prometheus text exposition format. Metric names are sanitized, e.g.
+  // "/tensorflow/runtime/version" is written as "tensorflow_runtime_version".
+  // String gauges are written as gauges with the value 1 and the string in the
+  // "value" label. A histogram value equal to a bucket bound is counted in the
+  // bucket labelled by that bound.
+  void WritePrometheusText(raw_ostream& os) const;
+
+  // Write all the metrics to the file at `path`, in the Prometheus text
+  // exposition format.
+  Error WritePrometheusTextFile(string_view path) const;
+
+  // The base class of the metrics of the registry.
+  class Metric;
+
+ private:
+  // Returns the metric `name` if it exists with the same type, or adds the
+  // metric created by `create` otherwise.
+  template <typename T, typename CreateFn>
+  T* GetOrAdd(std::string name, CreateFn create);
+
+  mutable mutex mu_;
+  std::vector<std::unique_ptr<Metric>> metrics_ TFRT_GUARDED_BY(mu_);
+  llvm::StringMap<Metric*> metrics_by_name_ TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace metrics
+}  // namespace tfrt
+
+#endif  // TFRT_METRICS_LOCAL_METRICS_REGISTRY_H_
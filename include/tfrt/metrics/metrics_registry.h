@@ -19,8 +19,11 @@
 #ifndef TFRT_METRICS_METRICS_REGISTRY_H_
 #define TFRT_METRICS_METRICS_REGISTRY_H_
 
+#include <cstdint>
+#include <functional>
 #include <string>
 
+#include "counter.h"
 #include "gauge.h"
 #include "histogram.h"
 
@@ -31,6 +34,15 @@ class MetricsRegistry {
  public:
   virtual ~MetricsRegistry() {}
 
+  // Registries that do not support counters return nullptr, in which case the
+  // counter is not recorded.
+  virtual Counter* NewCounter(std::string name) { return nullptr; }
+
+  // Registries that do not support numeric gauges return nullptr, in which
+  // case the gauge is not recorded.
+  virtual Gauge<int64_t>* NewInt64Gauge(std::string name) { return nullptr; }
+  virtual Gauge<double>* NewDoubleGauge(std::string name) { return nullptr; }
+
   virtual Gauge<std::string>* NewStringGauge(std::string name) = 0;
 
   virtual Histogram* NewHistogram(std::string name, const Buckets& buckets) = 0;
@@ -45,6 +57,20 @@ extern MetricsRegistry* kMetricsRegistry;
 // time.
 void RegisterMetricsRegistry(MetricsRegistry* metrics_registry);
 
+// Registers `callback` to run before the metrics are read, so that metrics
+// whose values are buffered by their producers are up to date. Returns an id
+// to pass to RemoveCollectionCallback(). Callbacks must not add or remove
+// collection callbacks.
+int64_t AddCollectionCallback(std::function<void()> callback);
+
+// Unregisters the collection callback `id`. Waits for the callback to return
+// if it is running.
+void RemoveCollectionCallback(int64_t id);
+
+// Runs the collection callbacks. Registries call this before they read the
+// metrics.
+void RunCollectionCallbacks();
+
 }  // namespace metrics
 }  // namespace tfrt
 
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2022 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares utilities for querying the NUMA and CPU topology of the
+// machine, pinning threads to NUMA nodes or CPUs and allocating memory on a
+// NUMA node.
+//
+// NUMA nodes are identified by a dense index in [0, GetNumNumaNodes()). On
+// platforms without NUMA support, the machine is a single node.
+
+#ifndef TFRT_SUPPORT_NUMA_H_
+#define TFRT_SUPPORT_NUMA_H_
+
+#include <cstddef>
+
+#include "llvm/ADT/ArrayRef.h"
+
+namespace tfrt {
+
+// Return the number of NUMA nodes of the machine.
+int GetNumNumaNodes();
+
+// Return the CPUs of the NUMA node `node`. Return an empty list if the CPUs
+// are unknown.
+llvm::ArrayRef<int> GetNumaNodeCpus(int node);
+
+// Return the NUMA node of the calling thread. This is the node the thread is
+// pinned to by PinCurrentThreadToNumaNode(), or else the node of the CPU the
+// thread is currently running on.
+int GetCurrentNumaNode();
+
+// Restrict the calling thread to run on the CPUs of the NUMA node `node`.
+// Return false if the thread cannot be pinned.
+bool PinCurrentThreadToNumaNode(int node);
+
+// Allocate `size` bytes aligned to `alignment`, preferably from the memory of
+// the NUMA node `node`. The memory is allocated in whole pages, so this is
+// meant for large allocations. The returned pointer must be deallocated with
+// NumaFree() with the same `size`.
+void* NumaAlloc(size_t alignment, size_t size, int node);
+
+void NumaFree(void* ptr, size_t size);
+
+// The position of a CPU in the cache hierarchy of the machine. Caches are
+// identified by the lowest CPU id sharing them. If a cache level is unknown,
+// the CPU is considered not to share it with any other CPU.
+struct CpuTopology {
+  int cpu;
+  // The physical package (socket) of the CPU.
+  int package_id;
+  // The L3 and L2 caches of the CPU.
+  int l3_id;
+  int l2_id;
+};
+
+// Return the topology of the CPUs the process is allowed to run on, ordered by
+// package, L3 cache, L2 cache and CPU, so that the CPUs sharing caches are
+// adjacent. Return an empty list if the topology is unknown.
+llvm::ArrayRef<CpuTopology> GetCpuTopology();
+
+// Restrict the calling thread to run on the CPU `cpu`. Return false if the
+// thread cannot be pinned.
+bool PinCurrentThreadToCpu(int cpu);
+
+}  // namespace tfrt
+
+#endif  // TFRT_SUPPORT_NUMA_H_
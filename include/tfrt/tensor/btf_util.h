@@ -22,6 +22,8 @@
 
 #include <cstdint>
 #include <fstream>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "llvm/ADT/FunctionExtras.h"
@@ -29,6 +31,7 @@
 #include "tfrt/dtype/dtype.h"
 #include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/host_buffer.h"
 #include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/forward_decls.h"
@@ -38,6 +41,9 @@
 #include "tfrt/tensor/tensor_shape.h"
 
 namespace tfrt {
+namespace io {
+class ReadOnlyMemoryRegion;
+}  // namespace io
 
 // Utility function to read n elements of data of type T from the input stream.
 template <typename T>
@@ -198,6 +204,46 @@ Expected<DenseHostTensor> ReadDHTFromBTF(std::istream* stream, uint64_t offset,
 // only supports DenseHostTensors.
 Error WriteTensorsToBTF(std::ostream* stream, ArrayRef<const Tensor*> tensors);
 
+// A BTF-file that is memory mapped. The DenseHostTensors read from it alias
+// the mapping instead of copying the tensor data, so a large file is paged in
+// on demand, and the pages are shared by all the readers of the file. The
+// tensors keep the mapping alive, and must not be written to.
+//
+// The offsets table is validated when the file is opened, so a tensor is
+// located in constant time. The tensor records are 8-byte aligned in the
+// file, which together with the alignment of the mapping guarantees that the
+// tensor data is aligned for its dtype. This is checked for each tensor.
+//
+// This class is thread-safe.
+class MappedBTFFile {
+ public:
+  // Maps the BTF-file at `path` with the file system registered for the
+  // scheme of `path`, e.g. "scheme://file". Local files have an empty scheme.
+  static Expected<MappedBTFFile> Open(string_view path);
+
+  // Reads the BTF-file in `region`. `path` is only used in error messages.
+  static Expected<MappedBTFFile> Create(
+      std::unique_ptr<io::ReadOnlyMemoryRegion> region, string_view path);
+
+  size_t num_tensors() const { return offsets_.size(); }
+
+  // Returns the TENSOR_RECORD at `index` as a DHT that aliases the mapping.
+  Expected<DenseHostTensor> ReadDHT(size_t index) const;
+
+ private:
+  MappedBTFFile(std::string path, RCReference<HostBuffer> buffer,
+                ArrayRef<uint64_t> offsets)
+      : path_(std::move(path)),
+        buffer_(std::move(buffer)),
+        offsets_(offsets) {}
+
+  std::string path_;
+  // The contents of the file, which owns the mapping.
+  RCReference<HostBuffer> buffer_;
+  // The TENSOR_RECORD_OFFSETs, which point into `buffer_`.
+  ArrayRef<uint64_t> offsets_;
+};
+
 }  // namespace tfrt
 
 #endif  // TFRT_TENSOR_BTF_UTIL_H_
@@ -60,6 +60,13 @@ class DenseHostTensor final : public HostTensor,
     return CreateUninitialized(TensorMetadata(GetDType<T>(), shape), host);
   }
 
+  template <typename T>
+  static std::optional<DenseHostTensor> CreateUninitialized(
+      const TensorShape& shape, HostAllocator* allocator) {
+    return CreateUninitialized(TensorMetadata(GetDType<T>(), shape),
+                               allocator);
+  }
+
   template <typename T>
   static std::optional<DenseHostTensor> CreateScalar(T value,
                                                      HostContext* host) {
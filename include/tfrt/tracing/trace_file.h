@@ -0,0 +1,75 @@
+/*
+ * Copyright 2022 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Binary Trace File
+//
+// This file declares the compact binary trace format written by the ring
+// buffer tracing sink, and its conversion to the Chrome trace event format.
+
+#ifndef TFRT_TRACING_TRACE_FILE_H_
+#define TFRT_TRACING_TRACE_FILE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+namespace tracing {
+
+// A scope or an instant event. Timestamps are in ticks of the trace clock,
+// relative to the start of the trace.
+struct TraceEvent {
+  uint64_t begin = 0;
+  uint64_t end = 0;
+  // Index into TraceFile::names.
+  uint32_t name_id = 0;
+  bool instant = false;
+};
+
+struct TraceThread {
+  uint32_t thread_id = 0;
+  std::vector<TraceEvent> events;
+};
+
+// The contents of a binary trace file.
+//
+// The file starts with a header holding a magic number, a version and the
+// duration of a tick, followed by the interned names and by the events of
+// each thread. Integers are stored in the byte order of the machine that
+// recorded the trace.
+struct TraceFile {
+  double ns_per_tick = 1.0;
+  std::vector<std::string> names;
+  std::vector<TraceThread> threads;
+};
+
+// Writes `trace` in the binary trace format.
+void WriteTraceFile(const TraceFile& trace, raw_ostream& os);
+
+// Parses a binary trace file.
+Expected<TraceFile> ReadTraceFile(llvm::StringRef data);
+
+// Writes `trace` in the Chrome trace event format, which can be loaded in
+// chrome://tracing or Perfetto.
+void WriteChromeTraceJson(const TraceFile& trace, raw_ostream& os);
+
+}  // namespace tracing
+}  // namespace tfrt
+
+#endif  // TFRT_TRACING_TRACE_FILE_H_
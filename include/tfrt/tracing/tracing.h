@@ -51,6 +51,14 @@ class TracingSink {
 
   // Pushes a tracing scope to the calling thread's stack.
   virtual void PushTracingScope(NameGenerator gen_name) = 0;
+
+  // Same as RecordTracingEvent() and PushTracingScope(), but `name` has static
+  // storage duration, e.g. it is a string literal. A sink may record the name
+  // without building or copying a string. By default, the name is copied into
+  // a string and passed to the NameGenerator overload.
+  virtual void RecordStaticTracingEvent(string_view name);
+  virtual void PushStaticTracingScope(string_view name);
+
   // Ends the tracing scope from top of the calling thread's stack.
   // May be called after trace recording has been disabled.
   virtual void PopTracingScope() = 0;
@@ -143,6 +151,12 @@ inline void RecordTracingEvent(TracingLevel level,
   }
 }
 
+inline void RecordStaticTracingEvent(TracingLevel level, string_view name) {
+  if (IsTracingEnabled(level)) {
+    internal::kTracingSink->RecordStaticTracingEvent(name);
+  }
+}
+
 // RAII class that pushes/pops a tracing scope.
 class TracingScope {
   // No copy or assignment.
@@ -163,6 +177,27 @@ class TracingScope {
   const bool enabled_;
 };
 
+// RAII class that pushes/pops a tracing scope whose name has static storage
+// duration (see TracingSink::PushStaticTracingScope).
+class StaticTracingScope {
+  // No copy or assignment.
+  StaticTracingScope(const StaticTracingScope&) = delete;
+  StaticTracingScope& operator=(const StaticTracingScope&) = delete;
+
+ public:
+  StaticTracingScope(TracingLevel level, string_view name)
+      : enabled_(IsTracingEnabled(level)) {
+    if (enabled_) internal::kTracingSink->PushStaticTracingScope(name);
+  }
+
+  ~StaticTracingScope() {
+    if (enabled_) internal::kTracingSink->PopTracingScope();
+  }
+
+ private:
+  const bool enabled_;
+};
+
 }  // namespace tracing
 }  // namespace tfrt
 
@@ -176,4 +211,13 @@ class TracingScope {
   ::tfrt::tracing::RecordTracingEvent(TFRT_GET_TRACE_LEVEL(level), \
                                       [&] { return message; })
 
+// Same as above, but `name` must be a string literal, which is recorded without
+// building a std::string.
+#define TFRT_TRACE_STATIC_SCOPE(level, name)         \
+  ::tfrt::tracing::StaticTracingScope tracing_scope( \
+      TFRT_GET_TRACE_LEVEL(level), "" name)
+#define TFRT_TRACE_STATIC_EVENT(level, name)                             \
+  ::tfrt::tracing::RecordStaticTracingEvent(TFRT_GET_TRACE_LEVEL(level), \
+                                            "" name)
+
 #endif  // TFRT_TRACING_TRACING_H_
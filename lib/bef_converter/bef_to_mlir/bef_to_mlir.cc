@@ -101,6 +101,10 @@ struct BEFFile {
 
   mlir::Location location;
 
+  // The format version of the file, which determines the layout of the kernel
+  // table entries.
+  uint8_t format_version = kBEFCurrentVersion;
+
   llvm::DenseMap<size_t, string_view> strings;
 
   llvm::DenseMap<size_t, mlir::Attribute> attributes;
@@ -332,9 +336,11 @@ mlir::LogicalResult BEFToMLIRConverter::ReadHeader() {
     EmitError(bef_file_.location, "Invalid BEF file header detected");
     return mlir::failure();
   }
-  if (!file_reader_.ReadByte(&byte) || (byte != kBEFVersion0)) {
+  if (!file_reader_.ReadByte(&byte) || (byte > kBEFCurrentVersion)) {
     EmitError(bef_file_.location, "Unknown BEF format version detected");
+    return mlir::failure();
   }
+  bef_file_.format_version = byte;
   return mlir::success();
 }
 
@@ -712,13 +718,17 @@ mlir::LogicalResult BEFFunctionReader::ReadKernelTable() {
   size_t num_kernels;
   if (!function_reader_.ReadVbrInt(&num_kernels)) return mlir::failure();
   for (int i = 0; i < num_kernels; ++i) {
-    // stream_id is not needed to reconstruct the MLIR function.
+    // stream_id and priority are not needed to reconstruct the MLIR function.
+    // Files of version 0 have no priority.
     size_t stream_id = 0;
+    size_t priority = 0;
 
     KernelTableEntry entry;
     if (!function_reader_.ReadVbrInt(&entry.offset) ||
         !function_reader_.ReadVbrInt(&entry.num_operands) ||
-        !function_reader_.ReadVbrInt(&stream_id))
+        !function_reader_.ReadVbrInt(&stream_id) ||
+        (BEFKernelEntriesHavePriority(bef_file_.format_version) &&
+         !function_reader_.ReadVbrInt(&priority)))
       return mlir::failure();
 
     kernel_table_.push_back(entry);
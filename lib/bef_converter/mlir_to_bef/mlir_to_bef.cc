@@ -830,6 +830,8 @@ void BEFFunctionEmitter::EmitFunction(mlir::Region* region,
   EmitVbrInt(0);
   // The pseudo kernel is always in the root stream.
   EmitVbrInt(stream_analysis.GetRootStream().id());
+  // The pseudo kernel is on every path of the function.
+  EmitVbrInt(stream_analysis.GetRootCriticalPathCost());
 
   EmitArgumentsPseudoKernel(&block, &kernel_list);
 
@@ -851,6 +853,10 @@ void BEFFunctionEmitter::EmitFunction(mlir::Region* region,
     const auto& stream = stream_analysis.GetStream(&op);
     EmitVbrInt(stream.id());
 
+    // Emit the critical path cost, which is used by the executor to prioritize
+    // kernels on the longest remaining path.
+    EmitVbrInt(stream_analysis.GetCriticalPathCost(&op));
+
     EmitKernel(&op, &kernel_list, locations, attribute_names);
   }
 
@@ -1117,7 +1123,7 @@ BefBuffer ConvertMLIRToBEF(mlir::ModuleOp module,
     return {};
 
   // Emit magic numbers and format version.
-  emitter.EmitBytes({kBEFMagic1, kBEFMagic2, kBEFVersion0});
+  emitter.EmitBytes({kBEFMagic1, kBEFMagic2, kBEFCurrentVersion});
 
   BEFFileEmitter attribute_types;
   BEFFileEmitter attribute_names;
@@ -16,6 +16,7 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
 #include <string>
@@ -29,8 +30,11 @@
 #include "llvm/ADT/SmallVector.h"
 #include "tfrt/bef/bef_encoding.h"
 #include "tfrt/bef/bef_reader.h"
+#include "tfrt/bef_executor/kernel_latency_sampler.h"
+#include "tfrt/bef_executor/kernel_profiler.h"
 #include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/async_value.h"
+#include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/host_context.h"
@@ -110,8 +114,39 @@ llvm::ArrayRef<unsigned> GetNextUsedBys(const BEFKernel& kernel,
   return used_bys;
 }
 
+// Run `kernel_fn` and record its wall time in the kernel profiler. This is kept
+// out of line so that it does not affect the executor when profiling is off.
+LLVM_ATTRIBUTE_NOINLINE void ProfileKernel(AsyncKernelImplementation kernel_fn,
+                                           AsyncKernelFrame* kernel_frame) {
+  auto start = std::chrono::steady_clock::now();
+  kernel_fn(kernel_frame);
+  auto duration = std::chrono::steady_clock::now() - start;
+
+  if (auto* profiler = GetKernelProfiler())
+    profiler->RecordKernel(kernel_frame->GetLocation(), duration);
+}
+
+// Run `kernel_fn` and record its wall time in `sampler`. This is kept out of
+// line for the same reason as ProfileKernel().
+LLVM_ATTRIBUTE_NOINLINE void SampleKernel(AsyncKernelImplementation kernel_fn,
+                                          AsyncKernelFrame* kernel_frame,
+                                          const char* kernel_name,
+                                          KernelLatencySampler* sampler) {
+  auto start = std::chrono::steady_clock::now();
+  kernel_fn(kernel_frame);
+  auto duration = std::chrono::steady_clock::now() - start;
+
+  sampler->RecordKernel(kernel_name, duration);
+}
+
 // ReadyKernelQueue is used for managing ready-to-run kernels in one sequential
 // path.
+//
+// Inline kernels are kept in a max-heap ordered by their priority, which is the
+// critical path cost computed by the compiler, so that the kernel on the
+// longest remaining path is executed first. Ties are broken in favor of the
+// larger kernel id, which preserves the LIFO order for kernels without
+// priority information.
 class ReadyKernelQueue {
  public:
   // Constructs an empty queue with `stream_id`.
@@ -126,7 +161,10 @@ class ReadyKernelQueue {
                    std::vector<unsigned> kernel_ids)
       : stream_id_(stream_id),
         kernel_array_(kernel_array),
-        inline_kernel_ids_(std::move(kernel_ids)) {}
+        inline_kernel_ids_(std::move(kernel_ids)) {
+    std::make_heap(inline_kernel_ids_.begin(), inline_kernel_ids_.end(),
+                   KernelPriorityLess{kernel_array_});
+  }
 
   // If the inline kernels are empty, we can move some of the outline kernels
   // into the inline kernels, and update the stream id. This allows to reduce
@@ -137,8 +175,13 @@ class ReadyKernelQueue {
     // We can't switch stream id if we do not have outline kernels.
     if (outline_kernel_ids_.empty()) return;
 
-    // Pick the new stream id from the ready outline kernels.
-    stream_id_ = kernel_array_[outline_kernel_ids_[0]].stream_id;
+    // Pick the new stream id from the ready outline kernel with the highest
+    // priority, so that the critical path stays in the current thread.
+    stream_id_ = kernel_array_[*std::max_element(
+                                   outline_kernel_ids_.begin(),
+                                   outline_kernel_ids_.end(),
+                                   KernelPriorityLess{kernel_array_})]
+                     .stream_id;
 
     // Partition outlined kernels using the new stream id.
     auto inline_kernels_begin = std::partition(
@@ -148,6 +191,8 @@ class ReadyKernelQueue {
     // Move outline kernels belonging to the new stream into the inline kernels.
     inline_kernel_ids_.assign(inline_kernels_begin, outline_kernel_ids_.end());
     outline_kernel_ids_.erase(inline_kernels_begin, outline_kernel_ids_.end());
+    std::make_heap(inline_kernel_ids_.begin(), inline_kernel_ids_.end(),
+                   KernelPriorityLess{kernel_array_});
   }
 
   // Decrement the ready counts for `kernel_ids` and put them in the queue.
@@ -169,6 +214,8 @@ class ReadyKernelQueue {
           ready_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
         if (kernel_info.stream_id == stream_id_) {
           inline_kernel_ids_.push_back(kernel_id);
+          std::push_heap(inline_kernel_ids_.begin(), inline_kernel_ids_.end(),
+                         KernelPriorityLess{kernel_array_});
         } else {
           outline_kernel_ids_.push_back(kernel_id);
         }
@@ -176,8 +223,18 @@ class ReadyKernelQueue {
     }
   }
 
-  // `inline_kernel_ids` contains the kernels to be executed in the same thread.
-  std::vector<unsigned>& inline_kernel_ids() { return inline_kernel_ids_; }
+  // Returns true if there are no kernels to be executed in the same thread.
+  bool inline_kernels_empty() const { return inline_kernel_ids_.empty(); }
+
+  // Removes and returns the inline kernel with the highest priority.
+  unsigned PopInlineKernel() {
+    assert(!inline_kernel_ids_.empty());
+    std::pop_heap(inline_kernel_ids_.begin(), inline_kernel_ids_.end(),
+                  KernelPriorityLess{kernel_array_});
+    unsigned kernel_id = inline_kernel_ids_.back();
+    inline_kernel_ids_.pop_back();
+    return kernel_id;
+  }
 
   // `outline_kernel_ids` contains the kernels to be launched to a separate
   // thread.
@@ -191,13 +248,121 @@ class ReadyKernelQueue {
   int stream_id() const { return stream_id_; }
 
  private:
+  // Orders kernel ids by their priority, and then by their ids.
+  struct KernelPriorityLess {
+    bool operator()(unsigned x_id, unsigned y_id) const {
+      assert(x_id < kernel_array.size());
+      assert(y_id < kernel_array.size());
+      unsigned x_priority = kernel_array[x_id].priority;
+      unsigned y_priority = kernel_array[y_id].priority;
+      return x_priority < y_priority ||
+             (x_priority == y_priority && x_id < y_id);
+    }
+
+    MutableArrayRef<BEFFileImpl::KernelInfo> kernel_array;
+  };
+
   int stream_id_;
   MutableArrayRef<BEFFileImpl::KernelInfo> kernel_array_;
 
+  // `inline_kernel_ids_` contains the kernels to be executed in the same
+  // thread. It is a max-heap ordered by KernelPriorityLess.
   std::vector<unsigned> inline_kernel_ids_;
   std::vector<unsigned> outline_kernel_ids_;
 };
 
+// OutlineKernelBatch is a batch of stream groups of ready outline kernels that
+// is launched to the concurrent work queue as a single task. The task that
+// picks up the batch forks off parts of it while there are idle workers to run
+// them, so that a wide fan-out does not result in many enqueues and thread
+// wake-ups from the thread that made the kernels ready. The stream groups are
+// split so that the estimated costs of both parts are balanced. Stream groups
+// that are too cheap to be worth a task of their own are run one after another
+// by the thread that holds the batch.
+class OutlineKernelBatch {
+ public:
+  // A batch whose estimated cost is at most this is not split. The compiler
+  // gives the cheapest kernels (e.g. returns and chain merges) a cost of 1.
+  static constexpr uint64_t kMaxCoalescedCost = 4;
+
+  // Add a stream group of `kernel_ids` with the estimated `cost`. Stream
+  // groups are processed in the order they are added.
+  void AddStreamGroup(ArrayRef<unsigned> kernel_ids, unsigned cost) {
+    assert(!kernel_ids.empty());
+    kernel_ids_.insert(kernel_ids_.end(), kernel_ids.begin(), kernel_ids.end());
+    // Without kernel priorities (e.g. in BEF files of format version 0), the
+    // cost is unknown and the stream group is not considered cheap.
+    uint64_t group_cost = cost > 0 ? cost : kMaxCoalescedCost + 1;
+    stream_groups_.push_back(
+        {static_cast<unsigned>(kernel_ids_.size()), group_cost});
+    total_cost_ += group_cost;
+  }
+
+  size_t num_stream_groups() const { return stream_groups_.size(); }
+
+  // Return true if the stream groups of this batch should not be split.
+  bool IsCheap() const { return total_cost_ <= kMaxCoalescedCost; }
+
+  // Split off the trailing stream groups to a new batch, keeping the leading
+  // stream groups that account for about half of the cost in this batch.
+  OutlineKernelBatch SplitBalanced() {
+    assert(stream_groups_.size() > 1);
+
+    size_t split = 0;
+    uint64_t kept_cost = 0;
+    while (split + 1 < stream_groups_.size() && kept_cost * 2 < total_cost_)
+      kept_cost += stream_groups_[split++].cost;
+    return SplitAt(std::max<size_t>(split, 1));
+  }
+
+  // Split off all stream groups but the first one to a new batch.
+  OutlineKernelBatch SplitAfterFirst() {
+    assert(stream_groups_.size() > 1);
+    return SplitAt(1);
+  }
+
+  // Remove the first stream group from this batch and return its kernel ids.
+  std::vector<unsigned> TakeFirstStreamGroup() {
+    assert(!stream_groups_.empty());
+    OutlineKernelBatch rest;
+    if (stream_groups_.size() > 1) rest = SplitAt(1);
+    std::vector<unsigned> kernel_ids = std::move(kernel_ids_);
+    *this = std::move(rest);
+    return kernel_ids;
+  }
+
+ private:
+  // Split off the stream groups from `split` on to a new batch.
+  OutlineKernelBatch SplitAt(size_t split) {
+    OutlineKernelBatch forked;
+    unsigned split_offset = stream_groups_[split - 1].end;
+    forked.kernel_ids_.assign(kernel_ids_.begin() + split_offset,
+                              kernel_ids_.end());
+    for (size_t i = split; i < stream_groups_.size(); ++i) {
+      forked.stream_groups_.push_back(
+          {stream_groups_[i].end - split_offset, stream_groups_[i].cost});
+      forked.total_cost_ += stream_groups_[i].cost;
+    }
+
+    kernel_ids_.resize(split_offset);
+    stream_groups_.resize(split);
+    total_cost_ -= forked.total_cost_;
+    return forked;
+  }
+
+  struct StreamGroup {
+    // The end offset of the stream group in `kernel_ids_`.
+    unsigned end;
+    uint64_t cost;
+  };
+
+  // The ids of the kernels in all stream groups, in the order of the stream
+  // groups.
+  std::vector<unsigned> kernel_ids_;
+  llvm::SmallVector<StreamGroup, 4> stream_groups_;
+  uint64_t total_cost_ = 0;
+};
+
 }  // namespace
 
 /// A BEFExecutor runs a BEF function containing a stream of asynchronous
@@ -213,19 +378,27 @@ class BEFExecutor final : public ReferenceCounted<BEFExecutor> {
                            std::vector<RCReference<AsyncValue>> arguments,
                            MutableArrayRef<RCReference<AsyncValue>> results);
 
-  /// When the last reference to the BEFExecutor is dropped, we deallocate
-  /// ourself.  The memory for this class is managed through the HostAllocator
-  /// managed by the HostContext.
+  /// When the last reference to the BEFExecutor is dropped, we recycle our
+  /// frame into the executor pool of the function, or deallocate it if the
+  /// pool is full.
   void Destroy() {
-    auto host = this->GetHost();
+    // The pool is owned by the function, which is kept alive by the BEF file
+    // until the frame is recycled.
+    RCReference<BEFFileImpl> bef_file = std::move(bef_file_);
+    BEFExecutorPool* executor_pool = executor_pool_;
     this->~BEFExecutor();
-    host->Deallocate<BEFExecutor>(this);
+    if (!executor_pool->Push(this)) executor_pool->Deallocate(this);
   }
 
  private:
-  BEFExecutor(ExecutionContext exec_ctx, BEFFileImpl* bef_file);
+  BEFExecutor(ExecutionContext exec_ctx, BEFFileImpl* bef_file,
+              BEFExecutorPool* executor_pool);
   ~BEFExecutor();
 
+  // Return the storage for the register and kernel infos, which are placed
+  // right after the BEFExecutor in the same frame.
+  void* GetFunctionInfoStorage();
+
   void Execute(std::vector<RCReference<AsyncValue>> arguments);
 
  private:
@@ -269,17 +442,24 @@ class BEFExecutor final : public ReferenceCounted<BEFExecutor> {
   // executed in a dfferent thread in parallel.
   void EnqueueReadyKernels(std::vector<unsigned>& kernel_ids);
 
+  // Enqueue `batch` to the concurrent work queue as a single task.
+  void EnqueueOutlineKernelBatch(OutlineKernelBatch batch);
+
+  // Fork parts of `batch` to other tasks while there are idle workers, and
+  // process the remaining stream groups in the current thread.
+  void ProcessOutlineKernelBatch(OutlineKernelBatch batch);
+
   HostContext* GetHost() const { return exec_ctx_.host(); }
   BEFFileImpl* BefFile() const { return bef_file_.get(); }
 
   ArrayRef<uint32_t> kernels() { return function_info_.kernels; }
 
   MutableArrayRef<BEFFileImpl::RegisterInfo> register_infos() {
-    return function_info_.register_infos.mutable_array();
+    return function_info_.register_infos;
   }
 
   MutableArrayRef<BEFFileImpl::KernelInfo> kernel_infos() {
-    return function_info_.kernel_infos.mutable_array();
+    return function_info_.kernel_infos;
   }
 
   void DebugPrintError(const BEFKernel& kernel, unsigned kernel_id,
@@ -294,8 +474,40 @@ class BEFExecutor final : public ReferenceCounted<BEFExecutor> {
   BEFFileImpl::FunctionInfo function_info_;
 
   RCReference<BEFFileImpl> bef_file_;
+
+  /// The pool that this executor's frame is recycled into.
+  BEFExecutorPool* executor_pool_;
 };
 
+namespace {
+
+// A BEFExecutor frame holds the BEFExecutor followed by its register and
+// kernel infos.
+constexpr size_t kExecutorFrameAlignment =
+    std::max(alignof(BEFExecutor), alignof(BEFFileImpl::RegisterInfo));
+constexpr size_t kFunctionInfoOffset =
+    (sizeof(BEFExecutor) + alignof(BEFFileImpl::RegisterInfo) - 1) /
+    alignof(BEFFileImpl::RegisterInfo) * alignof(BEFFileImpl::RegisterInfo);
+
+size_t GetExecutorFrameSize(const BEFFunctionTemplate& function_template) {
+  return kFunctionInfoOffset +
+         BEFFileImpl::GetFunctionInfoSize(function_template);
+}
+
+metrics::Counter* GetExecutorPoolHitCounter() {
+  static auto* counter =
+      metrics::NewCounter("/tensorflow/runtime/bef_executor/pool_hits");
+  return counter;
+}
+
+metrics::Counter* GetExecutorPoolMissCounter() {
+  static auto* counter =
+      metrics::NewCounter("/tensorflow/runtime/bef_executor/pool_misses");
+  return counter;
+}
+
+}  // namespace
+
 //===----------------------------------------------------------------------===//
 // Core executor logic
 //===----------------------------------------------------------------------===//
@@ -401,7 +613,7 @@ LLVM_ATTRIBUTE_ALWAYS_INLINE void BEFExecutor::ProcessUsedBysAndSetRegister(
 void BEFExecutor::ProcessArgumentsPseudoKernel(
     std::vector<RCReference<AsyncValue>> arguments,
     ReadyKernelQueue& ready_kernel_queue) {
-  assert(ready_kernel_queue.inline_kernel_ids().empty());
+  assert(ready_kernel_queue.inline_kernels_empty());
   assert(ready_kernel_queue.outline_kernel_ids().empty());
 
   BEFKernel kernel(kernels().data());
@@ -507,6 +719,7 @@ void BEFExecutor::ProcessReadyKernel(unsigned kernel_id,
   auto attributes =
       kernel.GetKernelEntries(entry_offset, kernel.num_attributes());
   kernel_frame->SetAttributes(attributes);
+  kernel_frame->SetAttributeCache(&function_info_.attribute_caches[kernel_id]);
 
   // Set up functions.
   entry_offset += attributes.size();
@@ -527,7 +740,15 @@ void BEFExecutor::ProcessReadyKernel(unsigned kernel_id,
 
     // kernel_fn should populate results in kernel_frame with pointers to
     // AsyncValue before it returns.
-    kernel_fn(kernel_frame);
+    KernelLatencySampler* sampler = GetKernelLatencySampler();
+    if (LLVM_UNLIKELY(GetKernelProfiler() != nullptr)) {
+      ProfileKernel(kernel_fn, kernel_frame);
+    } else if (LLVM_UNLIKELY(sampler != nullptr && sampler->ShouldSample())) {
+      SampleKernel(kernel_fn, kernel_frame,
+                   BefFile()->GetKernelName(kernel.kernel_code()), sampler);
+    } else {
+      kernel_fn(kernel_frame);
+    }
 
   } else {
     // Otherwise, automatically propagate errors to the result values.
@@ -591,35 +812,90 @@ LLVM_ATTRIBUTE_NOINLINE void BEFExecutor::EnqueueReadyKernels(
         return kernel_array[x_id].stream_id < kernel_array[y_id].stream_id;
       });
 
-  // For each stream group, we enqueue the kernels to the work queue.
+  // Find the stream groups and their highest kernel priorities.
+  struct StreamGroup {
+    unsigned priority;
+    std::vector<unsigned>::iterator begin;
+    std::vector<unsigned>::iterator end;
+  };
+  llvm::SmallVector<StreamGroup, 4> stream_groups;
   for (auto iter = kernel_ids.begin(); iter != kernel_ids.end();) {
-    int stream_id = kernel_array[*iter].stream_id;
-    auto jter = iter++;
+    unsigned stream_id = kernel_array[*iter].stream_id;
+    StreamGroup group{0, iter, iter};
     for (;
          iter != kernel_ids.end() && kernel_array[*iter].stream_id == stream_id;
          ++iter) {
+      group.priority = std::max(group.priority, kernel_array[*iter].priority);
     }
+    group.end = iter;
+    stream_groups.push_back(group);
+  }
 
-    std::vector<unsigned> stream_kernel_ids(jter, iter);
-    AddRef();
-    EnqueueWork(
-        exec_ctx_,
-        [this, stream_id, kernel_ids = std::move(stream_kernel_ids)]() mutable {
-          ReadyKernelQueue ready_kernel_queue(stream_id, kernel_infos(),
-                                              std::move(kernel_ids));
-          ProcessReadyKernels(ready_kernel_queue);
-          DropRef();
-        });
+  // Order the stream groups on the longest remaining paths first, so that they
+  // are processed first when the batch is picked up by the work queue.
+  std::stable_sort(stream_groups.begin(), stream_groups.end(),
+                   [](const StreamGroup& x, const StreamGroup& y) {
+                     return x.priority > y.priority;
+                   });
+
+  // Launch all the stream groups as a single task, which forks the other
+  // groups when it starts running. This way the enqueue work for a wide
+  // fan-out is spread over the threads that pick up the forked tasks.
+  OutlineKernelBatch batch;
+  for (const auto& group : stream_groups) {
+    batch.AddStreamGroup(llvm::ArrayRef(&*group.begin, group.end - group.begin),
+                         group.priority);
   }
+  EnqueueOutlineKernelBatch(std::move(batch));
 
   // Clear the kernel_ids as they are enqueued.
   kernel_ids.clear();
 }
 
+// Enqueue `batch` to the concurrent work queue.
+void BEFExecutor::EnqueueOutlineKernelBatch(OutlineKernelBatch batch) {
+  AddRef();
+  EnqueueWork(exec_ctx_, [this, batch = std::move(batch)]() mutable {
+    ProcessOutlineKernelBatch(std::move(batch));
+    DropRef();
+  });
+}
+
+// Fork parts of `batch` into separate tasks while there are idle workers to run
+// them, and then process the remaining stream groups in the current thread.
+void BEFExecutor::ProcessOutlineKernelBatch(OutlineKernelBatch batch) {
+  int num_idle_workers = exec_ctx_.work_queue().GetNumIdleWorkers();
+  while (batch.num_stream_groups() > 1 && !batch.IsCheap()) {
+    if (num_idle_workers > 0) {
+      --num_idle_workers;
+      EnqueueOutlineKernelBatch(batch.SplitBalanced());
+    } else {
+      // All workers are busy, so forked tasks would only wait in the queues.
+      // Keep the other stream groups in a single task, which is split further
+      // by the worker that picks it up.
+      EnqueueOutlineKernelBatch(batch.SplitAfterFirst());
+    }
+  }
+
+  while (batch.num_stream_groups() > 0) {
+    std::vector<unsigned> kernel_ids = batch.TakeFirstStreamGroup();
+    assert(!kernel_ids.empty());
+    int stream_id = kernel_infos()[kernel_ids.front()].stream_id;
+    ReadyKernelQueue ready_kernel_queue(stream_id, kernel_infos(),
+                                        std::move(kernel_ids));
+    ProcessReadyKernels(ready_kernel_queue);
+  }
+}
+
 // Iteratively process ready kernels in `ready_kernel_queue` and inserts ready
 // users back for next round of processing, until there are no more ready
 // kernels.
 void BEFExecutor::ProcessReadyKernels(ReadyKernelQueue& ready_kernel_queue) {
+  // Kernels of a request whose deadline has passed are not run: the request is
+  // cancelled, so ProcessReadyKernel() propagates the cancellation to their
+  // results instead.
+  exec_ctx_.request_ctx()->CancelIfDeadlineExceeded();
+
   // Process the kernel record to get information about what argument
   // registers, result registers, and attributes should be passed.
   KernelFrameBuilder kernel_frame(exec_ctx_);
@@ -627,7 +903,7 @@ void BEFExecutor::ProcessReadyKernels(ReadyKernelQueue& ready_kernel_queue) {
   kernel_frame.SetFunctions(BefFile()->functions_);
 
   // Switch stream id if there are no inline kernels to process.
-  if (ready_kernel_queue.inline_kernel_ids().empty())
+  if (ready_kernel_queue.inline_kernels_empty())
     ready_kernel_queue.SwitchStreamId();
 
   // Enqueue outline kernels into the concurrent work queue.
@@ -635,17 +911,17 @@ void BEFExecutor::ProcessReadyKernels(ReadyKernelQueue& ready_kernel_queue) {
     EnqueueReadyKernels(ready_kernel_queue.outline_kernel_ids());
   assert(ready_kernel_queue.outline_kernel_ids().empty());
 
-  // The loop below process inline kernels in a LIFO order for cache locality.
-  // Outline kernels are enqueued to the concurrent work queue immediately.
+  // The loop below process inline kernels in the order of their priorities, so
+  // that the kernel on the longest remaining path is executed first. Outline
+  // kernels are enqueued to the concurrent work queue immediately.
 
-  while (!ready_kernel_queue.inline_kernel_ids().empty()) {
-    auto kernel_id = ready_kernel_queue.inline_kernel_ids().back();
-    ready_kernel_queue.inline_kernel_ids().pop_back();
+  while (!ready_kernel_queue.inline_kernels_empty()) {
+    auto kernel_id = ready_kernel_queue.PopInlineKernel();
 
     ProcessReadyKernel(kernel_id, &kernel_frame, ready_kernel_queue);
 
     // Switch stream id if there are no inline kernels to process.
-    if (ready_kernel_queue.inline_kernel_ids().empty())
+    if (ready_kernel_queue.inline_kernels_empty())
       ready_kernel_queue.SwitchStreamId();
 
     // Enqueue outline kernels into the concurrent work queue.
@@ -659,11 +935,18 @@ void BEFExecutor::ProcessReadyKernels(ReadyKernelQueue& ready_kernel_queue) {
 // Executor Setup
 //===----------------------------------------------------------------------===//
 
-BEFExecutor::BEFExecutor(ExecutionContext exec_ctx, BEFFileImpl* bef_file)
-    : exec_ctx_(std::move(exec_ctx)), bef_file_(FormRef(bef_file)) {}
+BEFExecutor::BEFExecutor(ExecutionContext exec_ctx, BEFFileImpl* bef_file,
+                         BEFExecutorPool* executor_pool)
+    : exec_ctx_(std::move(exec_ctx)),
+      bef_file_(FormRef(bef_file)),
+      executor_pool_(executor_pool) {}
 
 BEFExecutor::~BEFExecutor() {}
 
+void* BEFExecutor::GetFunctionInfoStorage() {
+  return reinterpret_cast<char*>(this) + kFunctionInfoOffset;
+}
+
 void BEFExecutor::Execute(std::vector<RCReference<AsyncValue>> arguments) {
   // Each KernelInfo::arguments_not_ready to the number of arguments (or one for
   // kernels with no arguments). This means that as we walk the list to drop the
@@ -698,25 +981,39 @@ RCReference<BEFExecutor> BEFExecutor::Create(
   assert(results.size() == fn.result_types().size() &&
          "incorrect number of results passed to function call");
 
-  HostContext* host = exec_ctx.host();
-  auto* exec_ptr = host->Allocate<BEFExecutor>();
-  auto* exec = new (exec_ptr) BEFExecutor(std::move(exec_ctx), bef_file);
-
-  size_t location_offset;
-  llvm::SmallVector<size_t, 4> result_regs;
-  bool success = bef_file->ReadFunction(fn.function_offset(), fn.result_types(),
-                                        &location_offset, &exec->function_info_,
-                                        &result_regs, host->allocator());
-  if (!success) {
+  // The function template is decoded on the first execution of `fn` and
+  // reused afterwards.
+  const BEFFunctionTemplate* function_template = fn.GetFunctionTemplate();
+  if (!function_template) {
     for (size_t i = 0, e = results.size(); i != e; ++i) {
       assert(!results[i] && "result AsyncValue is not nullptr");
-      results[i]->SetError(absl::InternalError("Could not read BEF function."));
+      results[i] = MakeErrorAsyncValueRef(
+          absl::InternalError("Could not read BEF function."));
     }
     return {};
   };
 
+  ArrayRef<size_t> result_regs = function_template->result_regs;
   assert(result_regs.size() == fn.result_types().size());
 
+  // Reuse a recycled frame if there is one, so that steady-state executions
+  // of the function do not allocate.
+  BEFExecutorPool& executor_pool = fn.executor_pool();
+  void* frame = executor_pool.Pop();
+  if (frame) {
+    GetExecutorPoolHitCounter()->Increment();
+  } else {
+    GetExecutorPoolMissCounter()->Increment();
+    frame = executor_pool.Allocate(GetExecutorFrameSize(*function_template),
+                                   kExecutorFrameAlignment);
+  }
+
+  auto* exec =
+      new (frame) BEFExecutor(std::move(exec_ctx), bef_file, &executor_pool);
+  BEFFileImpl::InstantiateFunction(*function_template,
+                                   exec->GetFunctionInfoStorage(),
+                                   &exec->function_info_);
+
   MutableArrayRef<BEFFileImpl::RegisterInfo> register_array =
       exec->register_infos();
 
@@ -779,18 +1076,66 @@ void BEFExecutor::ExecuteAsync(
   if (!exec) return;
 
   auto& work_queue = exec->exec_ctx_.work_queue();
-  work_queue.AddTask([&fn, exec = std::move(exec),
-                      arg_copies = std::move(arguments)]() mutable {
-    DEBUG_PRINT("Execute function %s start\n",
-                fn.name().empty() ? "(unknown)" : fn.name().str().c_str());
+  const int priority = exec->exec_ctx_.priority();
+  work_queue.AddTaskWithPriority(
+      [&fn, exec = std::move(exec),
+       arg_copies = std::move(arguments)]() mutable {
+        DEBUG_PRINT("Execute function %s start\n",
+                    fn.name().empty() ? "(unknown)" : fn.name().str().c_str());
+
+        // Kick off BEF execution starting from ready kernels.
+        exec->Execute(std::move(arg_copies));
+
+        DEBUG_PRINT("Execute function %s end\n",
+                    fn.name().empty() ? "(unknown)" : fn.name().str().c_str());
+        (void)fn;
+      },
+      priority);
+}
 
-    // Kick off BEF execution starting from ready kernels.
-    exec->Execute(std::move(arg_copies));
+//===----------------------------------------------------------------------===//
+// BEFExecutorPool implementation
+//===----------------------------------------------------------------------===//
 
-    DEBUG_PRINT("Execute function %s end\n",
-                fn.name().empty() ? "(unknown)" : fn.name().str().c_str());
-    (void)fn;
-  });
+BEFExecutorPool::~BEFExecutorPool() {
+  for (auto& frame : frames_) {
+    if (void* ptr = frame.load(std::memory_order_relaxed)) Deallocate(ptr);
+  }
+}
+
+void* BEFExecutorPool::Allocate(size_t size, size_t alignment) {
+  // Frames are handed over between threads with the pool or the reference
+  // count of the executor, which orders this store before the deallocations.
+  assert(frame_size_.load(std::memory_order_relaxed) == 0 ||
+         frame_size_.load(std::memory_order_relaxed) == size);
+  frame_size_.store(size, std::memory_order_relaxed);
+  return allocator_->AllocateBytes(size, alignment);
+}
+
+void BEFExecutorPool::Deallocate(void* frame) {
+  allocator_->DeallocateBytes(frame,
+                              frame_size_.load(std::memory_order_relaxed));
+}
+
+void* BEFExecutorPool::Pop() {
+  for (auto& frame : frames_) {
+    if (frame.load(std::memory_order_relaxed) == nullptr) continue;
+    if (void* ptr = frame.exchange(nullptr, std::memory_order_acquire))
+      return ptr;
+  }
+  return nullptr;
+}
+
+bool BEFExecutorPool::Push(void* ptr) {
+  assert(ptr);
+  for (auto& frame : frames_) {
+    if (frame.load(std::memory_order_relaxed) != nullptr) continue;
+    void* expected = nullptr;
+    if (frame.compare_exchange_strong(expected, ptr, std::memory_order_release,
+                                      std::memory_order_relaxed))
+      return true;
+  }
+  return false;
 }
 
 //===----------------------------------------------------------------------===//
@@ -19,9 +19,18 @@
 
 #include "tfrt/bef_executor/bef_file.h"
 
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
 
 #include "bef_file_impl.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
 #include "tfrt/bef/bef_encoding.h"
 #include "tfrt/bef/bef_location.h"
 #include "tfrt/bef/bef_reader.h"
@@ -30,6 +39,7 @@
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/location.h"
 #include "tfrt/host_context/native_function.h"
+#include "tfrt/io/file_system.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/variant.h"
 
@@ -50,8 +60,9 @@ struct FunctionIndex {
 
 // This class is a direct reflection of some of the BEF file contents in memory,
 // expressed with ranges and other helpers to decode them. The BEFFile
-// constructor uses these (combined with the kernel registry) to resolve and
-// build the tables in BEFFile that the executor walks.
+// constructor uses these (combined with the kernel registry) to build the
+// tables in BEFFile that the executor walks. The kernels are resolved lazily
+// when the functions using them are decoded (see BEFFileImpl::BindKernels).
 //
 // These functions return true on success.
 // When a failure occurs, emit an error message and return false.
@@ -62,15 +73,13 @@ class BEFFileReader : public BEFReader {
       : BEFReader(file), registry_(registry), bef_file_(bef_file) {}
 
   bool ReadNextSection();
-  bool ReadKernelsSection(HostAllocator* host_allocator);
+  bool ReadKernelsSection();
   bool ReadTypesSection();
   bool ReadFunctionIndexSection();
 
  private:
   bool ReadFunctionIndexSectionInternal(
       llvm::SmallVectorImpl<FunctionIndex>* function_indices);
-  bool DiagnoseUnknownKernel(size_t kernel_idx, const char* kernel_name,
-                             HostAllocator* host_allocator);
 
   // These are things set up at construction time.
   const KernelRegistry& registry_;
@@ -151,73 +160,10 @@ bool BEFFileReader::ReadNextSection() {
   return true;
 }
 
-// BEF files can refer to arbitrary kernels, which get resolved at load time
-// through a KernelRegistry.  When an unknown kernel name is found, this method
-// is invoked to try to resolve a nice location to emit the error.
-//
-// This does not need to be particularly fast, given that it only happens in
-// error cases.
-//
-// If we can't find a nice location, we can fallback to a poor location.
-bool BEFFileReader::DiagnoseUnknownKernel(size_t kernel_idx,
-                                          const char* kernel_name,
-                                          HostAllocator* host_allocator) {
-  std::string error_message =
-      "unknown kernel name '" + std::string(kernel_name) + "'";
-
-  // This gets run before the functionindex is processed, but we want to use it
-  // below.
-  llvm::SmallVector<FunctionIndex, 8> function_indices;
-  if (!ReadFunctionIndexSectionInternal(&function_indices)) {
-    bef_file_->EmitFormatError(error_message.c_str());
-    return false;
-  }
-
-  // The unknown kernel must be referenced by some function in the program,
-  // and each kernel record has location info.  Scan through to see if we can
-  // figure out where the reference is coming from.
-  llvm::SmallVector<size_t, 4> result_regs;
-
-  for (const auto& function_index : function_indices) {
-    if (function_index.kind == FunctionKind::kNativeFunction) continue;
-
-    BEFFileImpl::FunctionInfo function_info;
-
-    result_regs.clear();
-    size_t location_offset;
-    bool success = bef_file_->ReadFunction(
-        function_index.function_offset, function_index.results,
-        &location_offset, &function_info, &result_regs, host_allocator);
-    if (!success) continue;
-
-    // Decode all of the kernels to see if any refers to our unknown kernel.
-    MutableArrayRef<BEFFileImpl::KernelInfo> kernel_infos_array =
-        function_info.kernel_infos.mutable_array();
-    for (const auto& kernel_info : kernel_infos_array) {
-      assert(kernel_info.offset % kKernelEntryAlignment == 0);
-      BEFKernel kernel(function_info.kernels.data() +
-                       kernel_info.offset / kKernelEntryAlignment);
-
-      // Okay, we decoded the kernel.  See if this is referring to the
-      // current kernel_idx.  If so, we can use its location.  We know that the
-      // relevant KernelEntry for the opcode is always first, so we just
-      // need to check it.
-      if (kernel.kernel_code() == kernel_idx) {
-        auto decoded_loc = bef_file_->DecodeLocation(kernel.kernel_location());
-        bef_file_->error_handler_(
-            DecodedDiagnostic(decoded_loc, absl::InternalError(error_message)));
-        return false;
-      }
-    }
-  }
-
-  bef_file_->EmitFormatError(error_message.c_str());
-  return false;
-}
-
-// Read the Kernels section from a BEF file, resolving the kernels and
-// returning true on success.  Emit an error and return false on failure.
-bool BEFFileReader::ReadKernelsSection(HostAllocator* host_allocator) {
+// Read the Kernels section from a BEF file, recording the kernel names and
+// returning true on success.  Emit an error and return false on failure. The
+// kernels are resolved by BEFFileImpl::BindKernels().
+bool BEFFileReader::ReadKernelsSection() {
   auto format_error = [&]() -> bool {
     bef_file_->EmitFormatError("invalid Kernels section in BEF file");
     return false;
@@ -228,11 +174,7 @@ bool BEFFileReader::ReadKernelsSection(HostAllocator* host_allocator) {
   size_t num_kernels;
   if (!reader.ReadVbrInt(&num_kernels)) return format_error();
 
-#if defined(TFRT_BEF_DEBUG)
   bef_file_->kernel_names_.reserve(num_kernels);
-#endif
-
-  bef_file_->kernels_.reserve(num_kernels);
   while (num_kernels--) {
     // Each kernel is encoded as an offset into the string table of the
     // kernel name.
@@ -243,24 +185,15 @@ bool BEFFileReader::ReadKernelsSection(HostAllocator* host_allocator) {
         kernel_name_offset >= bef_file_->string_section_.size())
       return format_error();
 
-    // If this is an unknown kernel, bail out.
     const char* kernel_name = reinterpret_cast<const char*>(
         &bef_file_->string_section_[kernel_name_offset]);
-
-#if defined(TFRT_BEF_DEBUG)
     bef_file_->kernel_names_.push_back(kernel_name);
-#endif
-
-    auto kernel = registry_.GetKernel(kernel_name);
-    if (kernel.is<Monostate>()) {
-      return DiagnoseUnknownKernel(bef_file_->kernels_.size(), kernel_name,
-                                   host_allocator);
-    }
-
-    // Otherwise remember it.
-    bef_file_->kernels_.push_back(kernel);
   }
 
+  // All the kernels are unbound (Monostate) until they are used.
+  bef_file_->kernels_.resize(bef_file_->kernel_names_.size());
+  bef_file_->registry_ = &registry_;
+
   return true;
 }
 
@@ -398,8 +331,7 @@ bool BEFFileReader::ReadFunctionIndexSection() {
         auto bef_function = SyncBEFFunction::Create(
             name, function_index.arguments, function_index.results,
             function_index.function_offset, bef_file_);
-        if (!bef_function) return format_error(bef_function.takeError());
-        bef_file_->functions_.push_back(std::move(bef_function.get()));
+        bef_file_->functions_.push_back(std::move(bef_function));
         break;
       }
       case FunctionKind::kNativeFunction: {
@@ -430,6 +362,7 @@ RCReference<BEFFile> BEFFile::Open(ArrayRef<uint8_t> file,
                                    tfrt::HostAllocator* host_allocator) {
   auto* bef_impl = new BEFFileImpl(error_handler);
   auto bef_rc = TakeRef(bef_impl);
+  bef_impl->allocator_ = host_allocator;
 
   if (reinterpret_cast<uintptr_t>(file.data()) % GetRequiredBefAlignment() !=
       0) {
@@ -451,10 +384,12 @@ RCReference<BEFFile> BEFFile::Open(ArrayRef<uint8_t> file,
   }
 
   uint8_t format_version;
-  if (!reader.ReadByte(&format_version) || format_version != kBEFVersion0) {
+  if (!reader.ReadByte(&format_version) ||
+      format_version > kBEFCurrentVersion) {
     bef_impl->EmitFormatError("Unknown BEF format version detected");
     return {};
   }
+  bef_impl->format_version_ = format_version;
 
   while (!reader.Empty()) {
     if (!reader.ReadNextSection()) return {};
@@ -462,14 +397,54 @@ RCReference<BEFFile> BEFFile::Open(ArrayRef<uint8_t> file,
 
   // Now that we've figured out the contents of the sections, resolve some
   // things.
-  if (!reader.ReadKernelsSection(host_allocator) ||
-      !reader.ReadTypesSection() || !reader.ReadFunctionIndexSection())
+  if (!reader.ReadKernelsSection() || !reader.ReadTypesSection() ||
+      !reader.ReadFunctionIndexSection())
     return {};
 
   // Now that we decoded the whole thing, return the BEFFile to the caller.
   return bef_rc;
 }
 
+RCReference<BEFFile> BEFFile::OpenMapped(string_view path,
+                                         const KernelRegistry& registry,
+                                         ErrorHandler error_handler,
+                                         tfrt::HostAllocator* host_allocator,
+                                         bool prefetch) {
+  auto emit_error = [&](string_view message) {
+    error_handler(DecodedDiagnostic(absl::InternalError(message)));
+  };
+
+  auto file_system_or = io::FileSystemRegistry::Default()->LookupForPath(path);
+  if (!file_system_or) {
+    emit_error(llvm::toString(file_system_or.takeError()));
+    return {};
+  }
+
+  std::unique_ptr<io::ReadOnlyMemoryRegion> memory_region;
+  if (auto error = (*file_system_or)->NewReadOnlyMemoryRegionFromFile(
+          std::string(path), &memory_region)) {
+    emit_error(llvm::toString(std::move(error)));
+    return {};
+  }
+
+  auto bef_file =
+      Open(memory_region->data(), registry, error_handler, host_allocator);
+  if (!bef_file) return {};
+
+  auto* bef_impl = static_cast<BEFFileImpl*>(bef_file.get());
+  if (prefetch) {
+    // The kernels are encoded in the functions section.
+    const uint8_t* file_begin = memory_region->data().data();
+    for (ArrayRef<uint8_t> section :
+         {bef_impl->function_section_, bef_impl->attribute_section_}) {
+      memory_region->Prefetch(section.data() - file_begin, section.size());
+    }
+  }
+  bef_impl->memory_region_ = std::move(memory_region);
+
+  return bef_file;
+}
+
 DecodedLocation BEFLocationHandler::DecodeLocation(Location loc) const {
   return bef_file_->DecodeLocation(loc.data);
 }
@@ -488,14 +463,62 @@ void BEFFileImpl::EmitFormatError(string_view message) {
   error_handler_(DecodedDiagnostic(absl::InternalError(message)));
 }
 
+bool BEFFileImpl::BindKernels(ArrayRef<uint32_t> kernels,
+                              ArrayRef<uint32_t> kernel_offsets) {
+  mutex_lock lock(kernels_mu_);
+  for (uint32_t kernel_offset : kernel_offsets) {
+    assert(kernel_offset % kKernelEntryAlignment == 0);
+    if (kernel_offset / kKernelEntryAlignment >= kernels.size()) {
+      EmitFormatError("invalid kernel offset in BEF file");
+      return false;
+    }
+    BEFKernel kernel(kernels.data() + kernel_offset / kKernelEntryAlignment);
+
+    uint32_t kernel_code = kernel.kernel_code();
+    if (kernel_code >= kernels_.size()) {
+      EmitFormatError("invalid kernel code in BEF file");
+      return false;
+    }
+    if (!kernels_[kernel_code].is<Monostate>()) continue;
+
+    const char* kernel_name = kernel_names_[kernel_code];
+    auto kernel_impl = registry_->GetKernel(kernel_name);
+    if (kernel_impl.is<Monostate>()) {
+      // Report the unknown kernel at the location of its first use.
+      error_handler_(DecodedDiagnostic(
+          DecodeLocation(kernel.kernel_location()),
+          absl::InternalError(StrCat("unknown kernel name '", kernel_name,
+                                     "'"))));
+      return false;
+    }
+    kernels_[kernel_code] = kernel_impl;
+  }
+  return true;
+}
+
+bool BEFFileImpl::DecodeFunction(const Function& function) {
+  switch (function.function_kind()) {
+    case FunctionKind::kBEFFunction:
+      return static_cast<const BEFFunction&>(function).GetFunctionTemplate() !=
+             nullptr;
+    case FunctionKind::kSyncBEFFunction:
+      if (auto error =
+              static_cast<const SyncBEFFunction&>(function).Initialize()) {
+        EmitFormatError(llvm::toString(std::move(error)));
+        return false;
+      }
+      return true;
+    case FunctionKind::kNativeFunction:
+      return true;
+  }
+  return true;
+}
+
 // TODO(b/160504938): Refactor this function to return Error instead of
 // reporting error via EmitFormatError to make the API more natural.
-bool BEFFileImpl::ReadFunction(size_t function_offset,
-                               ArrayRef<TypeName> results,
-                               size_t* location_offset,
-                               FunctionInfo* function_info,
-                               llvm::SmallVectorImpl<size_t>* result_regs,
-                               HostAllocator* host_allocator) {
+bool BEFFileImpl::ReadFunctionTemplate(size_t function_offset,
+                                       ArrayRef<TypeName> results,
+                                       BEFFunctionTemplate* function_template) {
   auto format_error = [&]() -> bool {
     EmitFormatError("invalid Function section in BEF file");
     return false;
@@ -507,57 +530,102 @@ bool BEFFileImpl::ReadFunction(size_t function_offset,
 
   // First we have the location info and register info table.
   size_t num_registers;
-  if (!reader.ReadVbrInt(location_offset) || !reader.ReadVbrInt(&num_registers))
+  if (!reader.ReadVbrInt(&function_template->location_offset) ||
+      !reader.ReadVbrInt(&num_registers))
     return format_error();
 
-  function_info->register_infos.resize(num_registers, host_allocator);
-  auto* register_info_ptr =
-      function_info->register_infos.mutable_array().data();
-  unsigned register_idx = 0;
-  while (num_registers--) {
+  function_template->register_user_counts.reserve(num_registers);
+  for (size_t i = 0; i < num_registers; ++i) {
     size_t user_count;
     if (!reader.ReadVbrInt(&user_count)) return format_error();
-    new (register_info_ptr + register_idx) RegisterInfo(user_count);
-    ++register_idx;
+    function_template->register_user_counts.push_back(user_count);
   }
 
   // Next we have the kernel index table.
   size_t num_kernels;
   if (!reader.ReadVbrInt(&num_kernels)) return format_error();
 
-  function_info->kernel_infos.resize(num_kernels, host_allocator);
-  auto* kernel_info_ptr = function_info->kernel_infos.mutable_array().data();
-  unsigned kernel_idx = 0;
+  // Kernels of files without priorities all have the same priority, so they
+  // are run in the order of their ids.
+  const bool has_priority = BEFKernelEntriesHavePriority(format_version_);
+  function_template->kernel_templates.reserve(num_kernels);
   while (num_kernels--) {
-    size_t offset, num_operands, stream_id;
+    size_t offset, num_operands, stream_id, priority = 0;
     if (!reader.ReadVbrInt(&offset) || !reader.ReadVbrInt(&num_operands) ||
-        !reader.ReadVbrInt(&stream_id))
+        !reader.ReadVbrInt(&stream_id) ||
+        (has_priority && !reader.ReadVbrInt(&priority)))
       return format_error();
-    new (kernel_info_ptr + kernel_idx)
-        KernelInfo(offset, stream_id, num_operands);
-    ++kernel_idx;
+    // Critical path costs are only compared with each other, so saturate them
+    // instead of truncating.
+    priority = std::min<size_t>(priority, std::numeric_limits<unsigned>::max());
+    function_template->kernel_templates.push_back(
+        BEFFunctionTemplate::KernelTemplate{
+            static_cast<unsigned>(offset), static_cast<unsigned>(stream_id),
+            static_cast<unsigned>(num_operands),
+            static_cast<unsigned>(priority)});
   }
+  function_template->attribute_caches = std::make_unique<AttributeCache[]>(
+      function_template->kernel_templates.size());
 
   // Read the result registers.
-  result_regs->reserve(results.size());
+  function_template->result_regs.reserve(results.size());
   for (unsigned i = 0, e = results.size(); i != e; ++i) {
     size_t result_reg;
     if (!reader.ReadVbrInt(&result_reg) || result_reg >= num_registers)
       return format_error();
-    result_regs->push_back(result_reg);
+    function_template->result_regs.push_back(result_reg);
   }
 
   // Kernels are aligned to kKernelEntryAlignment.
   if (!reader.ReadAlignment(kKernelEntryAlignment)) return format_error();
 
   // We found the start of our kernel section.
-  function_info->kernels =
+  function_template->kernels =
       llvm::ArrayRef(reinterpret_cast<const uint32_t*>(reader.file().begin()),
                      reader.file().size() / kKernelEntryAlignment);
 
   return true;
 }
 
+size_t BEFFileImpl::GetFunctionInfoSize(
+    const BEFFunctionTemplate& function_template) {
+  static_assert(alignof(RegisterInfo) >= alignof(KernelInfo),
+                "Kernel infos are placed right after the register infos");
+  return sizeof(RegisterInfo) * function_template.register_user_counts.size() +
+         sizeof(KernelInfo) * function_template.kernel_templates.size();
+}
+
+void BEFFileImpl::InstantiateFunction(
+    const BEFFunctionTemplate& function_template, void* storage,
+    FunctionInfo* function_info) {
+  // Register and kernel infos are trivially destructible, so that the storage
+  // can be reused or released without running their destructors.
+  static_assert(std::is_trivially_destructible<RegisterInfo>::value, "");
+  static_assert(std::is_trivially_destructible<KernelInfo>::value, "");
+  assert(reinterpret_cast<uintptr_t>(storage) % alignof(RegisterInfo) == 0);
+
+  function_info->kernels = function_template.kernels;
+
+  ArrayRef<unsigned> user_counts = function_template.register_user_counts;
+  auto* register_info_ptr = static_cast<RegisterInfo*>(storage);
+  for (size_t i = 0, e = user_counts.size(); i != e; ++i)
+    new (register_info_ptr + i) RegisterInfo(user_counts[i]);
+  function_info->register_infos = {register_info_ptr, user_counts.size()};
+
+  ArrayRef<BEFFunctionTemplate::KernelTemplate> kernel_templates =
+      function_template.kernel_templates;
+  auto* kernel_info_ptr =
+      reinterpret_cast<KernelInfo*>(register_info_ptr + user_counts.size());
+  for (size_t i = 0, e = kernel_templates.size(); i != e; ++i) {
+    const auto& kernel_template = kernel_templates[i];
+    new (kernel_info_ptr + i)
+        KernelInfo(kernel_template.offset, kernel_template.stream_id,
+                   kernel_template.priority, kernel_template.num_operands);
+  }
+  function_info->kernel_infos = {kernel_info_ptr, kernel_templates.size()};
+  function_info->attribute_caches = function_template.attribute_caches.get();
+}
+
 // Given an offset into locations_section_, decode it and return
 // a DecodedDiagnostic.
 DecodedLocation BEFFileImpl::DecodeLocation(size_t location_position_offset) {
@@ -595,28 +663,111 @@ void BEFFile::GetFunctionList(
 }
 
 // Return the Function record with the specified name, or null if it isn't
-// found in this BEF file.
+// found in this BEF file or cannot be decoded.
 const Function* BEFFile::GetFunction(string_view function_name) const {
-  auto* impl = static_cast<const BEFFileImpl*>(this);
+  auto function = GetFunctionOrError(function_name);
+  if (!function) {
+    llvm::consumeError(function.takeError());
+    return nullptr;
+  }
+  return *function;
+}
+
+// Return the Function record with the specified name, null if it isn't found
+// in this BEF file, or an error if it cannot be decoded.
+Expected<const Function*> BEFFile::GetFunctionOrError(
+    string_view function_name) const {
+  // Decoding a function only updates the lazily decoded states, which are
+  // thread-safe.
+  auto* impl = const_cast<BEFFileImpl*>(static_cast<const BEFFileImpl*>(this));
 
   auto it = impl->function_symbol_table_.find(function_name);
   if (it == impl->function_symbol_table_.end()) return nullptr;
-  return impl->functions_[it->second].get();
+  const Function* function = impl->functions_[it->second].get();
+  if (!impl->DecodeFunction(*function))
+    return MakeStringError("failed to decode function ", function_name);
+  return function;
+}
+
+BEFFunction::BEFFunction(string_view name, FunctionKind function_kind,
+                         ArrayRef<TypeName> arguments,
+                         ArrayRef<TypeName> results, size_t function_offset,
+                         BEFFileImpl* bef_file)
+    : Function(name, function_kind, arguments, results),
+      function_offset_(function_offset),
+      bef_file_(bef_file),
+      executor_pool_(bef_file->allocator_) {}
+
+BEFFunction::BEFFunction(BEFFunction&& other)
+    : Function(std::move(other)),
+      function_offset_(other.function_offset_),
+      bef_file_(other.bef_file_),
+      function_template_(other.function_template_.exchange(nullptr)),
+      executor_pool_(bef_file_->allocator_) {}
+
+const BEFFunctionTemplate* BEFFunction::GetFunctionTemplate() const {
+  // Fast path: the function has already been decoded.
+  const auto* function_template =
+      function_template_.load(std::memory_order_acquire);
+  if (!function_template) function_template = DecodeFunctionTemplate();
+  return function_template->decode_failed ? nullptr : function_template;
+}
+
+const BEFFunctionTemplate* BEFFunction::DecodeFunctionTemplate() const {
+  auto function_template = std::make_unique<BEFFunctionTemplate>();
+  auto decode = [&] {
+    if (!bef_file_->ReadFunctionTemplate(function_offset_, result_types(),
+                                         function_template.get()))
+      return false;
+
+    // Bind the kernels of this function before publishing the template, so
+    // that the executions using the template see the bound kernels. The
+    // pseudo kernel is not a real kernel.
+    llvm::SmallVector<uint32_t, 16> kernel_offsets;
+    kernel_offsets.reserve(function_template->kernel_templates.size());
+    for (const auto& kernel_template :
+         llvm::drop_begin(function_template->kernel_templates))
+      kernel_offsets.push_back(kernel_template.offset);
+    return bef_file_->BindKernels(function_template->kernels, kernel_offsets);
+  };
+
+  // A malformed function is not decoded again, so that its error is only
+  // emitted once. Its template only records the failure.
+  if (!decode()) {
+    function_template = std::make_unique<BEFFunctionTemplate>();
+    function_template->decode_failed = true;
+  }
+
+  // Publish the decoded template. If another thread won the race, use its
+  // template and discard ours.
+  const BEFFunctionTemplate* expected = nullptr;
+  if (function_template_.compare_exchange_strong(expected,
+                                                 function_template.get(),
+                                                 std::memory_order_acq_rel))
+    return function_template.release();
+  return expected;
 }
 
-Expected<std::unique_ptr<SyncBEFFunction>> SyncBEFFunction::Create(
+std::unique_ptr<SyncBEFFunction> SyncBEFFunction::Create(
     string_view name, ArrayRef<TypeName> arguments, ArrayRef<TypeName> results,
     size_t function_offset, BEFFileImpl* bef_file) {
   // std::make_unique cannot be used, as the constructor of SyncBEFFunction is
   // private.
   // NOLINTNEXTLINE
-  auto bef_function = std::unique_ptr<SyncBEFFunction>(
+  return std::unique_ptr<SyncBEFFunction>(
       new SyncBEFFunction(name, arguments, results, function_offset, bef_file));
+}
 
-  if (auto error = bef_function->Init())
-    return std::move(error);
-  else
-    return std::move(bef_function);
+Error SyncBEFFunction::Initialize() const {
+  std::call_once(init_once_, [this] {
+    // SyncBEFFunctions are always created as non-const objects owned by
+    // BEFFileImpl, so it is safe to initialize them here.
+    auto* self = const_cast<SyncBEFFunction*>(this);
+    if (auto error = self->Init())
+      self->init_error_ = llvm::toString(std::move(error));
+  });
+  if (!init_error_.empty()) return MakeStringError(init_error_);
+  return Error::success();
 }
 
 Error SyncBEFFunction::Init() {
@@ -665,16 +816,24 @@ Error SyncBEFFunction::Init() {
 
   kernel_offsets_.reserve(num_kernels);
 
-  size_t offset, num_operands, stream_id;
+  // The kernel priorities are not used by the synchronous executor.
+  const bool has_priority =
+      BEFKernelEntriesHavePriority(bef_file_->format_version_);
+  auto read_kernel_entry = [&](size_t* offset) {
+    size_t num_operands, stream_id, priority;
+    return reader.ReadVbrInt(offset) && reader.ReadVbrInt(&num_operands) &&
+           reader.ReadVbrInt(&stream_id) &&
+           (!has_priority || reader.ReadVbrInt(&priority));
+  };
+
+  size_t offset;
 
   // Skip the first kernel which is the pseudo kernel used in BEF executor.
-  if (!reader.ReadVbrInt(&offset) || !reader.ReadVbrInt(&num_operands) ||
-      !reader.ReadVbrInt(&stream_id))
+  if (!read_kernel_entry(&offset))
     return format_error("Failed to read kernel offset or num_operands");
 
   for (size_t kernel_index = 1; kernel_index < num_kernels; ++kernel_index) {
-    if (!reader.ReadVbrInt(&offset) || !reader.ReadVbrInt(&num_operands) ||
-        !reader.ReadVbrInt(&stream_id))
+    if (!read_kernel_entry(&offset))
       return format_error("Failed to read kernel offset or num_operands");
 
     kernel_offsets_.push_back(offset);
@@ -708,6 +867,9 @@ Error SyncBEFFunction::Init() {
       llvm::ArrayRef(reinterpret_cast<const uint32_t*>(reader.file().begin()),
                      reader.file().size() / kKernelEntryAlignment);
 
+  if (!bef_file_->BindKernels(kernels_, kernel_offsets_))
+    return format_error("Failed to bind kernels");
+
   return Error::success();
 }
 
@@ -19,7 +19,12 @@
 #ifndef TFRT_LIB_BEF_EXECUTOR_BEF_FILE_IMPL_H_
 #define TFRT_LIB_BEF_EXECUTOR_BEF_FILE_IMPL_H_
 
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <string>
 #include <type_traits>
 #include <vector>
 
@@ -28,76 +33,93 @@
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Error.h"
+#include "tfrt/bef/bef_encoding.h"
 #include "tfrt/bef_executor/bef_file.h"
+#include "tfrt/host_context/attribute_cache.h"
 #include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/kernel_registry.h"
 #include "tfrt/host_context/location.h"
 #include "tfrt/host_context/native_function.h"
+#include "tfrt/io/file_system.h"
 #include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
 
 namespace tfrt {
 
 class BEFFileImpl;
 class Value;
 
-// Inlined array to keep registers and kernels info together with a BEF executor
-// if their size is small. Default constructed as empty, and must be resized
-// before use. If the number of records is larger than `n` it allocates
-// HostArray for storage.
-template <typename InfoT, size_t n>
-class BEFInfoArray {
+// A lock-free pool of recycled BEFExecutor frames of a BEFFunction. A frame is
+// the memory block holding a BEFExecutor together with its register and kernel
+// infos. All frames in a pool have the same size, as they are instantiated from
+// the same function. Frames are allocated with the HostAllocator of the BEF
+// file, so that they are accounted by its instrumentation. The HostAllocator
+// of the executing HostContext is not used, as frames are cached beyond its
+// lifetime.
+class BEFExecutorPool {
  public:
-  BEFInfoArray() : inlined_size_(0) {}
+  explicit BEFExecutorPool(HostAllocator* allocator) : allocator_(allocator) {}
+  ~BEFExecutorPool();
 
-  ~BEFInfoArray() {
-    for (size_t i = 0; i < inlined_size_; ++i) {
-      (inlined_data() + i)->~InfoT();
-    }
-  }
-
-  void resize(size_t num_objects, HostAllocator* allocator) {
-    assert(inlined_size_ == 0 && host_array_.size() == 0 && num_objects >= 0);
-    if (num_objects > n) {
-      host_array_ = HostArray<InfoT>(num_objects, allocator);
-    } else {
-      inlined_size_ = num_objects;
-    }
-  }
+  // Allocate a new frame of `size` bytes. All the frames of the pool must have
+  // the same size.
+  void* Allocate(size_t size, size_t alignment);
 
-  MutableArrayRef<InfoT> mutable_array() {
-    if (host_array_.size() > 0) {
-      return host_array_.mutable_array();
-    }
-    return {inlined_data(), inlined_size_};
-  }
+  // Deallocate a frame of this pool that is not pushed to the pool.
+  void Deallocate(void* frame);
 
-  size_t size() const {
-    if (host_array_.size() > 0) {
-      return host_array_.size();
-    }
-    return inlined_size_;
-  }
+  // Pop a recycled frame. Return nullptr if the pool is empty.
+  void* Pop();
 
-  InfoT& operator[](size_t index) {
-    assert(index < size());
-    if (host_array_.size() > 0) {
-      return host_array_[index];
-    }
-    return *(inlined_data() + index);
-  }
+  // Push a frame to the pool for reuse. Return false if the pool is full, in
+  // which case the caller keeps the ownership of the frame.
+  bool Push(void* frame);
 
  private:
-  BEFInfoArray(const BEFInfoArray&) = delete;
-  BEFInfoArray(BEFInfoArray&&) = delete;
-  BEFInfoArray& operator=(const BEFInfoArray&) = delete;
-  BEFInfoArray& operator=(BEFInfoArray&&) = delete;
+  BEFExecutorPool(const BEFExecutorPool&) = delete;
+  BEFExecutorPool& operator=(const BEFExecutorPool&) = delete;
+
+  // The maximum number of frames cached in the pool, which bounds the memory
+  // retained by an idle function to the peak number of its concurrent
+  // executions up to this capacity.
+  static constexpr int kCapacity = 8;
+
+  HostAllocator* const allocator_;
+  // The size of the frames, set by the first allocation.
+  std::atomic<size_t> frame_size_{0};
+  std::array<std::atomic<void*>, kCapacity> frames_{};
+};
 
-  InfoT* inlined_data() { return reinterpret_cast<InfoT*>(&inlined_array_[0]); }
+// Decoded, immutable information of a BEFFunction. It is read from the BEF file
+// once per BEFFunction and shared by all executions of the function, so that
+// each execution only needs to instantiate its mutable register and kernel
+// states from it.
+struct BEFFunctionTemplate {
+  // Static information of a kernel used to initialize the per-execution
+  // BEFFileImpl::KernelInfo.
+  struct KernelTemplate {
+    unsigned offset;
+    unsigned stream_id;
+    unsigned num_operands;
+    unsigned priority;
+  };
 
-  size_t inlined_size_;
-  typename std::aligned_storage<sizeof(InfoT), alignof(InfoT)>::type
-      inlined_array_[n];
-  HostArray<InfoT> host_array_;
+  // This ArrayRef contains kernel entries of all kernels of this function.
+  ArrayRef<uint32_t> kernels;
+  // The number of uses of each register, indexed by the register number.
+  llvm::SmallVector<unsigned, 16> register_user_counts;
+  // The kernel templates, indexed by the kernel number.
+  llvm::SmallVector<KernelTemplate, 8> kernel_templates;
+  // The values derived from their attributes by the kernels, indexed by the
+  // kernel number. They are shared by all executions of the function.
+  std::unique_ptr<AttributeCache[]> attribute_caches;
+  // The register indices of the function results.
+  llvm::SmallVector<size_t, 4> result_regs;
+  // The offset of the function location in the LocationPositions section.
+  size_t location_offset = 0;
+  // Whether the function is malformed. The other fields of a failed template
+  // are empty.
+  bool decode_failed = false;
 };
 
 // This class implements Function for BEF files.
@@ -109,14 +131,23 @@ class BEFFunction : public Function {
       : BEFFunction(name, FunctionKind::kBEFFunction, arguments, results,
                     function_offset, bef_file) {}
 
-  BEFFunction(BEFFunction&& other)
-      : Function(std::move(other)),
-        function_offset_(other.function_offset_),
-        bef_file_(other.bef_file_) {}
+  BEFFunction(BEFFunction&& other);
+
+  ~BEFFunction() override { delete function_template_.load(); }
 
   size_t function_offset() const { return function_offset_; }
   BEFFileImpl* bef_file() const { return bef_file_; }
 
+  // Return the decoded template of this function. The template is decoded from
+  // the BEF file on the first call and cached for all later executions. It is
+  // safe to call this method concurrently. Return nullptr if the function is
+  // malformed, in which case an error is emitted to the BEF file's error
+  // handler on the first call. The failure is cached as well.
+  const BEFFunctionTemplate* GetFunctionTemplate() const;
+
+  // Return the pool of recycled executor frames for this function.
+  BEFExecutorPool& executor_pool() const { return executor_pool_; }
+
   void Execute(const ExecutionContext& exec_ctx,
                ArrayRef<AsyncValue*> arguments,
                MutableArrayRef<RCReference<AsyncValue>> results) const override;
@@ -134,13 +165,21 @@ class BEFFunction : public Function {
  protected:
   BEFFunction(string_view name, FunctionKind function_kind,
               ArrayRef<TypeName> arguments, ArrayRef<TypeName> results,
-              size_t function_offset, BEFFileImpl* bef_file)
-      : Function(name, function_kind, arguments, results),
-        function_offset_(function_offset),
-        bef_file_(bef_file) {}
+              size_t function_offset, BEFFileImpl* bef_file);
+
+  // Decode the template of this function and publish it in
+  // `function_template_`, unless another thread did so first. Return the
+  // published template.
+  const BEFFunctionTemplate* DecodeFunctionTemplate() const;
 
   size_t function_offset_;
   BEFFileImpl* bef_file_;
+
+  // Lazily decoded function template, owned by this BEFFunction.
+  mutable std::atomic<const BEFFunctionTemplate*> function_template_{nullptr};
+
+  // Recycled executor frames, reused across executions of this function.
+  mutable BEFExecutorPool executor_pool_;
 };
 
 // This class implements SyncFunction for BEF files.
@@ -151,11 +190,12 @@ class SyncBEFFunction final : public BEFFunction {
     bool is_arg_or_result : 1;
   };
 
-  // Create a SyncBEFFunction. Return nullptr if the BEF file has format error.
-  static Expected<std::unique_ptr<SyncBEFFunction>> Create(
-      string_view name, ArrayRef<TypeName> arguments,
-      ArrayRef<TypeName> results, size_t function_offset,
-      BEFFileImpl* bef_file);
+  // Create a SyncBEFFunction. The function is decoded lazily by Initialize().
+  static std::unique_ptr<SyncBEFFunction> Create(string_view name,
+                                                 ArrayRef<TypeName> arguments,
+                                                 ArrayRef<TypeName> results,
+                                                 size_t function_offset,
+                                                 BEFFileImpl* bef_file);
 
   void Execute(
       const ExecutionContext& exec_ctx, ArrayRef<AsyncValue*> arguments,
@@ -172,6 +212,12 @@ class SyncBEFFunction final : public BEFFunction {
   Error SyncExecute(const ExecutionContext& exec_ctx,
                     ArrayRef<Value*> arguments, ArrayRef<Value*> results) const;
 
+  // Decode the register and kernel information of this function and bind its
+  // kernels on the first call. Later calls return the result of the first
+  // call. It is safe to call this method concurrently. The accessors below
+  // can only be used after Initialize() succeeds.
+  Error Initialize() const;
+
   // Return an array of descriptors for all of our registers, indexed by
   // their register number.
   ArrayRef<RegisterInfo> register_infos() const { return register_infos_; }
@@ -198,6 +244,11 @@ class SyncBEFFunction final : public BEFFunction {
   // information for every function execution.
   Error Init();
 
+  // Guards the lazy Init() call in Initialize().
+  mutable std::once_flag init_once_;
+  // The error message of Init(), or empty if Init() succeeded.
+  std::string init_error_;
+
   // This is an array of descriptors for all of our registers, indexed by
   // their register number.
   llvm::SmallVector<RegisterInfo, 16> register_infos_;
@@ -257,12 +308,16 @@ class BEFFileImpl : public BEFFile {
   //
   // The executor keeps an array of these, indexed by kernel number to know
   // where to find each kernel in the kernels section, and to know how many
-  // arguments are still waiting to come in before the kernel can start.
+  // arguments are still waiting to come in before the kernel can start. The
+  // `priority` is the critical path cost computed by the compiler, and kernels
+  // with higher priority are executed first when several kernels are ready.
   //
-  // This struct is defined here, because ReadFunction() below will populate it.
+  // This struct is defined here, because InstantiateFunction() below will
+  // populate it.
   struct KernelInfo {
     unsigned offset;
     unsigned stream_id;
+    unsigned priority;
     std::atomic<int> arguments_not_ready;
 
     // We initialize the ready list to at least 1 so that kernels with no
@@ -270,43 +325,62 @@ class BEFFileImpl : public BEFFile {
     //
     // TODO(b/173800007): Add perf benchmark to illustrate the improvement from
     // the reduced number of kernel enqueues.
-    KernelInfo(unsigned offset, unsigned stream_id, unsigned num_operands)
+    KernelInfo(unsigned offset, unsigned stream_id, unsigned priority,
+               unsigned num_operands)
         : offset(offset),
           stream_id(stream_id),
+          priority(priority),
           arguments_not_ready(std::max(1u, num_operands)) {}
   };
 
-  using RegisterInfoArray = BEFInfoArray<BEFFileImpl::RegisterInfo, 24>;
-  using KernelInfoArray = BEFInfoArray<BEFFileImpl::KernelInfo, 8>;
-
   // Decoded BEFFunction information.
   struct FunctionInfo {
     // This ArrayRef contains kernel entries of all kernels of this function.
     ArrayRef<uint32_t> kernels;
-    // This is an array of descriptors for all of the kernels in this function,
-    // indexed by the kernel number.
-    RegisterInfoArray register_infos;
     // This is an array of descriptors for all of our registers, indexed by
     // their register number.
-    KernelInfoArray kernel_infos;
+    MutableArrayRef<RegisterInfo> register_infos;
+    // This is an array of descriptors for all of the kernels in this function,
+    // indexed by the kernel number.
+    MutableArrayRef<KernelInfo> kernel_infos;
+    // The attribute caches of the kernels, indexed by the kernel number.
+    AttributeCache* attribute_caches = nullptr;
   };
 
-  // Decode the specified BEFFunction into the FunctionInfo. `host_allocator` is
-  // used for the heap-allocated buffer that backs info arrays in FunctionInfo.
+  // Bind the kernels at `kernel_offsets` (in units of bytes) in `kernels` to
+  // the kernel implementations in the registry, if they are not bound yet.
+  // This is called when a function is decoded, so that only the kernels used
+  // by the functions that are actually used are resolved.
+  //
+  // On error, an error is emitted and false is returned. It is safe to call
+  // this method concurrently.
+  bool BindKernels(ArrayRef<uint32_t> kernels,
+                   ArrayRef<uint32_t> kernel_offsets);
+
+  // Decode `function` and bind its kernels if it is not decoded yet. Return
+  // false if the function is malformed, in which case an error is emitted.
+  bool DecodeFunction(const Function& function);
+
+  // Decode the specified BEFFunction into `function_template`.
   //
   // On error, an error is emitted and false is returned.
   //
-  // ReadFunction is invoked for every BEFFunction execution. We can consider
-  // caching the kernel and register information in the BEFFunction object to
-  // avoid repeadly reading the same information from the BEF file. However, in
-  // the current implementation, we couple BEFExecutor states, e.g. AsyncValue
-  // for RegisterInfo, with the function reading. Caching kernel and register
-  // information would require us to avoid such coupling which can adversely
-  // affect the performance.
-  bool ReadFunction(size_t function_offset, ArrayRef<TypeName> results,
-                    size_t* location_offset, FunctionInfo* function_info,
-                    llvm::SmallVectorImpl<size_t>* result_regs,
-                    HostAllocator* host_allocator);
+  // ReadFunctionTemplate is invoked once per BEFFunction, and the decoded
+  // template is cached in the BEFFunction to avoid repeatedly reading the same
+  // kernel and register information from the BEF file for every execution.
+  bool ReadFunctionTemplate(size_t function_offset, ArrayRef<TypeName> results,
+                            BEFFunctionTemplate* function_template);
+
+  // Return the number of bytes needed to instantiate the FunctionInfo of
+  // `function_template`. The storage must be aligned to alignof(RegisterInfo).
+  static size_t GetFunctionInfoSize(
+      const BEFFunctionTemplate& function_template);
+
+  // Instantiate the mutable per-execution FunctionInfo from a decoded
+  // `function_template` in `storage`, which must hold at least
+  // GetFunctionInfoSize() bytes.
+  static void InstantiateFunction(const BEFFunctionTemplate& function_template,
+                                  void* storage, FunctionInfo* function_info);
 
   // Given an offset into the LocationPositions section, decode it and return
   // a DecodedDiagnostic.
@@ -333,7 +407,19 @@ class BEFFileImpl : public BEFFile {
 
   ArrayRef<uint8_t> function_section() const { return function_section_; }
 
+  // The memory region that holds the file contents if the file is opened by
+  // BEFFile::OpenMapped(). All the sections below point into this region, so
+  // it is declared first to be destroyed last.
+  std::unique_ptr<io::ReadOnlyMemoryRegion> memory_region_;
+
   ErrorHandler error_handler_;
+  const KernelRegistry* registry_ = nullptr;
+  // The allocator of the executor frames of the functions.
+  HostAllocator* allocator_ = nullptr;
+
+  // The format version of the file, which determines the layout of the kernel
+  // table entries.
+  uint8_t format_version_ = kBEFCurrentVersion;
 
   ArrayRef<uint8_t> string_section_;
   ArrayRef<uint8_t> attribute_section_;
@@ -341,17 +427,19 @@ class BEFFileImpl : public BEFFile {
   ArrayRef<uint8_t> types_section_;
   ArrayRef<uint8_t> function_section_;
   ArrayRef<uint8_t> function_index_section_;
+  // The kernels indexed by kernel code. A kernel is Monostate until it is
+  // bound by BindKernels(). Entries are only written under `kernels_mu_`, and
+  // are read without locking by the executions of the functions that bound
+  // them, which happen after the functions are published.
   llvm::SmallVector<KernelImplementation, 8> kernels_;
+  // The names of the kernels indexed by kernel code.
+  std::vector<const char*> kernel_names_;
+  mutex kernels_mu_;
   llvm::SmallVector<TypeName, 8> type_names_;
   llvm::StringMap<size_t> function_symbol_table_;
   llvm::SmallVector<std::unique_ptr<Function>, 8> functions_;
   ArrayRef<uint8_t> location_strings_section_;
   ArrayRef<uint8_t> locations_section_;
-
-#if defined(TFRT_BEF_DEBUG)
-  // Maps from kernel_id to the name of the kernel.
-  std::vector<const char*> kernel_names_;
-#endif
 };
 
 }  // namespace tfrt
@@ -21,6 +21,7 @@
 #include <cstdint>
 #include <cstdio>
 #include <memory>
+#include <utility>
 
 #include "bef_file_impl.h"
 #include "llvm/ADT/ArrayRef.h"
@@ -77,6 +78,9 @@ class BEFInterpreterImpl final {
 
   const SyncBEFFunction& func_;
 
+  // Whether `func_` has been decoded successfully.
+  bool initialized_ = false;
+
   // All registers used in the function.
   llvm::SmallVector<Value*, 16> registers_;
 
@@ -111,6 +115,15 @@ Error BEFInterpreter::Execute(const ExecutionContext& exec_ctx,
 BEFInterpreterImpl::BEFInterpreterImpl(const Function& func)
     : func_{static_cast<const SyncBEFFunction&>(func)} {
   assert(func.function_kind() == FunctionKind::kSyncBEFFunction);
+
+  // The function is decoded on its first use. Execute() reports the error if
+  // it cannot be decoded.
+  if (auto error = func_.Initialize()) {
+    llvm::consumeError(std::move(error));
+    return;
+  }
+  initialized_ = true;
+
   auto register_infos = func_.register_infos();
 
   size_t num_registers = register_infos.size();
@@ -253,6 +266,8 @@ Error BEFInterpreterImpl::Execute(const ExecutionContext& exec_ctx,
   assert(results.size() == func_.num_results() &&
          "incorrect number of results passed to function call");
 
+  if (!initialized_) return func_.Initialize();
+
   SetupRegisters(arguments, results);
 
   SyncKernelFrameBuilder kernel_frame(registers_, exec_ctx);
@@ -0,0 +1,164 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements KernelLatencySampler.
+
+#include "tfrt/bef_executor/kernel_latency_sampler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "tfrt/metrics/metrics.h"
+#include "tfrt/metrics/metrics_registry.h"
+#include "tfrt/support/string_util.h"
+
+namespace tfrt {
+namespace {
+
+std::atomic<KernelLatencySampler*> kernel_latency_sampler{nullptr};
+
+std::atomic<uint64_t> next_sampler_id{0};
+
+// The number of samples a thread buffers before exporting them.
+constexpr int kMaxBufferedSamples = 1024;
+
+// Returns a pseudo-random number from a per-thread xorshift generator.
+uint64_t NextRandom() {
+  thread_local uint64_t state =
+      std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+}  // namespace
+
+void SetKernelLatencySampler(KernelLatencySampler* sampler) {
+  kernel_latency_sampler.store(sampler, std::memory_order_release);
+}
+
+KernelLatencySampler* GetKernelLatencySampler() {
+  return kernel_latency_sampler.load(std::memory_order_acquire);
+}
+
+struct KernelLatencySampler::ThreadSamples {
+  mutex mu;
+  // Latencies in microseconds, keyed by kernel name.
+  llvm::StringMap<std::vector<double>> samples TFRT_GUARDED_BY(mu);
+  int num_samples TFRT_GUARDED_BY(mu) = 0;
+};
+
+thread_local int64_t KernelLatencySampler::sample_countdown_ = 0;
+
+metrics::Buckets KernelLatencySampler::DefaultBuckets() {
+  std::vector<double> bounds;
+  for (double bound = 0.25; bound < 2e6; bound *= 2) bounds.push_back(bound);
+  return metrics::Buckets::Explicit(std::move(bounds));
+}
+
+KernelLatencySampler::KernelLatencySampler(int sample_period,
+                                           metrics::Buckets buckets)
+    : sample_period_(std::max(sample_period, 1)),
+      buckets_(std::move(buckets)),
+      id_(next_sampler_id.fetch_add(1, std::memory_order_relaxed)),
+      collection_callback_id_(
+          metrics::AddCollectionCallback([this]() { Flush(); })) {}
+
+KernelLatencySampler::~KernelLatencySampler() {
+  metrics::RemoveCollectionCallback(collection_callback_id_);
+  Flush();
+}
+
+void KernelLatencySampler::ResetSampleCountdown() {
+  // Uniform in [1, 2 * sample_period_ - 1], which averages to sample_period_.
+  sample_countdown_ = 1 + NextRandom() % (2 * sample_period_ - 1);
+}
+
+KernelLatencySampler::ThreadSamples& KernelLatencySampler::GetThreadSamples() {
+  struct ThreadState {
+    uint64_t sampler_id = ~uint64_t{0};
+    std::shared_ptr<ThreadSamples> samples;
+  };
+  thread_local ThreadState state;
+
+  if (LLVM_UNLIKELY(state.sampler_id != id_)) {
+    auto samples = std::make_shared<ThreadSamples>();
+    {
+      mutex_lock lock(mu_);
+      thread_samples_.push_back(samples);
+    }
+    state.sampler_id = id_;
+    state.samples = std::move(samples);
+  }
+  return *state.samples;
+}
+
+void KernelLatencySampler::RecordKernel(string_view kernel_name,
+                                        std::chrono::nanoseconds duration) {
+  ThreadSamples& thread_samples = GetThreadSamples();
+
+  llvm::StringMap<std::vector<double>> full_samples;
+  {
+    mutex_lock lock(thread_samples.mu);
+    thread_samples.samples[kernel_name].push_back(duration.count() * 1e-3);
+    if (++thread_samples.num_samples < kMaxBufferedSamples) return;
+    full_samples = std::move(thread_samples.samples);
+    thread_samples.samples.clear();
+    thread_samples.num_samples = 0;
+  }
+  Export(std::move(full_samples));
+}
+
+void KernelLatencySampler::Flush() {
+  std::vector<std::shared_ptr<ThreadSamples>> thread_samples;
+  {
+    mutex_lock lock(mu_);
+    thread_samples = thread_samples_;
+  }
+
+  for (const auto& samples : thread_samples) {
+    llvm::StringMap<std::vector<double>> buffered_samples;
+    {
+      mutex_lock lock(samples->mu);
+      buffered_samples = std::move(samples->samples);
+      samples->samples.clear();
+      samples->num_samples = 0;
+    }
+    Export(std::move(buffered_samples));
+  }
+}
+
+void KernelLatencySampler::Export(
+    llvm::StringMap<std::vector<double>> samples) {
+  if (samples.empty()) return;
+
+  mutex_lock lock(mu_);
+  for (const auto& iter : samples) {
+    metrics::Histogram*& histogram = histograms_[iter.first()];
+    if (histogram == nullptr) {
+      histogram = metrics::NewHistogram(
+          StrCat("/tensorflow/runtime/bef_executor/kernel_latency/",
+                 iter.first()),
+          buckets_);
+    }
+    for (double latency : iter.second) histogram->Record(latency);
+  }
+}
+
+}  // namespace tfrt
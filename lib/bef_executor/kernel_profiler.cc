@@ -0,0 +1,87 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements KernelProfiler.
+
+#include "tfrt/bef_executor/kernel_profiler.h"
+
+#include <atomic>
+#include <string>
+#include <system_error>
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/string_util.h"
+
+namespace tfrt {
+namespace {
+
+std::atomic<KernelProfiler*> kernel_profiler{nullptr};
+
+}  // namespace
+
+void SetKernelProfiler(KernelProfiler* profiler) {
+  kernel_profiler.store(profiler, std::memory_order_release);
+}
+
+KernelProfiler* GetKernelProfiler() {
+  return kernel_profiler.load(std::memory_order_acquire);
+}
+
+void KernelProfiler::RecordKernel(Location location,
+                                  std::chrono::nanoseconds duration) {
+  DecodedLocation decoded = location.Decode();
+  if (!decoded.is<FileLineColLocation>()) return;
+  auto& file_loc = decoded.get<FileLineColLocation>();
+
+  std::string key = StrCat(file_loc.filename, ":", file_loc.line, ":",
+                           file_loc.column);
+
+  mutex_lock lock(mu_);
+  auto& entry = entries_[key];
+  if (entry.count == 0) {
+    entry.filename = std::move(file_loc.filename);
+    entry.line = file_loc.line;
+    entry.column = file_loc.column;
+  }
+  ++entry.count;
+  entry.total_ns += duration.count();
+}
+
+void KernelProfiler::PrintProfile(raw_ostream& os) const {
+  mutex_lock lock(mu_);
+  for (const auto& iter : entries_) {
+    const Entry& entry = iter.second;
+    os << entry.filename << '\t' << entry.line << '\t' << entry.column << '\t'
+       << entry.count << '\t' << entry.total_ns / entry.count << '\n';
+  }
+}
+
+Error KernelProfiler::WriteProfile(string_view path) const {
+  std::error_code error_code;
+  llvm::raw_fd_ostream os(path, error_code, llvm::sys::fs::OF_Text);
+  if (error_code)
+    return MakeStringError("error opening kernel profile file ", path, ": ",
+                           error_code.message());
+  PrintProfile(os);
+  return Error::success();
+}
+
+void KernelProfiler::Clear() {
+  mutex_lock lock(mu_);
+  entries_.clear();
+}
+
+}  // namespace tfrt
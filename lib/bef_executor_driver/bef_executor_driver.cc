@@ -25,6 +25,7 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/ScopeExit.h"
 #include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/Error.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm_derived/Support/raw_ostream.h"
 #include "mlir/IR/BuiltinAttributes.h"
@@ -76,7 +77,7 @@ int RunBefExecutor(
         HostContext*, ResourceContext*)>& create_execution_context) {
   assert(create_execution_context);
 
-  TFRT_TRACE_SCOPE(Default, "Bef Executor");
+  TFRT_TRACE_STATIC_SCOPE(Default, "Bef Executor");
   metrics::AddTFRTVersionMetric();
 
   // Set up the input file.
@@ -221,19 +222,30 @@ int RunBefExecutor(
     function_list.reserve(run_config.functions.size());
 
     for (auto& fn_name : run_config.functions) {
-      auto* fn = bef->GetFunction(fn_name);
+      auto fn = bef->GetFunctionOrError(fn_name);
 
       if (!fn) {
+        llvm::errs() << run_config.program_name << ": "
+                     << llvm::toString(fn.takeError()) << "\n";
+        return 1;
+      }
+      if (!*fn) {
         llvm::errs() << run_config.program_name << ": couldn't find function "
                      << fn_name << "\n";
         return 1;
       }
-      function_list.push_back(fn);
+      function_list.push_back(*fn);
     }
   }
 
   // Run the init function first if exists.
-  auto test_init_function = bef->GetFunction(run_config.test_init_function);
+  auto init_function = bef->GetFunctionOrError(run_config.test_init_function);
+  if (!init_function) {
+    llvm::errs() << run_config.program_name << ": "
+                 << llvm::toString(init_function.takeError()) << "\n";
+    return 1;
+  }
+  const Function* test_init_function = *init_function;
 
   if (test_init_function) {
     RunBefFunction(host, *test_init_function, create_execution_context,
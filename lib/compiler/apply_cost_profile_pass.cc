@@ -0,0 +1,152 @@
+/*
+ * Copyright 2022 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This implements ApplyCostProfilePass that attaches the kernel costs measured
+// at runtime (see tfrt/bef_executor/kernel_profiler.h) to operations, so that
+// StreamAnalysis partitions streams according to the measured costs.
+//
+// The profile is matched with the operations using their file-line-column
+// locations, so the program must be compiled from the same source file that
+// was used for the profiling run. Note that the locations must be preserved
+// (eg. using -mlir-print-debuginfo) if the output is compiled to BEF
+// separately.
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/Pass.h"
+
+namespace tfrt {
+namespace compiler {
+namespace {
+
+// The name of the attribute that specifies the cost of an operation. It is
+// the same attribute used by the AttrCostTrait in tfrt_traits.h.
+constexpr char kCostAttrName[] = "_tfrt_cost";
+
+std::string GetLocationKey(llvm::StringRef filename, int64_t line,
+                           int64_t column) {
+  return (filename + ":" + llvm::Twine(line) + ":" + llvm::Twine(column)).str();
+}
+
+class ApplyCostProfilePass
+    : public mlir::PassWrapper<ApplyCostProfilePass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+ public:
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(ApplyCostProfilePass)
+
+  ApplyCostProfilePass() = default;
+  ApplyCostProfilePass(const ApplyCostProfilePass& other)
+      : PassWrapper(other) {}
+
+  llvm::StringRef getArgument() const final {
+    return "tfrt-apply-cost-profile";
+  }
+
+  llvm::StringRef getDescription() const final {
+    return "Attach the kernel costs measured at runtime to operations";
+  }
+
+  void runOnOperation() override {
+    auto module = getOperation();
+
+    // Maps a location key to the measured cost of the kernel.
+    llvm::StringMap<int64_t> costs;
+    if (mlir::failed(ReadProfile(costs))) {
+      signalPassFailure();
+      return;
+    }
+
+    mlir::Builder builder(module.getContext());
+    module.walk([&](mlir::Operation* op) {
+      if (llvm::isa<mlir::ModuleOp, mlir::func::FuncOp>(op)) return;
+
+      auto loc = op->getLoc().dyn_cast<mlir::FileLineColLoc>();
+      if (!loc) return;
+
+      auto iter = costs.find(GetLocationKey(loc.getFilename().getValue(),
+                                            loc.getLine(), loc.getColumn()));
+      if (iter == costs.end()) return;
+
+      op->setAttr(kCostAttrName, builder.getI64IntegerAttr(iter->second));
+    });
+  }
+
+ private:
+  // Read the profile written by KernelProfiler. Each line of the profile is
+  // `<filename> \t <line> \t <column> \t <count> \t <average ns>`.
+  mlir::LogicalResult ReadProfile(llvm::StringMap<int64_t>& costs) {
+    if (ns_per_cost_ <= 0) {
+      getOperation().emitError("ns-per-cost must be positive");
+      return mlir::failure();
+    }
+
+    auto file = llvm::MemoryBuffer::getFile(profile_path_);
+    if (std::error_code error = file.getError()) {
+      getOperation().emitError("cannot open kernel profile ")
+          << profile_path_ << ": " << error.message();
+      return mlir::failure();
+    }
+
+    llvm::SmallVector<llvm::StringRef, 16> lines;
+    (*file)->getBuffer().split(lines, '\n', /*MaxSplit=*/-1,
+                               /*KeepEmpty=*/false);
+
+    for (auto line : lines) {
+      llvm::SmallVector<llvm::StringRef, 5> fields;
+      line.split(fields, '\t');
+
+      int64_t line_number, column, count, average_ns;
+      if (fields.size() != 5 || fields[1].getAsInteger(10, line_number) ||
+          fields[2].getAsInteger(10, column) ||
+          fields[3].getAsInteger(10, count) ||
+          fields[4].getAsInteger(10, average_ns)) {
+        getOperation().emitError("malformed kernel profile entry: ") << line;
+        return mlir::failure();
+      }
+
+      // Costs must be positive. Kernels that are cheaper than one cost unit
+      // are considered the cheapest.
+      int64_t cost =
+          std::max<int64_t>(1, (average_ns + ns_per_cost_ - 1) / ns_per_cost_);
+      costs[GetLocationKey(fields[0], line_number, column)] = cost;
+    }
+
+    return mlir::success();
+  }
+
+  Option<std::string> profile_path_{
+      *this, "profile",
+      llvm::cl::desc("The kernel profile written by the BEF executor.")};
+  Option<int64_t> ns_per_cost_{
+      *this, "ns-per-cost",
+      llvm::cl::desc("The number of nanoseconds in one unit of cost."),
+      llvm::cl::init(1000)};
+};
+
+static mlir::PassRegistration<ApplyCostProfilePass> apply_cost_profile;
+
+}  // namespace
+}  // namespace compiler
+}  // namespace tfrt
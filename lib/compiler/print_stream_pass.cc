@@ -72,9 +72,38 @@ class PrintStreamPass
   }
 };
 
+class PrintCriticalPathPass
+    : public mlir::PassWrapper<PrintCriticalPathPass,
+                               mlir::OperationPass<mlir::func::FuncOp>> {
+ public:
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(PrintCriticalPathPass)
+
+  llvm::StringRef getArgument() const final {
+    return "tfrt-print-critical-path";
+  }
+
+  llvm::StringRef getDescription() const final {
+    return "A test pass for critical path costs in StreamAnalysis";
+  }
+
+  void runOnOperation() override {
+    auto func_op = getOperation();
+
+    const auto& stream_analysis = getAnalysis<StreamAnalysis>();
+
+    mlir::emitRemark(func_op.getLoc(), "critical path cost: ")
+        << stream_analysis.GetRootCriticalPathCost();
+    for (auto& op : func_op.front()) {
+      mlir::emitRemark(op.getLoc(), "critical path cost: ")
+          << stream_analysis.GetCriticalPathCost(&op);
+    }
+  }
+};
+
 // TODO(chky): Consider not using static initializers and register this pass
 // explicitly in the relevant binaries.
 static mlir::PassRegistration<PrintStreamPass> print_stream;
+static mlir::PassRegistration<PrintCriticalPathPass> print_critical_path;
 
 }  // namespace
 }  // namespace compiler
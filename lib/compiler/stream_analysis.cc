@@ -18,6 +18,7 @@
 
 #include "tfrt/compiler/stream_analysis.h"
 
+#include <algorithm>
 #include <optional>
 #include <string>
 
@@ -69,6 +70,13 @@ bool GetMergeInterDependentStreams(mlir::Block& block) {
 class DefaultCostModel : public StreamAnalysis::CostModelInterface {
  public:
   std::optional<int64_t> GetOperationCost(mlir::Operation* op) const override {
+    // Costs attached to the operation, eg. measured costs from a kernel
+    // profile, take precedence over the static cost functions.
+    if (auto cost_attr = op->getAttrOfType<mlir::IntegerAttr>("_tfrt_cost")) {
+      int64_t cost = cost_attr.getInt();
+      if (cost > 0) return cost;
+    }
+
     // Check if operations defines a cost function.
     if (auto cost_function = mlir::dyn_cast<CostFunctionInterface>(op)) {
       int64_t cost = cost_function.cost();
@@ -197,6 +205,34 @@ void StreamAnalysis::ScheduleOpForwardPass(mlir::Block& block) {
             << max_cost;
 }
 
+// ComputeCriticalPathBackwardPass traverses the operations in a reversed
+// topological order, and computes for each operation the cost of the most
+// expensive path from it to the end of the function. It must be called after
+// ScheduleOpForwardPass() which computes the cost of each operation.
+void StreamAnalysis::ComputeCriticalPathBackwardPass(mlir::Block& block) {
+  int64_t max_critical_path_cost = 0;
+
+  for (auto& op : llvm::reverse(block)) {
+    int64_t max_user_cost = 0;
+    for (auto* user : op.getUsers()) {
+      // Users might be nested in the regions of the operations in this block.
+      auto* user_in_block = block.findAncestorOpInBlock(*user);
+      if (user_in_block == nullptr || user_in_block == &op) continue;
+      max_user_cost =
+          std::max(max_user_cost, critical_path_costs_.lookup(user_in_block));
+    }
+
+    int64_t critical_path_cost = build_info_.op_map[&op].cost + max_user_cost;
+    critical_path_costs_[&op] = critical_path_cost;
+    max_critical_path_cost =
+        std::max(max_critical_path_cost, critical_path_cost);
+  }
+
+  // The root operation is the entry of every path in the function.
+  critical_path_costs_[kRootOperation] =
+      build_info_.op_map[kRootOperation].cost + max_critical_path_cost;
+}
+
 void StreamAnalysis::MergeStreams(int from_id, int to_id) {
   assert(from_id != to_id);
 
@@ -503,6 +539,7 @@ void StreamAnalysis::FinalizeStreams(mlir::Block& block) {
 void StreamAnalysis::AnalyzeBlock(mlir::Block& block) {
   GetOptionsForBlock(block);
   ScheduleOpForwardPass(block);
+  ComputeCriticalPathBackwardPass(block);
   BuildStreamBackwardPass(block);
   FinalizeStreams(block);
 }
@@ -16,8 +16,16 @@
 
 #include "tfrt/core_runtime/core_runtime.h"
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <string>
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Compiler.h"
+
 #include "tfrt/core_runtime/core_runtime_op.h"
 #include "tfrt/core_runtime/op_handler.h"
 #include "tfrt/core_runtime/op_invocation.h"
@@ -36,6 +44,7 @@
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/logging.h"
 #include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
 #include "tfrt/tensor/conversion_registry.h"
 #include "tfrt/tensor/tensor_metadata.h"
 #include "tfrt/tracing/tracing.h"
@@ -70,6 +79,36 @@ class OpHandlerRegistry {
   std::vector<std::unique_ptr<OpHandler>> all_op_handlers_;
 };
 
+// Runtime ids are never reused, so that the thread op caches never return
+// the ops of a destroyed CoreRuntime.
+std::atomic<uint64_t> next_runtime_id{1};
+
+// A direct-mapped cache of the ops recently resolved by CoreRuntime::Execute()
+// on a thread. Entries are indexed by the address of the op name, which is
+// stable for the op names of BEF files and string literals, and verified by
+// the content of the op name.
+struct ThreadOpCache {
+  static constexpr int kNumEntries = 64;
+
+  struct Entry {
+    uint64_t runtime_id = 0;
+    const OpHandler* op_handler = nullptr;
+    // Points to the key of the op in the resolved ops of the runtime.
+    string_view op_name;
+    const CoreRuntimeOp* op = nullptr;
+  };
+
+  Entry& GetEntry(const OpHandler* op_handler, string_view op_name) {
+    size_t hash = llvm::hash_combine(op_handler, op_name.data());
+    return entries[hash % kNumEntries];
+  }
+
+  std::array<Entry, kNumEntries> entries;
+  CoreRuntime::OpCacheStats stats;
+};
+
+thread_local ThreadOpCache thread_op_cache;
+
 }  // namespace
 
 OpHandler::~OpHandler() {}
@@ -105,6 +144,11 @@ class CoreRuntime::Impl {
  private:
   friend class CoreRuntime;
 
+  // Return the op `op_name` of `op_handler`, or nullptr if `op_handler` does
+  // not support it. The ops are resolved once and kept for the lifetime of
+  // the runtime.
+  const CoreRuntimeOp* GetOrMakeOp(OpHandler* op_handler, string_view op_name);
+
   void SetOpHandlerRegistry(OpHandlerRegistry op_handler_registry) {
     op_handler_registry_ = std::move(op_handler_registry);
   }
@@ -113,8 +157,48 @@ class CoreRuntime::Impl {
   HostContext context_;
 
   OpHandlerRegistry op_handler_registry_;
+
+  const uint64_t runtime_id_ =
+      next_runtime_id.fetch_add(1, std::memory_order_relaxed);
+
+  mutex resolved_ops_mu_;
+  llvm::DenseMap<OpHandler*, llvm::StringMap<CoreRuntimeOp>> resolved_ops_
+      TFRT_GUARDED_BY(resolved_ops_mu_);
 };
 
+const CoreRuntimeOp* CoreRuntime::Impl::GetOrMakeOp(OpHandler* op_handler,
+                                                    string_view op_name) {
+  ThreadOpCache::Entry& entry = thread_op_cache.GetEntry(op_handler, op_name);
+  if (LLVM_LIKELY(entry.runtime_id == runtime_id_ &&
+                  entry.op_handler == op_handler && entry.op_name == op_name)) {
+    ++thread_op_cache.stats.hits;
+    return entry.op;
+  }
+  ++thread_op_cache.stats.misses;
+
+  {
+    mutex_lock lock(resolved_ops_mu_);
+    auto& ops = resolved_ops_[op_handler];
+    auto it = ops.find(op_name);
+    if (it != ops.end()) {
+      entry = {runtime_id_, op_handler, it->first(), &it->second};
+      return entry.op;
+    }
+  }
+
+  // Resolve the op without holding the lock, as the op handler may call back
+  // into the runtime. Failures are not cached.
+  auto op_handle = op_handler->MakeOp(op_name);
+  if (!op_handle) return nullptr;
+
+  mutex_lock lock(resolved_ops_mu_);
+  auto it = resolved_ops_[op_handler]
+                .try_emplace(op_name, std::move(op_handle.get()))
+                .first;
+  entry = {runtime_id_, op_handler, it->first(), &it->second};
+  return entry.op;
+}
+
 void CoreRuntime::Impl::Execute(const ExecutionContext& exec_ctx,
                                 string_view op_name, OpHandler* op_handler,
                                 MutableArrayRef<TensorHandle> arguments,
@@ -122,9 +206,8 @@ void CoreRuntime::Impl::Execute(const ExecutionContext& exec_ctx,
                                 MutableArrayRef<TensorHandle> results,
                                 AsyncValueRef<Chain>* chain) {
   // Ask the op_handler to execute the op.  If successful, we're done.
-  auto op_handle = op_handler->MakeOp(op_name);
-  if (op_handle) {
-    op_handle.get()(exec_ctx, arguments, attrs, results, chain);
+  if (const CoreRuntimeOp* op = GetOrMakeOp(op_handler, op_name)) {
+    (*op)(exec_ctx, arguments, attrs, results, chain);
     return;
   }
 
@@ -219,6 +302,10 @@ void CoreRuntime::Execute(const ExecutionContext& exec_ctx, string_view op_name,
                  chain);
 }
 
+CoreRuntime::OpCacheStats CoreRuntime::GetThreadOpCacheStats() {
+  return thread_op_cache.stats;
+}
+
 Expected<CoreRuntimeOp> CoreRuntime::MakeOp(string_view op_name,
                                             OpHandler* op_handler) {
   auto op = op_handler->MakeOp(op_name);
@@ -70,7 +70,7 @@ MDFunctionExecResult ExecuteMetadataFunction(
 
   // TODO(tfrt-devs): Remove this tracing tag when finished debugging
   // dispatch performance.
-  TFRT_TRACE_SCOPE(Verbose, "RunMetadataFunction");
+  TFRT_TRACE_STATIC_SCOPE(Verbose, "RunMetadataFunction");
   if (auto error = metadata_fn(invocation.exec_ctx, argument_mds,
                                invocation.attrs, result_mds)) {
     // If the metadata function produced an error, propagate it.
@@ -22,7 +22,9 @@
 #include "tfrt/core_runtime/tensor_handle.h"
 #include "tfrt/host_context/async_value.h"
 #include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/attribute_cache.h"
 #include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/kernel_frame.h"
 #include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/host_context/sync_kernel_utils.h"
 #include "tfrt/support/error_util.h"
@@ -147,8 +149,7 @@ void AsyncWaitForResultsFromTensorHandles(
 void ExecuteOpImpl(CoreRuntimeOp op, ArrayRef<AsyncValue *> args,
                    AsyncValueRef<Chain> *op_chain,
                    MutableArrayRef<RCReference<AsyncValue>> results,
-                   AggregateAttr op_attr_array,
-                   AggregateAttr op_func_attr_array,
+                   const OpAttrsRef &op_attrs,
                    const ExecutionContext &exec_ctx) {
   llvm::SmallVector<TensorHandle, 8> th_args;
   th_args.reserve(args.size());
@@ -167,6 +168,17 @@ void ExecuteOpImpl(CoreRuntimeOp op, ArrayRef<AsyncValue *> args,
   llvm::SmallVector<TensorHandle, 8> result_ths;
   result_ths.resize(results.size());
 
+  op(exec_ctx, th_args, op_attrs, result_ths, op_chain);
+
+  AsyncWaitForResultsFromTensorHandles(results, result_ths);
+}
+
+void ExecuteOpImpl(CoreRuntimeOp op, ArrayRef<AsyncValue *> args,
+                   AsyncValueRef<Chain> *op_chain,
+                   MutableArrayRef<RCReference<AsyncValue>> results,
+                   AggregateAttr op_attr_array,
+                   AggregateAttr op_func_attr_array,
+                   const ExecutionContext &exec_ctx) {
   // Set up OpAttrs.
   OpAttrs op_attrs;
   SetUpOpAttrs(op_attr_array, &op_attrs);
@@ -174,9 +186,34 @@ void ExecuteOpImpl(CoreRuntimeOp op, ArrayRef<AsyncValue *> args,
   // Set up OpAttrs specifically for function attributes.
   SetUpOpFuncAttrs(op_func_attr_array, &op_attrs);
 
-  op(exec_ctx, th_args, OpAttrsRef(op_attrs), result_ths, op_chain);
+  ExecuteOpImpl(std::move(op), args, op_chain, results, OpAttrsRef(op_attrs),
+                exec_ctx);
+}
 
-  AsyncWaitForResultsFromTensorHandles(results, result_ths);
+void ExecuteOpImpl(CoreRuntimeOp op, ArrayRef<AsyncValue *> args,
+                   AsyncValueRef<Chain> *op_chain,
+                   MutableArrayRef<RCReference<AsyncValue>> results,
+                   AggregateAttr op_attr_array,
+                   AggregateAttr op_func_attr_array,
+                   const AsyncKernelFrame &frame) {
+  AttributeCache *attribute_cache = frame.GetAttributeCache();
+  if (attribute_cache == nullptr) {
+    ExecuteOpImpl(std::move(op), args, op_chain, results, op_attr_array,
+                  op_func_attr_array, frame.GetExecutionContext());
+    return;
+  }
+
+  const OpAttrsRef &frozen_attrs =
+      attribute_cache->GetOrCreate<OpAttrsRef>([&] {
+        OpAttrs op_attrs;
+        SetUpOpAttrs(op_attr_array, &op_attrs);
+        SetUpOpFuncAttrs(op_func_attr_array, &op_attrs);
+        return op_attrs.freeze();
+      });
+
+  // Freezing an immutable attribute set only adds a reference to it.
+  ExecuteOpImpl(std::move(op), args, op_chain, results, frozen_attrs.freeze(),
+                frame.GetExecutionContext());
 }
 
 void ExecuteOpImplSync(const CoreRuntimeOp &op,
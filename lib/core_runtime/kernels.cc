@@ -223,10 +223,9 @@ static llvm::Expected<CoreRuntimeOp> GetCoreRuntimeOp(
 static void ExecuteOp(Argument<OpHandler *> op_handler, RemainingArguments args,
                       RemainingResults results, AggregateAttr op_attr_array,
                       AggregateAttr op_func_attr_array, StringAttr op_name,
-                      KernelErrorHandler handler,
-                      const ExecutionContext &exec_ctx) {
-  auto expected_op =
-      GetCoreRuntimeOp(op_name.GetValue(), op_handler.get(), exec_ctx);
+                      KernelErrorHandler handler, AsyncKernelFrame *frame) {
+  auto expected_op = GetCoreRuntimeOp(op_name.GetValue(), op_handler.get(),
+                                      frame->GetExecutionContext());
   if (!expected_op) return handler.ReportError(StrCat(expected_op.takeError()));
 
   for (int b = 0, e = results.size(); b < e; ++b)
@@ -234,7 +233,7 @@ static void ExecuteOp(Argument<OpHandler *> op_handler, RemainingArguments args,
 
   ExecuteOpImpl(std::move(expected_op.get()), args.values(),
                 /*op_chain=*/nullptr, results.values(), op_attr_array,
-                op_func_attr_array, exec_ctx);
+                op_func_attr_array, *frame);
 }
 
 // ExecuteOpSeq executes the `op_name` operation on the `op_handler`. It takes
@@ -246,10 +245,9 @@ static void ExecuteOpSeq(Argument<OpHandler *> op_handler,
                          Result<Chain> out_op_chain, RemainingResults results,
                          AggregateAttr op_attr_array,
                          AggregateAttr op_func_attr_array, StringAttr op_name,
-                         KernelErrorHandler handler,
-                         const ExecutionContext &exec_ctx) {
-  auto expected_op =
-      GetCoreRuntimeOp(op_name.GetValue(), op_handler.get(), exec_ctx);
+                         KernelErrorHandler handler, AsyncKernelFrame *frame) {
+  auto expected_op = GetCoreRuntimeOp(op_name.GetValue(), op_handler.get(),
+                                      frame->GetExecutionContext());
   if (!expected_op) return handler.ReportError(StrCat(expected_op.takeError()));
 
   for (int b = 0, e = results.size(); b < e; ++b)
@@ -257,7 +255,7 @@ static void ExecuteOpSeq(Argument<OpHandler *> op_handler,
 
   auto op_chain = in_op_chain.ValueRef();
   ExecuteOpImpl(std::move(expected_op.get()), args.values(), &op_chain,
-                results.values(), op_attr_array, op_func_attr_array, exec_ctx);
+                results.values(), op_attr_array, op_func_attr_array, *frame);
   out_op_chain.Set(std::move(op_chain));
 }
 
@@ -268,8 +266,8 @@ static void ExecuteCoreRuntimeOp(Argument<CoreRuntimeOp> op,
                                  AggregateAttr op_attrs,
                                  AggregateAttr op_func_attrs,
                                  KernelErrorHandler handler,
-                                 const ExecutionContext &exec_ctx) {
-  auto *host = exec_ctx.host();
+                                 AsyncKernelFrame *frame) {
+  auto *host = frame->GetHostContext();
   auto *core_rt = CoreRuntime::GetFromHostContext(host);
   if (!core_rt) return handler.ReportError("no CoreRuntime available");
 
@@ -278,7 +276,7 @@ static void ExecuteCoreRuntimeOp(Argument<CoreRuntimeOp> op,
 
   ExecuteOpImpl(std::move(op.get()), args.values(),
                 /*op_chain=*/nullptr, results.values(), op_attrs, op_func_attrs,
-                exec_ctx);
+                *frame);
 }
 
 static tfrt::Expected<CoreRuntimeOp> MakeCompositeOp(
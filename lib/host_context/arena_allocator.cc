@@ -0,0 +1,218 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- arena_allocator.cc - Arena Allocator -------------------------------===//
+//
+// This file implements the arena allocator.
+//
+// Chunks are kChunkSize aligned, with a header at their start, so that the
+// chunk of an allocation can be found from its address. Each chunk counts its
+// live allocations, plus one reference held by the arena until it is
+// released. The arena object itself is alive as long as it is not released or
+// any of its chunks or forwarded allocations is alive, as the allocations call
+// back into it when they are deallocated.
+
+#include "tfrt/host_context/arena_allocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include "llvm/Support/MathExtras.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace {
+
+constexpr size_t kChunkSize = 64 * 1024;
+constexpr size_t kChunkHeaderSize = 64;
+
+// Larger allocations are forwarded to the parent allocator.
+constexpr size_t kMaxArenaAllocation = 4 * 1024;
+
+// Allocations with larger alignments are forwarded to the parent allocator,
+// as they could waste most of a chunk.
+constexpr size_t kMaxArenaAlignment = kChunkSize / 4;
+
+struct ChunkHeader {
+  // The offset of the first free byte in the chunk.
+  std::atomic<size_t> offset{kChunkHeaderSize};
+  // The number of live allocations, plus one until the arena is released.
+  std::atomic<int64_t> num_live{1};
+  // The next chunk of the arena.
+  ChunkHeader* next = nullptr;
+};
+static_assert(sizeof(ChunkHeader) <= kChunkHeaderSize,
+              "ChunkHeader does not fit in the chunk header");
+
+ChunkHeader* GetChunk(void* ptr) {
+  return reinterpret_cast<ChunkHeader*>(reinterpret_cast<uintptr_t>(ptr) &
+                                        ~(kChunkSize - 1));
+}
+
+// Returns whether the allocation at `ptr` of `size` bytes was forwarded to the
+// parent allocator. Over-aligned allocations are forwarded with kChunkSize
+// alignment, which the allocations served by the arena never have, as they
+// follow the chunk header.
+bool IsForwarded(void* ptr, size_t size) {
+  return size > kMaxArenaAllocation ||
+         (reinterpret_cast<uintptr_t>(ptr) & (kChunkSize - 1)) == 0;
+}
+
+class ArenaAllocatorImpl : public ArenaAllocator {
+ public:
+  explicit ArenaAllocatorImpl(HostAllocator* parent) : parent_(parent) {}
+
+  void* AllocateBytes(size_t size, size_t alignment) override;
+  void DeallocateBytes(void* ptr, size_t size) override;
+  void Release() override;
+
+ private:
+  // Bump-allocate from `chunk`. Returns nullptr if the chunk is full.
+  static void* TryAllocate(ChunkHeader* chunk, size_t size, size_t alignment);
+
+  // Allocate a new chunk and add it to the list of chunks.
+  ChunkHeader* NewChunk() TFRT_REQUIRES(mu_);
+
+  void FreeChunk(ChunkHeader* chunk);
+
+  void DropRef() {
+    if (num_refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+  }
+
+  HostAllocator* const parent_;
+
+  // The chunk to bump-allocate from.
+  std::atomic<ChunkHeader*> current_{nullptr};
+
+  // One reference is held until the arena is released, and one by each chunk
+  // and forwarded allocation.
+  std::atomic<int64_t> num_refs_{1};
+
+  mutex mu_;
+  // All chunks of the arena, until it is released.
+  ChunkHeader* chunks_ TFRT_GUARDED_BY(mu_) = nullptr;
+};
+
+void* ArenaAllocatorImpl::TryAllocate(ChunkHeader* chunk, size_t size,
+                                      size_t alignment) {
+  const auto base = reinterpret_cast<uintptr_t>(chunk);
+  size_t offset = chunk->offset.load(std::memory_order_relaxed);
+  while (true) {
+    size_t begin = llvm::alignTo(base + offset, alignment) - base;
+    size_t end = begin + size;
+    if (end > kChunkSize) return nullptr;
+    if (chunk->offset.compare_exchange_weak(offset, end,
+                                            std::memory_order_relaxed)) {
+      chunk->num_live.fetch_add(1, std::memory_order_relaxed);
+      return reinterpret_cast<void*>(base + begin);
+    }
+  }
+}
+
+ChunkHeader* ArenaAllocatorImpl::NewChunk() {
+  void* memory = parent_->AllocateBytes(kChunkSize, kChunkSize);
+  if (memory == nullptr) return nullptr;
+  num_refs_.fetch_add(1, std::memory_order_relaxed);
+
+  auto* chunk = new (memory) ChunkHeader();
+  chunk->next = chunks_;
+  chunks_ = chunk;
+  return chunk;
+}
+
+void ArenaAllocatorImpl::FreeChunk(ChunkHeader* chunk) {
+  chunk->~ChunkHeader();
+  parent_->DeallocateBytes(chunk, kChunkSize);
+  DropRef();
+}
+
+void* ArenaAllocatorImpl::AllocateBytes(size_t size, size_t alignment) {
+  if (size > kMaxArenaAllocation || alignment > kMaxArenaAlignment) {
+    // See IsForwarded() for the alignment of small forwarded allocations.
+    if (size <= kMaxArenaAllocation)
+      alignment = std::max(alignment, kChunkSize);
+    void* ptr = parent_->AllocateBytes(size, alignment);
+    if (ptr != nullptr) num_refs_.fetch_add(1, std::memory_order_relaxed);
+    return ptr;
+  }
+
+  // Zero sized allocations still take a byte, so that they never point past
+  // the end of their chunk.
+  size = std::max<size_t>(size, 1);
+
+  ChunkHeader* chunk = current_.load(std::memory_order_acquire);
+  if (chunk != nullptr) {
+    if (void* ptr = TryAllocate(chunk, size, alignment)) return ptr;
+  }
+
+  mutex_lock lock(mu_);
+  // Another thread may have replaced the chunk while we were waiting.
+  ChunkHeader* current = current_.load(std::memory_order_relaxed);
+  if (current != nullptr && current != chunk) {
+    if (void* ptr = TryAllocate(current, size, alignment)) return ptr;
+  }
+
+  ChunkHeader* new_chunk = NewChunk();
+  if (new_chunk == nullptr) return nullptr;
+  void* ptr = TryAllocate(new_chunk, size, alignment);
+  assert(ptr != nullptr);
+  current_.store(new_chunk, std::memory_order_release);
+  return ptr;
+}
+
+void ArenaAllocatorImpl::DeallocateBytes(void* ptr, size_t size) {
+  if (IsForwarded(ptr, size)) {
+    parent_->DeallocateBytes(ptr, size);
+    DropRef();
+    return;
+  }
+
+  ChunkHeader* chunk = GetChunk(ptr);
+  if (chunk->num_live.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    FreeChunk(chunk);
+}
+
+void ArenaAllocatorImpl::Release() {
+  ChunkHeader* chunks;
+  {
+    mutex_lock lock(mu_);
+    chunks = chunks_;
+    chunks_ = nullptr;
+    current_.store(nullptr, std::memory_order_relaxed);
+  }
+
+  // Free the chunks without live allocations. The other chunks are freed when
+  // their last allocation is deallocated.
+  while (chunks != nullptr) {
+    ChunkHeader* next = chunks->next;
+    if (chunks->num_live.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      FreeChunk(chunks);
+    chunks = next;
+  }
+
+  DropRef();
+}
+
+}  // namespace
+
+ArenaAllocatorPtr CreateArenaAllocator(HostAllocator* parent) {
+  return ArenaAllocatorPtr(new ArenaAllocatorImpl(parent));
+}
+
+}  // namespace tfrt
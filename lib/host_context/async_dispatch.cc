@@ -20,6 +20,7 @@
 
 #include <utility>
 
+#include "llvm/Support/Compiler.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/task_function.h"
 
@@ -37,7 +38,16 @@ void Await(HostContext* host, ArrayRef<RCReference<AsyncValue>> values) {
 void EnqueueWork(const ExecutionContext& exec_ctx,
                  llvm::unique_function<void()> work) {
   auto& work_queue = exec_ctx.work_queue();
-  work_queue.AddTask(TaskFunction(std::move(work)));
+  RequestContext* request_ctx = exec_ctx.request_ctx();
+  if (LLVM_UNLIKELY(request_ctx->HasDeadline())) {
+    work = [request_ctx = FormRef(request_ctx),
+            work = std::move(work)]() mutable {
+      request_ctx->CancelIfDeadlineExceeded();
+      work();
+    };
+  }
+  work_queue.AddTaskWithPriority(TaskFunction(std::move(work)),
+                                 exec_ctx.priority());
 }
 
 void EnqueueWork(HostContext* host, llvm::unique_function<void()> work) {
@@ -21,6 +21,7 @@
 #include <utility>
 
 #include "llvm/Support/Error.h"
+#include "tfrt/host_context/arena_allocator.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/host_context.h"
 
@@ -33,9 +34,15 @@ CancellationContext::~CancellationContext() {
 }
 
 void CancellationContext::Cancel() {
+  Cancel(absl::CancelledError("Cancelled"));
+}
+
+void CancellationContext::Cancel(absl::Status status) {
+  // Do not create the error value if the context is already cancelled.
+  if (IsCancelled()) return;
+
   // Create an AsyncValue in error state for cancel.
-  auto* error_value =
-      MakeErrorAsyncValueRef(absl::CancelledError("Cancelled")).release();
+  auto* error_value = MakeErrorAsyncValueRef(std::move(status)).release();
 
   ErrorAsyncValue* expected_value = nullptr;
   // Use memory_order_release for the success case so that error_value is
@@ -49,11 +56,39 @@ void CancellationContext::Cancel() {
   }
 }
 
+RequestContext::RequestContext(HostContext* host,
+                               ResourceContext* resource_context,
+                               ContextData ctx_data, int64_t id,
+                               RequestOptions::RequestPriority priority,
+                               RequestOptions::Clock::time_point deadline,
+                               ArenaAllocatorPtr arena)
+    : id_{id},
+      priority_{priority},
+      deadline_{deadline},
+      host_{host},
+      arena_{std::move(arena)},
+      allocator_{arena_ ? arena_.get() : host->allocator()},
+      resource_context_{resource_context},
+      context_data_{std::move(ctx_data)},
+      cancellation_{TakeRef(new CancellationContext)} {}
+
 void RequestContext::Cancel() { cancellation_->Cancel(); }
 
+bool RequestContext::CancelIfDeadlineExceededSlow() {
+  if (IsCancelled()) return true;
+  if (RequestOptions::Clock::now() < deadline_) return false;
+  cancellation_->Cancel(absl::DeadlineExceededError("Deadline exceeded"));
+  return true;
+}
+
 Expected<RCReference<RequestContext>> RequestContextBuilder::build() && {
+  ArenaAllocatorPtr arena;
+  if (use_arena_allocator_) arena = CreateArenaAllocator(host_->allocator());
   return TakeRef(new RequestContext(host_, resource_context_,
-                                    std::move(context_data_), id_));
+                                    std::move(context_data_), id_,
+                                    request_options_.priority,
+                                    request_options_.deadline,
+                                    std::move(arena)));
 };
 
 ExecutionContext::ExecutionContext(RCReference<RequestContext> req_ctx,
@@ -21,10 +21,12 @@
 #include "llvm/Support/Error.h"
 #include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/function.h"
 #include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/location.h"
 #include "tfrt/host_context/shared_context.h"
+#include "tfrt/support/error_util.h"
 #include "tfrt/support/string_util.h"
 
 namespace tfrt {
@@ -105,6 +107,27 @@ bool HostContext::IsInWorkerThread() const {
   return work_queue_->IsInWorkerThread();
 }
 
+//===----------------------------------------------------------------------===//
+// Admission Control
+//===----------------------------------------------------------------------===//
+
+Error HostContext::AdmitRequest(
+    const RequestContext& request,
+    std::chrono::system_clock::duration estimated_cost) const {
+  if (!request.HasDeadline()) return Error::success();
+
+  auto remaining_time = request.GetRemainingTime();
+  if (estimated_cost <= remaining_time) return Error::success();
+
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+  return llvm::make_error<DeadlineExceededErrorInfo>(
+      StrCat("Request ", request.id(), " rejected: the estimated cost of ",
+             duration_cast<microseconds>(estimated_cost).count(),
+             "us exceeds the remaining time of ",
+             duration_cast<microseconds>(remaining_time).count(), "us"));
+}
+
 //===----------------------------------------------------------------------===//
 // SharedContext management
 //===----------------------------------------------------------------------===//
@@ -0,0 +1,201 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements a host memory allocator that allocates memory on the
+// NUMA node of the calling thread.
+//
+// Large allocations are carved out of regions. A region is a kRegionSize
+// aligned chunk of memory bound to a NUMA node that holds blocks of a single
+// power of two size class. Its first block holds a header that records the
+// node and the size class, so DeallocateBytes() finds them from the address of
+// a block. Freed blocks are kept on the free lists of the node of their region
+// and reused; the regions are only unmapped when the allocator is destroyed.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "llvm/Support/MathExtras.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/support/alloc.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/numa.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+
+namespace {
+
+// Allocations smaller than this are served by malloc. Pages are placed on the
+// node of the thread that first touches them, and malloc keeps per-thread
+// arenas, so small allocations made by a pinned thread are mostly local
+// anyway. Larger allocations come from memory bound to the node of the calling
+// thread, which also covers buffers that are touched first by another thread
+// (e.g. filled by an I/O thread).
+constexpr size_t kMinNumaAllocationSize = 64 * 1024;
+
+// The size classes are the powers of two from kMinNumaAllocationSize to
+// kMaxPooledSize. Larger allocations are mapped directly.
+constexpr int kNumClasses = 8;
+constexpr size_t kMaxPooledSize = kMinNumaAllocationSize << (kNumClasses - 1);
+
+// Only the header page of the first block of a region is touched, so the rest
+// of that block does not take up physical memory.
+constexpr size_t kRegionSize = 64 * 1024 * 1024;
+
+size_t ClassSize(int size_class) {
+  return kMinNumaAllocationSize << size_class;
+}
+
+// Returns the size class that can hold `size` bytes aligned to `alignment`, or
+// -1 if the allocation is too large to be pooled. Blocks are aligned to their
+// size.
+int SizeClass(size_t size, size_t alignment) {
+  size_t block_size = std::max(size, alignment);
+  if (block_size > kMaxPooledSize) return -1;
+  return llvm::Log2_64_Ceil(block_size) -
+         llvm::Log2_64(kMinNumaAllocationSize);
+}
+
+struct RegionHeader {
+  int node;
+  // The size class of the blocks of the region, or -1 if the region was mapped
+  // for a single large allocation.
+  int size_class;
+  // The start and size of the mapping of a large allocation.
+  void* mapped;
+  size_t mapped_size;
+};
+
+// Blocks never start at the beginning of a region, as the header is there. A
+// large allocation aligned to kRegionSize or more has its header kRegionSize
+// bytes before it.
+RegionHeader* GetRegionHeader(void* ptr) {
+  auto address = reinterpret_cast<uintptr_t>(ptr);
+  if (address % kRegionSize == 0) address -= kRegionSize;
+  return reinterpret_cast<RegionHeader*>(address & ~(kRegionSize - 1));
+}
+
+// A free block is linked through its first word.
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+// The regions and free blocks of a NUMA node.
+class NodePool {
+ public:
+  ~NodePool() {
+    for (void* region : regions_) NumaFree(region, kRegionSize);
+  }
+
+  void* Allocate(int node, int size_class) {
+    mutex_lock lock(mu_);
+    if (FreeBlock* block = free_lists_[size_class]) {
+      free_lists_[size_class] = block->next;
+      return block;
+    }
+
+    const size_t block_size = ClassSize(size_class);
+    char*& region = current_regions_[size_class];
+    size_t& offset = next_offsets_[size_class];
+    if (region == nullptr || offset == kRegionSize) {
+      region = static_cast<char*>(NumaAlloc(kRegionSize, kRegionSize, node));
+      if (region == nullptr) return nullptr;
+      new (region) RegionHeader{node, size_class, region, kRegionSize};
+      regions_.push_back(region);
+      offset = block_size;
+    }
+    void* ptr = region + offset;
+    offset += block_size;
+    return ptr;
+  }
+
+  void Deallocate(void* ptr, int size_class) {
+    auto* block = static_cast<FreeBlock*>(ptr);
+    mutex_lock lock(mu_);
+    block->next = free_lists_[size_class];
+    free_lists_[size_class] = block;
+  }
+
+ private:
+  mutex mu_;
+  FreeBlock* free_lists_[kNumClasses] TFRT_GUARDED_BY(mu_) = {};
+  // The region the blocks of each size class are carved from, and the offset
+  // of its next block.
+  char* current_regions_[kNumClasses] TFRT_GUARDED_BY(mu_) = {};
+  size_t next_offsets_[kNumClasses] TFRT_GUARDED_BY(mu_) = {};
+  std::vector<void*> regions_ TFRT_GUARDED_BY(mu_);
+};
+
+class NumaAllocator : public HostAllocator {
+ public:
+  NumaAllocator()
+      : num_nodes_(GetNumNumaNodes()),
+        pools_(std::make_unique<NodePool[]>(num_nodes_)) {}
+
+  void* AllocateBytes(size_t size, size_t alignment) override {
+    if (size < kMinNumaAllocationSize) return AlignedAlloc(alignment, size);
+
+    int node = GetCurrentNumaNode();
+    if (node < 0 || node >= num_nodes_) node = 0;
+    int size_class = SizeClass(size, alignment);
+    if (size_class >= 0) return pools_[node].Allocate(node, size_class);
+    return AllocateLarge(size, alignment, node);
+  }
+
+  void DeallocateBytes(void* ptr, size_t size) override {
+    if (size < kMinNumaAllocationSize) {
+      AlignedFree(ptr);
+      return;
+    }
+
+    RegionHeader* header = GetRegionHeader(ptr);
+    if (header->size_class >= 0) {
+      pools_[header->node].Deallocate(ptr, header->size_class);
+    } else {
+      NumaFree(header->mapped, header->mapped_size);
+    }
+  }
+
+ private:
+  // Maps a large allocation with its own header. The mapping is aligned to
+  // kRegionSize, so that the header is found like the one of a region.
+  static void* AllocateLarge(size_t size, size_t alignment, int node) {
+    const size_t offset =
+        alignment >= kRegionSize ? alignment : std::max(alignment, size_t{64});
+    const size_t mapped_alignment = std::max(alignment, kRegionSize);
+    const size_t mapped_size = offset + size;
+    char* mapped =
+        static_cast<char*>(NumaAlloc(mapped_alignment, mapped_size, node));
+    if (mapped == nullptr) return nullptr;
+
+    void* ptr = mapped + offset;
+    new (GetRegionHeader(ptr)) RegionHeader{node, -1, mapped, mapped_size};
+    return ptr;
+  }
+
+  const int num_nodes_;
+  std::unique_ptr<NodePool[]> pools_;
+};
+
+}  // namespace
+
+std::unique_ptr<HostAllocator> CreateNumaAllocator() {
+  return std::make_unique<NumaAllocator>();
+}
+
+}  // namespace tfrt
@@ -17,6 +17,8 @@
 #include <string>
 #include <thread>
 
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/support/logging.h"
 
@@ -39,58 +41,104 @@ std::unique_ptr<ConcurrentWorkQueue> SingleThreadedWorkQueueFactory(
 }
 
 struct MakeMultiThreadedWorkQueue {
-  static std::unique_ptr<ConcurrentWorkQueue> make(int num_nonblocking_threads,
-                                                   int num_blocking_threads) {
+  static std::unique_ptr<ConcurrentWorkQueue> make(
+      int num_nonblocking_threads, int num_blocking_threads,
+      const MultiThreadedWorkQueueOptions& options) {
     return CreateMultiThreadedWorkQueue(num_nonblocking_threads,
-                                        num_blocking_threads);
+                                        num_blocking_threads, options);
   }
 };
 
-// Factory function for a multi-threaded thread pool.  Parses the given argument
-// to determine the construction parameters.  The argument must be either "X" or
-// "X,Y", where X and Y are integers. X will determine the number of threads to
-// use for blocking work, and Y will determine the number of threads for
-// nonblocking work. If X is not specified, the pool will use a number of
-// threads based on the number of CPUs in the system. Y is not specified, a
-// `kDefaultNumBlockingThreads` of threads will be used for blocking work.
+struct MakeNumaMultiThreadedWorkQueue {
+  static std::unique_ptr<ConcurrentWorkQueue> make(
+      int num_nonblocking_threads, int num_blocking_threads,
+      MultiThreadedWorkQueueOptions options) {
+    options.pin_to_numa_nodes = true;
+    return CreateMultiThreadedWorkQueue(num_nonblocking_threads,
+                                        num_blocking_threads, options);
+  }
+};
+
+struct MakePriorityMultiThreadedWorkQueue {
+  static std::unique_ptr<ConcurrentWorkQueue> make(
+      int num_nonblocking_threads, int num_blocking_threads,
+      MultiThreadedWorkQueueOptions options) {
+    options.request_priorities = true;
+    return CreateMultiThreadedWorkQueue(num_nonblocking_threads,
+                                        num_blocking_threads, options);
+  }
+};
+
+// Parses a "key=value" option of a multi-threaded thread pool into `options`.
+// Returns false if the option is invalid.
+bool ParseMultiThreadedWorkQueueOption(llvm::StringRef option,
+                                       MultiThreadedWorkQueueOptions* options) {
+  auto [key, value] = option.split('=');
+  int int_value;
+  if (value.getAsInteger(10, int_value) || int_value < 0) return false;
+
+  if (key == "stats") {
+    options->collect_stats = int_value != 0;
+  } else if (key == "spinning_threads") {
+    options->max_spinning_threads = int_value;
+  } else if (key == "spin_count") {
+    options->spin_count = int_value;
+  } else if (key == "adaptive_spinning") {
+    options->adaptive_spinning = int_value != 0;
+  } else if (key == "topology") {
+    options->topology_aware_stealing = int_value != 0;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Factory function for a multi-threaded thread pool. Parses the given argument
+// to determine the construction parameters. The argument is a comma separated
+// list of up to two integers X and Y, followed by "key=value" options. X will
+// determine the number of threads for nonblocking work, and Y will determine
+// the number of threads for blocking work. If X is not specified, the pool will
+// use a number of threads based on the number of CPUs in the system. If Y is
+// not specified, a `kDefaultNumBlockingThreads` of threads will be used for
+// blocking work. The options are (see MultiThreadedWorkQueueOptions):
+//
+//   stats=0|1              Export the statistics of the nonblocking threads.
+//   spinning_threads=N     The maximum number of spinning threads.
+//   spin_count=N           The number of steal attempts before parking.
+//   adaptive_spinning=0|1  Tune the spin count from the spin hit rate.
+//   topology=0|1           Steal from the threads sharing caches first.
+//
+// For example "mstd:8,16,spinning_threads=2,adaptive_spinning=1".
 template <typename MakeWorkQueue>
 std::unique_ptr<ConcurrentWorkQueue> MultiThreadedWorkQueueFactory(
     string_view arg) {
-  if (arg.empty()) {
-    int num_nonblocking = std::thread::hardware_concurrency();
-    int num_blocking = kDefaultNumBlockingThreads;
-    return MakeWorkQueue::make(num_nonblocking, num_blocking);
-  } else {
-    size_t comma = arg.find(',');
-    int num_threads;
-    int num_blocking = kDefaultNumBlockingThreads;
-    if (comma == std::string::npos) {
-      size_t pos;
-      num_threads = std::stoi(std::string(arg), &pos);
-      if (pos != arg.size()) {
-        TFRT_LOG(ERROR) << "Invalid argument for mstd work queue: "
-                        << std::string(arg);
-        return nullptr;
-      }
+  int num_threads = std::thread::hardware_concurrency();
+  int num_blocking = kDefaultNumBlockingThreads;
+  MultiThreadedWorkQueueOptions options;
+
+  llvm::SmallVector<llvm::StringRef, 4> items;
+  llvm::StringRef(arg.data(), arg.size())
+      .split(items, ',', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+  int num_positional = 0;
+  for (llvm::StringRef item : items) {
+    bool valid;
+    if (item.contains('=')) {
+      valid = ParseMultiThreadedWorkQueueOption(item, &options);
+      // Thread counts must precede the options.
+      num_positional = 2;
+    } else if (num_positional < 2) {
+      int& value = num_positional++ == 0 ? num_threads : num_blocking;
+      valid = !item.getAsInteger(10, value) && value > 0;
     } else {
-      size_t pos;
-      num_threads =
-          std::stoi(std::string(arg.data(), arg.data() + comma), &pos);
-      if (pos != comma) {
-        TFRT_LOG(ERROR) << "Invalid argument for mstd work queue: "
-                        << std::string(arg);
-        return nullptr;
-      }
-      num_blocking = std::stoi(
-          std::string(arg.data() + comma + 1, arg.data() + arg.size()), &pos);
-      if (pos != arg.size() - comma - 1) {
-        TFRT_LOG(ERROR) << "Invalid argument for mstd work queue: "
-                        << std::string(arg);
-        return nullptr;
-      }
+      valid = false;
+    }
+    if (!valid) {
+      TFRT_LOG(ERROR) << "Invalid argument for mstd work queue: "
+                      << std::string(arg);
+      return nullptr;
     }
-    return MakeWorkQueue::make(num_threads, num_blocking);
   }
+  return MakeWorkQueue::make(num_threads, num_blocking, options);
 }
 
 }  // namespace
@@ -98,5 +146,13 @@ std::unique_ptr<ConcurrentWorkQueue> MultiThreadedWorkQueueFactory(
 TFRT_WORK_QUEUE_FACTORY("s", SingleThreadedWorkQueueFactory);
 TFRT_WORK_QUEUE_FACTORY(
     "mstd", MultiThreadedWorkQueueFactory<MakeMultiThreadedWorkQueue>);
+// Same as "mstd", but the non-blocking worker threads are pinned to NUMA nodes.
+TFRT_WORK_QUEUE_FACTORY(
+    "mstd_numa", MultiThreadedWorkQueueFactory<MakeNumaMultiThreadedWorkQueue>);
+// Same as "mstd", but the non-blocking tasks are scheduled according to the
+// request priorities.
+TFRT_WORK_QUEUE_FACTORY(
+    "mstd_priority",
+    MultiThreadedWorkQueueFactory<MakePriorityMultiThreadedWorkQueue>);
 
 }  // namespace tfrt
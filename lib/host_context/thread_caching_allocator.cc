@@ -0,0 +1,338 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- thread_caching_allocator.cc - Thread Caching Allocator -------------===//
+//
+// This file implements a host memory allocator with per-thread caches of
+// size-classed blocks.
+//
+// Small blocks are carved out of spans. A span is a kSpanSize aligned chunk of
+// memory holding blocks of a single size class, with a header at its start
+// that records the size class. This allows DeallocateBytes() to find the size
+// class of a block from its address, even if the block was allocated from a
+// larger size class to satisfy the alignment.
+
+#include "tfrt/host_context/thread_caching_allocator.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "llvm/Support/MathExtras.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/metrics/metrics.h"
+#include "tfrt/support/alloc.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+
+namespace {
+
+constexpr size_t kSpanSize = 256 * 1024;
+constexpr size_t kSpanHeaderSize = 64;
+
+// The largest allocation served from the size classes.
+constexpr size_t kMaxCachedSize = 32 * 1024;
+
+// Size classes are multiples of 16 bytes up to 256 bytes, which covers async
+// values and small executor frames, followed by powers of two up to
+// kMaxCachedSize.
+constexpr int kNumSmallClasses = 16;
+constexpr int kNumClasses = kNumSmallClasses + 7;
+
+// The number of bytes moved between a thread cache and the central free list
+// at a time.
+constexpr size_t kBatchBytes = 16 * 1024;
+constexpr int kMaxBatchSize = 64;
+
+size_t ClassSize(int size_class) {
+  if (size_class < kNumSmallClasses) return (size_class + 1) * 16;
+  return size_t{512} << (size_class - kNumSmallClasses);
+}
+
+// Returns the size class for `size` bytes, ignoring alignment.
+int SizeClass(size_t size) {
+  if (size <= 256) return size == 0 ? 0 : (size - 1) / 16;
+  return kNumSmallClasses + llvm::Log2_64_Ceil(size) - 9;
+}
+
+// All blocks of a size class are aligned to the largest power of two that
+// divides the class size.
+size_t ClassAlignment(int size_class) {
+  size_t size = ClassSize(size_class);
+  return size & (~size + 1);
+}
+
+// The blocks start after the span header, at the alignment of the size class.
+size_t FirstBlockOffset(int size_class) {
+  return llvm::alignTo(kSpanHeaderSize, ClassAlignment(size_class));
+}
+
+int BatchSize(int size_class) {
+  return std::clamp<int>(kBatchBytes / ClassSize(size_class), 2,
+                         kMaxBatchSize);
+}
+
+// Returns the size class that can hold `size` bytes aligned to `alignment`, or
+// -1 if there is none.
+int SizeClass(size_t size, size_t alignment) {
+  size_t aligned_size = llvm::alignTo(std::max<size_t>(size, 1), alignment);
+  if (aligned_size > kMaxCachedSize) return -1;
+  for (int size_class = SizeClass(aligned_size); size_class < kNumClasses;
+       ++size_class) {
+    if (ClassAlignment(size_class) >= alignment) return size_class;
+  }
+  return -1;
+}
+
+struct SpanHeader {
+  int size_class;
+};
+
+// Blocks never start at the beginning of a span, as the span header is there.
+// Small allocations that no size class can align are forwarded to
+// AlignedAlloc() aligned to at least kSpanSize, so that they are recognized
+// by their address when they are deallocated.
+bool IsForwarded(void* ptr, size_t size) {
+  return size > kMaxCachedSize ||
+         reinterpret_cast<uintptr_t>(ptr) % kSpanSize == 0;
+}
+
+int GetSpanSizeClass(void* ptr) {
+  auto span = reinterpret_cast<uintptr_t>(ptr) & ~(kSpanSize - 1);
+  return reinterpret_cast<const SpanHeader*>(span)->size_class;
+}
+
+// A free block is linked through its first word.
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+// A list of free blocks. It is not thread-safe.
+struct FreeList {
+  FreeBlock* head = nullptr;
+  int length = 0;
+
+  void Push(void* ptr) {
+    auto* block = static_cast<FreeBlock*>(ptr);
+    block->next = head;
+    head = block;
+    ++length;
+  }
+
+  void* Pop() {
+    FreeBlock* block = head;
+    head = block->next;
+    --length;
+    return block;
+  }
+
+  // Move up to `n` blocks from the front of this list to the front of `other`.
+  void MoveTo(FreeList& other, int n) {
+    for (; n > 0 && head != nullptr; --n) other.Push(Pop());
+  }
+};
+
+metrics::Counter* NewAllocatorCounter(const char* name) {
+  return metrics::NewCounter(
+      std::string("/tensorflow/runtime/host_allocator/thread_caching/") + name);
+}
+
+// The process-wide central free lists and the statistics of all thread caches.
+class CentralHeap {
+ public:
+  static CentralHeap& Get() {
+    // Leaked, so that thread caches can be flushed during program exit.
+    static auto* central_heap = new CentralHeap();
+    return *central_heap;
+  }
+
+  // Move up to `n` free blocks of `size_class` to `list`, allocating a new span
+  // if the central free list is empty.
+  void Fetch(int size_class, int n, FreeList& list);
+
+  // Move all the blocks of `list` of `size_class` to the central free list.
+  void Release(int size_class, FreeList& list);
+
+  metrics::Counter* allocations() const { return allocations_; }
+  metrics::Counter* large_allocations() const { return large_allocations_; }
+
+ private:
+  CentralHeap()
+      : allocations_(NewAllocatorCounter("allocations")),
+        large_allocations_(NewAllocatorCounter("large_allocations")),
+        fetches_(NewAllocatorCounter("central_fetches")),
+        releases_(NewAllocatorCounter("central_releases")),
+        spans_(NewAllocatorCounter("spans")) {}
+
+  // Carve a new span into blocks of `size_class` and add them to `list`.
+  bool AllocateSpan(int size_class, FreeList& list);
+
+  struct CentralFreeList {
+    mutex mu;
+    FreeList list TFRT_GUARDED_BY(mu);
+  };
+  std::array<CentralFreeList, kNumClasses> free_lists_;
+
+  metrics::Counter* allocations_;
+  metrics::Counter* large_allocations_;
+  metrics::Counter* fetches_;
+  metrics::Counter* releases_;
+  metrics::Counter* spans_;
+};
+
+void CentralHeap::Fetch(int size_class, int n, FreeList& list) {
+  fetches_->Increment();
+  CentralFreeList& central = free_lists_[size_class];
+  mutex_lock lock(central.mu);
+  if (central.list.head == nullptr && !AllocateSpan(size_class, central.list))
+    return;
+  central.list.MoveTo(list, n);
+}
+
+void CentralHeap::Release(int size_class, FreeList& list) {
+  if (list.head == nullptr) return;
+  releases_->Increment();
+  CentralFreeList& central = free_lists_[size_class];
+  mutex_lock lock(central.mu);
+  list.MoveTo(central.list, list.length);
+}
+
+bool CentralHeap::AllocateSpan(int size_class, FreeList& list) {
+  void* span = AlignedAlloc(kSpanSize, kSpanSize);
+  if (span == nullptr) return false;
+  spans_->Increment();
+
+  static_cast<SpanHeader*>(span)->size_class = size_class;
+
+  const size_t block_size = ClassSize(size_class);
+  auto* begin = static_cast<char*>(span) + FirstBlockOffset(size_class);
+  auto* end = static_cast<char*>(span) + kSpanSize;
+  // Push the blocks in the reverse order, so that they are handed out in
+  // address order.
+  size_t num_blocks = (end - begin) / block_size;
+  for (size_t i = num_blocks; i > 0; --i)
+    list.Push(begin + (i - 1) * block_size);
+  return true;
+}
+
+// A cache of free blocks owned by a thread.
+class ThreadCache {
+ public:
+  ~ThreadCache();
+
+  void* Allocate(int size_class) {
+    FreeList& list = free_lists_[size_class];
+    if (list.head == nullptr) {
+      Flush();
+      CentralHeap::Get().Fetch(size_class, BatchSize(size_class), list);
+      if (list.head == nullptr) return nullptr;
+    }
+    ++num_allocations_;
+    return list.Pop();
+  }
+
+  void Deallocate(void* ptr, int size_class) {
+    FreeList& list = free_lists_[size_class];
+    list.Push(ptr);
+
+    // Return a batch of blocks to the central free list when the thread holds
+    // too many of them, e.g. when it frees blocks allocated by other threads.
+    const int batch_size = BatchSize(size_class);
+    if (list.length > 2 * batch_size) {
+      FreeList batch;
+      list.MoveTo(batch, batch_size);
+      CentralHeap::Get().Release(size_class, batch);
+    }
+  }
+
+ private:
+  // Export the statistics accumulated by this thread cache.
+  void Flush() {
+    if (num_allocations_ == 0) return;
+    CentralHeap::Get().allocations()->IncrementBy(num_allocations_);
+    num_allocations_ = 0;
+  }
+
+  std::array<FreeList, kNumClasses> free_lists_;
+  // The number of allocations not yet exported to the metrics.
+  int64_t num_allocations_ = 0;
+};
+
+// Set when the thread cache of the current thread is destroyed. This is a
+// trivially destructible thread local, so it can be read during thread exit.
+thread_local bool thread_cache_destroyed = false;
+
+ThreadCache::~ThreadCache() {
+  thread_cache_destroyed = true;
+  Flush();
+  for (int size_class = 0; size_class < kNumClasses; ++size_class)
+    CentralHeap::Get().Release(size_class, free_lists_[size_class]);
+}
+
+ThreadCache* GetThreadCache() {
+  if (thread_cache_destroyed) return nullptr;
+  static thread_local ThreadCache thread_cache;
+  return &thread_cache;
+}
+
+class ThreadCachingAllocator : public HostAllocator {
+ public:
+  void* AllocateBytes(size_t size, size_t alignment) override {
+    int size_class = SizeClass(size, alignment);
+    if (size_class < 0) {
+      if (size <= kMaxCachedSize) alignment = std::max(alignment, kSpanSize);
+      CentralHeap::Get().large_allocations()->Increment();
+      return AlignedAlloc(alignment, size);
+    }
+
+    if (ThreadCache* thread_cache = GetThreadCache())
+      return thread_cache->Allocate(size_class);
+
+    // The thread is exiting, allocate from the central free list directly.
+    FreeList list;
+    CentralHeap::Get().Fetch(size_class, 1, list);
+    return list.head == nullptr ? nullptr : list.Pop();
+  }
+
+  void DeallocateBytes(void* ptr, size_t size) override {
+    if (IsForwarded(ptr, size)) {
+      AlignedFree(ptr);
+      return;
+    }
+
+    int size_class = GetSpanSizeClass(ptr);
+    if (ThreadCache* thread_cache = GetThreadCache()) {
+      thread_cache->Deallocate(ptr, size_class);
+      return;
+    }
+
+    // The thread is exiting, return the block to the central free list.
+    FreeList list;
+    list.Push(ptr);
+    CentralHeap::Get().Release(size_class, list);
+  }
+};
+
+}  // namespace
+
+std::unique_ptr<HostAllocator> CreateThreadCachingAllocator() {
+  return std::make_unique<ThreadCachingAllocator>();
+}
+
+}  // namespace tfrt
@@ -15,80 +15,327 @@
 // Timer Queue
 //
 // This file implements TimerQueue.
+//
+// Each shard has kNumLevels wheels of kNumSlots slots. A slot of level `l`
+// spans kNumSlots^l ticks, and holds an intrusive list of the timers whose
+// deadline falls in its span. Timers in level 0 expire when the wheel reaches
+// their slot. The timers of a slot of a higher level are cascaded into the
+// lower levels when the level below wraps around.
 
 #include "tfrt/host_context/timer_queue.h"
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <limits>
+#include <utility>
+
+#include "tfrt/support/thread_annotations.h"
+
 namespace tfrt {
+namespace {
+
+using Tick = std::chrono::milliseconds;
+
+constexpr int kLevelBits = 8;
+constexpr int kNumSlots = 1 << kLevelBits;
+constexpr uint64_t kSlotMask = kNumSlots - 1;
+constexpr int kNumLevels = 4;
+
+// Timers that expire later than kMaxDelta ticks from now (about 49 days) are
+// kept in the last slot of the top level, and re-inserted when it cascades.
+constexpr uint64_t kMaxDelta = uint64_t{1} << (kLevelBits * kNumLevels);
+
+constexpr uint64_t kNoTick = std::numeric_limits<uint64_t>::max();
+
+constexpr unsigned kMaxNumShards = 32;
+
+}  // namespace
+
+struct TimerQueue::Shard {
+  // Add `entry` to the wheels. The wheels take a reference to `entry`.
+  void Add(TimerEntry* entry, uint64_t now_tick) TFRT_REQUIRES(mu);
+
+  // Remove `entry` from the wheels. The caller takes over the reference held
+  // by the wheels.
+  void Remove(TimerEntry* entry) TFRT_REQUIRES(mu);
+
+  // Process the ticks up to `now_tick` and move the expired timers to
+  // `expired`.
+  void Advance(uint64_t now_tick, std::vector<RCReference<TimerEntry>>* expired)
+      TFRT_REQUIRES(mu);
+
+  // Returns the next tick the shard has to be advanced to, or kNoTick if the
+  // shard is empty.
+  uint64_t NextTick() const TFRT_REQUIRES(mu);
+
+  // Remove all the timers of the shard.
+  std::vector<RCReference<TimerEntry>> Clear() TFRT_REQUIRES(mu);
+
+  mutable mutex mu;
+  // All the ticks before `current_tick` are processed.
+  uint64_t current_tick TFRT_GUARDED_BY(mu) = 0;
+  size_t num_timers TFRT_GUARDED_BY(mu) = 0;
+  std::array<std::array<TimerEntry*, kNumSlots>, kNumLevels> wheels
+      TFRT_GUARDED_BY(mu) = {};
+
+ private:
+  // Link `entry` into the slot of its deadline.
+  void Insert(TimerEntry* entry) TFRT_REQUIRES(mu);
+
+  // Re-insert the timers of the higher level slots that start at
+  // `current_tick`.
+  void Cascade() TFRT_REQUIRES(mu);
+};
+
+void TimerQueue::Shard::Add(TimerEntry* entry, uint64_t now_tick) {
+  // The timer thread does not advance empty shards, so catch up before
+  // inserting, rather than walking all the elapsed ticks later.
+  if (num_timers == 0) current_tick = std::max(current_tick, now_tick);
+
+  entry->shard_ = this;
+  entry->AddRef();
+  ++num_timers;
+  Insert(entry);
+}
+
+void TimerQueue::Shard::Insert(TimerEntry* entry) {
+  // Timers whose deadline has passed expire at the next processed tick.
+  uint64_t tick = std::max(entry->deadline_tick_, current_tick);
+  uint64_t delta = tick - current_tick;
+  if (delta >= kMaxDelta) {
+    delta = kMaxDelta - 1;
+    tick = current_tick + delta;
+  }
+
+  int level = 0;
+  while (delta >> (kLevelBits * (level + 1)) != 0) ++level;
+  int slot = (tick >> (kLevelBits * level)) & kSlotMask;
+
+  TimerEntry*& head = wheels[level][slot];
+  entry->prev_ = nullptr;
+  entry->next_ = head;
+  if (head != nullptr) head->prev_ = entry;
+  head = entry;
+  entry->level_ = level;
+  entry->slot_ = slot;
+}
+
+void TimerQueue::Shard::Remove(TimerEntry* entry) {
+  assert(entry->level_ >= 0);
+  if (entry->prev_ != nullptr) {
+    entry->prev_->next_ = entry->next_;
+  } else {
+    wheels[entry->level_][entry->slot_] = entry->next_;
+  }
+  if (entry->next_ != nullptr) entry->next_->prev_ = entry->prev_;
+  entry->prev_ = nullptr;
+  entry->next_ = nullptr;
+  entry->level_ = -1;
+  --num_timers;
+}
+
+void TimerQueue::Shard::Cascade() {
+  // Cascade the higher levels first, as their timers may land in the slots of
+  // the lower levels that start at the same tick.
+  int top_level = 1;
+  while (top_level + 1 < kNumLevels &&
+         (current_tick & ((uint64_t{1} << (kLevelBits * (top_level + 1))) -
+                          1)) == 0)
+    ++top_level;
+
+  for (int level = top_level; level > 0; --level) {
+    int slot = (current_tick >> (kLevelBits * level)) & kSlotMask;
+    TimerEntry* entry = std::exchange(wheels[level][slot], nullptr);
+    while (entry != nullptr) {
+      TimerEntry* next = entry->next_;
+      Insert(entry);
+      entry = next;
+    }
+  }
+}
+
+void TimerQueue::Shard::Advance(
+    uint64_t now_tick, std::vector<RCReference<TimerEntry>>* expired) {
+  while (current_tick <= now_tick) {
+    if (num_timers == 0) {
+      current_tick = now_tick + 1;
+      return;
+    }
+    if ((current_tick & kSlotMask) == 0) Cascade();
+
+    TimerEntry*& head = wheels[0][current_tick & kSlotMask];
+    while (head != nullptr) {
+      TimerEntry* entry = head;
+      Remove(entry);
+      expired->push_back(TakeRef(entry));
+    }
+    ++current_tick;
+  }
+}
+
+uint64_t TimerQueue::Shard::NextTick() const {
+  if (num_timers == 0) return kNoTick;
+  // Level 0 holds the timers that expire in the next kNumSlots ticks.
+  for (uint64_t tick = current_tick; tick < current_tick + kNumSlots; ++tick) {
+    if (wheels[0][tick & kSlotMask] != nullptr) return tick;
+  }
+
+  // Otherwise the shard has to be advanced when the first non-empty slot of a
+  // higher level cascades.
+  uint64_t next_tick = kNoTick;
+  for (int level = 1; level < kNumLevels; ++level) {
+    const int shift = kLevelBits * level;
+    const uint64_t position = current_tick >> shift;
+    // The current slot has not cascaded yet if `current_tick` is its first
+    // tick. Otherwise, it holds the timers of the slot kNumSlots ahead.
+    const uint64_t first =
+        (current_tick & ((uint64_t{1} << shift) - 1)) == 0 ? 0 : 1;
+    for (uint64_t i = first; i < first + kNumSlots; ++i) {
+      if (wheels[level][(position + i) & kSlotMask] != nullptr) {
+        next_tick = std::min(next_tick, (position + i) << shift);
+        break;
+      }
+    }
+  }
+  assert(next_tick != kNoTick);
+  return next_tick;
+}
+
+std::vector<RCReference<TimerQueue::TimerEntry>> TimerQueue::Shard::Clear() {
+  std::vector<RCReference<TimerEntry>> entries;
+  for (auto& wheel : wheels) {
+    for (TimerEntry*& head : wheel) {
+      while (head != nullptr) {
+        TimerEntry* entry = head;
+        Remove(entry);
+        entries.push_back(TakeRef(entry));
+      }
+    }
+  }
+  return entries;
+}
+
+TimerQueue::TimerQueue() : start_(Clock::now()) {
+  unsigned num_shards =
+      std::clamp(std::thread::hardware_concurrency(), 1u, kMaxNumShards);
+  shards_.reserve(num_shards);
+  for (unsigned i = 0; i < num_shards; ++i)
+    shards_.push_back(std::make_unique<Shard>());
 
-TimerQueue::TimerQueue() {
   // Start the timer thread.
   // TODO(tfrt-devs): use alternative to std::thread in google-internal build.
   timer_thread_ = std::thread([this]() { TimerThreadRun(); });
 }
 
 TimerQueue::~TimerQueue() {
-  mu_.lock();
-  // Cancel every timer in the queue.
-  while (!timers_.empty()) {
-    timers_.pop();
+  {
+    mutex_lock lock(mu_);
+    stop_ = true;
+    // Notify the timer thread we are done.
+    cv_.notify_one();
   }
-  stop_.store(true, std::memory_order_release);
-  // Notify the timer thread we are done cleaning up.
-  cv_.notify_one();
-  mu_.unlock();
   assert(timer_thread_.joinable());
   timer_thread_.join();
+
+  // Cancel every timer in the queue.
+  for (auto& shard : shards_) {
+    std::vector<RCReference<TimerEntry>> entries;
+    {
+      mutex_lock lock(shard->mu);
+      entries = shard->Clear();
+    }
+    for (auto& entry : entries)
+      entry->cancelled_.store(true, std::memory_order_release);
+  }
 }
 
 void TimerQueue::TimerThreadRun() {
-  mutex_lock lock(mu_);
-  while (!stop_.load(std::memory_order_acquire)) {
-    const TimerEntry* top_entry = getTopTimer();
-    if (!top_entry) {
-      cv_.wait(lock);
-    } else {
-      // Wait till the timer expires.
-      cv_.wait_until(lock, top_entry->deadline_);
+  std::vector<RCReference<TimerEntry>> expired;
+  while (true) {
+    // Threads that schedule timers while the shards are scanned, or while the
+    // callbacks run, wake up the timer thread, as the scan may miss their
+    // timers.
+    next_wakeup_tick_.store(0, std::memory_order_seq_cst);
+    {
+      mutex_lock lock(mu_);
+      if (stop_) return;
+      wakeup_requested_ = false;
     }
-    while (!timers_.empty() && timers_.top()->deadline_ <= Clock::now()) {
-      const auto top_entry = timers_.top();
-      timers_.pop();
-      mu_.unlock();
-      // If timer is not cancelled, run the callback.
-      if (!top_entry->cancelled_) {
-        top_entry->timer_callback_();
-      }
-      mu_.lock();
+
+    uint64_t now_tick = NowTick();
+    uint64_t next_tick = kNoTick;
+    for (auto& shard : shards_) {
+      mutex_lock lock(shard->mu);
+      shard->Advance(now_tick, &expired);
+      next_tick = std::min(next_tick, shard->NextTick());
     }
-  }
-}
 
-TimerQueue::TimerEntry* TimerQueue::getTopTimer() TFRT_REQUIRES(mu_) {
-  while (!timers_.empty()) {
-    if (timers_.top()->cancelled_) {
-      // Timer is cancelled, discard.
-      timers_.pop();
+    // If timer is not cancelled, run the callback.
+    for (auto& entry : expired) {
+      if (!entry->cancelled_.load(std::memory_order_acquire))
+        entry->timer_callback_();
+    }
+    expired.clear();
+
+    mutex_lock lock(mu_);
+    next_wakeup_tick_.store(next_tick, std::memory_order_seq_cst);
+    auto wakeup = [this]() TFRT_REQUIRES(mu_) {
+      return stop_ || wakeup_requested_;
+    };
+    if (next_tick == kNoTick) {
+      cv_.wait(lock, wakeup);
     } else {
-      return timers_.top().get();
+      cv_.wait_until(lock, TickTime(next_tick), wakeup);
     }
   }
-  // No active timer found. Return a nullptr.
-  return nullptr;
+}
+
+TimerQueue::Shard& TimerQueue::GetShard() {
+  // Threads are assigned to the shards in a round-robin fashion on first use.
+  static std::atomic<unsigned> next_thread_index{0};
+  thread_local unsigned thread_index =
+      next_thread_index.fetch_add(1, std::memory_order_relaxed);
+  return *shards_[thread_index % shards_.size()];
+}
+
+uint64_t TimerQueue::DeadlineTick(TimePoint deadline) const {
+  if (deadline <= start_) return 0;
+  // Round up, so that timers never expire before their deadline.
+  return std::chrono::ceil<Tick>(deadline - start_).count();
+}
+
+uint64_t TimerQueue::NowTick() const {
+  TimePoint now = Clock::now();
+  if (now <= start_) return 0;
+  return std::chrono::floor<Tick>(now - start_).count();
+}
+
+TimerQueue::TimePoint TimerQueue::TickTime(uint64_t tick) const {
+  return start_ + std::chrono::duration_cast<TimeDuration>(Tick(tick));
 }
 
 TimerQueue::TimerHandle TimerQueue::ScheduleTimerAt(TimePoint deadline,
                                                     TimerCallback callback) {
   TimerHandle th = TimerEntry::Create(deadline, std::move(callback));
-  bool notify = false;
+  th->deadline_tick_ = DeadlineTick(deadline);
+
+  uint64_t now_tick = NowTick();
+  Shard& shard = GetShard();
   {
+    mutex_lock lock(shard.mu);
+    shard.Add(th.get(), now_tick);
+  }
+
+  // Only notify timer thread when the newly added timer expires before the
+  // timer thread wakes up, or when the timer thread is scanning the shards, as
+  // the scan may have missed the timer.
+  uint64_t wakeup_tick = next_wakeup_tick_.load(std::memory_order_seq_cst);
+  if (wakeup_tick == 0 || th->deadline_tick_ < wakeup_tick) {
     mutex_lock lock(mu_);
-    // Only notify timer thread when the queue is empty, or when the newly added
-    // timer's deadline is shorter.
-    notify = timers_.empty() || timers_.top()->deadline_ > deadline;
-    timers_.push(th);
+    wakeup_requested_ = true;
+    cv_.notify_one();
   }
-  // Notify the timer thread that a new timer is added.
-  if (notify) cv_.notify_one();
   return th;
 }
 
@@ -103,6 +350,18 @@ void TimerQueue::CancelTimer(const TimerQueue::TimerHandle& timer_handle) {
   // callback has started execution, the CancelTimer() will block until
   // the execution finishes.
   timer_handle->cancelled_.store(true, std::memory_order_release);
+
+  // Remove the timer from its wheel, so that cancelled timers do not pile up.
+  // The callback is destroyed outside of the lock, as it may cancel timers.
+  TimerCallback callback;
+  {
+    mutex_lock lock(timer_handle->shard_->mu);
+    if (timer_handle->level_ < 0) return;
+    timer_handle->shard_->Remove(timer_handle.get());
+    callback = std::move(timer_handle->timer_callback_);
+  }
+  // Drop the reference held by the wheel. The caller still holds one.
+  timer_handle->DropRef();
 }
 
 }  // namespace tfrt
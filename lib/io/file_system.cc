@@ -18,8 +18,101 @@
 
 #include "tfrt/io/file_system.h"
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "absl/status/status.h"  // from @com_google_absl
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/support/alloc.h"
+
 namespace tfrt {
 namespace io {
+namespace {
+
+// A read-only memory region that holds a copy of the file in heap memory.
+class HeapReadOnlyMemoryRegion : public ReadOnlyMemoryRegion {
+ public:
+  HeapReadOnlyMemoryRegion(void* data, size_t size)
+      : data_(data), size_(size) {}
+
+  ~HeapReadOnlyMemoryRegion() override { AlignedFree(data_); }
+
+  // This class is not copyable or movable.
+  HeapReadOnlyMemoryRegion(const HeapReadOnlyMemoryRegion&) = delete;
+  HeapReadOnlyMemoryRegion& operator=(const HeapReadOnlyMemoryRegion&) =
+      delete;
+
+  ArrayRef<uint8_t> data() const override {
+    return ArrayRef<uint8_t>(static_cast<const uint8_t*>(data_), size_);
+  }
+
+ private:
+  void* data_;
+  size_t size_;
+};
+
+}  // namespace
+
+AsyncValueRef<size_t> RandomAccessFile::ReadAsync(char* buf, size_t max_count,
+                                                  size_t offset,
+                                                  HostContext* host) const {
+  ReadRequest request = {buf, max_count, offset};
+  return std::move(ReadBatchAsync(request, host).front());
+}
+
+std::vector<AsyncValueRef<size_t>> RandomAccessFile::ReadBatchAsync(
+    ArrayRef<ReadRequest> requests, HostContext* host) const {
+  std::vector<AsyncValueRef<size_t>> results;
+  results.reserve(requests.size());
+  for (const ReadRequest& request : requests) {
+    auto result = MakeUnconstructedAsyncValueRef<size_t>();
+    bool enqueued = EnqueueBlockingWork(
+        host, [this, request, result = result.CopyRef()]() {
+          auto count = Read(request.buf, request.max_count, request.offset);
+          if (!count) {
+            result.SetError(
+                absl::InternalError(llvm::toString(count.takeError())));
+            return;
+          }
+          result.emplace(*count);
+        });
+    if (!enqueued) {
+      result.SetError(absl::InternalError(
+          "failed to enqueue the blocking work of an asynchronous read"));
+    }
+    results.push_back(std::move(result));
+  }
+  return results;
+}
+
+llvm::Error FileSystem::NewReadOnlyMemoryRegionFromFile(
+    const std::string& path, std::unique_ptr<ReadOnlyMemoryRegion>* region) {
+  region->reset();
+
+  std::unique_ptr<RandomAccessFile> file;
+  if (auto error = NewRandomAccessFile(path, &file)) return error;
+
+  // The file size is unknown, so read the file in chunks until EOF.
+  constexpr size_t kChunkSize = 1 << 20;
+  std::vector<char> contents;
+  while (true) {
+    size_t offset = contents.size();
+    contents.resize(offset + kChunkSize);
+    auto read_count = file->Read(contents.data() + offset, kChunkSize, offset);
+    if (!read_count) return read_count.takeError();
+    contents.resize(offset + *read_count);
+    if (*read_count < kChunkSize) break;
+  }
+
+  // Copy the contents to aligned memory. Allocate at least one byte so that
+  // the region of an empty file still has a valid address.
+  void* data = AlignedAlloc(kReadOnlyMemoryRegionAlignment,
+                            std::max<size_t>(contents.size(), 1));
+  if (!contents.empty()) std::memcpy(data, contents.data(), contents.size());
+  *region = std::make_unique<HeapReadOnlyMemoryRegion>(data, contents.size());
+  return llvm::Error::success();
+}
 
 void FileSystemRegistry::Register(const std::string& scheme,
                                   std::unique_ptr<FileSystem> file_system) {
@@ -36,5 +129,19 @@ FileSystem* FileSystemRegistry::Lookup(const std::string& scheme) {
   return file_systems_[scheme].get();
 }
 
+Expected<FileSystem*> FileSystemRegistry::LookupForPath(string_view path) {
+  std::string scheme;
+  size_t scheme_end = path.find("://");
+  if (scheme_end != string_view::npos)
+    scheme = std::string(path.substr(0, scheme_end));
+
+  auto* file_system = Lookup(scheme);
+  if (file_system == nullptr) {
+    return MakeStringError("no file system is registered for scheme '", scheme,
+                           "' to open ", path);
+  }
+  return file_system;
+}
+
 }  // namespace io
 }  // namespace tfrt
@@ -0,0 +1,332 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the IoUring class. The ring is set up and used with
+// the io_uring system calls directly, so that liburing is not required.
+
+#include "io_uring.h"
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <utility>
+
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/logging.h"
+
+#if defined(__NR_io_uring_setup) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define TFRT_HAS_IO_URING 1
+#endif
+
+namespace tfrt {
+namespace io {
+
+// The reads of a SubmitReads() call share the callback.
+struct IoUring::Batch {
+  Batch(ReadCallback done, size_t size)
+      : done(std::move(done)), num_pending(size) {}
+
+  ReadCallback done;
+  std::atomic<size_t> num_pending;
+};
+
+struct IoUring::Read {
+  Batch* batch;
+  size_t index;
+  int fd;
+  string_view path;
+  char* buf;
+  size_t max_count;
+  size_t offset;
+  // The number of bytes read so far.
+  size_t count;
+  // The iovec of the submitted readv, which must stay valid until the kernel
+  // has consumed the submission.
+  struct iovec iov;
+};
+
+void IoUring::Finish(Read* read, llvm::Expected<size_t> count) {
+  Batch* batch = read->batch;
+  batch->done(read->index, std::move(count));
+  delete read;
+  if (batch->num_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    delete batch;
+}
+
+IoUring* IoUring::GetDefault() {
+  // Leaked, so that reads can complete during program exit.
+  static IoUring* io_uring = Create(/*num_entries=*/256).release();
+  return io_uring;
+}
+
+#if defined(TFRT_HAS_IO_URING)
+
+namespace {
+
+// Reads larger than this are split, as the length of a read is 32 bits.
+constexpr size_t kMaxReadSize = size_t{1} << 30;
+
+// The user data of the no-op that stops the completion thread.
+constexpr uint64_t kStopUserData = 0;
+
+unsigned LoadAcquire(const unsigned* ptr) {
+  return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+void StoreRelease(unsigned* ptr, unsigned value) {
+  __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+template <typename T>
+T* RingField(void* ring, uint32_t offset) {
+  return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+}
+
+}  // namespace
+
+std::unique_ptr<IoUring> IoUring::Create(unsigned num_entries) {
+  std::unique_ptr<IoUring> io_uring(new IoUring());
+  if (!io_uring->Init(num_entries)) return nullptr;
+  return io_uring;
+}
+
+bool IoUring::Init(unsigned num_entries) {
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  ring_fd_ = syscall(__NR_io_uring_setup, num_entries, &params);
+  if (ring_fd_ < 0) return false;
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    cq_ring_size_ = 0;
+  }
+
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    sq_ring_ = nullptr;
+    return false;
+  }
+  if (single_mmap) {
+    cq_ring_ = sq_ring_;
+  } else {
+    cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+      cq_ring_ = nullptr;
+      return false;
+    }
+  }
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) return false;
+  sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+  sq_entries_ = params.sq_entries;
+  sq_head_ = RingField<unsigned>(sq_ring_, params.sq_off.head);
+  sq_tail_ = RingField<unsigned>(sq_ring_, params.sq_off.tail);
+  sq_mask_ = RingField<unsigned>(sq_ring_, params.sq_off.ring_mask);
+  sq_array_ = RingField<unsigned>(sq_ring_, params.sq_off.array);
+
+  cq_entries_ = params.cq_entries;
+  cq_head_ = RingField<unsigned>(cq_ring_, params.cq_off.head);
+  cq_tail_ = RingField<unsigned>(cq_ring_, params.cq_off.tail);
+  cq_mask_ = RingField<unsigned>(cq_ring_, params.cq_off.ring_mask);
+  cqes_ = RingField<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+
+  completion_thread_ = std::thread([this]() { CompletionThreadRun(); });
+  return true;
+}
+
+IoUring::~IoUring() {
+  if (completion_thread_.joinable()) {
+    {
+      mutex_lock lock(mu_);
+      assert(num_in_flight_ == 0 && pending_.empty() &&
+             "IoUring destroyed with reads in flight");
+      io_uring_sqe* sqe = NextSqeLocked();
+      sqe->opcode = IORING_OP_NOP;
+      sqe->user_data = kStopUserData;
+      EnterLocked(1);
+    }
+    completion_thread_.join();
+  }
+
+  if (sqes_ != nullptr) munmap(sqes_, sqes_size_);
+  if (cq_ring_ != nullptr && cq_ring_ != sq_ring_)
+    munmap(cq_ring_, cq_ring_size_);
+  if (sq_ring_ != nullptr) munmap(sq_ring_, sq_ring_size_);
+  if (ring_fd_ >= 0) close(ring_fd_);
+}
+
+void IoUring::SubmitReads(int fd, string_view path,
+                          ArrayRef<ReadRequest> requests, ReadCallback done) {
+  if (requests.empty()) return;
+
+  auto* batch = new Batch(std::move(done), requests.size());
+  mutex_lock lock(mu_);
+  for (size_t i = 0; i < requests.size(); ++i) {
+    const ReadRequest& request = requests[i];
+    pending_.push_back(new Read{batch, i, fd, path, request.buf,
+                                request.max_count, request.offset,
+                                /*count=*/0, /*iov=*/{}});
+  }
+  SubmitPendingLocked();
+}
+
+io_uring_sqe* IoUring::NextSqeLocked() {
+  // The kernel consumes all the submitted entries in io_uring_enter(), so the
+  // submission queue is empty between the calls to EnterLocked().
+  unsigned tail = *sq_tail_;
+  assert(tail - LoadAcquire(sq_head_) < sq_entries_);
+  unsigned index = tail & *sq_mask_;
+  io_uring_sqe* sqe = &sqes_[index];
+  std::memset(sqe, 0, sizeof(*sqe));
+  sq_array_[index] = index;
+  StoreRelease(sq_tail_, tail + 1);
+  return sqe;
+}
+
+void IoUring::EnterLocked(unsigned count) {
+  while (count > 0) {
+    int submitted = syscall(__NR_io_uring_enter, ring_fd_, count,
+                            /*min_complete=*/0, /*flags=*/0, nullptr, 0);
+    if (submitted < 0) {
+      if (errno == EINTR || errno == EAGAIN) continue;
+      // The queued entries are valid, so this is a programming error.
+      TFRT_LOG(FATAL) << "io_uring_enter failed: " << strerror(errno);
+    }
+    count -= submitted;
+  }
+}
+
+void IoUring::SubmitPendingLocked() {
+  unsigned count = 0;
+  while (!pending_.empty() && num_in_flight_ < cq_entries_ &&
+         count < sq_entries_) {
+    Read* read = pending_.front();
+    pending_.pop_front();
+
+    read->iov.iov_base = read->buf + read->count;
+    read->iov.iov_len = std::min(read->max_count - read->count, kMaxReadSize);
+
+    // IORING_OP_READV is used instead of IORING_OP_READ, which requires Linux
+    // 5.6.
+    io_uring_sqe* sqe = NextSqeLocked();
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = read->fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&read->iov);
+    sqe->len = 1;
+    sqe->off = read->offset + read->count;
+    sqe->user_data = reinterpret_cast<uint64_t>(read);
+
+    ++count;
+    ++num_in_flight_;
+  }
+  EnterLocked(count);
+}
+
+void IoUring::CompletionThreadRun() {
+  llvm::SmallVector<std::pair<Read*, int>, 32> completions;
+  while (true) {
+    int result = syscall(__NR_io_uring_enter, ring_fd_, /*to_submit=*/0,
+                         /*min_complete=*/1, IORING_ENTER_GETEVENTS, nullptr,
+                         0);
+    if (result < 0 && errno != EINTR && errno != EAGAIN)
+      TFRT_LOG(FATAL) << "io_uring_enter failed: " << strerror(errno);
+
+    bool stop = false;
+    unsigned head = *cq_head_;
+    const unsigned tail = LoadAcquire(cq_tail_);
+    for (; head != tail; ++head) {
+      const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+      if (cqe.user_data == kStopUserData) {
+        stop = true;
+        continue;
+      }
+      completions.emplace_back(reinterpret_cast<Read*>(cqe.user_data),
+                               cqe.res);
+    }
+    StoreRelease(cq_head_, head);
+    if (stop) return;
+    if (completions.empty()) continue;
+
+    // Release the completion queue entries before calling the callbacks, which
+    // may destroy this instance after the last read completes.
+    {
+      mutex_lock lock(mu_);
+      num_in_flight_ -= completions.size();
+    }
+
+    llvm::SmallVector<Read*, 4> resumed;
+    for (auto& completion : completions) {
+      Read* read = completion.first;
+      int res = completion.second;
+      if (res == -EINTR || res == -EAGAIN) {
+        resumed.push_back(read);
+      } else if (res < 0) {
+        Finish(read, MakeStringError("failed to read file ", read->path,
+                                     " due to error: ", strerror(-res)));
+      } else {
+        read->count += res;
+        // A read of zero bytes indicates EOF.
+        if (res == 0 || read->count == read->max_count) {
+          Finish(read, read->count);
+        } else {
+          resumed.push_back(read);
+        }
+      }
+    }
+
+    completions.clear();
+
+    mutex_lock lock(mu_);
+    // The resumed reads are submitted before the new ones, so that their
+    // callers are not delayed further.
+    for (auto it = resumed.rbegin(); it != resumed.rend(); ++it)
+      pending_.push_front(*it);
+    SubmitPendingLocked();
+  }
+}
+
+#else  // TFRT_HAS_IO_URING
+
+std::unique_ptr<IoUring> IoUring::Create(unsigned num_entries) {
+  return nullptr;
+}
+
+IoUring::~IoUring() {}
+
+void IoUring::SubmitReads(int fd, string_view path,
+                          ArrayRef<ReadRequest> requests, ReadCallback done) {
+  assert(false && "io_uring is not supported");
+}
+
+#endif  // TFRT_HAS_IO_URING
+
+}  // namespace io
+}  // namespace tfrt
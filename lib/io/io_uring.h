@@ -0,0 +1,133 @@
+/*
+ * Copyright 2022 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares the IoUring class, which submits asynchronous file reads
+// to a Linux io_uring instance.
+
+#ifndef TFRT_LIB_IO_IO_URING_H_
+#define TFRT_LIB_IO_IO_URING_H_
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <thread>
+
+#include "llvm/ADT/FunctionExtras.h"
+#include "tfrt/io/file_system.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+struct io_uring_cqe;
+struct io_uring_sqe;
+
+namespace tfrt {
+namespace io {
+
+// A queue of asynchronous file reads, backed by an io_uring instance and a
+// thread that waits for the completions. The kernel queues the reads, so no
+// thread is blocked for the duration of a read.
+class IoUring {
+ public:
+  // Called with the index of the request in its batch, and the number of
+  // bytes read or the error.
+  using ReadCallback =
+      llvm::unique_function<void(size_t index, llvm::Expected<size_t> count)>;
+
+  // Returns the process-wide instance, or nullptr if io_uring is not
+  // supported, e.g. by old kernels, or if it is disabled by a seccomp policy.
+  static IoUring* GetDefault();
+
+  // Creates an instance with `num_entries` submission queue entries. Returns
+  // nullptr if io_uring is not supported.
+  static std::unique_ptr<IoUring> Create(unsigned num_entries);
+
+  // All the reads must be completed before the destruction.
+  ~IoUring();
+
+  // This class is not copyable or movable.
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+  // Submits the reads of `requests` from the file descriptor `fd`, with the
+  // same semantics as RandomAccessFile::Read(): short reads are resumed, so
+  // that a count smaller than `max_count` indicates EOF. `done` is called once
+  // for each request, on the completion thread. `fd` and the buffers must stay
+  // valid until then. `path` is only used in error messages.
+  void SubmitReads(int fd, string_view path, ArrayRef<ReadRequest> requests,
+                   ReadCallback done);
+
+ private:
+  struct Batch;
+  struct Read;
+
+  IoUring() = default;
+
+  // Sets up the ring and starts the completion thread.
+  bool Init(unsigned num_entries);
+
+  // Moves the pending reads to the submission queue, up to the capacity of the
+  // completion queue, and submits them to the kernel.
+  void SubmitPendingLocked() TFRT_REQUIRES(mu_);
+
+  // Returns the next free submission queue entry.
+  io_uring_sqe* NextSqeLocked() TFRT_REQUIRES(mu_);
+
+  // Submits `count` entries queued by NextSqeLocked() to the kernel.
+  void EnterLocked(unsigned count) TFRT_REQUIRES(mu_);
+
+  void CompletionThreadRun();
+
+  // Calls the callback of `read` and destroys it.
+  static void Finish(Read* read, llvm::Expected<size_t> count);
+
+  int ring_fd_ = -1;
+
+  // The memory mapped rings. The completion queue ring shares the mapping of
+  // the submission queue ring if the kernel supports it.
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  unsigned sq_entries_ = 0;
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned* sq_mask_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+
+  unsigned cq_entries_ = 0;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned* cq_mask_ = nullptr;
+  io_uring_cqe* cqes_ = nullptr;
+
+  mutex mu_;
+  // The reads waiting for a free completion queue entry.
+  std::deque<Read*> pending_ TFRT_GUARDED_BY(mu_);
+  // The number of reads submitted to the kernel and not yet completed. It is
+  // bounded by the size of the completion queue, so that it never overflows.
+  unsigned num_in_flight_ TFRT_GUARDED_BY(mu_) = 0;
+
+  // TODO(tfrt-devs): use alternative to std::thread in google-internal build.
+  std::thread completion_thread_;
+};
+
+}  // namespace io
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_IO_IO_URING_H_
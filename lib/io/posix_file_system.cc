@@ -20,16 +20,34 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cstdint>
 #include <limits>
+#include <string>
+#include <vector>
 
+#include "absl/status/status.h"  // from @com_google_absl
+#include "io_uring.h"
 #include "llvm_derived/Support/raw_ostream.h"
+#include "tfrt/host_context/async_dispatch.h"
 
 namespace tfrt {
 namespace io {
 namespace {
 
+// Returns the path of the local file at `path`, which may have the "file"
+// scheme, e.g. "file:///tmp/data".
+std::string LocalPath(const std::string& path) {
+  constexpr char kFileScheme[] = "file://";
+  if (string_view(path).startswith(kFileScheme))
+    return path.substr(sizeof(kFileScheme) - 1);
+  return path;
+}
+
 // This class is used to read data from a random access file.
 class PosixRandomAccessFile : public RandomAccessFile {
  public:
@@ -45,6 +63,9 @@ class PosixRandomAccessFile : public RandomAccessFile {
   llvm::Expected<size_t> Read(char* buf, size_t max_count,
                               size_t offset) const override;
 
+  std::vector<AsyncValueRef<size_t>> ReadBatchAsync(
+      ArrayRef<ReadRequest> requests, HostContext* host) const override;
+
  private:
   int fd_;
   const std::string path_;
@@ -81,11 +102,90 @@ llvm::Expected<size_t> PosixRandomAccessFile::Read(char* buf, size_t max_count,
 
   return actual_count;
 }
+
+std::vector<AsyncValueRef<size_t>> PosixRandomAccessFile::ReadBatchAsync(
+    ArrayRef<ReadRequest> requests, HostContext* host) const {
+  IoUring* io_uring = IoUring::GetDefault();
+  if (io_uring == nullptr || fd_ < 0)
+    return RandomAccessFile::ReadBatchAsync(requests, host);
+
+  std::vector<AsyncValueRef<size_t>> results;
+  results.reserve(requests.size());
+  for (size_t i = 0; i < requests.size(); ++i)
+    results.push_back(MakeUnconstructedAsyncValueRef<size_t>());
+
+  // Set the results on the work queue of `host`, so that their waiters do not
+  // delay the completions of the other reads.
+  io_uring->SubmitReads(
+      fd_, path_, requests,
+      [host, results = std::vector<AsyncValueRef<size_t>>(results)](
+          size_t index, llvm::Expected<size_t> count) mutable {
+        AsyncValueRef<size_t> result = std::move(results[index]);
+        if (!count) {
+          EnqueueWork(host, [result = std::move(result),
+                             status = absl::InternalError(
+                                 llvm::toString(count.takeError()))]() {
+            result.SetError(status);
+          });
+          return;
+        }
+        EnqueueWork(host, [result = std::move(result), count = *count]() {
+          result.emplace(count);
+        });
+      });
+  return results;
+}
+
+// This class is used to access a file that is memory mapped read-only.
+class PosixMappedMemoryRegion : public ReadOnlyMemoryRegion {
+ public:
+  explicit PosixMappedMemoryRegion(void* address, size_t size,
+                                   const std::string& path)
+      : address_(address), size_(size), path_(path) {}
+
+  ~PosixMappedMemoryRegion() override;
+
+  // This class is not copyable or movable.
+  PosixMappedMemoryRegion(const PosixMappedMemoryRegion&) = delete;
+  PosixMappedMemoryRegion& operator=(const PosixMappedMemoryRegion&) = delete;
+
+  ArrayRef<uint8_t> data() const override {
+    return ArrayRef<uint8_t>(static_cast<const uint8_t*>(address_), size_);
+  }
+
+  void Prefetch(size_t offset, size_t count) const override;
+
+ private:
+  void* address_;
+  size_t size_;
+  const std::string path_;
+};
+
+PosixMappedMemoryRegion::~PosixMappedMemoryRegion() {
+  if (munmap(address_, size_) < 0) {
+    tfrt::errs() << "failed to unmap file " << path_
+                 << " due to error: " << strerror(errno) << "\n";
+  }
+}
+
+void PosixMappedMemoryRegion::Prefetch(size_t offset, size_t count) const {
+  if (offset >= size_ || count == 0) return;
+  count = std::min(count, size_ - offset);
+
+  // madvise() requires a page aligned address.
+  static const size_t page_size = sysconf(_SC_PAGESIZE);
+  uintptr_t begin = reinterpret_cast<uintptr_t>(address_) + offset;
+  uintptr_t aligned_begin = begin / page_size * page_size;
+
+  // This is only a hint, so errors are ignored.
+  (void)madvise(reinterpret_cast<void*>(aligned_begin),
+                count + (begin - aligned_begin), MADV_WILLNEED);
+}
 }  // namespace
 
 llvm::Error PosixFileSystem::NewRandomAccessFile(
     const std::string& path, std::unique_ptr<RandomAccessFile>* file) {
-  int fd = open(path.c_str(), O_RDONLY);
+  int fd = open(LocalPath(path).c_str(), O_RDONLY);
   if (fd < 0) {
     file->reset();
     return MakeStringError("failed to open file ", path,
@@ -95,10 +195,53 @@ llvm::Error PosixFileSystem::NewRandomAccessFile(
   return llvm::Error::success();
 }
 
+llvm::Error PosixFileSystem::NewReadOnlyMemoryRegionFromFile(
+    const std::string& path, std::unique_ptr<ReadOnlyMemoryRegion>* region) {
+  region->reset();
+
+  int fd = open(LocalPath(path).c_str(), O_RDONLY);
+  if (fd < 0) {
+    return MakeStringError("failed to open file ", path,
+                           " due to error: ", strerror(errno));
+  }
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) < 0) {
+    std::string message = strerror(errno);
+    close(fd);
+    return MakeStringError("failed to stat file ", path,
+                           " due to error: ", message);
+  }
+
+  // mmap() does not support empty mappings, so read empty files into memory.
+  size_t size = file_stat.st_size;
+  if (size == 0) {
+    close(fd);
+    return FileSystem::NewReadOnlyMemoryRegionFromFile(path, region);
+  }
+
+  // Mapping is page aligned, which satisfies kReadOnlyMemoryRegionAlignment.
+  void* address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (address == MAP_FAILED) {
+    std::string message = strerror(errno);
+    close(fd);
+    return MakeStringError("failed to mmap file ", path,
+                           " due to error: ", message);
+  }
+  // The mapping keeps a reference to the file, so the descriptor can be closed.
+  close(fd);
+
+  *region = std::make_unique<PosixMappedMemoryRegion>(address, size, path);
+  return llvm::Error::success();
+}
+
 void RegisterFileSystem(FileSystemRegistry* registry) {
-  auto file_system = std::make_unique<PosixFileSystem>();
   // The scheme is an empty string to be backward-compatible with TF.
-  registry->Register("", std::move(file_system));
+  registry->Register("", std::make_unique<PosixFileSystem>());
+  // The io_uring instance of the asynchronous reads is created on the first
+  // read, so that it is not created by the static registration.
+  registry->Register(
+      "file", std::make_unique<PosixFileSystem>(FileSystemPriority::kHigh));
 }
 
 }  // namespace io
@@ -24,10 +24,14 @@
 namespace tfrt {
 namespace io {
 
-// This class is used to manage files in a POSIX file system.
+// This class is used to manage files in a POSIX file system. It is registered
+// for the empty scheme and, with a high priority, for the "file" scheme. The
+// asynchronous reads are submitted to io_uring if the kernel supports it.
 class PosixFileSystem : public FileSystem {
  public:
-  explicit PosixFileSystem() {}
+  explicit PosixFileSystem(
+      FileSystemPriority priority = FileSystemPriority::kDefault)
+      : priority_(priority) {}
 
   // This class is not copyable or movable.
   PosixFileSystem(const PosixFileSystem&) = delete;
@@ -36,6 +40,15 @@ class PosixFileSystem : public FileSystem {
   llvm::Error NewRandomAccessFile(
       const std::string& path,
       std::unique_ptr<RandomAccessFile>* file) override;
+
+  llvm::Error NewReadOnlyMemoryRegionFromFile(
+      const std::string& path,
+      std::unique_ptr<ReadOnlyMemoryRegion>* region) override;
+
+  FileSystemPriority GetPriority() override { return priority_; }
+
+ private:
+  const FileSystemPriority priority_;
 };
 
 }  // namespace io
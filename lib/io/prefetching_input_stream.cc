@@ -0,0 +1,153 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the PrefetchingInputStream class.
+
+#include "tfrt/io/prefetching_input_stream.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <string>
+
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+
+namespace tfrt {
+namespace io {
+
+PrefetchingInputStream::PrefetchingInputStream(
+    std::unique_ptr<RandomAccessFile> file, HostContext* host,
+    size_t buffer_size, size_t max_buffer_size, int num_buffers)
+    : file_(std::move(file)),
+      host_(host),
+      buffer_size_(buffer_size),
+      max_buffer_size_(std::max(buffer_size, max_buffer_size)),
+      num_buffers_(num_buffers) {
+  assert(buffer_size_ > 0);
+  assert(num_buffers_ > 0);
+  Prefetch();
+}
+
+PrefetchingInputStream::~PrefetchingInputStream() {
+  DiscardBuffers();
+  for (char* data : free_buffers_)
+    host_->allocator()->Deallocate(data, buffer_size_);
+}
+
+void PrefetchingInputStream::Prefetch() {
+  if (eof_) return;
+
+  llvm::SmallVector<ReadRequest, 4> requests;
+  while (buffers_.size() + requests.size() <
+         static_cast<size_t>(num_buffers_)) {
+    char* data;
+    if (free_buffers_.empty()) {
+      data = host_->allocator()->Allocate<char>(buffer_size_);
+    } else {
+      data = free_buffers_.back();
+      free_buffers_.pop_back();
+    }
+    requests.push_back({data, buffer_size_, read_offset_});
+    read_offset_ += buffer_size_;
+  }
+  if (requests.empty()) return;
+
+  std::vector<AsyncValueRef<size_t>> counts =
+      file_->ReadBatchAsync(requests, host_);
+  for (size_t i = 0; i < requests.size(); ++i) {
+    buffers_.push_back({requests[i].buf, requests[i].max_count,
+                        requests[i].offset, std::move(counts[i])});
+  }
+}
+
+void PrefetchingInputStream::DiscardBuffers() {
+  llvm::SmallVector<RCReference<AsyncValue>, 4> reads;
+  for (const Buffer& buffer : buffers_)
+    reads.push_back(buffer.count.CopyRCRef());
+  if (!reads.empty()) host_->Await(reads);
+
+  for (Buffer& buffer : buffers_) ReleaseBuffer(std::move(buffer));
+  buffers_.clear();
+  buffer_pos_ = 0;
+}
+
+void PrefetchingInputStream::ReleaseBuffer(Buffer buffer) {
+  if (buffer.capacity == buffer_size_) {
+    free_buffers_.push_back(buffer.data);
+  } else {
+    host_->allocator()->Deallocate(buffer.data, buffer.capacity);
+  }
+}
+
+llvm::Expected<size_t> PrefetchingInputStream::Read(char* buf,
+                                                    size_t max_count) {
+  size_t actual_count = 0;
+  while (actual_count < max_count) {
+    if (buffers_.empty()) {
+      Prefetch();
+      if (buffers_.empty()) break;
+    }
+
+    Buffer& buffer = buffers_.front();
+    if (!buffer.count.IsAvailable()) {
+      // The consumer is faster than the storage, so read larger buffers to
+      // keep more bytes in flight.
+      if (buffer_size_ < max_buffer_size_) {
+        for (char* data : free_buffers_)
+          host_->allocator()->Deallocate(data, buffer_size_);
+        free_buffers_.clear();
+        buffer_size_ = std::min(buffer_size_ * 2, max_buffer_size_);
+      }
+      host_->Await(buffer.count.CopyRCRef());
+    }
+
+    if (buffer.count.IsError()) {
+      // Return the bytes read so far. The next call reports the error.
+      if (actual_count > 0) break;
+      std::string message(buffer.count.GetError().message());
+      // The next call reads again from the failed buffer.
+      read_offset_ = buffer.offset;
+      DiscardBuffers();
+      return MakeStringError(message);
+    }
+
+    const size_t count = buffer.count.get();
+    size_t read_cnt = std::min(count - buffer_pos_, max_count - actual_count);
+    std::memcpy(buf + actual_count, buffer.data + buffer_pos_, read_cnt);
+    buffer_pos_ += read_cnt;
+    actual_count += read_cnt;
+
+    if (buffer_pos_ == count) {
+      // A short read indicates EOF, so the following buffers are empty.
+      if (count < buffer.capacity) eof_ = true;
+      ReleaseBuffer(std::move(buffer));
+      buffers_.pop_front();
+      buffer_pos_ = 0;
+      if (eof_) {
+        DiscardBuffers();
+        break;
+      }
+      Prefetch();
+    }
+  }
+  stream_pos_ += actual_count;
+  return actual_count;
+}
+
+llvm::Expected<size_t> PrefetchingInputStream::Tell() { return stream_pos_; }
+
+}  // namespace io
+}  // namespace tfrt
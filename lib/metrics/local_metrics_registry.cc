@@ -0,0 +1,344 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements LocalMetricsRegistry.
+
+#include "tfrt/metrics/local_metrics_registry.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cctype>
+#include <system_error>
+#include <utility>
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/logging.h"
+
+namespace tfrt {
+namespace metrics {
+namespace {
+
+constexpr int kNumShards = 16;
+
+// Returns the shard of the calling thread. Threads are assigned to the shards
+// in a round-robin fashion on first use.
+int GetShard() {
+  static std::atomic<unsigned> next_thread_index{0};
+  thread_local int shard =
+      next_thread_index.fetch_add(1, std::memory_order_relaxed) % kNumShards;
+  return shard;
+}
+
+void AtomicAdd(std::atomic<double>& sum, double value) {
+  double old_sum = sum.load(std::memory_order_relaxed);
+  while (!sum.compare_exchange_weak(old_sum, old_sum + value,
+                                    std::memory_order_relaxed)) {
+  }
+}
+
+// Returns `name` with the characters that are not allowed in Prometheus metric
+// names replaced by underscores, and without leading underscores.
+std::string SanitizeName(llvm::StringRef name) {
+  std::string result;
+  for (char c : name) {
+    bool valid = std::isalnum(static_cast<unsigned char>(c)) || c == '_' ||
+                 c == ':';
+    if (!valid) c = '_';
+    if (c == '_' && result.empty()) continue;
+    result.push_back(c);
+  }
+  if (result.empty() || std::isdigit(static_cast<unsigned char>(result[0])))
+    result.insert(result.begin(), '_');
+  return result;
+}
+
+// Writes `value` as a Prometheus label value.
+void WriteLabelValue(raw_ostream& os, llvm::StringRef value) {
+  os << '"';
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      os << '\\' << c;
+    } else if (c == '\n') {
+      os << "\\n";
+    } else {
+      os << c;
+    }
+  }
+  os << '"';
+}
+
+raw_ostream& operator<<(raw_ostream& os, const std::atomic<double>& value) {
+  return os << llvm::format("%.17g", value.load(std::memory_order_relaxed));
+}
+
+}  // namespace
+
+class LocalMetricsRegistry::Metric {
+ public:
+  enum class Kind { kCounter, kInt64Gauge, kDoubleGauge, kStringGauge, kHist };
+
+  Metric(Kind kind, std::string name) : kind_(kind), name_(std::move(name)) {}
+  virtual ~Metric() = default;
+
+  Kind kind() const { return kind_; }
+  const std::string& name() const { return name_; }
+
+  // Metrics whose name is already used by a metric of another type are kept
+  // alive but not written.
+  bool exported = true;
+
+  // Write the metric in the Prometheus text exposition format.
+  virtual void Write(raw_ostream& os, llvm::StringRef name) const = 0;
+
+ private:
+  const Kind kind_;
+  const std::string name_;
+};
+
+namespace {
+
+using Metric = LocalMetricsRegistry::Metric;
+
+class LocalCounter : public Counter, public Metric {
+ public:
+  static constexpr Kind kKind = Kind::kCounter;
+
+  explicit LocalCounter(std::string name) : Metric(kKind, std::move(name)) {}
+
+  void IncrementBy(int64_t value) override {
+    shards_[GetShard()].value.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  void Write(raw_ostream& os, llvm::StringRef name) const override {
+    int64_t value = 0;
+    for (const Shard& shard : shards_)
+      value += shard.value.load(std::memory_order_relaxed);
+    os << "# TYPE " << name << " counter\n" << name << ' ' << value << '\n';
+  }
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<int64_t> value{0};
+  };
+  std::array<Shard, kNumShards> shards_;
+};
+
+template <typename T, Metric::Kind kMetricKind>
+class LocalNumericGauge : public Gauge<T>, public Metric {
+ public:
+  static constexpr Kind kKind = kMetricKind;
+
+  explicit LocalNumericGauge(std::string name)
+      : Metric(kKind, std::move(name)) {}
+
+  void Set(T value) override { value_.store(value, std::memory_order_relaxed); }
+
+  void Write(raw_ostream& os, llvm::StringRef name) const override {
+    os << "# TYPE " << name << " gauge\n" << name << ' ' << value_ << '\n';
+  }
+
+ private:
+  std::atomic<T> value_{0};
+};
+
+using LocalInt64Gauge = LocalNumericGauge<int64_t, Metric::Kind::kInt64Gauge>;
+using LocalDoubleGauge = LocalNumericGauge<double, Metric::Kind::kDoubleGauge>;
+
+class LocalStringGauge : public Gauge<std::string>, public Metric {
+ public:
+  static constexpr Kind kKind = Kind::kStringGauge;
+
+  explicit LocalStringGauge(std::string name)
+      : Metric(kKind, std::move(name)) {}
+
+  void Set(std::string value) override {
+    mutex_lock lock(mu_);
+    value_ = std::move(value);
+  }
+
+  void Write(raw_ostream& os, llvm::StringRef name) const override {
+    mutex_lock lock(mu_);
+    os << "# TYPE " << name << " gauge\n" << name << "{value=";
+    WriteLabelValue(os, value_);
+    os << "} 1\n";
+  }
+
+ private:
+  mutable mutex mu_;
+  std::string value_ TFRT_GUARDED_BY(mu_);
+};
+
+class LocalHistogram : public Histogram, public Metric {
+ public:
+  static constexpr Kind kKind = Kind::kHist;
+
+  LocalHistogram(std::string name, const Buckets& buckets)
+      : Metric(kKind, std::move(name)), bounds_(buckets.explicit_bounds()) {
+    for (Shard& shard : shards_) {
+      shard.counts = std::make_unique<std::atomic<int64_t>[]>(NumBuckets());
+      for (size_t i = 0; i < NumBuckets(); ++i) shard.counts[i] = 0;
+    }
+  }
+
+  const std::vector<double>& bounds() const { return bounds_; }
+
+  void Record(double value) override {
+    // The buckets are labelled by their upper bound, and a value equal to a
+    // bound belongs to the bucket that ends at the bound. The last bucket is
+    // the overflow bucket.
+    size_t bucket =
+        std::lower_bound(bounds_.begin(), bounds_.end(), value) -
+        bounds_.begin();
+    Shard& shard = shards_[GetShard()];
+    shard.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    AtomicAdd(shard.sum, value);
+  }
+
+  void Write(raw_ostream& os, llvm::StringRef name) const override {
+    std::vector<int64_t> counts(NumBuckets());
+    double sum = 0;
+    for (const Shard& shard : shards_) {
+      for (size_t i = 0; i < NumBuckets(); ++i)
+        counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+      sum += shard.sum.load(std::memory_order_relaxed);
+    }
+
+    // Prometheus buckets are cumulative, and labelled by their inclusive upper
+    // bound.
+    os << "# TYPE " << name << " histogram\n";
+    int64_t count = 0;
+    for (size_t i = 0; i < bounds_.size(); ++i) {
+      count += counts[i];
+      os << name << "_bucket{le=\"" << llvm::format("%.17g", bounds_[i])
+         << "\"} " << count << '\n';
+    }
+    count += counts.back();
+    os << name << "_bucket{le=\"+Inf\"} " << count << '\n';
+    os << name << "_sum " << llvm::format("%.17g", sum) << '\n';
+    os << name << "_count " << count << '\n';
+  }
+
+ private:
+  size_t NumBuckets() const { return bounds_.size() + 1; }
+
+  struct alignas(64) Shard {
+    std::unique_ptr<std::atomic<int64_t>[]> counts;
+    std::atomic<double> sum{0};
+  };
+
+  const std::vector<double> bounds_;
+  std::array<Shard, kNumShards> shards_;
+};
+
+}  // namespace
+
+LocalMetricsRegistry::LocalMetricsRegistry() = default;
+LocalMetricsRegistry::~LocalMetricsRegistry() = default;
+
+template <typename T, typename CreateFn>
+T* LocalMetricsRegistry::GetOrAdd(std::string name, CreateFn create) {
+  mutex_lock lock(mu_);
+  Metric*& existing = metrics_by_name_[name];
+  if (existing != nullptr && existing->kind() == T::kKind)
+    return static_cast<T*>(existing);
+
+  auto metric = create(std::move(name));
+  T* result = metric.get();
+  if (existing == nullptr) {
+    existing = result;
+  } else {
+    TFRT_LOG(WARNING) << "Metric " << result->name()
+                      << " already exists with another type, it will not be "
+                         "exported";
+    result->exported = false;
+  }
+  metrics_.push_back(std::move(metric));
+  return result;
+}
+
+Counter* LocalMetricsRegistry::NewCounter(std::string name) {
+  return GetOrAdd<LocalCounter>(std::move(name), [](std::string name) {
+    return std::make_unique<LocalCounter>(std::move(name));
+  });
+}
+
+Gauge<int64_t>* LocalMetricsRegistry::NewInt64Gauge(std::string name) {
+  return GetOrAdd<LocalInt64Gauge>(std::move(name), [](std::string name) {
+    return std::make_unique<LocalInt64Gauge>(std::move(name));
+  });
+}
+
+Gauge<double>* LocalMetricsRegistry::NewDoubleGauge(std::string name) {
+  return GetOrAdd<LocalDoubleGauge>(std::move(name), [](std::string name) {
+    return std::make_unique<LocalDoubleGauge>(std::move(name));
+  });
+}
+
+Gauge<std::string>* LocalMetricsRegistry::NewStringGauge(std::string name) {
+  return GetOrAdd<LocalStringGauge>(std::move(name), [](std::string name) {
+    return std::make_unique<LocalStringGauge>(std::move(name));
+  });
+}
+
+Histogram* LocalMetricsRegistry::NewHistogram(std::string name,
+                                              const Buckets& buckets) {
+  LocalHistogram* histogram =
+      GetOrAdd<LocalHistogram>(std::move(name), [&](std::string name) {
+        return std::make_unique<LocalHistogram>(std::move(name), buckets);
+      });
+  // Histograms with the same name but other buckets are not supported.
+  assert(histogram->bounds() == buckets.explicit_bounds());
+  return histogram;
+}
+
+void LocalMetricsRegistry::WritePrometheusText(raw_ostream& os) const {
+  // The callbacks may create metrics, so they run before mu_ is held.
+  RunCollectionCallbacks();
+
+  std::vector<std::pair<std::string, const Metric*>> metrics;
+  {
+    mutex_lock lock(mu_);
+    for (const auto& metric : metrics_) {
+      if (metric->exported)
+        metrics.emplace_back(SanitizeName(metric->name()), metric.get());
+    }
+  }
+  std::sort(metrics.begin(), metrics.end());
+  for (const auto& metric : metrics) metric.second->Write(os, metric.first);
+}
+
+Error LocalMetricsRegistry::WritePrometheusTextFile(string_view path) const {
+  std::error_code error_code;
+  llvm::raw_fd_ostream os(path, error_code, llvm::sys::fs::OF_Text);
+  if (error_code)
+    return MakeStringError("error opening metrics file ", path, ": ",
+                           error_code.message());
+  WritePrometheusText(os);
+  os.close();
+  if (os.has_error()) {
+    error_code = os.error();
+    os.clear_error();
+    return MakeStringError("error writing metrics file ", path, ": ",
+                           error_code.message());
+  }
+  return Error::success();
+}
+
+}  // namespace metrics
+}  // namespace tfrt
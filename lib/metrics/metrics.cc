@@ -16,6 +16,7 @@
 
 #include "tfrt/metrics/metrics.h"
 
+#include <cstdint>
 #include <string>
 
 #include "tfrt/metrics/metrics_registry.h"
@@ -23,6 +24,14 @@
 namespace tfrt {
 namespace metrics {
 
+// A dummy implementation of the Counter metric interface.
+class DummyCounter : public Counter {
+ public:
+  DummyCounter() {}
+
+  void IncrementBy(int64_t value) override {}
+};
+
 // A dummy implementation of the Gauge metric interface.
 template <typename T>
 class DummyGauge : public Gauge<T> {
@@ -40,6 +49,32 @@ class DummyHistogram : public Histogram {
   void Record(double value) override {}
 };
 
+Counter* NewCounter(std::string name) {
+  if (internal::kMetricsRegistry != nullptr) {
+    if (auto* counter = internal::kMetricsRegistry->NewCounter(name))
+      return counter;
+  }
+  return new DummyCounter();
+}
+
+template <>
+Gauge<int64_t>* NewGauge(std::string name) {
+  if (internal::kMetricsRegistry != nullptr) {
+    if (auto* gauge = internal::kMetricsRegistry->NewInt64Gauge(name))
+      return gauge;
+  }
+  return new DummyGauge<int64_t>();
+}
+
+template <>
+Gauge<double>* NewGauge(std::string name) {
+  if (internal::kMetricsRegistry != nullptr) {
+    if (auto* gauge = internal::kMetricsRegistry->NewDoubleGauge(name))
+      return gauge;
+  }
+  return new DummyGauge<double>();
+}
+
 template <>
 Gauge<std::string>* NewGauge(std::string name) {
   if (internal::kMetricsRegistry != nullptr)
@@ -17,7 +17,9 @@
 #include "tfrt/metrics/metrics_registry.h"
 
 #include <cassert>
+#include <map>
 #include <mutex>
+#include <utility>
 
 namespace tfrt {
 namespace metrics {
@@ -36,5 +38,39 @@ void RegisterMetricsRegistry(MetricsRegistry* metrics_registry) {
   internal::kMetricsRegistry = metrics_registry;
 }
 
+namespace {
+struct CollectionCallbacks {
+  // Held while the callbacks run, so that removing a callback waits for it.
+  std::mutex mu;
+  int64_t next_id = 0;
+  std::map<int64_t, std::function<void()>> callbacks;
+};
+}  // namespace
+
+static CollectionCallbacks& GetCollectionCallbacks() {
+  static auto callbacks = new CollectionCallbacks;
+  return *callbacks;
+}
+
+int64_t AddCollectionCallback(std::function<void()> callback) {
+  CollectionCallbacks& callbacks = GetCollectionCallbacks();
+  std::lock_guard<std::mutex> lock(callbacks.mu);
+  int64_t id = callbacks.next_id++;
+  callbacks.callbacks.emplace(id, std::move(callback));
+  return id;
+}
+
+void RemoveCollectionCallback(int64_t id) {
+  CollectionCallbacks& callbacks = GetCollectionCallbacks();
+  std::lock_guard<std::mutex> lock(callbacks.mu);
+  callbacks.callbacks.erase(id);
+}
+
+void RunCollectionCallbacks() {
+  CollectionCallbacks& callbacks = GetCollectionCallbacks();
+  std::lock_guard<std::mutex> lock(callbacks.mu);
+  for (const auto& callback : callbacks.callbacks) callback.second();
+}
+
 }  // namespace metrics
 }  // namespace tfrt
@@ -0,0 +1,322 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the NUMA and CPU topology utilities. On Linux, the
+// topology is read from sysfs and the memory policy is set with the mbind
+// system call directly, so that libnuma is not required.
+
+#include "tfrt/support/numa.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <tuple>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "tfrt/support/alloc.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace tfrt {
+namespace {
+
+struct NumaTopology {
+  // The system ids of the nodes, indexed by the dense node index.
+  std::vector<int> node_ids;
+  // The CPUs of each node, indexed by the dense node index.
+  std::vector<std::vector<int>> node_cpus;
+  // The dense node index of each CPU, indexed by the CPU id.
+  std::vector<int> cpu_nodes;
+};
+
+// Parse a list in the sysfs list format, e.g. "0-3,8,10-11".
+std::vector<int> ParseList(llvm::StringRef list) {
+  std::vector<int> result;
+  llvm::SmallVector<llvm::StringRef, 8> ranges;
+  list.trim().split(ranges, ',', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+  for (llvm::StringRef range : ranges) {
+    auto bounds = range.split('-');
+    int first, last;
+    if (bounds.first.trim().getAsInteger(10, first)) return {};
+    if (bounds.second.empty()) {
+      last = first;
+    } else if (bounds.second.trim().getAsInteger(10, last)) {
+      return {};
+    }
+    for (int i = first; i <= last; ++i) result.push_back(i);
+  }
+  return result;
+}
+
+bool ReadFile(const std::string& path, std::string* contents) {
+  std::ifstream file(path);
+  if (!file) return false;
+  std::getline(file, *contents);
+  return true;
+}
+
+NumaTopology ReadNumaTopology() {
+  NumaTopology topology;
+
+#if defined(__linux__)
+  static constexpr char kNodePath[] = "/sys/devices/system/node/";
+
+  std::string online;
+  if (ReadFile(std::string(kNodePath) + "online", &online)) {
+    for (int node_id : ParseList(online)) {
+      std::string cpulist;
+      if (!ReadFile(kNodePath + ("node" + std::to_string(node_id)) + "/cpulist",
+                    &cpulist))
+        continue;
+      std::vector<int> cpus = ParseList(cpulist);
+      // Skip the memory-only nodes, as no thread can run on them.
+      if (cpus.empty()) continue;
+
+      int node = topology.node_ids.size();
+      for (int cpu : cpus) {
+        if (cpu >= static_cast<int>(topology.cpu_nodes.size()))
+          topology.cpu_nodes.resize(cpu + 1, 0);
+        topology.cpu_nodes[cpu] = node;
+      }
+      topology.node_ids.push_back(node_id);
+      topology.node_cpus.push_back(std::move(cpus));
+    }
+  }
+#endif
+
+  // Without topology information, the machine is a single node that runs on
+  // any CPU.
+  if (topology.node_ids.empty()) {
+    topology.node_ids.push_back(0);
+    topology.node_cpus.emplace_back();
+    topology.cpu_nodes.clear();
+  }
+  return topology;
+}
+
+#if defined(__linux__)
+// Read the id of the cache of `level` of `cpu`, or return -1 if it is unknown.
+int ReadCacheId(int cpu, int level) {
+  const std::string cache_path = "/sys/devices/system/cpu/cpu" +
+                                 std::to_string(cpu) + "/cache/index";
+  for (int index = 0;; ++index) {
+    std::string path = cache_path + std::to_string(index) + "/";
+    std::string contents;
+    if (!ReadFile(path + "level", &contents)) return -1;
+    int cache_level;
+    if (llvm::StringRef(contents).trim().getAsInteger(10, cache_level) ||
+        cache_level != level)
+      continue;
+    if (ReadFile(path + "type", &contents) &&
+        llvm::StringRef(contents).trim() == "Instruction")
+      continue;
+    if (!ReadFile(path + "shared_cpu_list", &contents)) return -1;
+    std::vector<int> cpus = ParseList(contents);
+    if (cpus.empty()) return -1;
+    return *std::min_element(cpus.begin(), cpus.end());
+  }
+}
+#endif
+
+std::vector<CpuTopology> ReadCpuTopology() {
+  std::vector<CpuTopology> topology;
+
+#if defined(__linux__)
+  cpu_set_t allowed;
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return {};
+
+  std::string online;
+  if (!ReadFile("/sys/devices/system/cpu/online", &online)) return {};
+  for (int cpu : ParseList(online)) {
+    if (cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed)) continue;
+
+    CpuTopology cpu_topology = {cpu, /*package_id=*/0, cpu, cpu};
+    std::string package_id;
+    if (!ReadFile("/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                      "/topology/physical_package_id",
+                  &package_id) ||
+        llvm::StringRef(package_id).trim().getAsInteger(
+            10, cpu_topology.package_id)) {
+      cpu_topology.package_id = 0;
+    }
+    if (int l3_id = ReadCacheId(cpu, 3); l3_id >= 0) cpu_topology.l3_id = l3_id;
+    if (int l2_id = ReadCacheId(cpu, 2); l2_id >= 0) cpu_topology.l2_id = l2_id;
+    topology.push_back(cpu_topology);
+  }
+
+  std::sort(topology.begin(), topology.end(),
+            [](const CpuTopology& a, const CpuTopology& b) {
+              return std::tie(a.package_id, a.l3_id, a.l2_id, a.cpu) <
+                     std::tie(b.package_id, b.l3_id, b.l2_id, b.cpu);
+            });
+#endif
+
+  return topology;
+}
+
+const NumaTopology& GetNumaTopology() {
+  static const NumaTopology* topology = new NumaTopology(ReadNumaTopology());
+  return *topology;
+}
+
+// The node the current thread is pinned to, or -1 if it is not pinned.
+thread_local int pinned_numa_node = -1;
+
+}  // namespace
+
+int GetNumNumaNodes() { return GetNumaTopology().node_ids.size(); }
+
+llvm::ArrayRef<CpuTopology> GetCpuTopology() {
+  static const auto* topology =
+      new std::vector<CpuTopology>(ReadCpuTopology());
+  return *topology;
+}
+
+bool PinCurrentThreadToCpu(int cpu) {
+#if defined(__linux__)
+  if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu, &cpu_set);
+  if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0) return false;
+
+  // Keep the node of the CPU, so that GetCurrentNumaNode() does not need to
+  // query the current CPU.
+  const auto& topology = GetNumaTopology();
+  if (cpu < static_cast<int>(topology.cpu_nodes.size()))
+    pinned_numa_node = topology.cpu_nodes[cpu];
+  return true;
+#else
+  return false;
+#endif
+}
+
+llvm::ArrayRef<int> GetNumaNodeCpus(int node) {
+  const auto& topology = GetNumaTopology();
+  if (node < 0 || node >= static_cast<int>(topology.node_cpus.size()))
+    return {};
+  return topology.node_cpus[node];
+}
+
+int GetCurrentNumaNode() {
+  if (pinned_numa_node >= 0) return pinned_numa_node;
+
+#if defined(__linux__)
+  const auto& topology = GetNumaTopology();
+  if (topology.node_ids.size() > 1) {
+    int cpu = sched_getcpu();
+    if (cpu >= 0 && cpu < static_cast<int>(topology.cpu_nodes.size()))
+      return topology.cpu_nodes[cpu];
+  }
+#endif
+  return 0;
+}
+
+bool PinCurrentThreadToNumaNode(int node) {
+#if defined(__linux__)
+  llvm::ArrayRef<int> cpus = GetNumaNodeCpus(node);
+  if (cpus.empty()) return false;
+
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) {
+    if (cpu < CPU_SETSIZE) CPU_SET(cpu, &cpu_set);
+  }
+  if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0) return false;
+
+  pinned_numa_node = node;
+  return true;
+#else
+  return false;
+#endif
+}
+
+#if defined(__linux__)
+
+namespace {
+
+// The MPOL_PREFERRED memory policy from <linux/mempolicy.h>.
+constexpr int kMpolPreferred = 1;
+
+// The number of NUMA nodes supported by the mbind node mask.
+constexpr int kMaxNumaNodeId = 1024;
+
+size_t RoundUpToPageSize(size_t size) {
+  static const size_t page_size = sysconf(_SC_PAGESIZE);
+  return (size + page_size - 1) / page_size * page_size;
+}
+
+}  // namespace
+
+void* NumaAlloc(size_t alignment, size_t size, int node) {
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t mapped_size = RoundUpToPageSize(size);
+
+  // Over-allocate to align the memory if the alignment is larger than a page,
+  // and unmap the excess memory on both sides.
+  const size_t padding = alignment > page_size ? alignment - page_size : 0;
+  void* mapped = mmap(nullptr, mapped_size + padding, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapped == MAP_FAILED) return nullptr;
+
+  auto begin = reinterpret_cast<uintptr_t>(mapped);
+  auto aligned = (begin + alignment - 1) / alignment * alignment;
+  if (padding > 0) {
+    if (aligned > begin) munmap(mapped, aligned - begin);
+    size_t tail = begin + mapped_size + padding - (aligned + mapped_size);
+    if (tail > 0) munmap(reinterpret_cast<void*>(aligned + mapped_size), tail);
+  }
+  void* ptr = reinterpret_cast<void*>(aligned);
+
+  // Set the preferred node of the pages before they are touched. A failure
+  // only loses the locality, so it is ignored.
+  const auto& topology = GetNumaTopology();
+  if (topology.node_ids.size() > 1 && node >= 0 &&
+      node < static_cast<int>(topology.node_ids.size())) {
+    int node_id = topology.node_ids[node];
+    if (node_id < kMaxNumaNodeId) {
+      constexpr int kBitsPerWord = sizeof(unsigned long) * 8;  // NOLINT
+      unsigned long node_mask[kMaxNumaNodeId / kBitsPerWord] = {};  // NOLINT
+      node_mask[node_id / kBitsPerWord] |= 1ul << (node_id % kBitsPerWord);
+      syscall(SYS_mbind, ptr, mapped_size, kMpolPreferred, node_mask,
+              kMaxNumaNodeId + 1, 0);
+    }
+  }
+  return ptr;
+}
+
+void NumaFree(void* ptr, size_t size) {
+  if (ptr != nullptr) munmap(ptr, RoundUpToPageSize(size));
+}
+
+#else
+
+void* NumaAlloc(size_t alignment, size_t size, int node) {
+  return AlignedAlloc(alignment, size);
+}
+
+void NumaFree(void* ptr, size_t size) { AlignedFree(ptr); }
+
+#endif
+
+}  // namespace tfrt
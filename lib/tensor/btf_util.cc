@@ -16,8 +16,12 @@
 
 #include "tfrt/tensor/btf_util.h"
 
+#include <cstring>
 #include <iostream>
 
+#include "llvm/Support/MathExtras.h"
+#include "tfrt/io/file_system.h"
+
 namespace tfrt {
 namespace {
 
@@ -141,4 +145,109 @@ Error WriteTensorsToBTF(std::ostream* stream, ArrayRef<const Tensor*> tensors) {
   return Error::success();
 }
 
+Expected<MappedBTFFile> MappedBTFFile::Open(string_view path) {
+  auto file_system_or = io::FileSystemRegistry::Default()->LookupForPath(path);
+  if (!file_system_or) return file_system_or.takeError();
+
+  std::unique_ptr<io::ReadOnlyMemoryRegion> region;
+  if (auto error = (*file_system_or)->NewReadOnlyMemoryRegionFromFile(
+          std::string(path), &region)) {
+    return std::move(error);
+  }
+  return Create(std::move(region), path);
+}
+
+Expected<MappedBTFFile> MappedBTFFile::Create(
+    std::unique_ptr<io::ReadOnlyMemoryRegion> region, string_view path) {
+  ArrayRef<uint8_t> data = region->data();
+  // The tensor data is aligned by the BTF writer relative to the beginning of
+  // the file.
+  if (reinterpret_cast<uintptr_t>(data.data()) % kBtfAlignment != 0) {
+    return MakeStringError("BTF file ", path, " is not mapped at a ",
+                           kBtfAlignment, "-byte aligned address");
+  }
+  const auto* words = reinterpret_cast<const uint64_t*>(data.data());
+  const size_t num_words = data.size() / sizeof(uint64_t);
+  if (num_words == 0) {
+    return MakeStringError("failed to read num_tensors from ", path);
+  }
+  const uint64_t num_tensors = words[0];
+  if (num_tensors > num_words - 1) {
+    return MakeStringError("failed to read tensor record offsets from ", path);
+  }
+  ArrayRef<uint64_t> offsets(words + 1, num_tensors);
+
+  // Validate the offsets once, so that ReadDHT() can use them directly.
+  const uint64_t records_begin = (1 + num_tensors) * sizeof(uint64_t);
+  for (size_t i = 0; i < offsets.size(); ++i) {
+    const uint64_t offset = offsets[i];
+    if (offset < records_begin || offset % kBtfAlignment != 0 ||
+        offset > data.size() ||
+        data.size() - offset < sizeof(btf::TensorHeader)) {
+      return MakeStringError("invalid tensor record offset ", offset,
+                             " for tensor index ", i, " in ", path);
+    }
+  }
+
+  // The mapping is read-only, but HostBuffer does not distinguish read-only
+  // memory.
+  auto* ptr = const_cast<uint8_t*>(data.data());
+  auto buffer = HostBuffer::CreateFromExternal(
+      ptr, data.size(),
+      [region = std::move(region)](void*, size_t) mutable { region.reset(); });
+  return MappedBTFFile(std::string(path), std::move(buffer), offsets);
+}
+
+Expected<DenseHostTensor> MappedBTFFile::ReadDHT(size_t index) const {
+  if (index >= offsets_.size()) {
+    return MakeStringError("invalid tensor index ", index,
+                           " to read tensor from path ", path_,
+                           " which contains ", offsets_.size(), " tensors");
+  }
+  const uint64_t offset = offsets_[index];
+  const auto* data = static_cast<const uint8_t*>(buffer_->data());
+  const size_t size = buffer_->size();
+
+  const auto* header =
+      reinterpret_cast<const btf::TensorHeader*>(data + offset);
+  if (header->layout != btf::TensorLayout::kRMD) {
+    return MakeStringError("unexpected tensor layout ", header->layout);
+  }
+  if (header->dtype > btf::TensorDType::kUInt64) {
+    return MakeStringError("unexpected tensor dtype ",
+                           static_cast<int>(header->dtype), " at offset ",
+                           offset);
+  }
+  const DType dtype = btf::ToDTypeKind(header->dtype);
+
+  const uint64_t rank = header->rank;
+  const uint64_t dims_offset = offset + sizeof(btf::TensorHeader);
+  if (rank > (size - dims_offset) / sizeof(Index)) {
+    return MakeStringError("failed to read tensor dims at offset ", offset);
+  }
+  ArrayRef<Index> dims(reinterpret_cast<const Index*>(data + dims_offset),
+                       rank);
+
+  int64_t num_bytes = GetHostSize(dtype);
+  for (Index dim : dims) {
+    if (dim < 0 || llvm::MulOverflow<int64_t>(num_bytes, dim, num_bytes)) {
+      return MakeStringError("invalid tensor dims at offset ", offset);
+    }
+  }
+  const uint64_t data_offset = dims_offset + rank * sizeof(Index);
+  if (static_cast<uint64_t>(num_bytes) > size - data_offset) {
+    return MakeStringError("failed to read tensor data at offset ", offset);
+  }
+  if (reinterpret_cast<uintptr_t>(data + data_offset) %
+          GetHostAlignment(dtype) !=
+      0) {
+    return MakeStringError("misaligned tensor data at offset ", offset);
+  }
+
+  auto tensor_data =
+      HostBuffer::CreateFromExternal(buffer_.CopyRef(), data_offset, num_bytes);
+  return DenseHostTensor(TensorMetadata(dtype, TensorShape(dims)),
+                         std::move(tensor_data));
+}
+
 }  // namespace tfrt
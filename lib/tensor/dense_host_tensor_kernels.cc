@@ -39,7 +39,7 @@ template <typename T, size_t Rank>
 static Expected<DenseHostTensor> CreateUninitializedDenseTensor(
     ArrayAttribute<Index> shape_in, const ExecutionContext& exec_ctx) {
   auto result = DenseHostTensor::CreateUninitialized<T>(
-      TensorShape(shape_in.data()), exec_ctx.host());
+      TensorShape(shape_in.data()), exec_ctx.allocator());
   if (!result.has_value()) {
     return MakeStringError("Cannot allocate tensor");
   }
@@ -85,7 +85,7 @@ static Expected<DenseHostTensor> CreateDenseTensor(
     ArrayAttribute<Index> shape, ArrayAttribute<T> values,
     const ExecutionContext& exec_ctx) {
   auto result = DenseHostTensor::CreateUninitialized<T>(
-      TensorShape(shape.data()), exec_ctx.host());
+      TensorShape(shape.data()), exec_ctx.allocator());
   if (!result.has_value()) {
     return MakeStringError("Cannot allocate tensor");
   }
@@ -0,0 +1,341 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements a low overhead tracing sink, which records activities
+// into preallocated per-thread ring buffers and dumps them to a binary trace
+// file when tracing is disabled. The trace file is written to the path in the
+// TFRT_TRACE_FILE environment variable, or to trace.tfrt_trace in the
+// undeclared test outputs directory or in the working directory. Use the
+// trace_to_json tool to convert it to the Chrome trace event format.
+//
+// Names are interned, first in a per-thread cache and then in a global table,
+// and timestamps are read from the time stamp counter where available. Each
+// thread keeps the last kRecordsPerThread - 1 activities. Activities with
+// static names (TFRT_TRACE_STATIC_SCOPE) are recorded without building a
+// std::string, and their names are looked up by address.
+//
+// Usage: replace simple_tracing_sink dependency of bef_executor target with
+// ring_buffer_tracing_sink and run with --enable_tracing.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/logging.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+#include "tfrt/tracing/trace_file.h"
+#include "tfrt/tracing/tracing.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace tfrt {
+namespace tracing {
+namespace {
+
+constexpr size_t kRecordsPerThread = size_t{1} << 16;
+
+// Returns the current time in ticks of the trace clock.
+uint64_t ReadTimestamp() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  uint64_t ticks;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+  return ticks;
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+// A recorded activity. The fields are atomics so that a trace dump racing with
+// a scope that ends after tracing is disabled is well defined. They are only
+// written by the thread owning the buffer, with relaxed stores.
+struct Record {
+  std::atomic<uint64_t> begin;
+  std::atomic<uint64_t> end;
+  std::atomic<uint32_t> name_id;
+  std::atomic<bool> instant;
+};
+
+// The global table of interned names.
+class NameTable {
+ public:
+  uint32_t Intern(llvm::StringRef name) {
+    mutex_lock lock(mu_);
+    auto it = ids_.try_emplace(name, names_.size());
+    if (it.second) names_.push_back(name.str());
+    return it.first->second;
+  }
+
+  std::vector<std::string> GetNames() const {
+    mutex_lock lock(mu_);
+    return names_;
+  }
+
+ private:
+  mutable mutex mu_;
+  llvm::StringMap<uint32_t> ids_ TFRT_GUARDED_BY(mu_);
+  std::vector<std::string> names_ TFRT_GUARDED_BY(mu_);
+};
+
+// The ring buffer of a thread. Only the dump reads it from other threads.
+class ThreadBuffer {
+ public:
+  ThreadBuffer(uint32_t thread_id, NameTable* name_table)
+      : thread_id_(thread_id),
+        name_table_(name_table),
+        records_(new Record[kRecordsPerThread]) {}
+
+  uint32_t Intern(llvm::StringRef name) {
+    auto it = name_ids_.find(name);
+    if (it != name_ids_.end()) return it->second;
+    uint32_t id = name_table_->Intern(name);
+    name_ids_.try_emplace(name, id);
+    return id;
+  }
+
+  // Same as above, for a name with static storage duration, which is looked
+  // up by address instead of hashing its characters.
+  uint32_t InternStatic(llvm::StringRef name) {
+    auto it = static_name_ids_.find(name.data());
+    if (it != static_name_ids_.end()) return it->second;
+    uint32_t id = Intern(name);
+    static_name_ids_.try_emplace(name.data(), id);
+    return id;
+  }
+
+  void PushScope(uint32_t name_id) {
+    stack_.push_back({name_id, ReadTimestamp()});
+  }
+
+  void PopScope() {
+    if (stack_.empty()) return;
+    uint64_t end = ReadTimestamp();
+    Write(stack_.back().begin, end, stack_.back().name_id, false);
+    stack_.pop_back();
+  }
+
+  void RecordEvent(uint32_t name_id) {
+    uint64_t now = ReadTimestamp();
+    Write(now, now, name_id, true);
+  }
+
+  // Returns the activities that started at or after `start`, relative to it.
+  TraceThread Read(uint64_t start) const;
+
+ private:
+  struct Scope {
+    uint32_t name_id;
+    uint64_t begin;
+  };
+
+  void Write(uint64_t begin, uint64_t end, uint32_t name_id, bool instant) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    // Orders the store of `head` by the previous write before the stores to
+    // the record, so that a reader that sees any of them also sees `head`.
+    std::atomic_thread_fence(std::memory_order_release);
+    Record& record = records_[head % kRecordsPerThread];
+    record.begin.store(begin, std::memory_order_relaxed);
+    record.end.store(end, std::memory_order_relaxed);
+    record.name_id.store(name_id, std::memory_order_relaxed);
+    record.instant.store(instant, std::memory_order_relaxed);
+    head_.store(head + 1, std::memory_order_release);
+  }
+
+  const uint32_t thread_id_;
+  NameTable* const name_table_;
+  const std::unique_ptr<Record[]> records_;
+  // The number of records written so far.
+  std::atomic<uint64_t> head_{0};
+
+  // Accessed by the owning thread only.
+  llvm::StringMap<uint32_t> name_ids_;
+  llvm::DenseMap<const char*, uint32_t> static_name_ids_;
+  llvm::SmallVector<Scope, 16> stack_;
+};
+
+TraceThread ThreadBuffer::Read(uint64_t start) const {
+  TraceThread thread;
+  thread.thread_id = thread_id_;
+
+  // The owning thread writes record `head` next, to the slot of record
+  // `head - kRecordsPerThread`, which is therefore not read.
+  uint64_t head = head_.load(std::memory_order_acquire);
+  uint64_t first =
+      head >= kRecordsPerThread ? head - kRecordsPerThread + 1 : 0;
+  std::vector<TraceEvent> events;
+  events.reserve(head - first);
+  for (uint64_t i = first; i < head; ++i) {
+    const Record& record = records_[i % kRecordsPerThread];
+    TraceEvent event;
+    event.begin = record.begin.load(std::memory_order_relaxed);
+    event.end = record.end.load(std::memory_order_relaxed);
+    event.name_id = record.name_id.load(std::memory_order_relaxed);
+    event.instant = record.instant.load(std::memory_order_relaxed);
+    events.push_back(event);
+  }
+
+  // Drop the records that the owning thread may have overwritten while they
+  // were read. Record `i` is overwritten by the write of record
+  // `i + kRecordsPerThread`, which may be in progress once `new_head` reaches
+  // it.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  uint64_t new_head = head_.load(std::memory_order_relaxed);
+  uint64_t num_overwritten =
+      new_head >= first + kRecordsPerThread
+          ? std::min(new_head - first - kRecordsPerThread + 1, head - first)
+          : 0;
+
+  for (size_t i = num_overwritten; i < events.size(); ++i) {
+    TraceEvent& event = events[i];
+    if (event.begin < start) continue;
+    event.begin -= start;
+    event.end -= start;
+    thread.events.push_back(event);
+  }
+  return thread;
+}
+
+class RingBufferTracingSink : public TracingSink {
+ public:
+  Error RequestTracing(bool enable) override;
+
+  void RecordTracingEvent(NameGenerator gen_name) override {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    buffer.RecordEvent(buffer.Intern(gen_name()));
+  }
+
+  void PushTracingScope(NameGenerator gen_name) override {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    buffer.PushScope(buffer.Intern(gen_name()));
+  }
+
+  void RecordStaticTracingEvent(string_view name) override {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    buffer.RecordEvent(buffer.InternStatic(name));
+  }
+
+  void PushStaticTracingScope(string_view name) override {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    buffer.PushScope(buffer.InternStatic(name));
+  }
+
+  void PopTracingScope() override { GetThreadBuffer().PopScope(); }
+
+ private:
+  ThreadBuffer& GetThreadBuffer() {
+    static thread_local ThreadBuffer* buffer = nullptr;
+    if (LLVM_UNLIKELY(buffer == nullptr)) buffer = NewThreadBuffer();
+    return *buffer;
+  }
+
+  ThreadBuffer* NewThreadBuffer() {
+    mutex_lock lock(mu_);
+    buffers_.push_back(
+        std::make_unique<ThreadBuffer>(buffers_.size(), &name_table_));
+    return buffers_.back().get();
+  }
+
+  Error WriteTrace();
+
+  NameTable name_table_;
+
+  // The trace clock and the steady clock when tracing was enabled, to convert
+  // ticks to nanoseconds.
+  uint64_t start_ticks_ = 0;
+  std::chrono::steady_clock::time_point start_time_;
+
+  mutex mu_;
+  // Buffers are never freed, so that the activities of exited threads are
+  // still dumped.
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers_ TFRT_GUARDED_BY(mu_);
+};
+
+Error RingBufferTracingSink::RequestTracing(bool enable) {
+  if (enable) {
+    start_time_ = std::chrono::steady_clock::now();
+    start_ticks_ = ReadTimestamp();
+    return Error::success();
+  }
+  return WriteTrace();
+}
+
+Error RingBufferTracingSink::WriteTrace() {
+  TraceFile trace;
+
+  auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start_time_)
+                        .count();
+  uint64_t elapsed_ticks = ReadTimestamp() - start_ticks_;
+  if (elapsed_ticks > 0 && elapsed_ns > 0)
+    trace.ns_per_tick = static_cast<double>(elapsed_ns) / elapsed_ticks;
+
+  {
+    mutex_lock lock(mu_);
+    for (const auto& buffer : buffers_) {
+      TraceThread thread = buffer->Read(start_ticks_);
+      if (!thread.events.empty()) trace.threads.push_back(std::move(thread));
+    }
+  }
+  // Read the names last, so that they include the names of all the events.
+  trace.names = name_table_.GetNames();
+
+  std::string path;
+  if (const char* file = std::getenv("TFRT_TRACE_FILE")) {
+    path = file;
+  } else if (const char* dir = std::getenv("TEST_UNDECLARED_OUTPUTS_DIR")) {
+    path = dir + std::string("/trace.tfrt_trace");
+  } else {
+    path = "trace.tfrt_trace";
+  }
+
+  std::error_code error_code;
+  llvm::raw_fd_ostream os(path, error_code);
+  if (error_code)
+    return MakeStringError("Failed to open ", path, ": ", error_code.message());
+  WriteTraceFile(trace, os);
+  os.close();
+  if (os.has_error())
+    return MakeStringError("Failed to write ", path, ": ",
+                           os.error().message());
+  TFRT_LOG(INFO) << "Wrote trace to " << path;
+  return Error::success();
+}
+
+}  // namespace
+
+static const bool kRegisterTracingSink = []() {
+  RegisterTracingSink(new RingBufferTracingSink);
+  return true;
+}();
+
+}  // namespace tracing
+}  // namespace tfrt
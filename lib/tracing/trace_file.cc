@@ -0,0 +1,186 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the binary trace format and its conversion to the
+// Chrome trace event format.
+
+#include "tfrt/tracing/trace_file.h"
+
+#include <cstring>
+#include <type_traits>
+
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/support/error_util.h"
+
+namespace tfrt {
+namespace tracing {
+namespace {
+
+constexpr char kMagic[8] = {'T', 'F', 'R', 'T', 'T', 'R', 'C', '\0'};
+constexpr uint32_t kVersion = 1;
+
+// Event flags.
+constexpr uint32_t kInstant = 1;
+
+template <typename T>
+void Write(raw_ostream& os, T value) {
+  static_assert(std::is_trivially_copyable<T>::value, "");
+  os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Reads values from a binary trace, checking the bounds.
+class Reader {
+ public:
+  explicit Reader(llvm::StringRef data) : data_(data) {}
+
+  template <typename T>
+  bool Read(T* value) {
+    static_assert(std::is_trivially_copyable<T>::value, "");
+    if (data_.size() < sizeof(T)) return false;
+    std::memcpy(value, data_.data(), sizeof(T));
+    data_ = data_.drop_front(sizeof(T));
+    return true;
+  }
+
+  bool Read(size_t size, llvm::StringRef* value) {
+    if (data_.size() < size) return false;
+    *value = data_.take_front(size);
+    data_ = data_.drop_front(size);
+    return true;
+  }
+
+  size_t remaining() const { return data_.size(); }
+
+ private:
+  llvm::StringRef data_;
+};
+
+// Chrome trace timestamps are in microseconds.
+double ToMicroseconds(const TraceFile& trace, uint64_t ticks) {
+  return ticks * trace.ns_per_tick * 1e-3;
+}
+
+}  // namespace
+
+void WriteTraceFile(const TraceFile& trace, raw_ostream& os) {
+  os.write(kMagic, sizeof(kMagic));
+  Write<uint32_t>(os, kVersion);
+  Write<uint32_t>(os, 0);
+  Write<double>(os, trace.ns_per_tick);
+
+  Write<uint32_t>(os, trace.names.size());
+  for (const std::string& name : trace.names) {
+    Write<uint32_t>(os, name.size());
+    os << name;
+  }
+
+  Write<uint32_t>(os, trace.threads.size());
+  for (const TraceThread& thread : trace.threads) {
+    Write<uint32_t>(os, thread.thread_id);
+    Write<uint64_t>(os, thread.events.size());
+    for (const TraceEvent& event : thread.events) {
+      Write<uint64_t>(os, event.begin);
+      Write<uint64_t>(os, event.end);
+      Write<uint32_t>(os, event.name_id);
+      Write<uint32_t>(os, event.instant ? kInstant : 0);
+    }
+  }
+}
+
+Expected<TraceFile> ReadTraceFile(llvm::StringRef data) {
+  Reader reader(data);
+  TraceFile trace;
+
+  llvm::StringRef magic;
+  uint32_t version, reserved;
+  if (!reader.Read(sizeof(kMagic), &magic) ||
+      magic != llvm::StringRef(kMagic, sizeof(kMagic)))
+    return MakeStringError("Invalid trace file: bad magic number");
+  if (!reader.Read(&version) || !reader.Read(&reserved) ||
+      !reader.Read(&trace.ns_per_tick))
+    return MakeStringError("Invalid trace file: truncated header");
+  if (version != kVersion)
+    return MakeStringError("Unsupported trace file version: ", version);
+
+  uint32_t num_names;
+  if (!reader.Read(&num_names))
+    return MakeStringError("Invalid trace file: missing name count");
+  for (uint32_t i = 0; i < num_names; ++i) {
+    uint32_t size;
+    llvm::StringRef name;
+    if (!reader.Read(&size) || !reader.Read(size, &name))
+      return MakeStringError("Invalid trace file: truncated name ", i);
+    trace.names.push_back(name.str());
+  }
+
+  uint32_t num_threads;
+  if (!reader.Read(&num_threads))
+    return MakeStringError("Invalid trace file: missing thread count");
+  for (uint32_t i = 0; i < num_threads; ++i) {
+    TraceThread thread;
+    uint64_t num_events;
+    if (!reader.Read(&thread.thread_id) || !reader.Read(&num_events))
+      return MakeStringError("Invalid trace file: truncated thread ", i);
+    // Each event takes 24 bytes, check before reserving the memory.
+    if (num_events > reader.remaining() / 24)
+      return MakeStringError("Invalid trace file: truncated events");
+    thread.events.reserve(num_events);
+    for (uint64_t j = 0; j < num_events; ++j) {
+      TraceEvent event;
+      uint32_t flags;
+      if (!reader.Read(&event.begin) || !reader.Read(&event.end) ||
+          !reader.Read(&event.name_id) || !reader.Read(&flags))
+        return MakeStringError("Invalid trace file: truncated events");
+      if (event.name_id >= trace.names.size())
+        return MakeStringError("Invalid trace file: bad name id ",
+                               event.name_id);
+      event.instant = flags & kInstant;
+      thread.events.push_back(event);
+    }
+    trace.threads.push_back(std::move(thread));
+  }
+  return trace;
+}
+
+void WriteChromeTraceJson(const TraceFile& trace, raw_ostream& os) {
+  llvm::json::OStream json(os);
+  json.object([&] {
+    json.attributeArray("traceEvents", [&] {
+      for (const TraceThread& thread : trace.threads) {
+        for (const TraceEvent& event : thread.events) {
+          json.object([&] {
+            json.attribute("name", trace.names[event.name_id]);
+            json.attribute("pid", 0);
+            json.attribute("tid", static_cast<int64_t>(thread.thread_id));
+            json.attribute("ts", ToMicroseconds(trace, event.begin));
+            if (event.instant) {
+              json.attribute("ph", "i");
+              json.attribute("s", "t");
+            } else {
+              json.attribute("ph", "X");
+              json.attribute("dur",
+                             ToMicroseconds(trace, event.end - event.begin));
+            }
+          });
+        }
+      }
+    });
+    json.attribute("displayTimeUnit", "ns");
+  });
+  os << "\n";
+}
+
+}  // namespace tracing
+}  // namespace tfrt
@@ -21,6 +21,7 @@
 #include <atomic>
 #include <cassert>
 #include <mutex>
+#include <string>
 #include <utility>
 
 #include "llvm/ADT/StringSwitch.h"
@@ -33,6 +34,14 @@ namespace tracing {
 
 TracingSink::~TracingSink() = default;
 
+void TracingSink::RecordStaticTracingEvent(string_view name) {
+  RecordTracingEvent([&] { return std::string(name); });
+}
+
+void TracingSink::PushStaticTracingScope(string_view name) {
+  PushTracingScope([&] { return std::string(name); });
+}
+
 raw_ostream& operator<<(raw_ostream& os, TracingLevel level) {
   switch (level) {
     case TracingLevel::None:
@@ -0,0 +1,37 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: printf "%s\t30\t3\t10\t2500\n%s\t32\t3\t10\t10\n" > %t.profile
+// RUN: tfrt_opt -tfrt-apply-cost-profile="profile=%t.profile" %s | FileCheck %s
+
+// CHECK-LABEL: func @profiled
+func.func @profiled(%a: i32) -> i32 {
+  // The first kernel takes 2500ns, which is rounded up to 3 cost units. The
+  // second kernel is cheaper than one cost unit. The third kernel is not in the
+  // profile.
+
+  // CHECK: tfrt.add.i32
+  // CHECK-SAME: _tfrt_cost = 3
+  // CHECK: tfrt.add.i32
+  // CHECK-SAME: _tfrt_cost = 1
+  // CHECK: tfrt.add.i32
+  // CHECK-NOT: _tfrt_cost
+  %x = "tfrt.add.i32"(%a, %a) : (i32, i32) -> i32
+
+  %y = "tfrt.add.i32"(%x, %a) : (i32, i32) -> i32
+
+  %z = "tfrt.add.i32"(%y, %a) : (i32, i32) -> i32
+
+  tfrt.return %z : i32
+}
@@ -0,0 +1,36 @@
+// Copyright 2022 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: tfrt_opt -tfrt-print-critical-path -verify-diagnostics %s
+
+module attributes {tfrt.cost_threshold = 1 : i64} {
+
+// expected-remark@+1 {{critical path cost: 13}}
+func.func @critical_path(%ch0: i32) -> i32 {
+  // critical path = 1 (root) + 10 (%a) + 1 (%d) + 1 (return)
+
+  // expected-remark@+1 {{critical path cost: 12}}
+  %a = tfrt_test.test_cost %ch0 {id = 0 : i64, _tfrt_cost = 10 : i64} : i32
+  // %b is cheaper than %a, but it is followed by %c on the way to %d.
+  // expected-remark@+1 {{critical path cost: 7}}
+  %b = tfrt_test.test_cost %ch0 {id = 1 : i64, _tfrt_cost = 2 : i64} : i32
+  // expected-remark@+1 {{critical path cost: 5}}
+  %c = tfrt_test.test_cost %b {id = 2 : i64, _tfrt_cost = 3 : i64} : i32
+  // expected-remark@+1 {{critical path cost: 2}}
+  %d = "tfrt.add.i32"(%a, %c) : (i32, i32) -> i32
+  // expected-remark@+1 {{critical path cost: 1}}
+  tfrt.return %d : i32
+}
+
+}
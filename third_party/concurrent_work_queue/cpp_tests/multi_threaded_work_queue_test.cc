@@ -5,13 +5,17 @@
 // Unit tests and benchmarks for MultiThreadedWorkQueue.
 
 #include <atomic>
+#include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/support/latch.h"
 
 namespace tfrt {
 namespace {
@@ -50,5 +54,99 @@ TEST(MultiThreadedWorkQueueTest, PingPong) {
   ASSERT_EQ(last_executed_task, num_tasks - 1);
 }
 
+TEST(MultiThreadedWorkQueueTest, PinToNumaNodes) {
+  MultiThreadedWorkQueueOptions options;
+  options.pin_to_numa_nodes = true;
+  auto host = std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateNumaAllocator(),
+      CreateMultiThreadedWorkQueue(4, 4, options));
+
+  std::atomic<int64_t> num_executed_tasks = 0;
+  const int64_t num_tasks = 10000;
+
+  // Tasks are submitted both from the caller thread and from worker threads.
+  for (int64_t i = 0; i < num_tasks / 2; ++i) {
+    EnqueueWork(host.get(), [&]() {
+      ++num_executed_tasks;
+      EnqueueWork(host.get(), [&]() { ++num_executed_tasks; });
+    });
+  }
+
+  host->Quiesce();
+  ASSERT_EQ(num_executed_tasks, num_tasks);
+}
+
+TEST(MultiThreadedWorkQueueTest, RequestPriorities) {
+  MultiThreadedWorkQueueOptions options;
+  options.request_priorities = true;
+  auto host = std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(1, 1, options));
+
+  auto create_exec_ctx = [&](int priority) {
+    RequestOptions request_options;
+    request_options.priority = priority;
+    auto request_ctx = RequestContextBuilder(host.get(), nullptr)
+                           .set_request_options(request_options)
+                           .build();
+    return ExecutionContext(std::move(*request_ctx));
+  };
+
+  // Keep the only worker thread busy while the tasks are enqueued.
+  tfrt::latch started(1);
+  tfrt::latch release(1);
+  EnqueueWork(host.get(), [&]() {
+    started.count_down();
+    release.wait();
+  });
+  started.wait();
+
+  std::vector<int> order;
+  tfrt::latch done(3);
+  for (int priority : {-1, 0, 2}) {
+    EnqueueWork(create_exec_ctx(priority), [&, priority]() {
+      order.push_back(priority);
+      done.count_down();
+    });
+  }
+
+  release.count_down();
+  done.wait();
+  EXPECT_EQ(order, std::vector<int>({2, 0, -1}));
+}
+
+TEST(MultiThreadedWorkQueueTest, NumIdleWorkers) {
+  auto host = CreateTestHostContext(2);
+  host->Quiesce();
+  EXPECT_EQ(host->work_queue().GetNumIdleWorkers(), 2);
+
+  // A worker running a task is not idle.
+  tfrt::latch started(1);
+  tfrt::latch release(1);
+  EnqueueWork(host.get(), [&]() {
+    started.count_down();
+    release.wait();
+  });
+  started.wait();
+  EXPECT_LE(host->work_queue().GetNumIdleWorkers(), 1);
+
+  release.count_down();
+  host->Quiesce();
+  EXPECT_EQ(host->work_queue().GetNumIdleWorkers(), 2);
+}
+
+TEST(MultiThreadedWorkQueueTest, CreateWithOptions) {
+  auto work_queue =
+      CreateWorkQueue("mstd:2,2,spinning_threads=2,adaptive_spinning=1");
+  ASSERT_NE(work_queue, nullptr);
+  EXPECT_EQ(work_queue->GetParallelismLevel(), 2);
+  EXPECT_NE(work_queue->name().find("adaptive spinning"), std::string::npos);
+
+  EXPECT_NE(CreateWorkQueue("mstd:2,2,spin_count=0,stats=1"), nullptr);
+  EXPECT_EQ(CreateWorkQueue("mstd:2,2,unknown=1"), nullptr);
+  EXPECT_EQ(CreateWorkQueue("mstd:spin_count=0,2"), nullptr);
+  EXPECT_EQ(CreateWorkQueue("mstd:2,2,2"), nullptr);
+}
+
 }  // namespace
 }  // namespace tfrt
@@ -6,16 +6,157 @@
 
 #include "non_blocking_work_queue.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "benchmark/benchmark.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "llvm/Support/raw_ostream.h"
 #include "tfrt/host_context/task_function.h"
+#include "tfrt/metrics/local_metrics_registry.h"
+#include "tfrt/metrics/metrics_registry.h"
 #include "tfrt/support/latch.h"
+#include "tfrt/support/numa.h"
 #include "tfrt/support/thread_environment.h"
 
 namespace tfrt {
 namespace {
 
+using ::testing::HasSubstr;
+using ::testing::Not;
+
 using WorkQueue = ::tfrt::internal::NonBlockingWorkQueue<ThreadingEnvironment>;
 
+// A burst of tasks submitted by a worker thread overflows its pending tasks
+// queue, and must not be executed inline in the worker thread.
+TEST(NonBlockingWorkQueueTest, BurstIsNotExecutedInline) {
+  auto qstate = std::make_unique<internal::QuiescingState>();
+  WorkQueue queue(qstate.get(), 4);
+
+  constexpr int kNumTasks = 100000;
+  // Tasks and the producer count down the latch.
+  ::tfrt::latch latch(kNumTasks + 1);
+  std::atomic<bool> producing = false;
+  std::atomic<int> num_inline = 0;
+
+  queue.AddTask(TaskFunction([&]() {
+    thread_local bool is_producer = false;
+    is_producer = true;
+    producing = true;
+    for (int i = 0; i < kNumTasks; ++i) {
+      queue.AddTask(TaskFunction([&]() {
+        if (is_producer && producing) num_inline.fetch_add(1);
+        latch.count_down();
+      }));
+    }
+    producing = false;
+    is_producer = false;
+    latch.count_down();
+  }));
+
+  latch.wait();
+  EXPECT_EQ(num_inline.load(), 0);
+}
+
+TEST(NonBlockingWorkQueueTest, AdaptiveSpinCount) {
+  internal::AdaptiveSpinCount fixed(1600, /*adaptive=*/false);
+  for (int i = 0; i < 100; ++i) fixed.Record(true);
+  EXPECT_EQ(fixed.Get(), 1600);
+
+  internal::AdaptiveSpinCount adaptive(1600, /*adaptive=*/true);
+  EXPECT_EQ(adaptive.Get(), 1600);
+  for (int i = 0; i < 100; ++i) adaptive.Record(true);
+  EXPECT_GT(adaptive.Get(), 6000);
+  EXPECT_LE(adaptive.Get(), 4 * 1600);
+  for (int i = 0; i < 100; ++i) adaptive.Record(false);
+  EXPECT_GE(adaptive.Get(), 1600 / 16);
+  EXPECT_LT(adaptive.Get(), 200);
+}
+
+TEST(NonBlockingWorkQueueTest, NoSpinning) {
+  auto qstate = std::make_unique<internal::QuiescingState>();
+  internal::WorkerOptions options;
+  options.max_spinning_threads = 0;
+  WorkQueue queue(qstate.get(), 4, options);
+
+  constexpr int kNumTasks = 1000;
+  ::tfrt::latch latch(kNumTasks);
+  for (int i = 0; i < kNumTasks; ++i) {
+    queue.AddTask(TaskFunction([&]() { latch.count_down(); }));
+    // Let the worker threads run out of work and park.
+    if (i % 100 == 0)
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+  latch.wait();
+}
+
+TEST(NonBlockingWorkQueueTest, TopologyAwareStealing) {
+  // CPUs sharing a cache are adjacent in the topology order.
+  llvm::ArrayRef<CpuTopology> cpus = GetCpuTopology();
+  for (size_t i = 1; i < cpus.size(); ++i) {
+    EXPECT_LE(cpus[i - 1].package_id, cpus[i].package_id);
+    if (cpus[i - 1].package_id == cpus[i].package_id)
+      EXPECT_LE(cpus[i - 1].l3_id, cpus[i].l3_id);
+  }
+
+  auto qstate = std::make_unique<internal::QuiescingState>();
+  internal::WorkerOptions options;
+  options.topology_aware_stealing = true;
+  WorkQueue queue(qstate.get(), 8, options);
+
+  // Tasks submitted by a worker thread are stolen by the other workers.
+  constexpr int kNumTasks = 10000;
+  ::tfrt::latch latch(kNumTasks);
+  queue.AddTask(TaskFunction([&]() {
+    for (int i = 0; i < kNumTasks; ++i)
+      queue.AddTask(TaskFunction([&]() { latch.count_down(); }));
+  }));
+  latch.wait();
+}
+
+TEST(NonBlockingWorkQueueTest, CollectStats) {
+  static auto* registry = new metrics::LocalMetricsRegistry();
+  metrics::RegisterMetricsRegistry(registry);
+
+  constexpr int kNumTasks = 1000;
+  {
+    auto qstate = std::make_unique<internal::QuiescingState>();
+    internal::WorkerOptions options;
+    options.collect_stats = true;
+    WorkQueue queue(qstate.get(), 4, options);
+
+    ::tfrt::latch latch(kNumTasks);
+    for (int i = 0; i < kNumTasks; ++i)
+      queue.AddTask(TaskFunction([&]() { latch.count_down(); }));
+    latch.wait();
+    // Worker threads export their remaining statistics when they exit.
+  }
+
+  std::string text;
+  llvm::raw_string_ostream os(text);
+  registry->WritePrometheusText(os);
+
+  const std::string prefix =
+      "tensorflow_runtime_work_queue_tfrt_non_blocking_queue_";
+  EXPECT_THAT(text, HasSubstr(prefix + "tasks_executed " +
+                              std::to_string(kNumTasks) + "\n"));
+  EXPECT_THAT(text, HasSubstr(prefix + "steals "));
+  EXPECT_THAT(text, HasSubstr(prefix + "parks "));
+  EXPECT_THAT(text, HasSubstr(prefix + "parked_time_ns "));
+  // Every worker thread samples its queue depth before parking.
+  EXPECT_THAT(text, HasSubstr(prefix + "queue_depth_0 "));
+  EXPECT_THAT(text, HasSubstr(prefix + "queue_depth_3 "));
+  // The first task added by a thread is always sampled.
+  EXPECT_THAT(text, HasSubstr(prefix + "task_latency_us_count "));
+  EXPECT_THAT(text, Not(HasSubstr(prefix + "task_latency_us_count 0\n")));
+}
+
 // Benchmark work queue throughput.
 //
 // Submit `num_producers` tasks to `producer` work queue, each submitting
@@ -78,5 +219,63 @@ BM_NoOp(8, 8);
 BM_NoOp(16, 16);
 BM_NoOp(32, 32);
 
+// Bursts that overflow the pending tasks queue of a single producer.
+BM_Run(NoOp, 1, 8)->ArgPair(1, 100000);
+
+// The overhead of the statistics collection.
+static void BM_NoOp_tpool_8x8_WithStats(benchmark::State& state) {
+  auto qstate = std::make_unique<internal::QuiescingState>();
+  WorkQueue producer(qstate.get(), 8);
+  internal::WorkerOptions options;
+  options.collect_stats = true;
+  WorkQueue worker(qstate.get(), 8, options);
+  NoOp(producer, worker, state);
+}
+BENCHMARK(BM_NoOp_tpool_8x8_WithStats)
+    ->UseRealTime()
+    ->ArgPair(10, 1000)
+    ->ArgPair(100, 1000);
+
+// Benchmark the latency of tasks added to an idle work queue.
+//
+// The benchmark thread adds a task and waits for its start, then leaves the
+// work queue idle for `idle_us` microseconds. Reports the p50 and p99 latency
+// from adding a task to its start, with `mode` 0 (no spinning), 1 (default
+// spinning) or 2 (adaptive spinning).
+void BM_PingPong(benchmark::State& state) {
+  const int mode = state.range(0);
+  const auto idle_time = std::chrono::microseconds(state.range(1));
+
+  internal::WorkerOptions options;
+  if (mode == 0) options.max_spinning_threads = 0;
+  if (mode == 2) options.adaptive_spinning = true;
+
+  auto qstate = std::make_unique<internal::QuiescingState>();
+  WorkQueue queue(qstate.get(), 4, options);
+
+  std::vector<double> latencies;
+  for (auto _ : state) {
+    std::atomic<bool> started = false;
+    auto start = std::chrono::steady_clock::now();
+    queue.AddTask(TaskFunction([&]() { started = true; }));
+    while (!started) {
+    }
+    std::chrono::duration<double> latency =
+        std::chrono::steady_clock::now() - start;
+    state.SetIterationTime(latency.count());
+    latencies.push_back(latency.count() * 1e6);
+
+    if (idle_time.count() > 0) std::this_thread::sleep_for(idle_time);
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  state.counters["p50_us"] = latencies[latencies.size() / 2];
+  state.counters["p99_us"] = latencies[latencies.size() * 99 / 100];
+}
+
+BENCHMARK(BM_PingPong)
+    ->UseManualTime()
+    ->ArgsProduct({{0, 1, 2}, {0, 20, 200}});
+
 }  // namespace
 }  // namespace tfrt
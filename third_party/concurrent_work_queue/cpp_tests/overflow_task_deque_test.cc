@@ -0,0 +1,220 @@
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Unit tests and benchmarks for OverflowTaskDeque and
+// OverflowTaskPriorityDeque.
+
+#include "overflow_task_deque.h"
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "task_deque.h"
+#include "tfrt/host_context/task_function.h"
+
+namespace tfrt {
+namespace {
+
+using OverflowTaskDeque = ::tfrt::internal::OverflowTaskDeque;
+using OverflowTaskPriorityDeque = ::tfrt::internal::OverflowTaskPriorityDeque;
+using TaskDeque = ::tfrt::internal::TaskDeque;
+
+// Helper class to create TaskFunction with an observable side effect.
+struct TaskFunctions {
+  TaskFunction Next(int value) {
+    return TaskFunction([this, value]() { this->value = value; });
+  }
+
+  int Run(std::optional<TaskFunction> task) {
+    if (!task.has_value()) return -1;
+    (*task)();
+    return value;
+  }
+
+  int value = -1;
+};
+
+TEST(OverflowTaskDequeTest, QueueCreatedEmpty) {
+  OverflowTaskDeque queue;
+
+  ASSERT_TRUE(queue.Empty());
+  ASSERT_EQ(queue.Size(), 0);
+
+  ASSERT_EQ(queue.PopFront(), std::nullopt);
+  ASSERT_EQ(queue.PopBack(), std::nullopt);
+}
+
+TEST(OverflowTaskDequeTest, PushFrontToOverflow) {
+  TaskFunctions fn;
+  OverflowTaskDeque queue;
+
+  const int num_tasks = 2 * TaskDeque::kCapacity;
+  for (int i = 0; i < num_tasks; ++i) queue.PushFront(fn.Next(i));
+  ASSERT_EQ(queue.Size(), num_tasks);
+
+  // Spilled tasks are popped from the back first.
+  for (int i = TaskDeque::kCapacity; i < num_tasks; ++i) {
+    ASSERT_EQ(fn.Run(queue.PopBack()), i);
+  }
+  for (int i = 0; i < TaskDeque::kCapacity; ++i) {
+    ASSERT_EQ(fn.Run(queue.PopBack()), i);
+  }
+  ASSERT_TRUE(queue.Empty());
+}
+
+TEST(OverflowTaskDequeTest, PushBackToOverflow) {
+  TaskFunctions fn;
+  OverflowTaskDeque queue;
+
+  const int num_tasks = 2 * TaskDeque::kCapacity;
+  for (int i = 0; i < num_tasks; ++i) queue.PushBack(fn.Next(i));
+  ASSERT_EQ(queue.Size(), num_tasks);
+
+  // Spilled tasks are popped from the front once the TaskDeque is empty.
+  for (int i = 0; i < num_tasks; ++i) {
+    ASSERT_EQ(fn.Run(queue.PopFront()), i);
+  }
+  ASSERT_TRUE(queue.Empty());
+}
+
+TEST(OverflowTaskDequeTest, Flush) {
+  OverflowTaskDeque queue;
+
+  for (int i = 0; i < 2 * TaskDeque::kCapacity; ++i) queue.PushFront({});
+  queue.Flush();
+  ASSERT_TRUE(queue.Empty());
+  ASSERT_EQ(queue.Size(), 0);
+}
+
+TEST(OverflowTaskPriorityDequeTest, PushFrontToOverflowWithPriority) {
+  using TaskPriority = ::tfrt::internal::TaskPriority;
+
+  TaskFunctions fn;
+  OverflowTaskPriorityDeque queue;
+
+  const int num_tasks = 2 * internal::TaskPriorityDeque::kCapacity;
+  for (int i = 0; i < num_tasks; ++i) {
+    queue.PushFront(fn.Next(i), TaskPriority::kLow);
+  }
+  queue.PushFront(fn.Next(-2), TaskPriority::kCritical);
+  ASSERT_EQ(queue.Size(), num_tasks + 1);
+
+  // The critical task is popped first, before the spilled tasks.
+  ASSERT_EQ(fn.Run(queue.PopFront()), -2);
+
+  // Spilled tasks are popped from the back first.
+  for (int i = internal::TaskPriorityDeque::kCapacity; i < num_tasks; ++i) {
+    ASSERT_EQ(fn.Run(queue.PopBack()), i);
+  }
+  for (int i = 0; i < internal::TaskPriorityDeque::kCapacity; ++i) {
+    ASSERT_EQ(fn.Run(queue.PopBack()), i);
+  }
+  ASSERT_TRUE(queue.Empty());
+}
+
+TEST(OverflowTaskPriorityDequeTest, SpilledTasksInPriorityOrder) {
+  using TaskPriority = ::tfrt::internal::TaskPriority;
+
+  TaskFunctions fn;
+  OverflowTaskPriorityDeque queue;
+
+  // Fill the low and critical priority levels, and spill one task into each.
+  const int capacity = internal::TaskPriorityDeque::kCapacity;
+  for (int i = 0; i < capacity; ++i) queue.PushBack({}, TaskPriority::kLow);
+  for (int i = 0; i < capacity; ++i) {
+    queue.PushBack({}, TaskPriority::kCritical);
+  }
+  queue.PushBack(fn.Next(1), TaskPriority::kLow);
+  queue.PushBack(fn.Next(2), TaskPriority::kCritical);
+
+  // Spilled tasks are stolen first, in the priority order.
+  ASSERT_EQ(fn.Run(queue.PopBack()), 2);
+  ASSERT_EQ(fn.Run(queue.PopBack()), 1);
+
+  queue.Flush();
+  ASSERT_TRUE(queue.Empty());
+}
+
+// Owner thread pushes a burst of tasks to the front of the queue while the
+// other threads steal from the back of the queue. All tasks must be executed
+// exactly once.
+TEST(OverflowTaskDequeTest, BurstWithConcurrentSteals) {
+  OverflowTaskDeque queue;
+
+  constexpr int kNumTasks = 100000;
+  constexpr int kNumThieves = 4;
+
+  auto executed = std::make_unique<std::atomic<int>[]>(kNumTasks);
+  for (int i = 0; i < kNumTasks; ++i) executed[i] = 0;
+  std::atomic<int> num_executed = 0;
+
+  auto run = [&](std::optional<TaskFunction> task) {
+    if (!task.has_value()) return;
+    (*task)();
+    num_executed.fetch_add(1);
+  };
+
+  std::vector<std::thread> thieves;
+  for (int i = 0; i < kNumThieves; ++i) {
+    thieves.emplace_back([&]() {
+      while (num_executed.load() < kNumTasks) run(queue.PopBack());
+    });
+  }
+
+  for (int i = 0; i < kNumTasks; ++i) {
+    queue.PushFront(TaskFunction([&, i]() { executed[i].fetch_add(1); }));
+    if (i % 16 == 0) run(queue.PopFront());
+  }
+  while (num_executed.load() < kNumTasks) run(queue.PopFront());
+
+  for (auto& thief : thieves) thief.join();
+
+  ASSERT_TRUE(queue.Empty());
+  for (int i = 0; i < kNumTasks; ++i) ASSERT_EQ(executed[i].load(), 1);
+}
+
+// Benchmark a burst of tasks pushed to the front of the queue by its owner.
+// With a TaskDeque, the tasks that do not fit into the queue are executed
+// inline (the previous NonBlockingWorkQueue behavior).
+void BM_TaskDequeBurst(benchmark::State& state) {
+  const int num_tasks = state.range(0);
+
+  TaskDeque queue;
+  int num_inline = 0;
+  for (auto _ : state) {
+    for (int i = 0; i < num_tasks; ++i) {
+      std::optional<TaskFunction> task = queue.PushFront({});
+      if (task.has_value()) ++num_inline;
+    }
+    while (queue.PopFront().has_value()) {
+    }
+  }
+
+  state.counters["inline"] = num_inline / state.iterations();
+  state.SetItemsProcessed(num_tasks * state.iterations());
+}
+
+void BM_OverflowTaskDequeBurst(benchmark::State& state) {
+  const int num_tasks = state.range(0);
+
+  OverflowTaskDeque queue;
+  for (auto _ : state) {
+    for (int i = 0; i < num_tasks; ++i) queue.PushFront({});
+    while (queue.PopFront().has_value()) {
+    }
+  }
+
+  state.SetItemsProcessed(num_tasks * state.iterations());
+}
+
+BENCHMARK(BM_TaskDequeBurst)->Arg(1000)->Arg(100000);
+BENCHMARK(BM_OverflowTaskDequeBurst)->Arg(1000)->Arg(100000);
+
+}  // namespace
+}  // namespace tfrt
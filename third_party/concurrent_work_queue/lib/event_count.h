@@ -154,7 +154,9 @@ class EventCount {
 
   // Notify wakes one or all waiting threads.
   // Must be called after changing the associated wait predicate.
-  void Notify(bool notify_all) {
+  // Returns true if a parked thread was unparked, and false if there was no
+  // waiter or only a thread in pre-wait state was unblocked.
+  bool Notify(bool notify_all) {
     std::atomic_thread_fence(std::memory_order_seq_cst);
     uint64_t state = state_.load(std::memory_order_acquire);
     for (;;) {
@@ -162,7 +164,8 @@ class EventCount {
       const uint64_t waiters = (state & kWaiterMask) >> kWaiterShift;
       const uint64_t signals = (state & kSignalMask) >> kSignalShift;
       // Easy case: no waiters.
-      if ((state & kStackMask) == kStackMask && waiters == signals) return;
+      if ((state & kStackMask) == kStackMask && waiters == signals)
+        return false;
       uint64_t newstate;
       if (notify_all) {
         // Empty wait stack and set signal to number of pre-wait threads.
@@ -181,12 +184,12 @@ class EventCount {
       if (state_.compare_exchange_weak(state, newstate,
                                        std::memory_order_acq_rel)) {
         if (!notify_all && (signals < waiters))
-          return;  // unblocked pre-wait thread
-        if ((state & kStackMask) == kStackMask) return;
+          return false;  // unblocked pre-wait thread
+        if ((state & kStackMask) == kStackMask) return false;
         Waiter* w = waiter(state & kStackMask);
         if (!notify_all) w->next.store(kStackMask, std::memory_order_relaxed);
         Unpark(w);
-        return;
+        return true;
       }
     }
   }
@@ -8,10 +8,12 @@
 #include <memory>
 #include <optional>
 #include <thread>
+#include <type_traits>
 
 #include "blocking_work_queue.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "non_blocking_work_queue.h"
+#include "overflow_task_deque.h"
 #include "tfrt/host_context/async_value.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/task_function.h"
@@ -22,19 +24,63 @@
 
 namespace tfrt {
 
+namespace {
+
+internal::WorkerOptions GetWorkerOptions(
+    const MultiThreadedWorkQueueOptions& options) {
+  internal::WorkerOptions worker_options;
+  worker_options.pin_to_numa_nodes = options.pin_to_numa_nodes;
+  worker_options.collect_stats = options.collect_stats;
+  worker_options.max_spinning_threads = options.max_spinning_threads;
+  worker_options.spin_count = options.spin_count;
+  worker_options.adaptive_spinning = options.adaptive_spinning;
+  worker_options.topology_aware_stealing = options.topology_aware_stealing;
+  return worker_options;
+}
+
+// Maps a request priority to the priority of its tasks.
+internal::TaskPriority GetTaskPriority(int request_priority) {
+  if (request_priority >= 2) return internal::TaskPriority::kCritical;
+  if (request_priority == 1) return internal::TaskPriority::kHigh;
+  if (request_priority == 0) return internal::TaskPriority::kDefault;
+  return internal::TaskPriority::kLow;
+}
+
+}  // namespace
+
+// `TaskQueue` is the type of the pending tasks queues of the non-blocking work
+// queue. Request priorities are supported if it is an
+// OverflowTaskPriorityDeque.
+template <typename TaskQueue>
 class MultiThreadedWorkQueue : public ConcurrentWorkQueue {
+  static constexpr bool kSupportsPriorities =
+      std::is_same_v<TaskQueue, internal::OverflowTaskPriorityDeque>;
+
  public:
-  MultiThreadedWorkQueue(int num_threads, int num_blocking_threads);
+  MultiThreadedWorkQueue(int num_threads, int num_blocking_threads,
+                         const MultiThreadedWorkQueueOptions& options);
   ~MultiThreadedWorkQueue() override;
 
   std::string name() const override {
     return StrCat("Multi-threaded C++ work queue (", num_threads_, " threads, ",
-                  num_blocking_threads_, " blocking threads)");
+                  num_blocking_threads_, " blocking threads",
+                  options_.pin_to_numa_nodes ? ", pinned to NUMA nodes" : "",
+                  kSupportsPriorities ? ", request priorities" : "",
+                  options_.collect_stats ? ", collecting stats" : "",
+                  options_.adaptive_spinning ? ", adaptive spinning" : "",
+                  options_.topology_aware_stealing
+                      ? ", topology-aware stealing"
+                      : "",
+                  ")");
   }
 
   int GetParallelismLevel() const final { return num_threads_; }
+  int GetNumIdleWorkers() const final {
+    return non_blocking_work_queue_.NumIdleThreads();
+  }
 
   void AddTask(TaskFunction task) final;
+  void AddTaskWithPriority(TaskFunction task, int priority) final;
   std::optional<TaskFunction> AddBlockingTask(TaskFunction task,
                                               bool allow_queuing) final;
   void Quiesce() final;
@@ -45,31 +91,51 @@ class MultiThreadedWorkQueue : public ConcurrentWorkQueue {
  private:
   const int num_threads_;
   const int num_blocking_threads_;
+  const MultiThreadedWorkQueueOptions options_;
 
   std::unique_ptr<internal::QuiescingState> quiescing_state_;
-  internal::NonBlockingWorkQueue<ThreadingEnvironment> non_blocking_work_queue_;
+  internal::NonBlockingWorkQueue<ThreadingEnvironment, TaskQueue>
+      non_blocking_work_queue_;
   internal::BlockingWorkQueue<ThreadingEnvironment> blocking_work_queue_;
 };
 
-MultiThreadedWorkQueue::MultiThreadedWorkQueue(int num_threads,
-                                               int num_blocking_threads)
+template <typename TaskQueue>
+MultiThreadedWorkQueue<TaskQueue>::MultiThreadedWorkQueue(
+    int num_threads, int num_blocking_threads,
+    const MultiThreadedWorkQueueOptions& options)
     : num_threads_(num_threads),
       num_blocking_threads_(num_blocking_threads),
+      options_(options),
       quiescing_state_(std::make_unique<internal::QuiescingState>()),
-      non_blocking_work_queue_(quiescing_state_.get(), num_threads),
+      non_blocking_work_queue_(quiescing_state_.get(), num_threads,
+                               GetWorkerOptions(options)),
       blocking_work_queue_(quiescing_state_.get(), num_blocking_threads) {}
 
-MultiThreadedWorkQueue::~MultiThreadedWorkQueue() {
+template <typename TaskQueue>
+MultiThreadedWorkQueue<TaskQueue>::~MultiThreadedWorkQueue() {
   // Pending tasks in the underlying queues might submit new tasks to each other
   // during destruction.
   Quiesce();
 }
 
-void MultiThreadedWorkQueue::AddTask(TaskFunction task) {
+template <typename TaskQueue>
+void MultiThreadedWorkQueue<TaskQueue>::AddTask(TaskFunction task) {
   non_blocking_work_queue_.AddTask(std::move(task));
 }
 
-std::optional<TaskFunction> MultiThreadedWorkQueue::AddBlockingTask(
+template <typename TaskQueue>
+void MultiThreadedWorkQueue<TaskQueue>::AddTaskWithPriority(TaskFunction task,
+                                                            int priority) {
+  if constexpr (kSupportsPriorities) {
+    non_blocking_work_queue_.AddTask(std::move(task),
+                                     GetTaskPriority(priority));
+  } else {
+    non_blocking_work_queue_.AddTask(std::move(task));
+  }
+}
+
+template <typename TaskQueue>
+std::optional<TaskFunction> MultiThreadedWorkQueue<TaskQueue>::AddBlockingTask(
     TaskFunction task, bool allow_queuing) {
   if (allow_queuing) {
     return blocking_work_queue_.EnqueueBlockingTask(std::move(task));
@@ -78,7 +144,8 @@ std::optional<TaskFunction> MultiThreadedWorkQueue::AddBlockingTask(
   }
 }
 
-void MultiThreadedWorkQueue::Quiesce() {
+template <typename TaskQueue>
+void MultiThreadedWorkQueue<TaskQueue>::Quiesce() {
   // Turn on pending tasks counter inside both work queues.
   auto quiescing = internal::Quiescing::Start(quiescing_state_.get());
 
@@ -98,7 +165,9 @@ void MultiThreadedWorkQueue::Quiesce() {
   }
 }
 
-void MultiThreadedWorkQueue::Await(ArrayRef<RCReference<AsyncValue>> values) {
+template <typename TaskQueue>
+void MultiThreadedWorkQueue<TaskQueue>::Await(
+    ArrayRef<RCReference<AsyncValue>> values) {
   // We might block on a latch waiting for the completion of all tasks, and
   // this is not allowed to do inside non blocking work queue.
   non_blocking_work_queue_.CheckCallerThread("MultiThreadedWorkQueue::Await",
@@ -116,15 +185,28 @@ void MultiThreadedWorkQueue::Await(ArrayRef<RCReference<AsyncValue>> values) {
   values_remaining.wait();
 }
 
-bool MultiThreadedWorkQueue::IsInWorkerThread() const {
+template <typename TaskQueue>
+bool MultiThreadedWorkQueue<TaskQueue>::IsInWorkerThread() const {
   return non_blocking_work_queue_.IsInWorkerThread();
 }
 
 std::unique_ptr<ConcurrentWorkQueue> CreateMultiThreadedWorkQueue(
     int num_threads, int num_blocking_threads) {
+  return CreateMultiThreadedWorkQueue(num_threads, num_blocking_threads,
+                                      MultiThreadedWorkQueueOptions());
+}
+
+std::unique_ptr<ConcurrentWorkQueue> CreateMultiThreadedWorkQueue(
+    int num_threads, int num_blocking_threads,
+    const MultiThreadedWorkQueueOptions& options) {
   assert(num_threads > 0 && num_blocking_threads > 0);
-  return std::make_unique<MultiThreadedWorkQueue>(num_threads,
-                                                  num_blocking_threads);
+  if (options.request_priorities) {
+    return std::make_unique<
+        MultiThreadedWorkQueue<internal::OverflowTaskPriorityDeque>>(
+        num_threads, num_blocking_threads, options);
+  }
+  return std::make_unique<MultiThreadedWorkQueue<internal::OverflowTaskDeque>>(
+      num_threads, num_blocking_threads, options);
 }
 
 }  // namespace tfrt
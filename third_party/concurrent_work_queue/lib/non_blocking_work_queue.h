@@ -10,11 +10,19 @@
 // Work queue implementation based on non-blocking concurrency primitives
 // optimized for CPU intensive non-blocking compute tasks.
 //
-// This work queue uses TaskDeque for storing pending tasks. Thread tries to
-// pop a task from the front of its own queue, and in a steal loop it tries to
-// steal a task from the back of another thread pending tasks queue. This gives
-// mostly LIFO task execution order, which is optimal for cache locality for
-// compute intensive tasks.
+// This work queue uses OverflowTaskDeque for storing pending tasks. Thread
+// tries to pop a task from the front of its own queue, and in a steal loop it
+// tries to steal a task from the back of another thread pending tasks queue.
+// This gives mostly LIFO task execution order, which is optimal for cache
+// locality for compute intensive tasks.
+//
+// Pending tasks queues are unbounded: when the fixed-size part of a queue is
+// full, tasks are spilled into its overflow deque, instead of being executed
+// in the caller thread (see OverflowTaskDeque).
+//
+// With OverflowTaskPriorityDeque as the pending tasks queue, tasks are added
+// with a TaskPriority, and each thread pops or steals the tasks with the
+// highest priority first.
 //
 // Work stealing algorithm is based on:
 //
@@ -27,27 +35,31 @@
 #include <optional>
 
 #include "llvm/Support/Compiler.h"
-#include "task_deque.h"
+#include "overflow_task_deque.h"
 #include "tfrt/host_context/task_function.h"
 #include "work_queue_base.h"
 
 namespace tfrt {
 namespace internal {
 
-template <typename ThreadingEnvironment>
+template <typename ThreadingEnvironment,
+          typename TaskQueue = ::tfrt::internal::OverflowTaskDeque>
 class NonBlockingWorkQueue;
 
-template <typename ThreadingEnvironmentTy>
-struct WorkQueueTraits<NonBlockingWorkQueue<ThreadingEnvironmentTy>> {
+template <typename ThreadingEnvironmentTy, typename TaskQueue>
+struct WorkQueueTraits<
+    NonBlockingWorkQueue<ThreadingEnvironmentTy, TaskQueue>> {
   using ThreadingEnvironment = ThreadingEnvironmentTy;
   using Thread = typename ThreadingEnvironment::Thread;
-  using Queue = ::tfrt::internal::TaskDeque;
+  using Queue = TaskQueue;
 };
 
-template <typename ThreadingEnvironment>
+template <typename ThreadingEnvironment, typename TaskQueue>
 class NonBlockingWorkQueue
-    : public WorkQueueBase<NonBlockingWorkQueue<ThreadingEnvironment>> {
-  using Base = WorkQueueBase<NonBlockingWorkQueue<ThreadingEnvironment>>;
+    : public WorkQueueBase<
+          NonBlockingWorkQueue<ThreadingEnvironment, TaskQueue>> {
+  using Base =
+      WorkQueueBase<NonBlockingWorkQueue<ThreadingEnvironment, TaskQueue>>;
 
   using Queue = typename Base::Queue;
   using Thread = typename Base::Thread;
@@ -55,12 +67,17 @@ class NonBlockingWorkQueue
   using ThreadData = typename Base::ThreadData;
 
  public:
-  explicit NonBlockingWorkQueue(QuiescingState* quiescing_state,
-                                int num_threads);
+  explicit NonBlockingWorkQueue(
+      QuiescingState* quiescing_state, int num_threads,
+      const WorkerOptions& options = WorkerOptions());
   ~NonBlockingWorkQueue() = default;
 
   void AddTask(TaskFunction task);
 
+  // Adds a task with the given priority. Only supported if the pending tasks
+  // queue is an OverflowTaskPriorityDeque.
+  void AddTask(TaskFunction task, TaskPriority priority);
+
   using Base::Steal;
 
  private:
@@ -69,9 +86,13 @@ class NonBlockingWorkQueue
   template <typename WorkQueue>
   friend class WorkQueueBase;
 
+  using Base::ExternalQueueIndex;
   using Base::GetPerThread;
+  using Base::IsCollectingStats;
   using Base::IsNotifyParkedThreadRequired;
   using Base::IsQuiescing;
+  using Base::NotifyParkedThread;
+  using Base::WithLatencySampling;
   using Base::WithPendingTaskCounter;
 
   using Base::coprimes_;
@@ -82,21 +103,39 @@ class NonBlockingWorkQueue
   [[nodiscard]] std::optional<TaskFunction> NextTask(Queue* queue);
   [[nodiscard]] std::optional<TaskFunction> Steal(Queue* queue);
   [[nodiscard]] bool Empty(Queue* queue);
+
+  template <typename... Priority>
+  void AddTaskImpl(TaskFunction task, Priority... priority);
 };
 
-template <typename ThreadingEnvironment>
-NonBlockingWorkQueue<ThreadingEnvironment>::NonBlockingWorkQueue(
-    QuiescingState* quiescing_state, int num_threads)
+template <typename ThreadingEnvironment, typename TaskQueue>
+NonBlockingWorkQueue<ThreadingEnvironment, TaskQueue>::NonBlockingWorkQueue(
+    QuiescingState* quiescing_state, int num_threads,
+    const WorkerOptions& options)
     : WorkQueueBase<NonBlockingWorkQueue>(quiescing_state, kThreadNamePrefix,
-                                          num_threads) {}
+                                          num_threads, options) {}
+
+template <typename ThreadingEnvironment, typename TaskQueue>
+void NonBlockingWorkQueue<ThreadingEnvironment, TaskQueue>::AddTask(
+    TaskFunction task) {
+  AddTaskImpl(std::move(task));
+}
+
+template <typename ThreadingEnvironment, typename TaskQueue>
+void NonBlockingWorkQueue<ThreadingEnvironment, TaskQueue>::AddTask(
+    TaskFunction task, TaskPriority priority) {
+  AddTaskImpl(std::move(task), priority);
+}
 
-template <typename ThreadingEnvironment>
-void NonBlockingWorkQueue<ThreadingEnvironment>::AddTask(TaskFunction task) {
+template <typename ThreadingEnvironment, typename TaskQueue>
+template <typename... Priority>
+void NonBlockingWorkQueue<ThreadingEnvironment, TaskQueue>::AddTaskImpl(
+    TaskFunction task, Priority... priority) {
   // Keep track of the number of pending tasks.
   if (IsQuiescing()) task = WithPendingTaskCounter(std::move(task));
 
-  // If the worker queue is full, we will execute `task` in the current thread.
-  std::optional<TaskFunction> inline_task;
+  if (LLVM_UNLIKELY(IsCollectingStats()))
+    task = WithLatencySampling(std::move(task));
 
   // If a caller thread is managed by `this` we push the new task into the front
   // of thread own queue (LIFO execution order). PushFront is completely lock
@@ -105,18 +144,19 @@ void NonBlockingWorkQueue<ThreadingEnvironment>::AddTask(TaskFunction task) {
   //
   // If a caller is a free-standing thread (or worker of another pool), we push
   // the new task into a random queue (FIFO execution order). Tasks still could
-  // be executed in LIFO order, if they would be stolen by other workers.
+  // be executed in LIFO order, if they would be stolen by other workers. If
+  // worker threads are pinned to NUMA nodes, the queue is picked from the node
+  // of the caller thread.
 
   PerThread* pt = GetPerThread();
   if (pt->parent == this) {
     // Worker thread of this pool, push onto the thread's queue.
     Queue& q = thread_data_[pt->thread_id].queue;
-    inline_task = q.PushFront(std::move(task));
+    q.PushFront(std::move(task), priority...);
   } else {
     // A free-standing thread (or worker of another pool).
-    unsigned rnd = FastReduce(pt->rng(), num_threads_);
-    Queue& q = thread_data_[rnd].queue;
-    inline_task = q.PushBack(std::move(task));
+    Queue& q = thread_data_[ExternalQueueIndex(pt)].queue;
+    q.PushBack(std::move(task), priority...);
   }
   // Note: below we touch `*this` after making `task` available to worker
   // threads. Strictly speaking, this can lead to a racy-use-after-free.
@@ -126,28 +166,23 @@ void NonBlockingWorkQueue<ThreadingEnvironment>::AddTask(TaskFunction task) {
   // destruction of this. We expect that such a scenario is prevented by the
   // program, that is, this is kept alive while any threads can potentially be
   // in Schedule.
-  if (!inline_task.has_value()) {
-    if (IsNotifyParkedThreadRequired())
-      event_count_.Notify(/*notify_all=*/false);
-  } else {
-    (*inline_task)();  // Push failed, execute directly.
-  }
+  if (IsNotifyParkedThreadRequired()) NotifyParkedThread();
 }
 
-template <typename ThreadingEnvironment>
+template <typename ThreadingEnvironment, typename TaskQueue>
 [[nodiscard]] std::optional<TaskFunction>
-NonBlockingWorkQueue<ThreadingEnvironment>::NextTask(Queue* queue) {
+NonBlockingWorkQueue<ThreadingEnvironment, TaskQueue>::NextTask(Queue* queue) {
   return queue->PopFront();
 }
 
-template <typename ThreadingEnvironment>
+template <typename ThreadingEnvironment, typename TaskQueue>
 [[nodiscard]] std::optional<TaskFunction>
-NonBlockingWorkQueue<ThreadingEnvironment>::Steal(Queue* queue) {
+NonBlockingWorkQueue<ThreadingEnvironment, TaskQueue>::Steal(Queue* queue) {
   return queue->PopBack();
 }
 
-template <typename ThreadingEnvironment>
-[[nodiscard]] bool NonBlockingWorkQueue<ThreadingEnvironment>::Empty(
+template <typename ThreadingEnvironment, typename TaskQueue>
+[[nodiscard]] bool NonBlockingWorkQueue<ThreadingEnvironment, TaskQueue>::Empty(
     Queue* queue) {
   return queue->Empty();
 }
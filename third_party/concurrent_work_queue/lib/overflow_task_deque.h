@@ -0,0 +1,260 @@
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// OverflowTaskDeque is an unbounded deque of Task items, built from a
+// fixed-size TaskDeque and an overflow deque protected by a mutex. Tasks are
+// spilled into the overflow deque only when the TaskDeque is full, so in the
+// common case all operations have the TaskDeque performance characteristics.
+//
+// Operations on front of the queue must be done by a single thread (owner),
+// operations on back of the queue can be done by multiple threads concurrently
+// (see TaskDeque).
+//
+// Spilled tasks are taken from the back of the queue by the stealing threads
+// first, which spreads a burst of tasks submitted by one thread over all the
+// threads of a work queue, and by the owner once its TaskDeque is empty.
+//
+// OverflowTaskPriorityDeque is the same extension of the TaskPriorityDeque,
+// with one overflow deque per priority level. Spilled tasks are taken in the
+// priority order, but only relative to the other spilled tasks.
+
+#ifndef TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_OVERFLOW_TASK_DEQUE_H_
+#define TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_OVERFLOW_TASK_DEQUE_H_
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <utility>
+
+#include "llvm/Support/Compiler.h"
+#include "task_deque.h"
+#include "task_priority_deque.h"
+#include "tfrt/host_context/task_function.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace internal {
+
+class OverflowTaskDeque {
+ public:
+  OverflowTaskDeque() : num_overflow_(0) {}
+  OverflowTaskDeque(const OverflowTaskDeque&) = delete;
+  void operator=(const OverflowTaskDeque&) = delete;
+
+  ~OverflowTaskDeque() { assert(Size() == 0); }
+
+  // PushFront() inserts task at the beginning of the queue. If the TaskDeque
+  // is full, the task is spilled into the front of the overflow deque.
+  void PushFront(TaskFunction task) {
+    std::optional<TaskFunction> overflow = deque_.PushFront(std::move(task));
+    if (LLVM_UNLIKELY(overflow.has_value())) {
+      mutex_lock lock(mutex_);
+      overflow_.push_front(std::move(*overflow));
+      num_overflow_.fetch_add(1, std::memory_order_release);
+    }
+  }
+
+  // PushBack() inserts task at the end of the queue. If the TaskDeque is full,
+  // the task is spilled into the back of the overflow deque.
+  void PushBack(TaskFunction task) {
+    std::optional<TaskFunction> overflow = deque_.PushBack(std::move(task));
+    if (LLVM_UNLIKELY(overflow.has_value())) {
+      mutex_lock lock(mutex_);
+      overflow_.push_back(std::move(*overflow));
+      num_overflow_.fetch_add(1, std::memory_order_release);
+    }
+  }
+
+  // PopFront() removes and returns the first element in the queue. Spilled
+  // tasks are returned only if the TaskDeque is empty.
+  //
+  // If the queue is empty returns empty optional.
+  [[nodiscard]] std::optional<TaskFunction> PopFront() {
+    std::optional<TaskFunction> task = deque_.PopFront();
+    if (task.has_value() || !HasOverflow()) return task;
+    return PopOverflow(/*front=*/true);
+  }
+
+  // PopBack() removes and returns the last element in the queue. Spilled tasks
+  // are returned first.
+  //
+  // If the queue is empty returns empty optional.
+  [[nodiscard]] std::optional<TaskFunction> PopBack() {
+    if (HasOverflow()) {
+      std::optional<TaskFunction> task = PopOverflow(/*front=*/false);
+      if (task.has_value()) return task;
+    }
+    return deque_.PopBack();
+  }
+
+  // Size returns current queue size.
+  // Can be called by any thread at any time.
+  unsigned Size() const {
+    return deque_.Size() + num_overflow_.load(std::memory_order_acquire);
+  }
+
+  // Empty tests whether container is empty.
+  // Can be called by any thread at any time.
+  bool Empty() const { return !HasOverflow() && deque_.Empty(); }
+
+  // Delete all the elements from the queue.
+  void Flush() {
+    deque_.Flush();
+    mutex_lock lock(mutex_);
+    overflow_.clear();
+    num_overflow_.store(0, std::memory_order_release);
+  }
+
+ private:
+  bool HasOverflow() const {
+    return num_overflow_.load(std::memory_order_acquire) != 0;
+  }
+
+  std::optional<TaskFunction> PopOverflow(bool front) {
+    mutex_lock lock(mutex_);
+    if (overflow_.empty()) return std::nullopt;
+
+    TaskFunction task;
+    if (front) {
+      task = std::move(overflow_.front());
+      overflow_.pop_front();
+    } else {
+      task = std::move(overflow_.back());
+      overflow_.pop_back();
+    }
+    num_overflow_.fetch_sub(1, std::memory_order_release);
+    return std::optional<TaskFunction>(std::move(task));
+  }
+
+  TaskDeque deque_;
+
+  mutex mutex_;
+  std::deque<TaskFunction> overflow_ TFRT_GUARDED_BY(mutex_);
+
+  // The number of spilled tasks, so that the emptiness checks do not need to
+  // lock the mutex.
+  alignas(128) std::atomic<unsigned> num_overflow_;
+};
+
+class OverflowTaskPriorityDeque {
+ public:
+  OverflowTaskPriorityDeque() : num_overflow_(0) {}
+  OverflowTaskPriorityDeque(const OverflowTaskPriorityDeque&) = delete;
+  void operator=(const OverflowTaskPriorityDeque&) = delete;
+
+  ~OverflowTaskPriorityDeque() { assert(Size() == 0); }
+
+  // PushFront() inserts task at the beginning of the queue for the specified
+  // priority. If the TaskPriorityDeque is full, the task is spilled into the
+  // front of the overflow deque of the priority.
+  void PushFront(TaskFunction task,
+                 TaskPriority priority = TaskPriority::kDefault) {
+    std::optional<TaskFunction> overflow =
+        deque_.PushFront(std::move(task), priority);
+    if (LLVM_UNLIKELY(overflow.has_value())) {
+      mutex_lock lock(mutex_);
+      overflow_[static_cast<int>(priority)].push_front(std::move(*overflow));
+      num_overflow_.fetch_add(1, std::memory_order_release);
+    }
+  }
+
+  // PushBack() inserts task at the end of the queue for the specified
+  // priority. If the TaskPriorityDeque is full, the task is spilled into the
+  // back of the overflow deque of the priority.
+  void PushBack(TaskFunction task,
+                TaskPriority priority = TaskPriority::kDefault) {
+    std::optional<TaskFunction> overflow =
+        deque_.PushBack(std::move(task), priority);
+    if (LLVM_UNLIKELY(overflow.has_value())) {
+      mutex_lock lock(mutex_);
+      overflow_[static_cast<int>(priority)].push_back(std::move(*overflow));
+      num_overflow_.fetch_add(1, std::memory_order_release);
+    }
+  }
+
+  // PopFront() removes and returns the first element with the highest priority
+  // in the queue. Spilled tasks are returned only if the TaskPriorityDeque is
+  // empty.
+  //
+  // If the queue is empty returns empty optional.
+  [[nodiscard]] std::optional<TaskFunction> PopFront() {
+    std::optional<TaskFunction> task = deque_.PopFront();
+    if (task.has_value() || !HasOverflow()) return task;
+    return PopOverflow(/*front=*/true);
+  }
+
+  // PopBack() removes and returns the last element with the highest priority
+  // in the queue. Spilled tasks are returned first.
+  //
+  // If the queue is empty returns empty optional.
+  [[nodiscard]] std::optional<TaskFunction> PopBack() {
+    if (HasOverflow()) {
+      std::optional<TaskFunction> task = PopOverflow(/*front=*/false);
+      if (task.has_value()) return task;
+    }
+    return deque_.PopBack();
+  }
+
+  // Size returns current queue size (sum of sizes for all priority levels).
+  // Can be called by any thread at any time.
+  uint64_t Size() const {
+    return deque_.Size() + num_overflow_.load(std::memory_order_acquire);
+  }
+
+  // Empty tests whether container is empty.
+  // Can be called by any thread at any time.
+  bool Empty() const { return !HasOverflow() && deque_.Empty(); }
+
+  // Delete all the elements from the queue.
+  void Flush() {
+    deque_.Flush();
+    mutex_lock lock(mutex_);
+    for (auto& overflow : overflow_) overflow.clear();
+    num_overflow_.store(0, std::memory_order_release);
+  }
+
+ private:
+  static constexpr int kNumTaskPriorities = 4;
+
+  bool HasOverflow() const {
+    return num_overflow_.load(std::memory_order_acquire) != 0;
+  }
+
+  std::optional<TaskFunction> PopOverflow(bool front) {
+    mutex_lock lock(mutex_);
+    for (auto& overflow : overflow_) {
+      if (overflow.empty()) continue;
+
+      TaskFunction task;
+      if (front) {
+        task = std::move(overflow.front());
+        overflow.pop_front();
+      } else {
+        task = std::move(overflow.back());
+        overflow.pop_back();
+      }
+      num_overflow_.fetch_sub(1, std::memory_order_release);
+      return std::optional<TaskFunction>(std::move(task));
+    }
+    return std::nullopt;
+  }
+
+  TaskPriorityDeque deque_;
+
+  mutex mutex_;
+  // Overflow deques indexed by the task priority.
+  std::array<std::deque<TaskFunction>, kNumTaskPriorities> overflow_
+      TFRT_GUARDED_BY(mutex_);
+
+  alignas(128) std::atomic<unsigned> num_overflow_;
+};
+
+}  // namespace internal
+}  // namespace tfrt
+
+#endif  // TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_OVERFLOW_TASK_DEQUE_H_
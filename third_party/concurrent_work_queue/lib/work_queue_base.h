@@ -20,13 +20,31 @@
 // new task added to the queue.
 //
 // Before parking on a conditional variable, thread might go into a spin loop
-// (controlled by `kMaxSpinningThreads` constant), and execute steal loop for a
-// fixed number of iterations. This allows to skip expensive park/unpark
-// operations, and reduces latency. Increasing `kMaxSpinningThreads` improves
-// latency at the cost of burned CPU cycles.
+// (controlled by `WorkerOptions::max_spinning_threads`), and execute steal loop
+// for a number of iterations. This allows to skip expensive park/unpark
+// operations, and reduces latency. Increasing `max_spinning_threads` improves
+// latency at the cost of burned CPU cycles. With adaptive spinning, each thread
+// tunes its number of iterations from the recent rate of the spin loops that
+// found a task (see AdaptiveSpinCount).
 //
 // See derived work queue implementation for more details about work stealing.
 //
+// Worker threads can optionally be pinned to NUMA nodes. Threads are split into
+// contiguous groups, one group per node, and each thread first tries to steal
+// from the threads of its own group before stealing from any thread.
+//
+// Worker threads can optionally be pinned to CPUs according to the CPU
+// topology (topology-aware stealing). Threads are assigned to the CPUs in the
+// topology order, so that the threads sharing an L2 cache, an L3 cache or a
+// package are contiguous, and each thread tries to steal from the threads
+// sharing its L2 cache, then from the other threads sharing its L3 cache, then
+// from the other threads of its package, and finally from the remaining
+// threads. Stolen tasks then likely find their data in a shared cache.
+//
+// Worker threads can optionally collect statistics about the scheduling (tasks
+// executed, steals, parking, and the latency from enqueueing a task to its
+// start), exported through tfrt/metrics (see WorkQueueMetrics).
+//
 // -------------------------------------------------------------------------- //
 // Work queue implementations are parametrized by `ThreadingEnvironment` that
 // allows to provide custom thread implementation:
@@ -49,19 +67,27 @@
 #ifndef TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_WORK_QUEUE_BASE_H_
 #define TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_WORK_QUEUE_BASE_H_
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include "event_count.h"
 #include "llvm/Support/Compiler.h"
 #include "task_queue.h"
 #include "tfrt/host_context/task_function.h"
+#include "tfrt/metrics/metrics.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/support/logging.h"
 #include "tfrt/support/mutex.h"
+#include "tfrt/support/numa.h"
 #include "tfrt/support/string_util.h"
 
 namespace tfrt {
@@ -174,6 +200,147 @@ class PendingTask {
   QuiescingState* state_;
 };
 
+//===----------------------------------------------------------------------===//
+// Options of the worker threads of a work queue.
+//===----------------------------------------------------------------------===//
+struct WorkerOptions {
+  // If true, worker threads are pinned to NUMA nodes.
+  bool pin_to_numa_nodes = false;
+
+  // If true, worker threads export their statistics through tfrt/metrics.
+  bool collect_stats = false;
+
+  // The maximum number of threads spinning in the steal loop before parking.
+  int max_spinning_threads = 1;
+
+  // The number of steal loop spin iterations before parking (this number is
+  // divided by the number of threads, to get spin count for each thread).
+  int spin_count = 5000;
+
+  // If true, each thread tunes its spin count from the recent spin hit rate.
+  bool adaptive_spinning = false;
+
+  // If true, worker threads are pinned to CPUs and steal from the threads
+  // closest in the cache hierarchy first. Takes precedence over
+  // `pin_to_numa_nodes`.
+  bool topology_aware_stealing = false;
+};
+
+//===----------------------------------------------------------------------===//
+// The number of steal loop spin iterations of a worker thread before parking.
+//
+// With adaptive spinning, the spin count moves between 1/16 and 4 times the
+// configured spin count, proportionally to the hit rate of the recent spin
+// loops (the rate of the spin loops that found a task before the end). Bursty
+// workloads, where new tasks arrive shortly after a thread runs out of work,
+// get long spin loops that skip the park/unpark latency, and workloads with
+// long idle periods do not waste CPU cycles spinning.
+//===----------------------------------------------------------------------===//
+class AdaptiveSpinCount {
+ public:
+  AdaptiveSpinCount(int spin_count, bool adaptive)
+      : adaptive_(adaptive),
+        min_spin_count_(spin_count / 16),
+        max_spin_count_(spin_count * 4),
+        spin_count_(spin_count) {
+    // Start from the configured spin count.
+    if (max_spin_count_ > min_spin_count_) {
+      hit_rate_ = (spin_count - min_spin_count_) * kOne /
+                  (max_spin_count_ - min_spin_count_);
+    }
+  }
+
+  int Get() const { return spin_count_; }
+
+  // Records whether a spin loop found a task.
+  void Record(bool hit) {
+    if (!adaptive_) return;
+    // Exponential moving average with a weight of 1/8 for the last spin loop.
+    hit_rate_ += ((hit ? kOne : 0) - hit_rate_) / 8;
+    spin_count_ = min_spin_count_ +
+                  (max_spin_count_ - min_spin_count_) * hit_rate_ / kOne;
+  }
+
+ private:
+  // The hit rate is a fixed point number in [0, kOne].
+  static constexpr int64_t kOne = 1024;
+
+  const bool adaptive_;
+  const int64_t min_spin_count_;
+  const int64_t max_spin_count_;
+  int64_t hit_rate_ = 0;
+  int64_t spin_count_;
+};
+
+//===----------------------------------------------------------------------===//
+// Metrics exported by a work queue that collects statistics. The metrics are
+// named "/tensorflow/runtime/work_queue/<thread name prefix>/<metric>".
+//===----------------------------------------------------------------------===//
+struct WorkQueueMetrics {
+  WorkQueueMetrics(string_view name_prefix, int num_threads) {
+    std::string prefix =
+        StrCat("/tensorflow/runtime/work_queue/", name_prefix, "/");
+    tasks_executed = metrics::NewCounter(prefix + "tasks_executed");
+    steals = metrics::NewCounter(prefix + "steals");
+    failed_steals = metrics::NewCounter(prefix + "failed_steals");
+    parks = metrics::NewCounter(prefix + "parks");
+    unparks = metrics::NewCounter(prefix + "unparks");
+    parked_time_ns = metrics::NewCounter(prefix + "parked_time_ns");
+    for (int i = 0; i < num_threads; ++i) {
+      queue_depth.push_back(
+          metrics::NewGauge<int64_t>(StrCat(prefix, "queue_depth/", i)));
+    }
+
+    // Exponential buckets from 1us to ~1s.
+    std::vector<double> bounds;
+    for (double bound = 1; bound < 2e6; bound *= 2) bounds.push_back(bound);
+    task_latency_us = metrics::NewHistogram(
+        prefix + "task_latency_us", metrics::Buckets::Explicit(bounds));
+  }
+
+  // Tasks executed by the worker threads.
+  metrics::Counter* tasks_executed;
+  // Successful and failed attempts of the worker threads to steal a task from
+  // any other worker thread.
+  metrics::Counter* steals;
+  metrics::Counter* failed_steals;
+  // Worker threads parked because they ran out of work, and notifications for
+  // newly added tasks that unparked a parked thread.
+  metrics::Counter* parks;
+  metrics::Counter* unparks;
+  // Total time spent by the worker threads in the parked state.
+  metrics::Counter* parked_time_ns;
+  // The number of pending tasks in the queue of each worker thread, sampled by
+  // the worker thread every kQueueDepthSamplePeriod tasks and before parking.
+  std::vector<metrics::Gauge<int64_t>*> queue_depth;
+  // The latency from adding a task to the start of its execution, for a
+  // sample of the tasks.
+  metrics::Histogram* task_latency_us;
+};
+
+// Statistics accumulated by a worker thread, exported to the metrics when the
+// thread parks, exits, or after every kExportPeriod tasks, so that recording
+// does not touch shared memory.
+struct WorkerStats {
+  static constexpr int64_t kExportPeriod = 1024;
+  static constexpr int64_t kQueueDepthSamplePeriod = 64;
+
+  void Export(const WorkQueueMetrics& metrics) {
+    if (tasks_executed) metrics.tasks_executed->IncrementBy(tasks_executed);
+    if (steals) metrics.steals->IncrementBy(steals);
+    if (failed_steals) metrics.failed_steals->IncrementBy(failed_steals);
+    if (parks) metrics.parks->IncrementBy(parks);
+    if (parked_time_ns) metrics.parked_time_ns->IncrementBy(parked_time_ns);
+    *this = WorkerStats();
+  }
+
+  int64_t tasks_executed = 0;
+  int64_t steals = 0;
+  int64_t failed_steals = 0;
+  int64_t parks = 0;
+  int64_t parked_time_ns = 0;
+};
+
 //===----------------------------------------------------------------------===//
 // Work queue base class (derived by non-blocking and blocking work queues).
 //===----------------------------------------------------------------------===//
@@ -228,6 +395,15 @@ class WorkQueueBase {
   // yet unparked and running. For strong guarantee must use use Quiesce.
   bool AllBlocked() const { return NumBlockedThreads() == num_threads_; }
 
+  // Returns the number of worker threads that are parked, or spinning without
+  // a task submitted for them. Like AllBlocked(), this is only a hint.
+  int NumIdleThreads() const {
+    SpinningState state = SpinningState::Decode(
+        spinning_state_.load(std::memory_order_relaxed));
+    return static_cast<int>(NumBlockedThreads() + state.num_spinning -
+                            state.num_no_notification);
+  }
+
   // CheckCallerThread() will abort the program or issue warning message if the
   // caller thread is managed by `*this`. This is required to prevent deadlocks
   // from calling `Quiesce` from a thread managed by the current worker queue.
@@ -246,7 +422,7 @@ class WorkQueueBase {
   template <typename ThreadingEnvironment>
   friend class BlockingWorkQueue;
 
-  template <typename ThreadingEnvironment>
+  template <typename ThreadingEnvironment, typename TaskQueue>
   friend class NonBlockingWorkQueue;
 
   struct PerThread {
@@ -271,13 +447,28 @@ class WorkQueueBase {
         });
   }
 
-  // TODO(ezhulenev): Make this a runtime parameter? More spinning threads help
-  // to reduce latency at the cost of wasted CPU cycles.
-  static constexpr int kMaxSpinningThreads = 1;
-
-  // The number of steal loop spin iterations before parking (this number is
-  // divided by the number of threads, to get spin count for each thread).
-  static constexpr int kSpinCount = 5000;
+  // One in kLatencySamplePeriod tasks added by a thread records its latency
+  // from enqueueing to start, if the statistics collection is enabled.
+  static constexpr int kLatencySamplePeriod = 64;
+
+  bool IsCollectingStats() const { return metrics_ != nullptr; }
+
+  // Returns `task`, or a TaskFunction that records the latency of `task` if it
+  // is sampled. Must only be called if the statistics collection is enabled.
+  TaskFunction WithLatencySampling(TaskFunction task) {
+    static thread_local int countdown = 0;
+    if (--countdown > 0) return task;
+    countdown = kLatencySamplePeriod;
+
+    return TaskFunction([task = std::move(task),
+                         histogram = metrics_->task_latency_us,
+                         start = std::chrono::steady_clock::now()]() mutable {
+      histogram->Record(std::chrono::duration<double, std::micro>(
+                            std::chrono::steady_clock::now() - start)
+                            .count());
+      task();
+    });
+  }
 
   // If there are enough active threads with an empty pending task queues, there
   // is no need for spinning before parking a thread that is out of work to do,
@@ -290,17 +481,25 @@ class WorkQueueBase {
   static constexpr int kMinActiveThreadsToStartSpinning = 4;
 
   explicit WorkQueueBase(QuiescingState* quiescing_state,
-                         string_view name_prefix, int num_threads);
+                         string_view name_prefix, int num_threads,
+                         const WorkerOptions& options = WorkerOptions());
   ~WorkQueueBase();
 
+  // Returns a random worker thread index for a task submitted by a thread not
+  // managed by `this`. If worker threads are pinned to NUMA nodes, the worker
+  // is picked from the node of the caller thread.
+  [[nodiscard]] unsigned ExternalQueueIndex(PerThread* pt);
+
   // Main worker thread loop.
   void WorkerLoop(int thread_id);
 
   // WaitForWork() blocks until new work is available (returns true), or if it
   // is time to exit (returns false). Can optionally return a task to execute in
-  // `task` (in such case `task.has_value() == true` on return).
+  // `task` (in such case `task.has_value() == true` on return). Records the
+  // steals and parking into `stats` if it is not null.
   [[nodiscard]] bool WaitForWork(EventCount::Waiter* waiter,
-                                 std::optional<TaskFunction>* task);
+                                 std::optional<TaskFunction>* task,
+                                 WorkerStats* stats);
 
   // StartSpinning() checks if the number of threads in the spin loop is less
   // than the allowed maximum, if so increments the number of spinning threads
@@ -323,6 +522,13 @@ class WorkQueueBase {
 
   void Notify() { event_count_.Notify(false); }
 
+  // Notifies a parked thread about a new task.
+  void NotifyParkedThread() {
+    bool unparked = event_count_.Notify(/*notify_all=*/false);
+    if (LLVM_UNLIKELY(IsCollectingStats()) && unparked)
+      metrics_->unparks->Increment();
+  }
+
   // Returns current thread id if the caller thread is managed by `this`,
   // returns `-1` otherwise.
   int CurrentThreadId() const;
@@ -341,10 +547,43 @@ class WorkQueueBase {
   unsigned NumActiveThreads() const { return num_threads_ - blocked_.load(); }
 
   const int num_threads_;
+  const WorkerOptions options_;
 
   std::vector<ThreadData> thread_data_;
   std::vector<unsigned> coprimes_;
 
+  // NUMA node index of each worker thread, and the [begin, end) range of the
+  // worker threads pinned to each node. Both are empty if worker threads are
+  // not pinned to NUMA nodes.
+  std::vector<int> thread_numa_node_;
+  std::vector<std::pair<unsigned, unsigned>> numa_node_threads_;
+
+  // With topology-aware stealing, the CPU of each worker thread, and the
+  // [begin, end) ranges of the worker threads sharing its L2 cache, L3 cache
+  // and package, followed by the range of all threads. Each range contains the
+  // previous one. Both are empty otherwise.
+  static constexpr int kNumTopologyLevels = 4;
+  using StealRanges =
+      std::array<std::pair<unsigned, unsigned>, kNumTopologyLevels>;
+  std::vector<int> thread_cpu_;
+  std::vector<StealRanges> thread_steal_ranges_;
+
+  // Assign the worker threads to CPUs, and compute their steal ranges.
+  void InitTopologyAwareStealing();
+
+  // Tries to steal a task from the threads in [begin, end) that are not in
+  // [skip_begin, skip_end), starting at a random thread. The skipped range must
+  // be empty or within [begin, end).
+  [[nodiscard]] std::optional<TaskFunction> StealFromRing(
+      unsigned begin, unsigned end, unsigned skip_begin, unsigned skip_end,
+      unsigned r);
+
+  // Tries to steal a task from the threads in [begin, end), starting at a
+  // random thread.
+  [[nodiscard]] std::optional<TaskFunction> StealFromRange(unsigned begin,
+                                                           unsigned end,
+                                                           unsigned r);
+
   std::atomic<unsigned> blocked_;
   std::atomic<bool> done_;
   std::atomic<bool> cancelled_;
@@ -399,6 +638,9 @@ class WorkQueueBase {
 
   EventCount event_count_;
   Derived& derived_;
+
+  // Null if the statistics collection is disabled.
+  std::unique_ptr<WorkQueueMetrics> metrics_;
 };
 
 // Calculate coprimes of all numbers [1, n].
@@ -427,8 +669,10 @@ inline std::vector<unsigned> ComputeCoprimes(int n) {
 
 template <typename Derived>
 WorkQueueBase<Derived>::WorkQueueBase(QuiescingState* quiescing_state,
-                                      string_view name_prefix, int num_threads)
+                                      string_view name_prefix, int num_threads,
+                                      const WorkerOptions& options)
     : num_threads_(num_threads),
+      options_(options),
       thread_data_(num_threads),
       coprimes_(ComputeCoprimes(num_threads)),
       blocked_(0),
@@ -439,12 +683,73 @@ WorkQueueBase<Derived>::WorkQueueBase(QuiescingState* quiescing_state,
       event_count_(num_threads),
       derived_(static_cast<Derived&>(*this)) {
   assert(num_threads >= 1);
+  assert(options.max_spinning_threads >= 0 && options.spin_count >= 0);
+
+  if (options.collect_stats)
+    metrics_ = std::make_unique<WorkQueueMetrics>(name_prefix, num_threads);
+
+  // Split worker threads into contiguous groups of (almost) the same size, one
+  // group per NUMA node.
+  const int num_numa_nodes = std::min(GetNumNumaNodes(), num_threads);
+  if (options.topology_aware_stealing) {
+    InitTopologyAwareStealing();
+  } else if (options.pin_to_numa_nodes && num_numa_nodes > 1) {
+    thread_numa_node_.resize(num_threads);
+    numa_node_threads_.resize(num_numa_nodes);
+    for (int node = 0; node < num_numa_nodes; ++node) {
+      unsigned begin = node * num_threads / num_numa_nodes;
+      unsigned end = (node + 1) * num_threads / num_numa_nodes;
+      numa_node_threads_[node] = {begin, end};
+      for (unsigned i = begin; i < end; ++i) thread_numa_node_[i] = node;
+    }
+  }
+
   for (int i = 0; i < num_threads; i++) {
     thread_data_[i].thread = ThreadingEnvironment::StartThread(
         name_prefix, [this, i]() { WorkerLoop(i); });
   }
 }
 
+template <typename Derived>
+void WorkQueueBase<Derived>::InitTopologyAwareStealing() {
+  llvm::ArrayRef<CpuTopology> cpus = GetCpuTopology();
+  if (cpus.size() <= 1) return;
+
+  // Threads are spread evenly over all CPUs, so that fewer threads than CPUs
+  // use as many caches as possible. The CPUs of the threads are in the
+  // topology order, so the threads sharing a cache are contiguous.
+  const size_t num_cpus = cpus.size();
+  std::vector<const CpuTopology*> thread_topology(num_threads_);
+  for (int i = 0; i < num_threads_; ++i)
+    thread_topology[i] = &cpus[i * num_cpus / num_threads_];
+
+  // Returns the id of the level of the topology shared by the threads. All
+  // threads share the last level.
+  auto level_id = [&](unsigned thread, int level) {
+    const CpuTopology* cpu = thread_topology[thread];
+    if (level == 0) return cpu->l2_id;
+    if (level == 1) return cpu->l3_id;
+    if (level == 2) return cpu->package_id;
+    return 0;
+  };
+
+  thread_cpu_.resize(num_threads_);
+  thread_steal_ranges_.resize(num_threads_);
+  for (int i = 0; i < num_threads_; ++i) {
+    thread_cpu_[i] = thread_topology[i]->cpu;
+    for (int level = 0; level < kNumTopologyLevels; ++level) {
+      const int id = level_id(i, level);
+      unsigned begin = i;
+      unsigned end = i + 1;
+      while (begin > 0 && level_id(begin - 1, level) == id) --begin;
+      while (end < static_cast<unsigned>(num_threads_) &&
+             level_id(end, level) == id)
+        ++end;
+      thread_steal_ranges_[i][level] = {begin, end};
+    }
+  }
+}
+
 template <typename Derived>
 WorkQueueBase<Derived>::~WorkQueueBase() {
   done_ = true;
@@ -514,6 +819,32 @@ template <typename Derived>
 [[nodiscard]] std::optional<TaskFunction> WorkQueueBase<Derived>::Steal() {
   PerThread* pt = GetPerThread();
   unsigned r = pt->rng();
+
+  // With topology-aware stealing, worker threads steal from the threads
+  // sharing a cache with them, from the closest to the farthest. Each level
+  // only visits the threads that the previous levels did not.
+  if (!thread_steal_ranges_.empty() && pt->parent == &derived_) {
+    unsigned skip_begin = pt->thread_id;
+    unsigned skip_end = pt->thread_id;
+    for (auto [begin, end] : thread_steal_ranges_[pt->thread_id]) {
+      if (end - begin == skip_end - skip_begin) continue;
+      std::optional<TaskFunction> t =
+          StealFromRing(begin, end, skip_begin, skip_end, r);
+      if (t.has_value()) return t;
+      skip_begin = begin;
+      skip_end = end;
+    }
+    return std::nullopt;
+  }
+
+  // Worker threads pinned to a NUMA node first try to steal from the threads
+  // of the same node, as their tasks are more likely to use node local memory.
+  if (!numa_node_threads_.empty() && pt->parent == &derived_) {
+    auto [begin, end] = numa_node_threads_[thread_numa_node_[pt->thread_id]];
+    std::optional<TaskFunction> t = StealFromRange(begin, end, r);
+    if (t.has_value()) return t;
+  }
+
   unsigned victim = FastReduce(r, num_threads_);
   unsigned inc = coprimes_[FastReduce(r, coprimes_.size())];
 
@@ -530,6 +861,40 @@ template <typename Derived>
   return std::nullopt;
 }
 
+template <typename Derived>
+std::optional<TaskFunction> WorkQueueBase<Derived>::StealFromRing(
+    unsigned begin, unsigned end, unsigned skip_begin, unsigned skip_end,
+    unsigned r) {
+  // Threads are indexed in the ring without the skipped range.
+  unsigned size = (end - begin) - (skip_end - skip_begin);
+  unsigned victim = FastReduce(r, size);
+  for (unsigned i = 0; i < size; i++) {
+    unsigned thread = begin + victim;
+    if (thread >= skip_begin) thread += skip_end - skip_begin;
+    std::optional<TaskFunction> t =
+        derived_.Steal(&(thread_data_[thread].queue));
+    if (t.has_value()) return t;
+
+    if (++victim == size) victim = 0;
+  }
+  return std::nullopt;
+}
+
+template <typename Derived>
+std::optional<TaskFunction> WorkQueueBase<Derived>::StealFromRange(
+    unsigned begin, unsigned end, unsigned r) {
+  unsigned size = end - begin;
+  unsigned victim = FastReduce(r, size);
+  for (unsigned i = 0; i < size; i++) {
+    std::optional<TaskFunction> t =
+        derived_.Steal(&(thread_data_[begin + victim].queue));
+    if (t.has_value()) return t;
+
+    if (++victim == size) victim = 0;
+  }
+  return std::nullopt;
+}
+
 template <typename Derived>
 void WorkQueueBase<Derived>::WorkerLoop(int thread_id) {
   PerThread* pt = GetPerThread();
@@ -537,6 +902,13 @@ void WorkQueueBase<Derived>::WorkerLoop(int thread_id) {
   pt->rng = FastRng(ThreadingEnvironment::ThisThreadIdHash());
   pt->thread_id = thread_id;
 
+  if (!thread_numa_node_.empty()) {
+    PinCurrentThreadToNumaNode(thread_numa_node_[thread_id]);
+  }
+  if (!thread_cpu_.empty()) {
+    PinCurrentThreadToCpu(thread_cpu_[thread_id]);
+  }
+
   Queue* q = &(thread_data_[thread_id].queue);
   EventCount::Waiter* waiter = event_count_.waiter(thread_id);
 
@@ -544,19 +916,39 @@ void WorkQueueBase<Derived>::WorkerLoop(int thread_id) {
   // proportional to num_threads_ and we assume that new work is scheduled at
   // a constant rate, so we set spin_count to 5000 / num_threads_. The
   // constant was picked based on a fair dice roll, tune it.
-  const int spin_count = num_threads_ > 0 ? kSpinCount / num_threads_ : 0;
+  AdaptiveSpinCount spin_count(
+      num_threads_ > 0 ? options_.spin_count / num_threads_ : 0,
+      options_.adaptive_spinning);
+
+  WorkerStats worker_stats;
+  WorkerStats* stats = IsCollectingStats() ? &worker_stats : nullptr;
+
+  // Steal() that records the steal attempt.
+  auto steal = [&]() {
+    std::optional<TaskFunction> t = Steal();
+    if (LLVM_UNLIKELY(stats != nullptr))
+      ++(t.has_value() ? stats->steals : stats->failed_steals);
+    return t;
+  };
+
+  // Records the number of pending tasks in the queue of this thread.
+  auto sample_queue_depth = [&]() {
+    metrics_->queue_depth[thread_id]->Set(q->Size());
+  };
 
   while (!cancelled_) {
     std::optional<TaskFunction> t = derived_.NextTask(q);
     if (!t.has_value()) {
-      t = Steal();
+      t = steal();
       if (!t.has_value()) {
         // Maybe leave thread spinning. This reduces latency.
         const bool start_spinning = StartSpinning();
         if (start_spinning) {
-          for (int i = 0; i < spin_count && !t.has_value(); ++i) {
-            t = Steal();
+          const int max_spins = spin_count.Get();
+          for (int i = 0; i < max_spins && !t.has_value(); ++i) {
+            t = steal();
           }
+          spin_count.Record(t.has_value());
 
           const bool stopped_spinning = StopSpinning();
           // If a task was submitted to the queue without a call to
@@ -565,12 +957,14 @@ void WorkQueueBase<Derived>::WorkerLoop(int thread_id) {
           // be executed. We will not necessarily find it, because it might have
           // been already stolen by some other thread.
           if (stopped_spinning && !t.has_value()) {
-            t = Steal();
+            t = steal();
           }
         }
 
         if (!t.has_value()) {
-          if (!WaitForWork(waiter, &t)) {
+          if (stats != nullptr) sample_queue_depth();
+          if (!WaitForWork(waiter, &t, stats)) {
+            if (stats != nullptr) stats->Export(*metrics_);
             return;
           }
           if (!t.has_value()) {
@@ -586,12 +980,23 @@ void WorkQueueBase<Derived>::WorkerLoop(int thread_id) {
     //         returns a new enqueued task.
     assert(t.has_value());
     (*t)();  // Execute a task.
+
+    if (LLVM_UNLIKELY(stats != nullptr)) {
+      ++stats->tasks_executed;
+      if (stats->tasks_executed % WorkerStats::kQueueDepthSamplePeriod == 0)
+        sample_queue_depth();
+      if (stats->tasks_executed >= WorkerStats::kExportPeriod)
+        stats->Export(*metrics_);
+    }
   }
+
+  if (stats != nullptr) stats->Export(*metrics_);
 }
 
 template <typename Derived>
 bool WorkQueueBase<Derived>::WaitForWork(EventCount::Waiter* waiter,
-                                         std::optional<TaskFunction>* task) {
+                                         std::optional<TaskFunction>* task,
+                                         WorkerStats* stats) {
   assert(!task->has_value());
   // We already did best-effort emptiness check in Steal, so prepare for
   // blocking.
@@ -604,6 +1009,8 @@ bool WorkQueueBase<Derived>::WaitForWork(EventCount::Waiter* waiter,
       return false;
     } else {
       *task = derived_.Steal(&(thread_data_[victim].queue));
+      if (stats != nullptr)
+        ++(task->has_value() ? stats->steals : stats->failed_steals);
       return true;
     }
   }
@@ -641,7 +1048,21 @@ bool WorkQueueBase<Derived>::WaitForWork(EventCount::Waiter* waiter,
     return false;
   }
 
-  event_count_.CommitWait(waiter);
+  if (stats != nullptr) {
+    // Export the statistics before parking, so that the metrics are up to date
+    // while the thread is idle.
+    ++stats->parks;
+    stats->Export(*metrics_);
+
+    auto start = std::chrono::steady_clock::now();
+    event_count_.CommitWait(waiter);
+    auto parked_time = std::chrono::steady_clock::now() - start;
+    stats->parked_time_ns +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(parked_time)
+            .count();
+  } else {
+    event_count_.CommitWait(waiter);
+  }
   blocked_.fetch_sub(1);
   return true;
 }
@@ -654,7 +1075,8 @@ bool WorkQueueBase<Derived>::StartSpinning() {
   for (;;) {
     SpinningState state = SpinningState::Decode(spinning);
 
-    if ((state.num_spinning - state.num_no_notification) >= kMaxSpinningThreads)
+    if ((state.num_spinning - state.num_no_notification) >=
+        static_cast<uint64_t>(options_.max_spinning_threads))
       return false;
 
     // Increment the number of spinning threads.
@@ -726,6 +1148,18 @@ int WorkQueueBase<Derived>::NonEmptyQueueIndex() {
   return -1;
 }
 
+template <typename Derived>
+unsigned WorkQueueBase<Derived>::ExternalQueueIndex(PerThread* pt) {
+  if (!numa_node_threads_.empty()) {
+    int node = GetCurrentNumaNode();
+    if (node < static_cast<int>(numa_node_threads_.size())) {
+      auto [begin, end] = numa_node_threads_[node];
+      return begin + FastReduce(pt->rng(), end - begin);
+    }
+  }
+  return FastReduce(pt->rng(), num_threads_);
+}
+
 template <typename Derived>
 int WorkQueueBase<Derived>::CurrentThreadId() const {
   const PerThread* pt = GetPerThread();
@@ -21,6 +21,8 @@
 #include <string>
 
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/bef_executor/kernel_profiler.h"
 #include "tfrt/bef_executor_driver/bef_executor_driver.h"
 #include "tfrt/host_context/host_allocator.h"
 #include "tfrt/tracing/tracing.h"
@@ -83,6 +85,13 @@ static llvm::cl::opt<bool> cl_print_error_code(  // NOLINT
     llvm::cl::desc("Print error code if there's any error."),
     llvm::cl::Optional, llvm::cl::ValueDisallowed);
 
+// Write the wall times of the executed kernels to a file.
+static llvm::cl::opt<std::string> cl_kernel_profile(  // NOLINT
+    "kernel_profile",
+    llvm::cl::desc("Write the kernel profile to the specified file, which can "
+                   "be used by the tfrt-apply-cost-profile pass."),
+    llvm::cl::init(""));
+
 //===----------------------------------------------------------------------===//
 // Driver main
 //===----------------------------------------------------------------------===//
@@ -104,5 +113,16 @@ int main(int argc, char** argv) {
   if (cl_enable_tracing) tracing.emplace();
   tfrt::tracing::SetTracingLevel(cl_tracing_level);
 
-  return RunBefExecutor(run_config);
+  if (cl_kernel_profile.empty()) return RunBefExecutor(run_config);
+
+  tfrt::KernelProfiler kernel_profiler;
+  tfrt::SetKernelProfiler(&kernel_profiler);
+  int exit_code = RunBefExecutor(run_config);
+  tfrt::SetKernelProfiler(nullptr);
+
+  if (auto error = kernel_profiler.WriteProfile(cl_kernel_profile)) {
+    llvm::errs() << error << "\n";
+    return 1;
+  }
+  return exit_code;
 }
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2022 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- Trace Converter ----------------------------------------------------===//
+//
+// This file converts a binary trace file written by the ring buffer tracing
+// sink to the Chrome trace event format, which can be loaded in
+// chrome://tracing or Perfetto.
+
+#include <memory>
+#include <string>
+#include <system_error>
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/tracing/trace_file.h"
+
+namespace {
+
+llvm::cl::opt<std::string> cl_input_filename(  // NOLINT
+    llvm::cl::Positional, llvm::cl::desc("<input file>"), llvm::cl::Required);
+
+llvm::cl::opt<std::string> cl_output_filename(  // NOLINT
+    "o", llvm::cl::desc("Output filename"), llvm::cl::value_desc("filename"),
+    llvm::cl::init("-"));
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  llvm::cl::ParseCommandLineOptions(argc, argv, "TFRT trace converter\n");
+
+  auto buffer = llvm::MemoryBuffer::getFileOrSTDIN(cl_input_filename);
+  if (std::error_code error = buffer.getError()) {
+    llvm::errs() << "Cannot open " << cl_input_filename << ": "
+                 << error.message() << "\n";
+    return 1;
+  }
+
+  auto trace = tfrt::tracing::ReadTraceFile((*buffer)->getBuffer());
+  if (!trace) {
+    llvm::errs() << trace.takeError() << "\n";
+    return 1;
+  }
+
+  std::error_code error;
+  llvm::raw_fd_ostream os(cl_output_filename, error);
+  if (error) {
+    llvm::errs() << "Cannot open " << cl_output_filename << ": "
+                 << error.message() << "\n";
+    return 1;
+  }
+  tfrt::tracing::WriteChromeTraceJson(*trace, os);
+  return 0;
+}